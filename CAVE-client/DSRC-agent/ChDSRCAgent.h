@@ -36,7 +36,7 @@
 
 #include "chrono_models/vehicle/hmmwv/HMMWV.h"
 #include <boost/asio.hpp>
-#include "ChSafeQueue.h"
+#include "ChRingQueue.h"
 
 using namespace chrono;
 using namespace chrono::vehicle;
@@ -52,7 +52,7 @@ public:
 private:
     ChWheeledVehicle* vehicle;
     int m_vehicleNumber;
-    ChSafeQueue<std::shared_ptr<boost::asio::streambuf>> incomingMessages;
+    ChRingQueue<std::shared_ptr<boost::asio::streambuf>> incomingMessages;
 
     bool canReach(ChDSRCAgent *vehicle);
 };
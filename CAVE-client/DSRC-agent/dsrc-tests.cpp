@@ -18,7 +18,7 @@
 
 #include <iostream>
 #include "ChDSRCAgent.h"
-#include "ChSafeQueue.h"
+#include "ChRingQueue.h"
 
 #include "chrono/core/ChFileutils.h"
 #include "chrono/core/ChStream.h"
@@ -20,6 +20,7 @@
 #define MESSAGECONVERSIONS_H
 
 #include "ChronoMessages.pb.h"
+#include "WheelKinematics.h"
 #include "chrono/physics/ChSystem.h"
 #include "chrono_models/vehicle/hmmwv/HMMWV.h"
 
@@ -27,9 +28,20 @@ using namespace chrono;
 using namespace chrono::vehicle;
 
 ChronoMessages::VehicleMessage generateVehicleMessageFromWheeledVehicle(ChWheeledVehicle* vehicle, int connectionNumber, int idNumber);
+// Same state with its wheels reduced against geometry, which must be that of
+// the same vehicle model.
+ChronoMessages::ReducedVehicleMessage generateReducedVehicleMessageFromWheeledVehicle(ChWheeledVehicle* vehicle,
+                                                                                      const vehicleGeometry& geometry,
+                                                                                      int connectionNumber, int idNumber);
+// Wheel hardpoints of vehicle, a VEHICLE_MODEL_* model, as it is now, so taken
+// right after it is initialized.
+vehicleGeometry vehicleGeometryFromWheeledVehicle(ChWheeledVehicle* vehicle, uint32_t model);
 void messageFromVector(ChronoMessages::MVector* message,
                        ChVector<> vector);
 void messageFromQuaternion(ChronoMessages::MQuaternion* message,
                            ChQuaternion<> quaternion);
+// Fills message's wheel arrays with every wheel of vehicle, however many
+// axles it has.
+void messageFromWheels(ChronoMessages::VehicleMessage* message, ChWheeledVehicle* vehicle);
 
 #endif
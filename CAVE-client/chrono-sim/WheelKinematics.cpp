@@ -0,0 +1,196 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of the wheel state reduction. Kept free of Chrono, so it
+//  depends on nothing but the messages.
+//
+// =============================================================================
+
+#include "WheelKinematics.h"
+#include "VehicleWheels.h"
+#include <algorithm>
+#include <cmath>
+
+struct vector3 {
+    double x, y, z;
+};
+
+struct quaternion {
+    double e0, e1, e2, e3;
+};
+
+static vector3 toVector(const ChronoMessages::MVector& message) {
+    return vector3{message.x(), message.y(), message.z()};
+}
+
+static quaternion toQuaternion(const ChronoMessages::MQuaternion& message) {
+    return quaternion{message.e0(), message.e1(), message.e2(), message.e3()};
+}
+
+static quaternion multiply(const quaternion& a, const quaternion& b) {
+    return quaternion{a.e0 * b.e0 - a.e1 * b.e1 - a.e2 * b.e2 - a.e3 * b.e3,
+                      a.e0 * b.e1 + a.e1 * b.e0 + a.e2 * b.e3 - a.e3 * b.e2,
+                      a.e0 * b.e2 - a.e1 * b.e3 + a.e2 * b.e0 + a.e3 * b.e1,
+                      a.e0 * b.e3 + a.e1 * b.e2 - a.e2 * b.e1 + a.e3 * b.e0};
+}
+
+static quaternion conjugate(const quaternion& q) {
+    return quaternion{q.e0, -q.e1, -q.e2, -q.e3};
+}
+
+// Rotates v by the unit quaternion q
+static vector3 rotate(const quaternion& q, const vector3& v) {
+    quaternion rotated = multiply(multiply(q, quaternion{0, v.x, v.y, v.z}), conjugate(q));
+    return vector3{rotated.e1, rotated.e2, rotated.e3};
+}
+
+vehicleGeometry geometryFromVehicleMessage(const ChronoMessages::VehicleMessage& message, uint32_t model) {
+    vehicleGeometry geometry;
+    geometry.model = model;
+    vector3 chassis = toVector(message.chassiscom());
+    quaternion inverse = conjugate(toQuaternion(message.chassisrot()));
+    int wheels = std::max(wheelCount(message), 0);
+    const double* positions = message.wheelpositions().data();
+    for (int wheel = 0; wheel < wheels; wheel++) {
+        const double* p = positions + WHEEL_POSITION_VALUES * wheel;
+        vector3 position = {p[0], p[1], p[2]};
+        vector3 local = rotate(inverse, vector3{position.x - chassis.x, position.y - chassis.y, position.z - chassis.z});
+        ChronoMessages::MVector hardpoint;
+        hardpoint.set_x(local.x);
+        hardpoint.set_y(local.y);
+        hardpoint.set_z(local.z);
+        geometry.hardpoints.push_back(hardpoint);
+    }
+    return geometry;
+}
+
+void reduceWheel(const ChronoMessages::MVector& chassisPosition, const ChronoMessages::MQuaternion& chassisRotation,
+                 const ChronoMessages::MVector& hardpoint, const ChronoMessages::MVector& position,
+                 const ChronoMessages::MQuaternion& rotation, double& spin, double& steer, double& travel) {
+    quaternion inverse = conjugate(toQuaternion(chassisRotation));
+    vector3 offset = {position.x() - chassisPosition.x(), position.y() - chassisPosition.y(),
+                      position.z() - chassisPosition.z()};
+    travel = rotate(inverse, offset).z - hardpoint.z();
+
+    // The wheel's rotation on the chassis is steer about z, then spin about
+    // the steered y. Steer turns the axle, y, within the chassis's xy plane,
+    // and spin then tips x out of it.
+    quaternion local = multiply(inverse, toQuaternion(rotation));
+    vector3 axle = rotate(local, vector3{0, 1, 0});
+    vector3 forward = rotate(local, vector3{1, 0, 0});
+    steer = std::atan2(-axle.x, axle.y);
+    spin = std::atan2(-forward.z, std::cos(steer) * forward.x + std::sin(steer) * forward.y);
+}
+
+void rebuildWheel(const ChronoMessages::MVector& chassisPosition, const ChronoMessages::MQuaternion& chassisRotation,
+                  const ChronoMessages::MVector& hardpoint, double spin, double steer, double travel,
+                  ChronoMessages::MVector* position, ChronoMessages::MQuaternion* rotation) {
+    quaternion chassis = toQuaternion(chassisRotation);
+    vector3 offset = rotate(chassis, vector3{hardpoint.x(), hardpoint.y(), hardpoint.z() + travel});
+    position->set_x(chassisPosition.x() + offset.x);
+    position->set_y(chassisPosition.y() + offset.y);
+    position->set_z(chassisPosition.z() + offset.z);
+
+    quaternion steering = {std::cos(steer / 2), 0, 0, std::sin(steer / 2)};
+    quaternion spinning = {std::cos(spin / 2), 0, std::sin(spin / 2), 0};
+    quaternion wheel = multiply(multiply(chassis, steering), spinning);
+    rotation->set_e0(wheel.e0);
+    rotation->set_e1(wheel.e1);
+    rotation->set_e2(wheel.e2);
+    rotation->set_e3(wheel.e3);
+}
+
+bool rebuildWheel(const ChronoMessages::ReducedVehicleMessage& message, const vehicleGeometry& geometry, int wheel,
+                  ChronoMessages::MVector* position, ChronoMessages::MQuaternion* rotation) {
+    if (message.model() != geometry.model || wheel < 0 || wheel >= (int)geometry.hardpoints.size() ||
+        wheel >= message.wheelspin_size() || wheel >= message.wheelsteer_size() || wheel >= message.wheeltravel_size()) {
+        return false;
+    }
+    rebuildWheel(message.chassiscom(), message.chassisrot(), geometry.hardpoints[wheel], message.wheelspin(wheel),
+                 message.wheelsteer(wheel), message.wheeltravel(wheel), position, rotation);
+    return true;
+}
+
+bool reduceVehicleMessage(const ChronoMessages::VehicleMessage& vehicle, const vehicleGeometry& geometry,
+                          ChronoMessages::ReducedVehicleMessage* reduced) {
+    int wheels = wheelCount(vehicle);
+    if (wheels < 0 || wheels != (int)geometry.hardpoints.size()) return false;
+    reduced->set_timestamp(vehicle.timestamp());
+    reduced->set_connectionnumber(vehicle.connectionnumber());
+    reduced->set_idnumber(vehicle.idnumber());
+    reduced->set_chtime(vehicle.chtime());
+    reduced->set_speed(vehicle.speed());
+    reduced->set_model(geometry.model);
+    *reduced->mutable_chassiscom() = vehicle.chassiscom();
+    *reduced->mutable_chassisrot() = vehicle.chassisrot();
+    reduced->mutable_wheelspin()->Resize(wheels, 0);
+    reduced->mutable_wheelsteer()->Resize(wheels, 0);
+    reduced->mutable_wheeltravel()->Resize(wheels, 0);
+    double* spin = reduced->mutable_wheelspin()->mutable_data();
+    double* steer = reduced->mutable_wheelsteer()->mutable_data();
+    double* travel = reduced->mutable_wheeltravel()->mutable_data();
+    const double* positions = vehicle.wheelpositions().data();
+    const double* rotations = vehicle.wheelrotations().data();
+    ChronoMessages::MVector position;
+    ChronoMessages::MQuaternion rotation;
+    for (int wheel = 0; wheel < wheels; wheel++) {
+        const double* p = positions + WHEEL_POSITION_VALUES * wheel;
+        const double* r = rotations + WHEEL_ROTATION_VALUES * wheel;
+        position.set_x(p[0]);
+        position.set_y(p[1]);
+        position.set_z(p[2]);
+        rotation.set_e0(r[0]);
+        rotation.set_e1(r[1]);
+        rotation.set_e2(r[2]);
+        rotation.set_e3(r[3]);
+        reduceWheel(vehicle.chassiscom(), vehicle.chassisrot(), geometry.hardpoints[wheel], position, rotation,
+                    spin[wheel], steer[wheel], travel[wheel]);
+    }
+    return true;
+}
+
+bool rebuildVehicleMessage(const ChronoMessages::ReducedVehicleMessage& reduced, const vehicleGeometry& geometry,
+                           ChronoMessages::VehicleMessage* vehicle) {
+    int wheels = (int)geometry.hardpoints.size();
+    if (reduced.model() != geometry.model || reduced.wheelspin_size() != wheels ||
+        reduced.wheelsteer_size() != wheels || reduced.wheeltravel_size() != wheels) {
+        return false;
+    }
+    vehicle->set_timestamp(reduced.timestamp());
+    vehicle->set_connectionnumber(reduced.connectionnumber());
+    vehicle->set_idnumber(reduced.idnumber());
+    vehicle->set_chtime(reduced.chtime());
+    vehicle->set_speed(reduced.speed());
+    *vehicle->mutable_chassiscom() = reduced.chassiscom();
+    *vehicle->mutable_chassisrot() = reduced.chassisrot();
+    resizeWheels(vehicle, wheels);
+    double* positions = vehicle->mutable_wheelpositions()->mutable_data();
+    double* rotations = vehicle->mutable_wheelrotations()->mutable_data();
+    ChronoMessages::MVector position;
+    ChronoMessages::MQuaternion rotation;
+    for (int wheel = 0; wheel < wheels; wheel++) {
+        rebuildWheel(reduced.chassiscom(), reduced.chassisrot(), geometry.hardpoints[wheel], reduced.wheelspin(wheel),
+                     reduced.wheelsteer(wheel), reduced.wheeltravel(wheel), &position, &rotation);
+        double* p = positions + WHEEL_POSITION_VALUES * wheel;
+        double* r = rotations + WHEEL_ROTATION_VALUES * wheel;
+        p[0] = position.x();
+        p[1] = position.y();
+        p[2] = position.z();
+        r[0] = rotation.e0();
+        r[1] = rotation.e1();
+        r[2] = rotation.e2();
+        r[3] = rotation.e3();
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Converts between wheel poses and the reduced wheel state carried by a
+//  ReducedVehicleMessage. A wheel is placed on its chassis by three numbers:
+//
+//    steer   rotation about the chassis's vertical (z) axis
+//    spin    rotation about the wheel's axle, the steered y axis
+//    travel  displacement from its hardpoint along the chassis's vertical
+//
+//  so its rotation is chassis * steer * spin and its position is the chassis
+//  position plus the displaced hardpoint, rotated with the chassis. Camber,
+//  and any wheel motion other than along the chassis's vertical, is lost.
+//
+// =============================================================================
+
+#ifndef WHEELKINEMATICS_H
+#define WHEELKINEMATICS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ChronoMessages.pb.h"
+
+// Vehicle models, as carried in ReducedVehicleMessage.model. Hardpoints are
+// derived at run time, so the model is what sender and receiver compare.
+#define VEHICLE_MODEL_UNKNOWN 0
+#define VEHICLE_MODEL_HMMWV 1
+
+// Where a vehicle's wheels sit on its chassis. Sender and receiver agree on
+// it by deriving it from the same vehicle model.
+struct vehicleGeometry {
+    // VEHICLE_MODEL_* the hardpoints were derived from
+    uint32_t model = VEHICLE_MODEL_UNKNOWN;
+    // Centre of each wheel in the chassis frame, at zero steer and travel
+    std::vector<ChronoMessages::MVector> hardpoints;
+};
+
+// Geometry of the vehicle in message as it is, wheels in the message's order.
+// Meant for a vehicle of model at rest right after it is initialized.
+vehicleGeometry geometryFromVehicleMessage(const ChronoMessages::VehicleMessage& message,
+                                           uint32_t model = VEHICLE_MODEL_UNKNOWN);
+
+// Finds the spin, steer and travel that put a wheel at position and rotation,
+// from hardpoint on a chassis at chassisPosition and chassisRotation.
+void reduceWheel(const ChronoMessages::MVector& chassisPosition, const ChronoMessages::MQuaternion& chassisRotation,
+                 const ChronoMessages::MVector& hardpoint, const ChronoMessages::MVector& position,
+                 const ChronoMessages::MQuaternion& rotation, double& spin, double& steer, double& travel);
+
+// Rebuilds the wheel pose reduceWheel reduced.
+void rebuildWheel(const ChronoMessages::MVector& chassisPosition, const ChronoMessages::MQuaternion& chassisRotation,
+                  const ChronoMessages::MVector& hardpoint, double spin, double steer, double travel,
+                  ChronoMessages::MVector* position, ChronoMessages::MQuaternion* rotation);
+
+// Rebuilds the pose of wheel from message. Returns false if either message or
+// geometry has no such wheel, or they are of different models.
+bool rebuildWheel(const ChronoMessages::ReducedVehicleMessage& message, const vehicleGeometry& geometry, int wheel,
+                  ChronoMessages::MVector* position, ChronoMessages::MQuaternion* rotation);
+
+// Converts a VehicleMessage to its reduced form, tagged with geometry's model,
+// and back. Both return false if the message doesn't have as many wheels as
+// geometry, and rebuilding if the reduced message is of another model.
+bool reduceVehicleMessage(const ChronoMessages::VehicleMessage& vehicle, const vehicleGeometry& geometry,
+                          ChronoMessages::ReducedVehicleMessage* reduced);
+bool rebuildVehicleMessage(const ChronoMessages::ReducedVehicleMessage& reduced, const vehicleGeometry& geometry,
+                           ChronoMessages::VehicleMessage* vehicle);
+
+#endif // WHEELKINEMATICS_H
@@ -2,6 +2,7 @@
 #include "ChNetworkHandler.h"
 #include "ChronoMessages.pb.h"
 #include "MessageConversions.h"
+#include "MessageTraits.h"
 #include "ServerVehicle.h"
 
 #include "chrono/core/ChFileutils.h"
@@ -86,6 +87,11 @@ double debug_step_size = 1.0 / 1;  // FPS = 1
 // POV-Ray output
 bool povray_output = false;
 
+// Send wheels reduced to spin, steer and travel rather than as full poses.
+// Off by default: the server keeps reduced vehicles as messages rather than
+// in its vehicle store, and sends them outside compact snapshots.
+bool reduced_state = false;
+
 // =============================================================================
 
 // TODO: Make a map-structure storing messages and their corresponding world object -- while preserving as much generality as possible.
@@ -123,6 +129,8 @@ int main(int argc, char **argv) {
     my_hmmwv.SetTireStepSize(tire_step_size);
     my_hmmwv.SetPacejkaParamfile("hmmwv/tire/HMMWV_pacejka.tir");
     my_hmmwv.Initialize();
+    // The only hardpoints this client knows are its own model's
+    vehicleGeometry geometry = vehicleGeometryFromWheeledVehicle(&my_hmmwv.GetVehicle(), VEHICLE_MODEL_HMMWV);
 
     VisualizationType tire_vis_type =
         (tire_model == TireModelType::RIGID_MESH) ? VisualizationType::MESH : VisualizationType::PRIMITIVES;
@@ -291,23 +299,45 @@ int main(int argc, char **argv) {
         app.Synchronize(driver.GetInputModeAsString(), steering_input, throttle_input, braking_input);
 
         if (step_number % send_steps == 0) {
-            auto message = generateVehicleMessageFromWheeledVehicle(&my_hmmwv.GetVehicle(), handler.connectionNumber(), 0);
-            handler.pushMessage(message);
+            if (reduced_state) {
+                auto message = generateReducedVehicleMessageFromWheeledVehicle(&my_hmmwv.GetVehicle(), geometry,
+                                                                               handler.connectionNumber(), 0);
+                handler.pushMessage(message);
+            } else {
+                auto message = generateVehicleMessageFromWheeledVehicle(&my_hmmwv.GetVehicle(), handler.connectionNumber(), 0);
+                handler.pushMessage(message);
+            }
 
             while (handler.waitingMessages() > 0) {
-                auto newMessage = std::static_pointer_cast<ChronoMessages::VehicleMessage>(handler.popSimMessage()); // TODO: Make this crap more general
-                if (newMessage->connectionnumber() != handler.connectionNumber()) {
+                auto newMessage = handler.popSimMessage();
+                uint8_t code = messageCode(*newMessage);
+                // Vehicles come in either form; removals and anything else are passed over
+                bool reduced = code == MessageTraits<ChronoMessages::ReducedVehicleMessage>::code;
+                if (!reduced && code != MessageTraits<ChronoMessages::VehicleMessage>::code) continue;
+                // Wheels of any other model can't be rebuilt without its hardpoints
+                if (reduced && static_cast<ChronoMessages::ReducedVehicleMessage&>(*newMessage).model() != geometry.model) {
+                    continue;
+                }
+                auto idPair =
+                    reduced ? MessageTraits<ChronoMessages::ReducedVehicleMessage>::stateKey(
+                                  static_cast<ChronoMessages::ReducedVehicleMessage&>(*newMessage))
+                            : MessageTraits<ChronoMessages::VehicleMessage>::stateKey(
+                                  static_cast<ChronoMessages::VehicleMessage&>(*newMessage));
+                if (idPair.first != handler.connectionNumber()) {
                     // TODO: Do thing with maps or something
-                    auto idPair = std::make_pair(newMessage->connectionnumber(), newMessage->idnumber());
-                    if (otherVehicles.find(idPair) == otherVehicles.end()) {
-                        auto newVehicle = std::make_shared<ServerVehicle>(my_hmmwv.GetVehicle().GetSystem());
-                        otherVehicles.insert(std::make_pair(idPair, newVehicle));
+                    std::shared_ptr<ServerVehicle>& vehicle = otherVehicles[idPair];
+                    bool created = !vehicle;
+                    if (created) {
+                        vehicle = std::make_shared<ServerVehicle>(my_hmmwv.GetVehicle().GetSystem());
                         app.AssetBindAll();
                         app.AssetUpdateAll();
-                        newVehicle->update(*newMessage);
-                        std::cout << "New vehicle updated." << std::endl;
                     }
-                    else otherVehicles[idPair]->update(*newMessage);
+                    if (reduced) {
+                        vehicle->update(static_cast<ChronoMessages::ReducedVehicleMessage&>(*newMessage), geometry);
+                    } else {
+                        vehicle->update(static_cast<ChronoMessages::VehicleMessage&>(*newMessage));
+                    }
+                    if (created) std::cout << "New vehicle updated." << std::endl;
                 }
             }
 
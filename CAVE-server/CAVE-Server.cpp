@@ -18,37 +18,103 @@
 
 #include <iostream>
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
 #include <thread>
 
 #include "MessageCodes.h"
 //#include "ChronoMessages.pb.h"
-#include "ChSafeQueue.h"
+#include "ChRingQueue.h"
 #include "ChNetworkHandler.h"
+#include "ChUpdateConflator.h"
+#include "ChCompactVehicles.h"
+#include "ChPacketCompressor.h"
 #include "World.h"
 
-void processMessages(World& world, ChSafeQueue<std::function<void()>>& worldQueue, ChServerHandler& handler);
+// World snapshots broadcast to every client per second, unless given on the
+// command line. 0 instead answers each received message with a snapshot.
+#define SNAPSHOT_RATE 60
+// Whether snapshot vehicles are quantized into compactVehicles, unless given
+// on the command line. Off unless asked for, since quantizing loses precision
+// every client would otherwise see.
+#define COMPACT_SNAPSHOTS 0
+// Whether clients that offer compression with the default dictionary get it,
+// unless given on the command line. Off until the dictionary measurably beats
+// compressing without one (network-bench compression).
+#define OFFER_COMPRESSION 0
+
+void processMessages(World& world, ChRingQueue<std::function<void()>>& worldQueue, ChServerHandler& handler,
+                     ChUpdateConflator& conflator, bool replyEach, bool compact);
+void broadcastSnapshots(World& world, ChRingQueue<std::function<void()>>& worldQueue, ChServerHandler& handler,
+                        double rate, bool compact);
 
 int main(int argc, char **argv) {
     if (argc < 2) {
-        std::cout << "Usage: " << std::string(argv[0]) << " <port number>" << std::endl;
+        std::cout << "Usage: " << std::string(argv[0])
+                  << " <port number> [io threads] [send cap in kB/s] [snapshots per second] [compact snapshots, 0 or 1]"
+                  << " [compression, 0 or 1]" << std::endl;
         return 1;
     }
     World world;
-    ChSafeQueue<std::function<void()>> worldQueue;
-    ChServerHandler handler(world, worldQueue, std::stoi(std::string(argv[1])));
+    ChRingQueue<std::function<void()>> worldQueue;
+    // Without an io thread count the handler runs its dedicated socket threads
+    unsigned int ioThreads = argc > 2 ? std::stoi(std::string(argv[2])) : THREADED_SERVER;
+    ChServerHandler handler(world, worldQueue, std::stoi(std::string(argv[1])), ioThreads);
+    // Paces every client so bursts don't overrun the switch; unpaced without a cap
+    if (argc > 3) handler.setDefaultSendRate(std::stod(std::string(argv[3])) * 1000);
+    double snapshotRate = argc > 4 ? std::stod(std::string(argv[4])) : SNAPSHOT_RATE;
+    bool compact = argc > 5 ? std::stoi(std::string(argv[5])) != 0 : COMPACT_SNAPSHOTS;
+    if (argc > 6 ? std::stoi(std::string(argv[6])) != 0 : OFFER_COMPRESSION) {
+        handler.setCompressor(std::make_shared<ChPacketCompressor>(defaultCompressionDictionary()));
+    }
     handler.beginListen();
     handler.beginSend();
 
-    std::thread worker(processMessages, std::ref(world), std::ref(worldQueue), std::ref(handler));
+    // Vehicle updates wait here rather than in worldQueue, so a backlog holds one per vehicle
+    ChUpdateConflator conflator;
+    std::thread worker(processMessages, std::ref(world), std::ref(worldQueue), std::ref(handler), std::ref(conflator),
+                       snapshotRate <= 0, compact);
+    std::thread snapshots;
+    if (snapshotRate > 0) {
+        snapshots = std::thread(broadcastSnapshots, std::ref(world), std::ref(worldQueue), std::ref(handler),
+                                snapshotRate, compact);
+    }
 
     while (true) {
         worldQueue.dequeue()();
     }
     worker.join();
+    if (snapshots.joinable()) snapshots.join();
     return 0;
 }
 
-void processMessages(World& world, ChSafeQueue<std::function<void()>>& worldQueue, ChServerHandler& handler) {
+// Hands a vehicle's state, of either form, to the world through the conflator
+template<class T> void conflateVehicle(World& world, ChRingQueue<std::function<void()>>& worldQueue,
+                                       ChServerHandler& handler, ChUpdateConflator& conflator,
+                                       boost::asio::ip::udp::endpoint& endpoint,
+                                       std::shared_ptr<google::protobuf::Message>& message) {
+    auto vehicle = std::static_pointer_cast<T>(message);
+    ChUpdateConflator::Key key = MessageTraits<T>::stateKey(*vehicle);
+    // Only the endpoint that was given key.first may update its vehicles. The
+    // world checks that again when the update is applied, but by then another
+    // sender's update could already have displaced the owner's pending one,
+    // or left a simulation time far enough ahead to discard everything after.
+    if (handler.connectionOf(endpoint) != key.first) return;
+    // Only the first pending update schedules a task; later ones replace it in the conflator
+    if (conflator.offer(key, vehicle->chtime(), endpoint, message)) {
+        worldQueue.enqueue([&world, &conflator, key] {
+            ChUpdateConflator::Update newest = conflator.take(key);
+            if (!newest.second) return;
+            // Registration may not have run when the update arrived
+            endpointProfile *owner = world.verifyConnection(key.first, newest.first);
+            if (owner == NULL) return;
+            world.updateElement(newest.second, owner, key.second);
+        });
+    }
+}
+
+void processMessages(World& world, ChRingQueue<std::function<void()>>& worldQueue, ChServerHandler& handler,
+                     ChUpdateConflator& conflator, bool replyEach, bool compact) {
     // TODO: Fix major memory issues. Make copies of everything to avoid memory errors.
     while (true) {
         auto messagePair = handler.popMessage();
@@ -61,30 +127,109 @@ void processMessages(World& world, ChSafeQueue<std::function<void()>>& worldQueu
         int connectionNumber = reflection->GetInt32(*message, conDesc);
         auto idDesc = descriptor->FindFieldByName(ID_NUMBER_FIELD);
         int idNumber = reflection->GetInt32(*message, idDesc);
-        std::string type = descriptor->full_name();
+        bool isPacket = messageCode(*message) == MessageTraits<ChronoMessages::MessagePacket>::code;
 
-        endpointProfile *profile = world.verifyConnection(connectionNumber, endpoint);
-        if (profile == NULL) {
-            worldQueue.enqueue([&, message] {
-                if(world.registerEndpoint(endpoint, connectionNumber)) {
-                    profile = world.verifyConnection(connectionNumber, endpoint);
-                    if (profile != NULL) {
-                        if (type.compare(MESSAGE_PACKET_TYPE) == 0) {
-                            world.updateElementsOfProfile(profile, message);
-                        } else {
-                            world.updateElement(message, profile, idNumber);
-                        }
-                        std::cout << "endpoint registered" << std::endl;
-                    }
+        if (messageCode(*message) == MessageTraits<ChronoMessages::ControlMessage>::code) {
+            auto control = std::static_pointer_cast<ChronoMessages::ControlMessage>(message);
+            // The profile is looked up again when the task runs, since a queued disconnect may remove it first
+            worldQueue.enqueue([&world, &handler, &conflator, control, endpoint] {
+                endpointProfile *owner = world.verifyConnection(control->connectionnumber(), endpoint);
+                if (owner == NULL) return;
+                if (control->action() == ChronoMessages::ControlMessage::DISCONNECT) {
+                    world.removeConnection(owner);
+                    conflator.forget(control->connectionnumber());
+                    handler.forgetEndpoint(endpoint);
+                    std::cout << "endpoint disconnected" << std::endl;
+                } else if (control->action() == ChronoMessages::ControlMessage::REMOVE_VEHICLE) {
+                    world.removeElement(control->idnumber(), owner);
                 }
             });
-        } else if (type.compare(MESSAGE_PACKET_TYPE) == 0) {
-            worldQueue.enqueue([&, message] { world.updateElementsOfProfile(profile, message); });
+            continue;
+        }
+
+        if (messageCode(*message) == MessageTraits<ChronoMessages::SnapshotAck>::code) {
+            auto ack = std::static_pointer_cast<ChronoMessages::SnapshotAck>(message);
+            worldQueue.enqueue([&world, ack, endpoint] {
+                endpointProfile *owner = world.verifyConnection(ack->connectionnumber(), endpoint);
+                if (owner != NULL) world.acknowledgeSnapshot(owner, ack->snapshot());
+            });
+            continue;
+        }
+
+        if (messageCode(*message) == MessageTraits<ChronoMessages::VehicleMessage>::code) {
+            conflateVehicle<ChronoMessages::VehicleMessage>(world, worldQueue, handler, conflator, endpoint, message);
+        } else if (messageCode(*message) == MessageTraits<ChronoMessages::ReducedVehicleMessage>::code) {
+            conflateVehicle<ChronoMessages::ReducedVehicleMessage>(world, worldQueue, handler, conflator, endpoint,
+                                                                   message);
         } else {
-            worldQueue.enqueue([&, message] { world.updateElement(message, profile, idNumber); });
+            // Verified on the world thread, where the profile can't be removed
+            // under it and the handshake's registration has had a chance to run
+            worldQueue.enqueue([&world, message, isPacket, endpoint, connectionNumber, idNumber] {
+                endpointProfile *owner = world.verifyConnection(connectionNumber, endpoint);
+                if (owner == NULL) return;
+                if (isPacket) {
+                    world.updateElementsOfProfile(owner, message);
+                } else {
+                    world.updateElement(message, owner, idNumber);
+                }
+            });
         }
-        if (profile != NULL) {
-            handler.pushMessage(endpoint, *world.generateWorldPacket());
+        if (replyEach) {
+            // Queued behind the update, so the reply already includes it
+            worldQueue.enqueue([&world, &handler, endpoint, connectionNumber, compact]() mutable {
+                if (world.verifyConnection(connectionNumber, endpoint) == NULL) return;
+                auto packet = world.generateWorldPacket();
+                if (compact) compactVehicles(*packet);
+                handler.pushMessage(endpoint, *packet);
+            });
         }
     }
 }
+
+void broadcastSnapshots(World& world, ChRingQueue<std::function<void()>>& worldQueue, ChServerHandler& handler,
+                        double rate, bool compact) {
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / rate));
+    auto next = std::chrono::steady_clock::now();
+    std::atomic<bool> waiting(false);
+    // Only touched on the world thread; each client gets the delta against the
+    // snapshot it last acknowledged, serialized once per baseline and reused
+    // until the world changes
+    std::map<uint64_t, std::shared_ptr<const ChSerializedMessage>> snapshots;
+    uint64_t snapshotVersion = 0;
+    // Whether the last snapshot built was too large to send, so it is only reported once
+    bool oversized = false;
+    while (true) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        // Missed ticks are skipped rather than made up in a burst
+        auto now = std::chrono::steady_clock::now();
+        if (next < now - period) next = now;
+        // A world thread still behind on the last snapshot doesn't get another queued
+        if (waiting.exchange(true)) continue;
+        // Built on the world thread, so it sees a consistent world; one packet serves every client on a baseline
+        worldQueue.enqueue([&world, &handler, &waiting, &snapshots, &snapshotVersion, &oversized, compact] {
+            waiting = false;
+            if (world.version() != snapshotVersion) {
+                snapshots.clear();
+                snapshotVersion = world.version();
+            }
+            for (auto& group : world.endpointsByBaseline()) {
+                // Clients that have acknowledged the current world have nothing to catch up on
+                if (group.first == snapshotVersion) continue;
+                std::shared_ptr<const ChSerializedMessage>& snapshot = snapshots[group.first];
+                if (!snapshot) {
+                    auto packet = world.generateDeltaPacket(group.first);
+                    // Vehicles out of the encoding's range are sent as messages instead
+                    if (compact) compactVehicles(*packet);
+                    snapshot = handler.serializeBroadcast(*packet);
+                    // The handler counts the drop in every client's send stats
+                    if (snapshot->datagrams.empty() && !oversized) {
+                        std::cout << "world snapshot of " << packet->ByteSizeLong() << " bytes too large to send" << std::endl;
+                    }
+                    oversized = snapshot->datagrams.empty();
+                }
+                handler.broadcastSerialized(group.second, *snapshot);
+            }
+        });
+    }
+}
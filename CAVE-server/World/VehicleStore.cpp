@@ -0,0 +1,213 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of VehicleStore.
+//
+// =============================================================================
+
+#include "VehicleStore.h"
+#include "VehicleWheels.h"
+#include <algorithm>
+#include <utility>
+
+// Element by element helpers shared by the scalar, vector and quaternion
+// arrays, so every field is grown, written and shrunk the same way.
+template<class T> static void moveLast(std::vector<T>& array, size_t index) {
+    array[index] = std::move(array.back());
+    array.pop_back();
+}
+
+static void grow(VehicleStore::vectorArrays& arrays) {
+    arrays.x.emplace_back();
+    arrays.y.emplace_back();
+    arrays.z.emplace_back();
+}
+
+static void grow(VehicleStore::quaternionArrays& arrays) {
+    arrays.e0.emplace_back();
+    arrays.e1.emplace_back();
+    arrays.e2.emplace_back();
+    arrays.e3.emplace_back();
+}
+
+// Each store returns true if it changed a value.
+template<class T> static bool store(std::vector<T>& array, size_t index, T value) {
+    bool changed = array[index] != value;
+    array[index] = value;
+    return changed;
+}
+
+static bool store(VehicleStore::vectorArrays& arrays, size_t index, const ChronoMessages::MVector& vector) {
+    bool changed = store(arrays.x, index, vector.x());
+    changed |= store(arrays.y, index, vector.y());
+    changed |= store(arrays.z, index, vector.z());
+    return changed;
+}
+
+static bool store(VehicleStore::quaternionArrays& arrays, size_t index, const ChronoMessages::MQuaternion& quaternion) {
+    bool changed = store(arrays.e0, index, quaternion.e0());
+    changed |= store(arrays.e1, index, quaternion.e1());
+    changed |= store(arrays.e2, index, quaternion.e2());
+    changed |= store(arrays.e3, index, quaternion.e3());
+    return changed;
+}
+
+static bool store(std::vector<double>& array, size_t first, const google::protobuf::RepeatedField<double>& values) {
+    double* stored = array.data() + first;
+    bool changed = !std::equal(values.begin(), values.end(), stored);
+    std::copy(values.begin(), values.end(), stored);
+    return changed;
+}
+
+static void load(const VehicleStore::vectorArrays& arrays, size_t index, ChronoMessages::MVector* vector) {
+    vector->set_x(arrays.x[index]);
+    vector->set_y(arrays.y[index]);
+    vector->set_z(arrays.z[index]);
+}
+
+static void load(const VehicleStore::quaternionArrays& arrays, size_t index, ChronoMessages::MQuaternion* quaternion) {
+    quaternion->set_e0(arrays.e0[index]);
+    quaternion->set_e1(arrays.e1[index]);
+    quaternion->set_e2(arrays.e2[index]);
+    quaternion->set_e3(arrays.e3[index]);
+}
+
+static void load(const std::vector<double>& array, size_t first, size_t count,
+                 google::protobuf::RepeatedField<double>* values) {
+    values->Resize((int)count, 0);
+    std::copy(array.begin() + first, array.begin() + first + count, values->mutable_data());
+}
+
+// Grows or shrinks the run of count values per wheel starting at wheel first
+// from wheels to resized wheels.
+static void resizeRun(std::vector<double>& array, size_t count, uint32_t first, uint32_t wheels, uint32_t resized) {
+    auto end = array.begin() + (first + wheels) * count;
+    if (resized < wheels) {
+        array.erase(array.begin() + (first + resized) * count, end);
+    } else {
+        array.insert(end, (resized - wheels) * count, 0.0);
+    }
+}
+
+static void moveLast(VehicleStore::vectorArrays& arrays, size_t index) {
+    moveLast(arrays.x, index);
+    moveLast(arrays.y, index);
+    moveLast(arrays.z, index);
+}
+
+static void moveLast(VehicleStore::quaternionArrays& arrays, size_t index) {
+    moveLast(arrays.e0, index);
+    moveLast(arrays.e1, index);
+    moveLast(arrays.e2, index);
+    moveLast(arrays.e3, index);
+}
+
+size_t VehicleStore::add(const ChronoMessages::VehicleMessage& vehicle, uint32_t owner) {
+    size_t index = owners.size();
+    owners.push_back(owner);
+    timestamp.emplace_back();
+    connectionNumber.emplace_back();
+    idNumber.emplace_back();
+    chTime.emplace_back();
+    speed.emplace_back();
+    grow(chassisPosition);
+    grow(chassisRotation);
+    // A new vehicle's wheels go on the end
+    firstWheel.push_back(wheelPositions.size() / WHEEL_POSITION_VALUES);
+    wheels.push_back(0);
+    set(index, vehicle);
+    return index;
+}
+
+bool VehicleStore::fits(const ChronoMessages::VehicleMessage& vehicle) {
+    return wheelCount(vehicle) <= VEHICLE_MAX_WHEELS;
+}
+
+bool VehicleStore::set(size_t index, const ChronoMessages::VehicleMessage& vehicle) {
+    if (!fits(vehicle)) return false;
+    timestamp[index] = vehicle.timestamp();
+    chTime[index] = vehicle.chtime();
+    bool changed = store(connectionNumber, index, vehicle.connectionnumber());
+    changed |= store(idNumber, index, vehicle.idnumber());
+    changed |= store(speed, index, vehicle.speed());
+    changed |= store(chassisPosition, index, vehicle.chassiscom());
+    changed |= store(chassisRotation, index, vehicle.chassisrot());
+    changed |= storeWheels(index, vehicle);
+    return changed;
+}
+
+void VehicleStore::resizeWheels(size_t index, uint32_t count) {
+    uint32_t first = firstWheel[index];
+    uint32_t old = wheels[index];
+    if (count == old) return;
+    resizeRun(wheelPositions, WHEEL_POSITION_VALUES, first, old, count);
+    resizeRun(wheelRotations, WHEEL_ROTATION_VALUES, first, old, count);
+    // Runs are in no particular order, so every one past this one is found and moved
+    for (size_t i = 0; i < firstWheel.size(); i++) {
+        if (i != index && firstWheel[i] >= first + old) firstWheel[i] = firstWheel[i] + count - old;
+    }
+    wheels[index] = count;
+}
+
+bool VehicleStore::storeWheels(size_t index, const ChronoMessages::VehicleMessage& vehicle) {
+    // Arrays that disagree on a wheel count leave the vehicle with none
+    int count = std::max(wheelCount(vehicle), 0);
+    bool changed = (uint32_t)count != wheels[index];
+    resizeWheels(index, count);
+    if (count == 0) return changed;
+    changed |= store(wheelPositions, firstWheel[index] * WHEEL_POSITION_VALUES, vehicle.wheelpositions());
+    changed |= store(wheelRotations, firstWheel[index] * WHEEL_ROTATION_VALUES, vehicle.wheelrotations());
+    return changed;
+}
+
+void VehicleStore::get(size_t index, ChronoMessages::VehicleMessage* vehicle) const {
+    vehicle->set_timestamp(timestamp[index]);
+    vehicle->set_connectionnumber(connectionNumber[index]);
+    vehicle->set_idnumber(idNumber[index]);
+    vehicle->set_chtime(chTime[index]);
+    vehicle->set_speed(speed[index]);
+    load(chassisPosition, index, vehicle->mutable_chassiscom());
+    load(chassisRotation, index, vehicle->mutable_chassisrot());
+    load(wheelPositions, firstWheel[index] * WHEEL_POSITION_VALUES, wheels[index] * WHEEL_POSITION_VALUES,
+         vehicle->mutable_wheelpositions());
+    load(wheelRotations, firstWheel[index] * WHEEL_ROTATION_VALUES, wheels[index] * WHEEL_ROTATION_VALUES,
+         vehicle->mutable_wheelrotations());
+}
+
+void VehicleStore::remove(size_t index) {
+    resizeWheels(index, 0);
+    moveLast(firstWheel, index);
+    moveLast(wheels, index);
+    moveLast(owners, index);
+    moveLast(timestamp, index);
+    moveLast(connectionNumber, index);
+    moveLast(idNumber, index);
+    moveLast(chTime, index);
+    moveLast(speed, index);
+    moveLast(chassisPosition, index);
+    moveLast(chassisRotation, index);
+}
+
+void VehicleStore::within(double x, double y, double z, double radius, std::vector<size_t>& indices) const {
+    const double* px = chassisPosition.x.data();
+    const double* py = chassisPosition.y.data();
+    const double* pz = chassisPosition.z.data();
+    double limit = radius * radius;
+    for (size_t i = 0; i < owners.size(); i++) {
+        double dx = px[i] - x;
+        double dy = py[i] - y;
+        double dz = pz[i] - z;
+        if (dx * dx + dy * dy + dz * dz <= limit) indices.push_back(i);
+    }
+}
@@ -0,0 +1,97 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	State of every vehicle in the world, kept field by field in contiguous
+//  arrays rather than as one protobuf message per vehicle. Vehicles are packed
+//  with no gaps, so a pass over one field, like the proximity search over
+//  chassis positions, reads straight through memory. Wheels, whose number
+//  varies from vehicle to vehicle, are kept back to back in one array per
+//  field, laid out as in a message, with each vehicle's first wheel and wheel
+//  count alongside. Messages are only built and read at the wire
+//  boundary.
+//
+// =============================================================================
+
+#ifndef VEHICLESTORE_H
+#define VEHICLESTORE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ChronoMessages.pb.h"
+
+class VehicleStore {
+public:
+    struct vectorArrays {
+        std::vector<double> x, y, z;
+    };
+
+    struct quaternionArrays {
+        std::vector<double> e0, e1, e2, e3;
+    };
+
+    // True unless vehicle carries more than VEHICLE_MAX_WHEELS wheels, which
+    // neither add nor set will store.
+    static bool fits(const ChronoMessages::VehicleMessage& vehicle);
+
+    // Appends the state in vehicle, tagged with owner, and returns its index.
+    size_t add(const ChronoMessages::VehicleMessage& vehicle, uint32_t owner);
+
+    // Overwrites the state at index with the state in vehicle. Returns false
+    // if nothing but the vehicle's clock, timestamp and chTime, changed, or,
+    // leaving the state untouched, if vehicle doesn't fit.
+    bool set(size_t index, const ChronoMessages::VehicleMessage& vehicle);
+
+    // Fills vehicle with the state at index.
+    void get(size_t index, ChronoMessages::VehicleMessage* vehicle) const;
+
+    // Removes the vehicle at index by moving the last vehicle into its place,
+    // unless it was the last itself. Its wheels are closed up behind it.
+    void remove(size_t index);
+
+    // Appends the index of every vehicle whose chassis is within radius of
+    // (x, y, z) to indices.
+    void within(double x, double y, double z, double radius, std::vector<size_t>& indices) const;
+
+    // Tag given to the vehicle at index when it was added.
+    uint32_t owner(size_t index) const { return owners[index]; }
+
+    size_t size() const { return owners.size(); }
+
+private:
+    // Gives the vehicle at index count wheels, growing or shrinking its run
+    // of the wheel arrays in place and moving every run after it to match.
+    void resizeWheels(size_t index, uint32_t count);
+
+    // Copies vehicle's wheels over the ones at index. Returns true if any
+    // changed.
+    bool storeWheels(size_t index, const ChronoMessages::VehicleMessage& vehicle);
+
+    std::vector<uint32_t> owners;
+    std::vector<int32_t> timestamp;
+    std::vector<int32_t> connectionNumber;
+    std::vector<int32_t> idNumber;
+    std::vector<double> chTime;
+    std::vector<double> speed;
+    vectorArrays chassisPosition;
+    quaternionArrays chassisRotation;
+    // Every vehicle's wheels, each laid out as in VehicleWheels.h
+    std::vector<double> wheelPositions;
+    std::vector<double> wheelRotations;
+    // Where each vehicle's wheels start in the arrays above, and how many
+    std::vector<uint32_t> firstWheel;
+    std::vector<uint32_t> wheels;
+};
+
+#endif // VEHICLESTORE_H
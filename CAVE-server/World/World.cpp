@@ -18,16 +18,25 @@
 
 #include "World.h"
 #include "MessageCodes.h"
+#include "MessageTraits.h"
+#include <algorithm>
+#include <google/protobuf/arena.h>
 #include <iostream>
 
 struct endpointProfile {
     int connectionNumber;
-    int count;
     boost::asio::ip::udp::endpoint endpoint;
-    std::map<std::pair<int, int>, std::shared_ptr<google::protobuf::Message>>::iterator first;
-    std::map<std::pair<int, int>, std::shared_ptr<google::protobuf::Message>>::iterator last;
+    // Newest snapshot the client has acknowledged
+    uint64_t acknowledged;
+    // Slots of the elements this connection owns, in no particular order
+    std::vector<uint32_t> slots;
 };
 
+World::World() {
+    currentVersion = 0;
+    forgottenVersion = 0;
+}
+
 World::~World() {
     for (auto endpointPair : endpoints) {
         delete endpointPair.second;
@@ -60,122 +69,295 @@ bool World::registerEndpoint(boost::asio::ip::udp::endpoint& endpoint, int conne
     registeredConnectionNumbers.erase(num);
     endpointProfile *profile = new endpointProfile;
     profile->connectionNumber = connectionNumber;
-    profile->count = 0;
     profile->endpoint = endpoint;
-    profile->first = elements.end();
-    profile->last = elements.end();
+    profile->acknowledged = 0;
     endpoints[connectionNumber] = profile;
     return true;
 }
 
-bool World::updateElement(std::shared_ptr<google::protobuf::Message> message, endpointProfile *profile, int idNumber) {
-    auto mess = elements.find(std::make_pair(profile->connectionNumber, idNumber));
-    // The update must be of the same type as the original message
-    if (mess != elements.end() && mess->second->GetDescriptor()->full_name().compare(message->GetDescriptor()->full_name()) != 0) {
-        return false;
-        // Else adds the update as a new element if not already found
-    } else if (mess == elements.end()) {
-        auto empPair = elements.insert(std::make_pair(std::make_pair(profile->connectionNumber, idNumber), message));
-        if (!empPair.second) return false;
-        profile->count++;
-        // Moves profile's iterators to re-encompass it's owned elements
-        mess = empPair.first;
-        auto curr = profile->first;
-        while (curr->first.first == profile->connectionNumber) {
-            curr--;
+uint64_t World::elementKey(int connectionNumber, int idNumber) {
+    return (uint64_t)(uint32_t)connectionNumber << 32 | (uint32_t)idNumber;
+}
+
+bool World::isVehicle(const worldElement& element) {
+    return element.message == NULL ||
+           messageCode(*element.message) == MessageTraits<ChronoMessages::ReducedVehicleMessage>::code;
+}
+
+static bool sameValues(const google::protobuf::RepeatedField<double>& a, const google::protobuf::RepeatedField<double>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+// Whether two reduced vehicles differ in more than their clocks
+static bool reducedStateChanged(const ChronoMessages::ReducedVehicleMessage& a,
+                                const ChronoMessages::ReducedVehicleMessage& b) {
+    const ChronoMessages::MVector& ap = a.chassiscom();
+    const ChronoMessages::MVector& bp = b.chassiscom();
+    const ChronoMessages::MQuaternion& ar = a.chassisrot();
+    const ChronoMessages::MQuaternion& br = b.chassisrot();
+    if (a.model() != b.model() || a.speed() != b.speed() || ap.x() != bp.x() || ap.y() != bp.y() || ap.z() != bp.z() ||
+        ar.e0() != br.e0() || ar.e1() != br.e1() || ar.e2() != br.e2() || ar.e3() != br.e3()) {
+        return true;
+    }
+    return !sameValues(a.wheelspin(), b.wheelspin()) || !sameValues(a.wheelsteer(), b.wheelsteer()) ||
+           !sameValues(a.wheeltravel(), b.wheeltravel());
+}
+
+uint32_t World::insertElement(endpointProfile *profile, int idNumber, std::shared_ptr<google::protobuf::Message> message) {
+    uint32_t slot;
+    if (freeSlots.empty()) {
+        slot = slots.size();
+        // Generations start at 1, so a zeroed handle is never valid
+        slots.push_back(elementSlot{0, 1});
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    slots[slot].index = elements.size();
+    currentVersion++;
+    elements.push_back(worldElement{profile->connectionNumber, idNumber, slot, (uint32_t)profile->slots.size(), 0,
+                                    currentVersion, message});
+    profile->slots.push_back(slot);
+    slotIndex[elementKey(profile->connectionNumber, idNumber)] = slot;
+    return slot;
+}
+
+bool World::updateVehicle(endpointProfile *profile, int idNumber, const ChronoMessages::VehicleMessage& vehicle) {
+    if (!VehicleStore::fits(vehicle)) return false;
+    auto found = slotIndex.find(elementKey(profile->connectionNumber, idNumber));
+    if (found == slotIndex.end()) {
+        uint32_t slot = insertElement(profile, idNumber, std::shared_ptr<google::protobuf::Message>());
+        elements.back().vehicle = vehicles.add(vehicle, slot);
+        return true;
+    }
+    worldElement& element = elements[slots[found->second].index];
+    if (element.message != NULL) return false;
+    // A parked vehicle still reports every step, but only its clock moves
+    if (vehicles.set(element.vehicle, vehicle)) element.changed = ++currentVersion;
+    return true;
+}
+
+void World::eraseElement(endpointProfile *profile, uint32_t index) {
+    worldElement& element = elements[index];
+    // The profile's last slot takes the erased one's place in its list
+    uint32_t moved = profile->slots.back();
+    profile->slots[element.profileIndex] = moved;
+    elements[slots[moved].index].profileIndex = element.profileIndex;
+    profile->slots.pop_back();
+
+    // As does the last vehicle in vehicles
+    if (element.message == NULL) {
+        vehicles.remove(element.vehicle);
+        if (element.vehicle < vehicles.size()) {
+            elements[slots[vehicles.owner(element.vehicle)].index].vehicle = element.vehicle;
         }
-        profile->first = ++curr;
-        curr = profile->last;
-        while (curr->first.first == profile->connectionNumber) {
-            curr++;
+    }
+
+    currentVersion++;
+    // Remembered for delta snapshots, which only carry vehicles
+    if (isVehicle(element)) {
+        removals.push_back(removedElement{element.connectionNumber, element.idNumber, currentVersion});
+        if (removals.size() > WORLD_REMOVAL_HISTORY) {
+            forgottenVersion = removals.front().removed;
+            removals.pop_front();
         }
-        profile->last = --curr;
+    }
+
+    slotIndex.erase(elementKey(element.connectionNumber, element.idNumber));
+    slots[element.slot].generation++;
+    freeSlots.push_back(element.slot);
+
+    // And the last element in elements
+    if (index + 1 != elements.size()) {
+        element = std::move(elements.back());
+        slots[element.slot].index = index;
+    }
+    elements.pop_back();
+}
+
+std::shared_ptr<google::protobuf::Message> World::elementMessage(const worldElement& element) {
+    if (element.message != NULL) return element.message;
+    auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+    vehicles.get(element.vehicle, vehicle.get());
+    return vehicle;
+}
+
+bool World::updateElement(std::shared_ptr<google::protobuf::Message> message, endpointProfile *profile, int idNumber) {
+    // Vehicles are copied into the vehicle store
+    if (messageCode(*message) == MessageTraits<ChronoMessages::VehicleMessage>::code) {
+        return updateVehicle(profile, idNumber, static_cast<ChronoMessages::VehicleMessage&>(*message));
+    }
+    // Reduced vehicles are copied off the arena they were parsed onto, which
+    // may hold a whole packet of them, so the world doesn't keep it alive
+    if (messageCode(*message) == MessageTraits<ChronoMessages::ReducedVehicleMessage>::code && message->GetArena()) {
+        message = std::make_shared<ChronoMessages::ReducedVehicleMessage>(
+            static_cast<ChronoMessages::ReducedVehicleMessage&>(*message));
+    }
+    auto found = slotIndex.find(elementKey(profile->connectionNumber, idNumber));
+    // Adds the update as a new element if not already found
+    if (found == slotIndex.end()) {
+        insertElement(profile, idNumber, message);
         return true;
     }
-    elements[std::make_pair(profile->connectionNumber, idNumber)]->CopyFrom(*message);
+    worldElement& element = elements[slots[found->second].index];
+    // The update must be of the same type as the original message
+    if (element.message == NULL || element.message->GetDescriptor() != message->GetDescriptor()) return false;
+    // As with full vehicles, a reduced one that only moved its clock isn't a change
+    bool changed = messageCode(*message) != MessageTraits<ChronoMessages::ReducedVehicleMessage>::code ||
+                   reducedStateChanged(static_cast<ChronoMessages::ReducedVehicleMessage&>(*element.message),
+                                       static_cast<ChronoMessages::ReducedVehicleMessage&>(*message));
+    // The update replaces the stored message instead of being copied into it
+    element.message = message;
+    if (changed) element.changed = ++currentVersion;
     return true;
 }
 
 bool World::updateElementsOfProfile(endpointProfile *profile, std::shared_ptr<google::protobuf::Message> message) {
-    // TODO: Handle cases of duplicate idNumbers and extra messages after all pre-existing elements have been updated.
-    if (message->GetDescriptor()->full_name().compare(MESSAGE_PACKET_TYPE)) return false;
+    if (messageCode(*message) != MessageTraits<ChronoMessages::MessagePacket>::code) return false;
     auto packet = std::static_pointer_cast<ChronoMessages::MessagePacket>(message);
-    auto finish = profile->first;
-    finish--;
-    for (auto curr = profile->last; curr != finish; curr--) {
-        std::shared_ptr<google::protobuf::Message>& message = curr->second;
-        std::string type = message->GetDescriptor()->full_name();
-        int idNumber = curr->first.second;
-        if (type.compare(VEHICLE_MESSAGE_TYPE) == 0) {
-            ChronoMessages::VehicleMessage *vehicle;
-            if (packet->vehiclemessages_size() > 0) {
-                vehicle = *(--packet->mutable_vehiclemessages()->pointer_end());
-            } else vehicle = NULL;
-            // Adds vehicle if not already present in elements
-            while (vehicle != NULL && vehicle->idnumber() > idNumber) {
-                std::shared_ptr<ChronoMessages::VehicleMessage> vehiclePtr;
-                vehiclePtr.reset(packet->mutable_vehiclemessages()->ReleaseLast());
-                updateElement(vehiclePtr, profile, vehicle->idnumber());
-                if (packet->vehiclemessages_size() > 0) {
-                    vehicle = *(--packet->mutable_vehiclemessages()->pointer_end());
-                } else vehicle = NULL;
-            }
-            // Updates vehicle if present
-            if (vehicle != NULL && vehicle->idnumber() == idNumber) {
-                message.reset(packet->mutable_vehiclemessages()->ReleaseLast());
-            } else {
-                removeElement(idNumber, profile);
-            }
-        } else return false;
-    }
-    // Adds remaining vehicles
-    while (!packet->vehiclemessages().empty()) {
-        std::shared_ptr<ChronoMessages::VehicleMessage> vehiclePtr;
-        vehiclePtr.reset(packet->mutable_vehiclemessages()->ReleaseLast());
-        updateElement(vehiclePtr, profile, vehiclePtr->idnumber());
+    std::vector<int> idNumbers;
+    idNumbers.reserve(packet->vehiclemessages_size() + packet->reducedvehicles_size());
+    for (const ChronoMessages::VehicleMessage& vehicle : packet->vehiclemessages()) {
+        idNumbers.push_back(vehicle.idnumber());
     }
+    for (const ChronoMessages::ReducedVehicleMessage& vehicle : packet->reducedvehicles()) {
+        idNumbers.push_back(vehicle.idnumber());
+    }
+    std::sort(idNumbers.begin(), idNumbers.end());
+    // Vehicles missing from the packet are gone from the client, so are removed
+    for (size_t i = profile->slots.size(); i-- > 0;) {
+        uint32_t index = slots[profile->slots[i]].index;
+        worldElement& element = elements[index];
+        if (!isVehicle(element)) return false;
+        if (!std::binary_search(idNumbers.begin(), idNumbers.end(), element.idNumber)) {
+            eraseElement(profile, index);
+        }
+    }
+    // Updates the rest, adding any not already present
+    for (const ChronoMessages::VehicleMessage& vehicle : packet->vehiclemessages()) {
+        updateVehicle(profile, vehicle.idnumber(), vehicle);
+    }
+    // updateElement copies reduced vehicles out of the packet
+    for (int i = 0; i < packet->reducedvehicles_size(); i++) {
+        updateElement(std::shared_ptr<google::protobuf::Message>(packet, packet->mutable_reducedvehicles(i)), profile,
+                      packet->reducedvehicles(i).idnumber());
+    }
+    // The packet's vehicles are used up, as they were when elements kept them
+    packet->clear_vehiclemessages();
     return true;
 }
 
 std::shared_ptr<google::protobuf::Message> World::getElement(int connectionNumber, int idNumber) {
-    auto el = elements.find(std::make_pair(connectionNumber, idNumber));
-    if (el != elements.end()) {
-        return el->second;
+    auto found = slotIndex.find(elementKey(connectionNumber, idNumber));
+    if (found != slotIndex.end()) {
+        return elementMessage(elements[slots[found->second].index]);
     } else {
         // Throws if this element doesn't exist
         throw OutOfBoundsException();
     }
 }
 
+elementHandle World::findElement(int connectionNumber, int idNumber) {
+    auto found = slotIndex.find(elementKey(connectionNumber, idNumber));
+    if (found == slotIndex.end()) return elementHandle{0, 0};
+    return elementHandle{found->second, slots[found->second].generation};
+}
+
+std::shared_ptr<google::protobuf::Message> World::getElement(elementHandle handle) {
+    if (handle.slot >= slots.size() || slots[handle.slot].generation != handle.generation) {
+        return std::shared_ptr<google::protobuf::Message>();
+    }
+    return elementMessage(elements[slots[handle.slot].index]);
+}
+
+std::vector<elementHandle> World::vehiclesWithin(double x, double y, double z, double radius) {
+    std::vector<size_t> indices;
+    vehicles.within(x, y, z, radius, indices);
+    std::vector<elementHandle> handles;
+    handles.reserve(indices.size());
+    for (size_t index : indices) {
+        uint32_t slot = vehicles.owner(index);
+        handles.push_back(elementHandle{slot, slots[slot].generation});
+    }
+    return handles;
+}
+
 std::shared_ptr<ChronoMessages::MessagePacket> World::generateWorldPacket() {
-    auto packet = std::make_shared<ChronoMessages::MessagePacket>();
+    // Built on an arena that lives as long as the packet, so its vehicles
+    // aren't allocated one sub-message at a time
+    auto arena = std::make_shared<google::protobuf::Arena>();
+    std::shared_ptr<ChronoMessages::MessagePacket> packet(
+        arena, google::protobuf::Arena::CreateMessage<ChronoMessages::MessagePacket>(arena.get()));
+    packet->set_connectionnumber(-1);
+    packet->mutable_vehiclemessages()->Reserve(vehicles.size());
+    // Every vehicle goes straight from the store into the packet
+    for (size_t i = 0; i < vehicles.size(); i++) {
+        vehicles.get(i, packet->add_vehiclemessages());
+    }
+    for (const worldElement& element : elements) {
+        if (element.message != NULL && isVehicle(element)) {
+            *packet->add_reducedvehicles() = static_cast<const ChronoMessages::ReducedVehicleMessage&>(*element.message);
+        }
+    }
+    return packet;
+}
+
+std::shared_ptr<ChronoMessages::MessagePacket> World::generateDeltaPacket(uint64_t baseline) {
+    if (baseline == 0 || baseline < forgottenVersion) {
+        auto packet = generateWorldPacket();
+        packet->set_snapshot(currentVersion);
+        return packet;
+    }
+    auto arena = std::make_shared<google::protobuf::Arena>();
+    std::shared_ptr<ChronoMessages::MessagePacket> packet(
+        arena, google::protobuf::Arena::CreateMessage<ChronoMessages::MessagePacket>(arena.get()));
     packet->set_connectionnumber(-1);
-    // Iterate through every element and add it to the packet
-    for (auto curr : elements) {
-        std::string type = curr.second->GetDescriptor()->full_name();
-        if (type.compare(VEHICLE_MESSAGE_TYPE) == 0) {
-            packet->add_vehiclemessages()->MergeFrom(*curr.second);
+    packet->set_snapshot(currentVersion);
+    packet->set_baseline(baseline);
+    for (const worldElement& element : elements) {
+        if (element.changed <= baseline || !isVehicle(element)) continue;
+        if (element.message == NULL) {
+            vehicles.get(element.vehicle, packet->add_vehiclemessages());
+        } else {
+            *packet->add_reducedvehicles() = static_cast<const ChronoMessages::ReducedVehicleMessage&>(*element.message);
         }
     }
+    // Newest first; a vehicle removed and added again is sent as it is now
+    for (auto removal = removals.rbegin(); removal != removals.rend() && removal->removed > baseline; removal++) {
+        if (slotIndex.count(elementKey(removal->connectionNumber, removal->idNumber))) continue;
+        ChronoMessages::ControlMessage *control = packet->add_removals();
+        control->set_connectionnumber(removal->connectionNumber);
+        control->set_idnumber(removal->idNumber);
+        control->set_action(ChronoMessages::ControlMessage::REMOVE_VEHICLE);
+    }
     return packet;
 }
 
+bool World::acknowledgeSnapshot(endpointProfile *profile, uint64_t snapshot) {
+    if (snapshot < profile->acknowledged || snapshot > currentVersion) return false;
+    profile->acknowledged = snapshot;
+    return true;
+}
+
+uint64_t World::acknowledgedSnapshot(endpointProfile *profile) {
+    return profile->acknowledged;
+}
+
+std::map<uint64_t, std::vector<boost::asio::ip::udp::endpoint>> World::endpointsByBaseline() {
+    std::map<uint64_t, std::vector<boost::asio::ip::udp::endpoint>> groups;
+    for (auto& endpointPair : endpoints) {
+        groups[endpointPair.second->acknowledged].push_back(endpointPair.second->endpoint);
+    }
+    return groups;
+}
+
 bool World::removeElement(int idNumber, endpointProfile *profile) {
-    auto mess = elements.find(std::pair<int, int>(profile->connectionNumber, idNumber));
+    auto found = slotIndex.find(elementKey(profile->connectionNumber, idNumber));
     // Element to be removed must be present
-    if (mess == elements.end()) {
+    if (found == slotIndex.end()) {
         return false;
     }
-    // Move profile's iterators if needed
-    if (mess == profile->last) {
-        profile->last--;
-        mess--;
-    }
-    if (mess == profile->first) {
-        profile->first++;
-    }
-    elements.erase(mess);
-    profile->count--;
+    eraseElement(profile, slots[found->second].index);
     return true;
 }
 
@@ -185,8 +367,10 @@ bool World::removeConnection(endpointProfile *profile) {
     if (prof == endpoints.end()) {
         return false;
     }
-    // Removes all owned elements
-    elements.erase(profile->first, ++profile->last);
+    // Removes all owned elements, last first so the profile's list never shuffles
+    while (!profile->slots.empty()) {
+        eraseElement(profile, slots[profile->slots.back()].index);
+    }
     endpoints.erase(prof);
     delete profile;
     return true;
@@ -195,6 +379,8 @@ bool World::removeConnection(endpointProfile *profile) {
 endpointProfile *World::verifyConnection(int connectionNumber, boost::asio::ip::udp::endpoint endpoint) {
     auto prof = endpoints.find(connectionNumber);
     if (prof == endpoints.end()) return NULL;
+    // Connection numbers are handed out in order, so the number alone proves nothing
+    if (prof->second->endpoint != endpoint) return NULL;
     return prof->second;
 }
 
@@ -203,9 +389,22 @@ int World::elementCount() {
 }
 
 int World::profileElementCount(endpointProfile *profile) {
-    return profile->count;
+    return profile->slots.size();
 }
 
 int World::connectionCount() {
     return endpoints.size();
 }
+
+uint64_t World::version() {
+    return currentVersion;
+}
+
+std::vector<boost::asio::ip::udp::endpoint> World::registeredEndpoints() {
+    std::vector<boost::asio::ip::udp::endpoint> registered;
+    registered.reserve(endpoints.size());
+    for (auto& endpointPair : endpoints) {
+        registered.push_back(endpointPair.second->endpoint);
+    }
+    return registered;
+}
@@ -21,14 +21,34 @@
 
 #include <boost/asio.hpp>
 #include <google/protobuf/message.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "ChronoMessages.pb.h"
+#include "VehicleStore.h"
+
+// Removals remembered for delta snapshots. A client whose baseline is older
+// than the oldest one forgotten gets the whole world instead.
+#define WORLD_REMOVAL_HISTORY 1024
 
 // Uniquely identifies any registered endoint in the world.
 struct endpointProfile;
 
+// Refers to a single world element without a lookup. A handle outlives its
+// element safely: once the element is removed the handle is stale, even if
+// its slot has since been given to another element.
+struct elementHandle {
+    uint32_t slot;
+    uint32_t generation;
+};
+
 class World {
 public:
+    World();
     ~World();
 
     // Adds new connection number to list of numbers server can receive from.
@@ -48,16 +68,46 @@ public:
     bool updateElement(std::shared_ptr<google::protobuf::Message> message, endpointProfile *profile, int idNumber);
 
     // Updates all the elements in the given profile with the message packet.
-    // Efficient, as long as the elemnts are sorted correctly in the packet
+    // Vehicles of the profile that are missing from the packet are removed.
     bool updateElementsOfProfile(endpointProfile *profile, std::shared_ptr<google::protobuf::Message> packet);
 
     // Returns a shared_ptr to the corresponding element. If element does not
-    // exist, returns a shared_ptr to NULL.
+    // exist, returns a shared_ptr to NULL. Vehicles are returned as a copy of
+    // their stored state.
     std::shared_ptr<google::protobuf::Message> getElement(int connectionNumber, int idNumber);
 
+    // Returns a handle to the corresponding element, or a handle that is
+    // never valid if the element doesn't exist.
+    elementHandle findElement(int connectionNumber, int idNumber);
+
+    // Returns the element handle refers to, or a shared_ptr to NULL if
+    // handle is stale.
+    std::shared_ptr<google::protobuf::Message> getElement(elementHandle handle);
+
+    // Returns handles to every vehicle with its chassis within radius of
+    // (x, y, z).
+    std::vector<elementHandle> vehiclesWithin(double x, double y, double z, double radius);
+
     // Returns a packet containing all world elements
     std::shared_ptr<ChronoMessages::MessagePacket> generateWorldPacket();
 
+    // Returns a packet holding only the vehicles changed and removed since
+    // snapshot baseline, or the whole world if baseline is 0 or older than
+    // the removals still remembered.
+    std::shared_ptr<ChronoMessages::MessagePacket> generateDeltaPacket(uint64_t baseline);
+
+    // Records that profile's client has received snapshot. Returns false if
+    // snapshot is older than one it already acknowledged or newer than the
+    // world.
+    bool acknowledgeSnapshot(endpointProfile *profile, uint64_t snapshot);
+
+    // Newest snapshot profile's client has acknowledged, 0 if none.
+    uint64_t acknowledgedSnapshot(endpointProfile *profile);
+
+    // Endpoints of every connected client, grouped by the snapshot each has
+    // acknowledged, so every group can be sent the same delta.
+    std::map<uint64_t, std::vector<boost::asio::ip::udp::endpoint>> endpointsByBaseline();
+
     // Removes and element from the world. Returns true (success) if element
     // exists and connectionNumber is the correct owner.
     bool removeElement(int idNumber, endpointProfile *profile);
@@ -80,13 +130,77 @@ public:
     // Number of client connections
     int connectionCount();
 
+    // Endpoints of every connected client, to broadcast world state to.
+    std::vector<boost::asio::ip::udp::endpoint> registeredEndpoints();
+
+    // Changes whenever an element is added, updated or removed, so anything
+    // derived from the elements, like a serialized snapshot, is still good as
+    // long as the version it was built at is current. An update that only
+    // moves a vehicle's clock forward isn't a change.
+    uint64_t version();
+
 private:
+    struct worldElement {
+        int connectionNumber;
+        int idNumber;
+        // Slot that handles to this element go through
+        uint32_t slot;
+        // Position in the owning profile's list of slots
+        uint32_t profileIndex;
+        // Position in vehicles if the element is a vehicle, in which case
+        // message is NULL
+        uint32_t vehicle;
+        // World version of the element's last change
+        uint64_t changed;
+        std::shared_ptr<google::protobuf::Message> message;
+    };
+
+    struct removedElement {
+        int connectionNumber;
+        int idNumber;
+        // World version of the removal
+        uint64_t removed;
+    };
+
+    struct elementSlot {
+        // Position of the element in elements while the slot is in use
+        uint32_t index;
+        // Bumped whenever the slot is freed, leaving old handles stale
+        uint32_t generation;
+    };
+
+    static uint64_t elementKey(int connectionNumber, int idNumber);
+    // True for vehicles, full or reduced, which snapshots carry
+    static bool isVehicle(const worldElement& element);
+
+    uint32_t insertElement(endpointProfile *profile, int idNumber, std::shared_ptr<google::protobuf::Message> message);
+    // Copies vehicle into the element idNumber, adding it if new. Returns
+    // false if the element isn't a vehicle or the vehicle has too many wheels.
+    bool updateVehicle(endpointProfile *profile, int idNumber, const ChronoMessages::VehicleMessage& vehicle);
+    void eraseElement(endpointProfile *profile, uint32_t index);
+    std::shared_ptr<google::protobuf::Message> elementMessage(const worldElement& element);
+
     // Set of connection numbers with no endpoints
-    std::set<int> registeredConnectionNumbers;
-    // Maps connection numbers to endpoints and owned element idNumbers
-    std::map<int, endpointProfile *> endpoints;
-    // Maps connection number-id number pair to elements in the world
-    std::map<std::pair<int, int>, std::shared_ptr<google::protobuf::Message>> elements;
+    std::unordered_set<int> registeredConnectionNumbers;
+    // Maps connection numbers to endpoints and owned element slots
+    std::unordered_map<int, endpointProfile *> endpoints;
+    // Every element in the world, packed with no gaps. Removing one moves the
+    // last element into its place.
+    std::vector<worldElement> elements;
+    // Slots of elements, indexed by elementHandle::slot, with freed slots
+    // waiting in freeSlots to be reused
+    std::vector<elementSlot> slots;
+    std::vector<uint32_t> freeSlots;
+    // State of every vehicle element, which holds no message of its own
+    VehicleStore vehicles;
+    // Maps connection number-id number keys to slots
+    std::unordered_map<uint64_t, uint32_t> slotIndex;
+    // Bumped by every change to elements
+    uint64_t currentVersion;
+    // Most recent removals, oldest first
+    std::deque<removedElement> removals;
+    // Version of the newest removal dropped from removals
+    uint64_t forgottenVersion;
 };
 
 class OutOfBoundsException : std::exception {
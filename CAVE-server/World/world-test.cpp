@@ -3,6 +3,7 @@
 #include "World.h"
 #include "ChronoMessages.pb.h"
 #include "MessageConversions.h"
+#include "VehicleWheels.h"
 
 #include "chrono/core/ChFileutils.h"
 #include "chrono/core/ChStream.h"
@@ -239,5 +240,199 @@ int main(int argc, char **argv) {
         std::cout << "PASSED -- World test 15" << '\n';
     } else std::cout << "FAILED -- World test 15" << '\n';
 
+    world.registerEndpoint(serverEndpoint, 3);
+    std::vector<boost::asio::ip::udp::endpoint> endpoints = world.registeredEndpoints();
+    if (endpoints.size() == 1 && endpoints[0] == serverEndpoint) {
+        std::cout << "PASSED -- World test 16" << '\n';
+    } else std::cout << "FAILED -- World test 16" << '\n';
+
+    endpointProfile *profile3 = world.verifyConnection(3, serverEndpoint);
+    uint64_t before = world.version();
+    world.updateElement(vehiclePtr, profile3, 0);
+    uint64_t updatedVersion = world.version();
+    world.generateWorldPacket();
+    world.registeredEndpoints();
+    uint64_t readVersion = world.version();
+    world.removeElement(0, profile3);
+    if (updatedVersion != before && readVersion == updatedVersion && world.version() != readVersion) {
+        std::cout << "PASSED -- World test 17" << '\n';
+    } else std::cout << "FAILED -- World test 17" << '\n';
+
+    world.updateElement(vehiclePtr, profile3, 1);
+    elementHandle handle = world.findElement(3, 1);
+    bool found = world.getElement(handle)->DebugString() == vehiclePtr->DebugString();
+    world.removeElement(1, profile3);
+    // The freed slot goes to the next element, which the old handle must not reach
+    world.updateElement(vehiclePtr, profile3, 2);
+    if (found && world.getElement(handle) == NULL && world.getElement(world.findElement(3, 2))->DebugString() == vehiclePtr->DebugString() &&
+        world.getElement(world.findElement(3, 1)) == NULL) {
+        std::cout << "PASSED -- World test 18" << '\n';
+    } else std::cout << "FAILED -- World test 18" << '\n';
+
+    // Vehicle 3 is moved 10 along x, and vehicles 2 and 4 are moved 20
+    auto nearVehicle = std::make_shared<ChronoMessages::VehicleMessage>(*vehiclePtr);
+    nearVehicle->mutable_chassiscom()->set_x(vehiclePtr->chassiscom().x() + 10);
+    world.updateElement(nearVehicle, profile3, 3);
+    auto farVehicle = std::make_shared<ChronoMessages::VehicleMessage>(*vehiclePtr);
+    farVehicle->mutable_chassiscom()->set_x(vehiclePtr->chassiscom().x() + 20);
+    world.updateElement(farVehicle, profile3, 4);
+    world.updateElement(farVehicle, profile3, 2);
+    const ChronoMessages::MVector& center = vehiclePtr->chassiscom();
+    std::vector<elementHandle> near = world.vehiclesWithin(center.x(), center.y(), center.z(), 10);
+    if (near.size() == 1 && world.getElement(near[0])->DebugString() == nearVehicle->DebugString() &&
+        world.vehiclesWithin(center.x() + 15, center.y(), center.z(), 5).size() == 3) {
+        std::cout << "PASSED -- World test 19" << '\n';
+    } else std::cout << "FAILED -- World test 19" << '\n';
+
+    uint64_t baseline = world.version();
+    bool acknowledged = world.acknowledgeSnapshot(profile3, baseline) && !world.acknowledgeSnapshot(profile3, baseline + 1) &&
+                        world.acknowledgedSnapshot(profile3) == baseline;
+    auto groups = world.endpointsByBaseline();
+    bool grouped = groups.size() == 1 && groups.count(baseline) && groups[baseline].size() == 1;
+    // Only the clock of vehicle 4 moves, which isn't worth sending
+    auto clockOnly = std::make_shared<ChronoMessages::VehicleMessage>(*farVehicle);
+    clockOnly->set_chtime(farVehicle->chtime() + 1);
+    world.updateElement(clockOnly, profile3, 4);
+    bool clockIgnored = world.version() == baseline;
+    auto moved = std::make_shared<ChronoMessages::VehicleMessage>(*nearVehicle);
+    moved->set_speed(nearVehicle->speed() + 1);
+    world.updateElement(moved, profile3, 3);
+    world.removeElement(2, profile3);
+    auto delta = world.generateDeltaPacket(baseline);
+    auto full = world.generateDeltaPacket(0);
+    if (acknowledged && grouped && clockIgnored && delta->baseline() == baseline && delta->snapshot() == world.version() &&
+        delta->vehiclemessages_size() == 1 && delta->vehiclemessages(0).DebugString() == moved->DebugString() &&
+        delta->removals_size() == 1 && delta->removals(0).idnumber() == 2 && !full->has_baseline() &&
+        full->vehiclemessages_size() == 2) {
+        std::cout << "PASSED -- World test 20" << '\n';
+    } else std::cout << "FAILED -- World test 20" << '\n';
+
+    // Once the removals since a baseline are forgotten, it gets the whole world
+    for (int i = 0; i <= WORLD_REMOVAL_HISTORY; i++) {
+        world.updateElement(vehiclePtr, profile3, 5);
+        world.removeElement(5, profile3);
+    }
+    delta = world.generateDeltaPacket(baseline);
+    if (!delta->has_baseline() && delta->vehiclemessages_size() == 2 && delta->removals_size() == 0 &&
+        world.generateDeltaPacket(world.version() - 1)->removals_size() == 1) {
+        std::cout << "PASSED -- World test 21" << '\n';
+    } else std::cout << "FAILED -- World test 21" << '\n';
+
+    // A reduced vehicle is carried by snapshots alongside the full ones, and its removal is sent like theirs
+    auto reducedVehicle = std::make_shared<ChronoMessages::ReducedVehicleMessage>();
+    reducedVehicle->set_timestamp(0);
+    reducedVehicle->set_connectionnumber(3);
+    reducedVehicle->set_idnumber(6);
+    reducedVehicle->set_chtime(1);
+    reducedVehicle->set_speed(2);
+    *reducedVehicle->mutable_chassiscom() = vehiclePtr->chassiscom();
+    *reducedVehicle->mutable_chassisrot() = vehiclePtr->chassisrot();
+    for (int i = 0; i < 4; i++) {
+        reducedVehicle->add_wheelspin(i);
+        reducedVehicle->add_wheelsteer(0);
+        reducedVehicle->add_wheeltravel(0);
+    }
+    uint64_t reducedBaseline = world.version();
+    world.updateElement(reducedVehicle, profile3, 6);
+    uint64_t reducedAdded = world.version();
+    auto reducedTicked = std::make_shared<ChronoMessages::ReducedVehicleMessage>(*reducedVehicle);
+    reducedTicked->set_chtime(2);
+    world.updateElement(reducedTicked, profile3, 6);
+    bool reducedClockIgnored = world.version() == reducedAdded;
+    auto reducedDelta = world.generateDeltaPacket(reducedBaseline);
+    auto reducedWorld = world.generateWorldPacket();
+    world.removeElement(6, profile3);
+    auto reducedRemoved = world.generateDeltaPacket(reducedAdded);
+    if (reducedAdded != reducedBaseline && reducedClockIgnored && reducedDelta->reducedvehicles_size() == 1 &&
+        reducedDelta->vehiclemessages_size() == 0 && reducedDelta->reducedvehicles(0).idnumber() == 6 &&
+        reducedWorld->reducedvehicles_size() == 1 && reducedWorld->vehiclemessages_size() == 2 &&
+        reducedRemoved->removals_size() == 1 && reducedRemoved->removals(0).idnumber() == 6 &&
+        reducedRemoved->reducedvehicles_size() == 0) {
+        std::cout << "PASSED -- World test 22" << '\n';
+    } else std::cout << "FAILED -- World test 22" << '\n';
+
+    // A vehicle with more wheels than the HMMWV is stored and sent whole, and moving only one of them is a change
+    auto truck = std::make_shared<ChronoMessages::VehicleMessage>(*vehiclePtr);
+    resizeWheels(truck.get(), 8);
+    for (int i = 0; i < truck->wheelpositions_size(); i++) truck->set_wheelpositions(i, i);
+    for (int i = 0; i < truck->wheelrotations_size(); i++) truck->set_wheelrotations(i, i % WHEEL_ROTATION_VALUES == 0);
+    world.updateElement(truck, profile3, 7);
+    bool truckStored = world.getElement(world.findElement(3, 7))->DebugString() == truck->DebugString();
+    uint64_t truckAdded = world.version();
+    auto truckMoved = std::make_shared<ChronoMessages::VehicleMessage>(*truck);
+    truckMoved->set_wheelpositions(23, -1);
+    world.updateElement(truckMoved, profile3, 7);
+    auto truckDelta = world.generateDeltaPacket(truckAdded);
+    world.removeElement(7, profile3);
+    if (truckStored && world.version() != truckAdded && truckDelta->vehiclemessages_size() == 1 &&
+        wheelCount(truckDelta->vehiclemessages(0)) == 8 && truckDelta->vehiclemessages(0).wheelpositions(23) == -1) {
+        std::cout << "PASSED -- World test 23" << '\n';
+    } else std::cout << "FAILED -- World test 23" << '\n';
+
+    // A DISCONNECT is only acted on for the profile verifyConnection returns,
+    // so one from any endpoint but the owner's is ignored
+    boost::asio::ip::udp::endpoint spoofedEndpoint(serverEndpoint.address(), serverEndpoint.port() + 1);
+    int connectionsBefore = world.connectionCount();
+    endpointProfile *spoofedProfile = world.verifyConnection(3, spoofedEndpoint);
+    if (spoofedProfile != NULL) world.removeConnection(spoofedProfile);
+    if (spoofedProfile == NULL && world.verifyConnection(3, serverEndpoint) == profile3 &&
+        world.connectionCount() == connectionsBefore) {
+        std::cout << "PASSED -- World test 24" << '\n';
+    } else std::cout << "FAILED -- World test 24" << '\n';
+
+    // A reduced vehicle parsed onto a packet's arena is stored as a copy, so the world doesn't hold on to the packet
+    google::protobuf::Arena reducedArena;
+    std::shared_ptr<ChronoMessages::MessagePacket> arenaPacket(
+        google::protobuf::Arena::CreateMessage<ChronoMessages::MessagePacket>(&reducedArena),
+        [](ChronoMessages::MessagePacket*) {});
+    *arenaPacket->add_reducedvehicles() = *reducedVehicle;
+    world.updateElement(std::shared_ptr<google::protobuf::Message>(arenaPacket, arenaPacket->mutable_reducedvehicles(0)),
+                        profile3, 6);
+    auto reducedStored = world.getElement(world.findElement(3, 6));
+    bool reducedCopied = reducedStored && reducedStored->GetArena() == NULL && arenaPacket.use_count() == 1 &&
+                         reducedStored->DebugString() == reducedVehicle->DebugString();
+    world.removeElement(6, profile3);
+    if (reducedCopied) {
+        std::cout << "PASSED -- World test 25" << '\n';
+    } else std::cout << "FAILED -- World test 25" << '\n';
+
+    // Wheels share one array per field, so growing one vehicle's or removing another's leaves the rest intact
+    auto wheeled = [&vehiclePtr](int wheels, double value) {
+        auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>(*vehiclePtr);
+        resizeWheels(vehicle.get(), wheels);
+        for (int i = 0; i < vehicle->wheelpositions_size(); i++) vehicle->set_wheelpositions(i, value + i);
+        for (int i = 0; i < vehicle->wheelrotations_size(); i++) vehicle->set_wheelrotations(i, value - i);
+        return vehicle;
+    };
+    auto twoWheels = wheeled(2, 100);
+    auto eightWheels = wheeled(8, 200);
+    auto fourWheels = wheeled(4, 300);
+    world.updateElement(twoWheels, profile3, 8);
+    world.updateElement(eightWheels, profile3, 9);
+    world.updateElement(fourWheels, profile3, 10);
+    auto sixWheels = wheeled(6, 400);
+    world.updateElement(sixWheels, profile3, 8);
+    world.removeElement(9, profile3);
+    auto grown = world.getElement(world.findElement(3, 8));
+    auto kept = world.getElement(world.findElement(3, 10));
+    world.removeElement(8, profile3);
+    world.removeElement(10, profile3);
+    if (grown && kept && grown->DebugString() == sixWheels->DebugString() &&
+        kept->DebugString() == fourWheels->DebugString()) {
+        std::cout << "PASSED -- World test 26" << '\n';
+    } else std::cout << "FAILED -- World test 26" << '\n';
+
+    // A vehicle with more wheels than the store keeps is turned away, and an
+    // update that grows one past them leaves its wheels as they were
+    auto tooMany = wheeled(VEHICLE_MAX_WHEELS + 1, 500);
+    bool rejected = !world.updateElement(tooMany, profile3, 11) && !world.getElement(world.findElement(3, 11));
+    world.updateElement(fourWheels, profile3, 12);
+    rejected &= !world.updateElement(tooMany, profile3, 12);
+    auto unchanged = world.getElement(world.findElement(3, 12));
+    world.removeElement(12, profile3);
+    if (rejected && unchanged && unchanged->DebugString() == fourWheels->DebugString()) {
+        std::cout << "PASSED -- World test 27" << '\n';
+    } else std::cout << "FAILED -- World test 27" << '\n';
+
     return 0;
 }
@@ -17,6 +17,7 @@
 // =============================================================================
 
 #include "MessageConversions.h"
+#include "VehicleWheels.h"
 
 using namespace chrono;
 using namespace chrono::vehicle;
@@ -31,24 +32,8 @@ ChronoMessages::VehicleMessage generateVehicleMessageFromWheeledVehicle(
     message.set_speed(vehicle->GetVehicleSpeed());
 
     messageFromVector(message.mutable_chassiscom(), vehicle->GetChassis()->GetPos());
-    messageFromVector(message.mutable_backleftwheelcom(),
-                      vehicle->GetWheelPos(WheelID(1, LEFT)));
-    messageFromVector(message.mutable_backrightwheelcom(),
-                      vehicle->GetWheelPos(WheelID(1, RIGHT)));
-    messageFromVector(message.mutable_frontleftwheelcom(),
-                      vehicle->GetWheelPos(WheelID(0, LEFT)));
-    messageFromVector(message.mutable_frontrightwheelcom(),
-                      vehicle->GetWheelPos(WheelID(0, RIGHT)));
-
     messageFromQuaternion(message.mutable_chassisrot(), vehicle->GetChassis()->GetRot());
-    messageFromQuaternion(message.mutable_backleftwheelrot(),
-                          vehicle->GetWheelRot(WheelID(1, LEFT)));
-    messageFromQuaternion(message.mutable_backrightwheelrot(),
-                          vehicle->GetWheelRot(WheelID(1, RIGHT)));
-    messageFromQuaternion(message.mutable_frontleftwheelrot(),
-                          vehicle->GetWheelRot(WheelID(0, LEFT)));
-    messageFromQuaternion(message.mutable_frontrightwheelrot(),
-                          vehicle->GetWheelRot(WheelID(0, RIGHT)));
+    messageFromWheels(&message, vehicle);
 
     return message;
 }
@@ -67,3 +52,21 @@ void messageFromQuaternion(ChronoMessages::MQuaternion* message,
     message->set_e2(quaternion.e2());
     message->set_e3(quaternion.e3());
 }
+
+void messageFromWheels(ChronoMessages::VehicleMessage* message, ChWheeledVehicle* vehicle) {
+    int wheels = 2 * vehicle->GetNumberAxles();
+    resizeWheels(message, wheels);
+    double* position = message->mutable_wheelpositions()->mutable_data();
+    double* rotation = message->mutable_wheelrotations()->mutable_data();
+    for (int i = 0; i < wheels; i++) {
+        const ChVector<>& pos = vehicle->GetWheelPos(WheelID(i));
+        const ChQuaternion<>& rot = vehicle->GetWheelRot(WheelID(i));
+        *position++ = pos.x();
+        *position++ = pos.y();
+        *position++ = pos.z();
+        *rotation++ = rot.e0();
+        *rotation++ = rot.e1();
+        *rotation++ = rot.e2();
+        *rotation++ = rot.e3();
+    }
+}
@@ -31,5 +31,8 @@ void messageFromVector(ChronoMessages::MVector* message,
                        ChVector<> vector);
 void messageFromQuaternion(ChronoMessages::MQuaternion* message,
                            ChQuaternion<> quaternion);
+// Fills message's wheel arrays with every wheel of vehicle, however many
+// axles it has.
+void messageFromWheels(ChronoMessages::VehicleMessage* message, ChWheeledVehicle* vehicle);
 
 #endif
@@ -1,5 +1,6 @@
 #include "ServerVehicle.h"
 #include "chrono/assets/ChTexture.h"
+#include "VehicleWheels.h"
 #define VEH_NUM_WHEELS 4
 
 using namespace chrono;
@@ -14,19 +15,7 @@ ServerVehicle::ServerVehicle(ChSystem* system) {
     m_hitbox->SetPos(ChVector<>(0, 0, 1));
 
     for (int i = 0; i < VEH_NUM_WHEELS; i++) {
-        std::shared_ptr<ChBody> wheel = std::make_shared<ChBody>();
-        wheel->SetBodyFixed(true);
-        auto cyl = std::make_shared<ChCylinderShape>();
-        cyl->GetCylinderGeometry().rad = 0.0254 * 18.15;
-        cyl->GetCylinderGeometry().p1 = ChVector<>(0, 0.0254 * 10 / 2, 0);
-        cyl->GetCylinderGeometry().p2 = ChVector<>(0, -0.0254 * 10 / 2, 0);
-        wheel->AddAsset(cyl);
-
-        auto tex = std::make_shared<ChTexture>();
-        tex->SetTextureFilename(GetChronoDataFile("bluwhite.png"));
-        wheel->AddAsset(tex);
-        m_wheels.push_back(wheel);
-        system->Add(wheel);
+        addWheel(system);
     }
 
     auto sphere = std::make_shared<ChSphereShape>();
@@ -53,6 +42,33 @@ ServerVehicle::~ServerVehicle() {
   m_system->RemoveBody(m_chassis);
 }
 
+void ServerVehicle::addWheel(ChSystem* system) {
+    std::shared_ptr<ChBody> wheel = std::make_shared<ChBody>();
+    wheel->SetBodyFixed(true);
+    auto cyl = std::make_shared<ChCylinderShape>();
+    cyl->GetCylinderGeometry().rad = 0.0254 * 18.15;
+    cyl->GetCylinderGeometry().p1 = ChVector<>(0, 0.0254 * 10 / 2, 0);
+    cyl->GetCylinderGeometry().p2 = ChVector<>(0, -0.0254 * 10 / 2, 0);
+    wheel->AddAsset(cyl);
+
+    auto tex = std::make_shared<ChTexture>();
+    tex->SetTextureFilename(GetChronoDataFile("bluwhite.png"));
+    wheel->AddAsset(tex);
+    m_wheels.push_back(wheel);
+    system->Add(wheel);
+}
+
+bool ServerVehicle::setWheelCount(int wheels) {
+    // A bad count would otherwise have us build a body per claimed wheel
+    if (wheels < 0 || wheels > VEHICLE_MAX_WHEELS) return false;
+    while ((int)m_wheels.size() < wheels) addWheel(m_system);
+    while ((int)m_wheels.size() > wheels) {
+        m_system->RemoveBody(m_wheels.back());
+        m_wheels.pop_back();
+    }
+    return true;
+}
+
 ChBody& ServerVehicle::GetChassis() {
     return *m_chassis;
 }
@@ -72,29 +88,31 @@ void ServerVehicle::update(ChronoMessages::VehicleMessage& message) {
       ChQuaternion<>(message.chassisrot().e0(), message.chassisrot().e1(),
                      message.chassisrot().e2(), message.chassisrot().e3()));
 
-  m_wheels.at(0)->SetPos(ChVector<>(message.backleftwheelcom().x(),
-                                    message.backleftwheelcom().y(),
-                                    message.backleftwheelcom().z()));
-  m_wheels.at(1)->SetPos(ChVector<>(message.backrightwheelcom().x(),
-                                    message.backrightwheelcom().y(),
-                                    message.backrightwheelcom().z()));
-  m_wheels.at(2)->SetPos(ChVector<>(message.frontleftwheelcom().x(),
-                                    message.frontleftwheelcom().y(),
-                                    message.frontleftwheelcom().z()));
-  m_wheels.at(3)->SetPos(ChVector<>(message.frontrightwheelcom().x(),
-                                    message.frontrightwheelcom().y(),
-                                    message.frontrightwheelcom().z()));
-
-  m_wheels.at(0)->SetRot(ChQuaternion<>(
-      message.backleftwheelrot().e0(), message.backleftwheelrot().e1(),
-      message.backleftwheelrot().e2(), message.backleftwheelrot().e3()));
-  m_wheels.at(1)->SetRot(ChQuaternion<>(
-      message.backrightwheelrot().e0(), message.backrightwheelrot().e1(),
-      message.backrightwheelrot().e2(), message.backrightwheelrot().e3()));
-  m_wheels.at(2)->SetRot(ChQuaternion<>(
-      message.frontleftwheelrot().e0(), message.frontleftwheelrot().e1(),
-      message.frontleftwheelrot().e2(), message.frontleftwheelrot().e3()));
-  m_wheels.at(3)->SetRot(ChQuaternion<>(
-      message.frontrightwheelrot().e0(), message.frontrightwheelrot().e1(),
-      message.frontrightwheelrot().e2(), message.frontrightwheelrot().e3()));
+  int wheels = wheelCount(message);
+  if (!setWheelCount(wheels)) return;
+  const double* position = message.wheelpositions().data();
+  const double* rotation = message.wheelrotations().data();
+  for (int i = 0; i < wheels; i++, position += WHEEL_POSITION_VALUES, rotation += WHEEL_ROTATION_VALUES) {
+    m_wheels[i]->SetPos(ChVector<>(position[0], position[1], position[2]));
+    m_wheels[i]->SetRot(ChQuaternion<>(rotation[0], rotation[1], rotation[2], rotation[3]));
+  }
+}
+
+void ServerVehicle::update(ChronoMessages::ReducedVehicleMessage& message, const vehicleGeometry& geometry) {
+  ChVector<> chassisPos(message.chassiscom().x(), message.chassiscom().y(), message.chassiscom().z());
+  ChQuaternion<> chassisRot(message.chassisrot().e0(), message.chassisrot().e1(),
+                            message.chassisrot().e2(), message.chassisrot().e3());
+  m_chassis->SetPos(chassisPos);
+  m_hitbox->SetPos(chassisPos + ChVector<>(0, .1, .5));
+  m_chassis->SetRot(chassisRot);
+  m_hitbox->SetRot(chassisRot);
+
+  ChronoMessages::MVector position;
+  ChronoMessages::MQuaternion rotation;
+  if (!setWheelCount((int)geometry.hardpoints.size())) return;
+  for (int i = 0; i < (int)m_wheels.size(); i++) {
+    if (!rebuildWheel(message, geometry, i, &position, &rotation)) continue;
+    m_wheels[i]->SetPos(ChVector<>(position.x(), position.y(), position.z()));
+    m_wheels[i]->SetRot(ChQuaternion<>(rotation.e0(), rotation.e1(), rotation.e2(), rotation.e3()));
+  }
 }
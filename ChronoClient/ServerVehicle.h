@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include "ChronoMessages.pb.h"
+#include "WheelKinematics.h"
 #include "chrono/physics/ChSystem.h"
 #include "chrono/utils/ChUtilsInputOutput.h"
 #include "physics/ChBodyEasy.h"
@@ -16,9 +17,19 @@ class ServerVehicle {
   ~ServerVehicle();
 
   ChBody& GetChassis();
+  // Adds or removes wheel bodies to match the wheels in the message, so
+  // vehicles with more than two axles are drawn whole.
   void update(ChronoMessages::VehicleMessage&);
+  // Wheels are rebuilt from geometry, which must be that of the vehicle that
+  // sent message.
+  void update(ChronoMessages::ReducedVehicleMessage& message, const vehicleGeometry& geometry);
 
  private:
+  void addWheel(ChSystem* system);
+  // Returns false, leaving the wheels as they were, for a negative count or
+  // one over VEHICLE_MAX_WHEELS.
+  bool setWheelCount(int wheels);
+
   ChSystem* m_system;
   std::shared_ptr<ChBody> m_chassis;
   std::shared_ptr<ChBodyEasyBox> m_hitbox;
@@ -33,9 +33,23 @@
 #define CONNECTION_REQUEST 8
 #define CONNECTION_ACCEPT 9
 #define CONNECTION_DECLINE 10
+#define CONNECTION_CHALLENGE 13
+
+#define ACK_MESSAGE 11
+#define CONTROL_MESSAGE 12
+#define SNAPSHOT_ACK 14
+#define REDUCED_VEHICLE_MESSAGE 15
+
+// Traffic classes outgoing messages are queued in, highest priority first
+#define TRAFFIC_CONTROL 0
+#define TRAFFIC_STATE 1
+#define TRAFFIC_DSRC 2
+#define TRAFFIC_BULK 3
+#define TRAFFIC_CLASSES 4
 
 #define VEHICLE_MESSAGE_TYPE "ChronoMessages.VehicleMessage"
-#define VEHICLE_MESSAGE_SIZE 361
+// Serialized size of a four wheeled VehicleMessage
+#define VEHICLE_MESSAGE_SIZE 326
 #define DSRC_MESSAGE_TYPE "ChronoMessages.DSRCMessage"
 #define MESSAGE_PACKET_TYPE "ChronoMessages.MessagePacket"
 
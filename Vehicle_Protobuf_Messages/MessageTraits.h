@@ -0,0 +1,147 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Compile-time registry mapping each protobuf message sent over the network
+//  to its wire code. Only types with a MessageTraits specialization can be
+//  sent; using any other type fails to compile. latestState marks messages
+//  holding a sender's complete state, which any newer one makes obsolete.
+//  reliable marks messages the reliable channel retransmits until they are
+//  acknowledged. trafficClass is the send queue a message waits in unless
+//  the handler is told otherwise. keyedState marks messages holding the state
+//  of one thing a sender owns, named by stateKey, so only the newest for each
+//  key is worth sending.
+//
+// =============================================================================
+
+#ifndef MESSAGETRAITS_H
+#define MESSAGETRAITS_H
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <google/protobuf/message.h>
+
+#include "MessageCodes.h"
+#include "ChronoMessages.pb.h"
+
+template<class T> struct MessageTraits {
+    static_assert(!std::is_same<T, T>::value, "Message type has no wire code in MessageTraits.h");
+};
+
+template<> struct MessageTraits<ChronoMessages::VehicleMessage> {
+    static constexpr uint8_t code = VEHICLE_MESSAGE;
+    // A sender can own several vehicles, so one doesn't replace another
+    static constexpr bool latestState = false;
+    static constexpr bool reliable = false;
+    static constexpr int trafficClass = TRAFFIC_STATE;
+    // but a newer state of the same vehicle does
+    static constexpr bool keyedState = true;
+    static std::pair<int, int> stateKey(const ChronoMessages::VehicleMessage& message) {
+        return std::make_pair(message.connectionnumber(), message.idnumber());
+    }
+};
+
+template<> struct MessageTraits<ChronoMessages::ReducedVehicleMessage> {
+    static constexpr uint8_t code = REDUCED_VEHICLE_MESSAGE;
+    // Stands in for a VehicleMessage, so is sent and kept the same way
+    static constexpr bool latestState = false;
+    static constexpr bool reliable = false;
+    static constexpr int trafficClass = TRAFFIC_STATE;
+    static constexpr bool keyedState = true;
+    static std::pair<int, int> stateKey(const ChronoMessages::ReducedVehicleMessage& message) {
+        return std::make_pair(message.connectionnumber(), message.idnumber());
+    }
+};
+
+template<> struct MessageTraits<ChronoMessages::DSRCMessage> {
+    static constexpr uint8_t code = DSRC_MESSAGE;
+    static constexpr bool latestState = false;
+    static constexpr bool reliable = false;
+    static constexpr int trafficClass = TRAFFIC_DSRC;
+    static constexpr bool keyedState = false;
+};
+
+template<> struct MessageTraits<ChronoMessages::MessagePacket> {
+    static constexpr uint8_t code = MESSAGE_PACKET;
+    static constexpr bool latestState = true;
+    static constexpr bool reliable = false;
+    // World packets are the vehicle state clients render
+    static constexpr int trafficClass = TRAFFIC_STATE;
+    static constexpr bool keyedState = false;
+};
+
+template<> struct MessageTraits<ChronoMessages::ControlMessage> {
+    static constexpr uint8_t code = CONTROL_MESSAGE;
+    static constexpr bool latestState = false;
+    static constexpr bool reliable = true;
+    static constexpr int trafficClass = TRAFFIC_CONTROL;
+    static constexpr bool keyedState = false;
+};
+
+template<> struct MessageTraits<ChronoMessages::SnapshotAck> {
+    static constexpr uint8_t code = SNAPSHOT_ACK;
+    // Only a client's newest acknowledgement is worth anything
+    static constexpr bool latestState = true;
+    // A lost one is made up for by the next
+    static constexpr bool reliable = false;
+    static constexpr int trafficClass = TRAFFIC_CONTROL;
+    static constexpr bool keyedState = true;
+    static std::pair<int, int> stateKey(const ChronoMessages::SnapshotAck& message) {
+        return std::make_pair(message.connectionnumber(), message.idnumber());
+    }
+};
+
+// Returns the wire code of a message only known by its base class, or
+// NULL_MESSAGE if it isn't a registered type. Compares descriptor pointers,
+// which protobuf keeps unique per type.
+inline uint8_t messageCode(const google::protobuf::Message& message) {
+    const google::protobuf::Descriptor* descriptor = message.GetDescriptor();
+    if (descriptor == ChronoMessages::VehicleMessage::descriptor()) return MessageTraits<ChronoMessages::VehicleMessage>::code;
+    if (descriptor == ChronoMessages::DSRCMessage::descriptor()) return MessageTraits<ChronoMessages::DSRCMessage>::code;
+    if (descriptor == ChronoMessages::MessagePacket::descriptor()) return MessageTraits<ChronoMessages::MessagePacket>::code;
+    if (descriptor == ChronoMessages::ControlMessage::descriptor()) return MessageTraits<ChronoMessages::ControlMessage>::code;
+    if (descriptor == ChronoMessages::SnapshotAck::descriptor()) return MessageTraits<ChronoMessages::SnapshotAck>::code;
+    if (descriptor == ChronoMessages::ReducedVehicleMessage::descriptor()) return MessageTraits<ChronoMessages::ReducedVehicleMessage>::code;
+    return NULL_MESSAGE;
+}
+
+// Returns the traffic class a wire code is sent in by default. Datagrams the
+// handlers generate themselves are control traffic, and unregistered codes
+// are bulk.
+inline int defaultTrafficClass(uint8_t code) {
+    switch (code) {
+        case MessageTraits<ChronoMessages::VehicleMessage>::code:
+            return MessageTraits<ChronoMessages::VehicleMessage>::trafficClass;
+        case MessageTraits<ChronoMessages::DSRCMessage>::code:
+            return MessageTraits<ChronoMessages::DSRCMessage>::trafficClass;
+        case MessageTraits<ChronoMessages::MessagePacket>::code:
+            return MessageTraits<ChronoMessages::MessagePacket>::trafficClass;
+        case MessageTraits<ChronoMessages::ControlMessage>::code:
+            return MessageTraits<ChronoMessages::ControlMessage>::trafficClass;
+        case MessageTraits<ChronoMessages::SnapshotAck>::code:
+            return MessageTraits<ChronoMessages::SnapshotAck>::trafficClass;
+        case MessageTraits<ChronoMessages::ReducedVehicleMessage>::code:
+            return MessageTraits<ChronoMessages::ReducedVehicleMessage>::trafficClass;
+        case ACK_MESSAGE:
+        case CONNECTION_REQUEST:
+        case CONNECTION_ACCEPT:
+        case CONNECTION_DECLINE:
+        case CONNECTION_CHALLENGE:
+            return TRAFFIC_CONTROL;
+        default:
+            return TRAFFIC_BULK;
+    }
+}
+
+#endif
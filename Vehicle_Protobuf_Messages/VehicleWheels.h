@@ -0,0 +1,52 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Layout of the wheel arrays in a VehicleMessage. Wheel i of a vehicle is the
+//  one Chrono numbers WheelID(i): left then right on each axle, front axle
+//  first. Its centre is wheelPositions[3 * i] to [3 * i + 2], and its rotation
+//  wheelRotations[4 * i] to [4 * i + 3], so code that moves wheels walks both
+//  arrays through their data() pointers rather than wheel by wheel.
+//
+// =============================================================================
+
+#ifndef VEHICLEWHEELS_H
+#define VEHICLEWHEELS_H
+
+#include "ChronoMessages.pb.h"
+
+// Values per wheel in each array
+#define WHEEL_POSITION_VALUES 3
+#define WHEEL_ROTATION_VALUES 4
+// Most wheels one vehicle may carry; the compact encoding's wheel count holds
+// no more
+#define VEHICLE_MAX_WHEELS 31
+
+// Number of wheels vehicle carries, or -1 if its arrays don't agree on one.
+inline int wheelCount(const ChronoMessages::VehicleMessage& vehicle) {
+    int positions = vehicle.wheelpositions_size();
+    if (positions % WHEEL_POSITION_VALUES != 0 ||
+        positions / WHEEL_POSITION_VALUES * WHEEL_ROTATION_VALUES != vehicle.wheelrotations_size()) {
+        return -1;
+    }
+    return positions / WHEEL_POSITION_VALUES;
+}
+
+// Sizes both of vehicle's arrays for wheels wheels, to be filled through
+// their mutable_data() pointers.
+inline void resizeWheels(ChronoMessages::VehicleMessage* vehicle, int wheels) {
+    vehicle->mutable_wheelpositions()->Resize(WHEEL_POSITION_VALUES * wheels, 0);
+    vehicle->mutable_wheelrotations()->Resize(WHEEL_ROTATION_VALUES * wheels, 0);
+}
+
+#endif // VEHICLEWHEELS_H
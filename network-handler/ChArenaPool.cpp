@@ -0,0 +1,66 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChArenaPool.
+//
+// =============================================================================
+
+#include "ChArenaPool.h"
+
+ChArenaPool::ChArenaPool(size_t arenaCount, size_t blockSize) : freeList(std::make_shared<FreeList>(arenaCount)) {
+    m_blockSize = blockSize;
+    freeList->hits = 0;
+    freeList->misses = 0;
+    freeList->inUse = 0;
+    for (size_t i = 0; i < arenaCount; i++) {
+        // Reset keeps a caller-provided first block, so it is only ever allocated here
+        google::protobuf::ArenaOptions options;
+        freeList->blocks.emplace_back(new char[blockSize]);
+        options.initial_block = freeList->blocks.back().get();
+        options.initial_block_size = blockSize;
+        options.start_block_size = blockSize;
+        freeList->arenas.emplace_back(new google::protobuf::Arena(options));
+        freeList->freeArenas.tryEnqueue(freeList->arenas.back().get());
+    }
+}
+
+std::shared_ptr<google::protobuf::Arena> ChArenaPool::acquire() {
+    google::protobuf::Arena* arena;
+    if (!freeList->freeArenas.tryDequeue(arena)) {
+        freeList->misses++;
+        google::protobuf::ArenaOptions options;
+        options.start_block_size = m_blockSize;
+        return std::make_shared<google::protobuf::Arena>(options);
+    }
+    freeList->hits++;
+    freeList->inUse++;
+    std::shared_ptr<FreeList> owner = freeList;
+    return std::shared_ptr<google::protobuf::Arena>(arena, [owner](google::protobuf::Arena* arena) {
+        arena->Reset();
+        owner->inUse--;
+        owner->freeArenas.tryEnqueue(arena);
+    });
+}
+
+long ChArenaPool::hits() {
+    return freeList->hits;
+}
+
+long ChArenaPool::misses() {
+    return freeList->misses;
+}
+
+long ChArenaPool::inUse() {
+    return freeList->inUse;
+}
@@ -0,0 +1,74 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Pool of protobuf Arenas that received messages are parsed onto. Each receive
+//  batch takes one arena, and every message parsed from the batch is handed out
+//  as a shared_ptr that shares ownership of it. When the last of those messages
+//  is dropped the arena is Reset and goes back on the free list, keeping its
+//  preallocated first block, so parsing a batch normally allocates nothing.
+//  The pool's free list stays alive until the last arena comes back, even if
+//  the pool itself is destroyed first.
+//
+// =============================================================================
+
+#ifndef CHARENAPOOL_H
+#define CHARENAPOOL_H
+
+#include <google/protobuf/arena.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "ChRingQueue.h"
+
+#define ARENA_POOL_SIZE 256
+// Room for a full MessagePacket of vehicles before an arena has to grow.
+#define ARENA_BLOCK_SIZE 16384
+
+class ChArenaPool {
+public:
+    ChArenaPool(size_t arenaCount = ARENA_POOL_SIZE, size_t blockSize = ARENA_BLOCK_SIZE);
+
+    ChArenaPool(const ChArenaPool&) = delete;
+    ChArenaPool& operator=(const ChArenaPool&) = delete;
+
+    // Returns an empty arena that is recycled once every shared_ptr to it, or
+    // aliasing it, is gone. Falls back to a plain heap arena when the pool is
+    // empty.
+    std::shared_ptr<google::protobuf::Arena> acquire();
+
+    // Arenas served from the free list.
+    long hits();
+    // Arenas that had to be created on the spot.
+    long misses();
+    // Pooled arenas currently held by messages.
+    long inUse();
+
+private:
+    struct FreeList {
+        FreeList(size_t arenaCount) : freeArenas(arenaCount) {}
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::vector<std::unique_ptr<google::protobuf::Arena>> arenas;
+        ChRingQueue<google::protobuf::Arena*> freeArenas;
+        std::atomic<long> hits;
+        std::atomic<long> misses;
+        std::atomic<long> inUse;
+    };
+
+    std::shared_ptr<FreeList> freeList;
+    size_t m_blockSize;
+};
+
+#endif
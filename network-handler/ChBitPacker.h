@@ -0,0 +1,149 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Writes and reads values packed at arbitrary bit widths, with no padding
+//  between them. Bits are stored least significant first, so a value never
+//  depends on the byte order of the machine. Integers are written as their
+//  low bits, and read back sign extended when the type read is signed. Any
+//  other trivially copyable type is written whole, as its raw bytes.
+//
+// =============================================================================
+
+#ifndef CHBITPACKER_H
+#define CHBITPACKER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Widest value a single write or read can carry
+#define BIT_PACKER_MAX_BITS 32
+
+class ChBitWriter {
+public:
+    // Appends to buffer, starting at its end.
+    explicit ChBitWriter(std::string& buffer);
+
+    // Writes the low bits of value. At most BIT_PACKER_MAX_BITS bits.
+    template<class T> void write(T value, int bits);
+
+    // Writes every byte of value.
+    template<class T> void writeRaw(const T& value);
+
+    // Writes out the last partial byte, padded with zeros. Called once, after
+    // the last write.
+    void finish();
+
+    // Bits written so far, including any not yet flushed to the buffer.
+    size_t bitCount() const { return written; }
+
+private:
+    std::string& buffer;
+    uint64_t pending;
+    int pendingBits;
+    size_t written;
+};
+
+class ChBitReader {
+public:
+    ChBitReader(const char* data, size_t size);
+
+    // Reads a value written with bits bits. Returns 0 once the data runs out.
+    template<class T> T read(int bits);
+
+    // Reads a value written with writeRaw.
+    template<class T> T readRaw();
+
+    // True once a read has asked for more bits than the data held.
+    bool overrun() const { return exhausted; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+    uint64_t pending;
+    int pendingBits;
+    bool exhausted;
+};
+
+inline ChBitWriter::ChBitWriter(std::string& buffer) : buffer(buffer), pending(0), pendingBits(0), written(0) {}
+
+template<class T> void ChBitWriter::write(T value, int bits) {
+    static_assert(std::is_integral<T>::value, "only integers are packed by width");
+    uint64_t mask = ((uint64_t)1 << bits) - 1;
+    pending |= ((uint64_t)value & mask) << pendingBits;
+    pendingBits += bits;
+    written += bits;
+    while (pendingBits >= 8) {
+        buffer.push_back((char)(pending & 0xff));
+        pending >>= 8;
+        pendingBits -= 8;
+    }
+}
+
+template<class T> void ChBitWriter::writeRaw(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "raw values are copied byte by byte");
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (size_t i = 0; i < sizeof(T); i++) {
+        write(bytes[i], 8);
+    }
+}
+
+inline void ChBitWriter::finish() {
+    if (pendingBits > 0) {
+        buffer.push_back((char)(pending & 0xff));
+        written += 8 - pendingBits;
+    }
+    pending = 0;
+    pendingBits = 0;
+}
+
+inline ChBitReader::ChBitReader(const char* data, size_t size)
+    : data((const unsigned char*)data), size(size), position(0), pending(0), pendingBits(0), exhausted(false) {}
+
+template<class T> T ChBitReader::read(int bits) {
+    static_assert(std::is_integral<T>::value, "only integers are packed by width");
+    while (pendingBits < bits && position < size) {
+        pending |= (uint64_t)data[position++] << pendingBits;
+        pendingBits += 8;
+    }
+    if (pendingBits < bits) {
+        exhausted = true;
+        return 0;
+    }
+    uint64_t mask = ((uint64_t)1 << bits) - 1;
+    uint64_t value = pending & mask;
+    pending >>= bits;
+    pendingBits -= bits;
+    // The top bit written is the sign bit of a signed value
+    if (std::is_signed<T>::value && bits > 0 && (value >> (bits - 1)) & 1) {
+        value |= ~mask;
+    }
+    return (T)value;
+}
+
+template<class T> T ChBitReader::readRaw() {
+    static_assert(std::is_trivially_copyable<T>::value, "raw values are copied byte by byte");
+    unsigned char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++) {
+        bytes[i] = read<unsigned char>(8);
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+#endif // CHBITPACKER_H
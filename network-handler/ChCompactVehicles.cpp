@@ -0,0 +1,272 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of the compact vehicle encoding.
+//
+// =============================================================================
+
+#include "ChCompactVehicles.h"
+#include "ChBitPacker.h"
+#include "VehicleWheels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#define COMPACT_COUNT_BITS 16
+#define COMPACT_WIDTH_BITS 6
+#define COMPACT_HEADER_BITS (COMPACT_COUNT_BITS + 6 * COMPACT_WIDTH_BITS + 8 * 64)
+// Up to VEHICLE_MAX_WHEELS per vehicle
+#define COMPACT_WHEEL_COUNT_BITS 5
+// Largest the smaller three components of a unit quaternion can be is 1/sqrt(2)
+#define COMPACT_SQRT2 1.41421356237309504880
+
+ChVehicleQuantization::ChVehicleQuantization()
+    : positionResolution(COMPACT_POSITION_RESOLUTION), wheelResolution(COMPACT_WHEEL_RESOLUTION),
+      speedResolution(COMPACT_SPEED_RESOLUTION), timeResolution(COMPACT_TIME_RESOLUTION),
+      positionBits(COMPACT_POSITION_BITS), wheelBits(COMPACT_WHEEL_BITS), quaternionBits(COMPACT_QUATERNION_BITS),
+      speedBits(COMPACT_SPEED_BITS), timeBits(COMPACT_TIME_BITS), idBits(COMPACT_ID_BITS) {}
+
+static bool validWidth(int bits, int least) {
+    return bits >= least && bits <= BIT_PACKER_MAX_BITS;
+}
+
+static bool validQuantization(const ChVehicleQuantization& q) {
+    for (double resolution : {q.positionResolution, q.wheelResolution, q.speedResolution, q.timeResolution}) {
+        if (!(resolution > 0) || !std::isfinite(resolution)) return false;
+    }
+    return validWidth(q.positionBits, 2) && validWidth(q.wheelBits, 2) && validWidth(q.quaternionBits, 2) &&
+           validWidth(q.speedBits, 2) && validWidth(q.timeBits, 1) && validWidth(q.idBits, 1);
+}
+
+// Writes value in resolution steps as a signed bits wide integer. Returns
+// false if it doesn't fit.
+static bool writeSigned(ChBitWriter& writer, double value, double resolution, int bits) {
+    double steps = std::round(value / resolution);
+    double limit = std::ldexp(1.0, bits - 1) - 1;
+    if (!(std::fabs(steps) <= limit)) return false;
+    writer.write((int64_t)steps, bits);
+    return true;
+}
+
+static bool writeUnsigned(ChBitWriter& writer, double value, double resolution, int bits) {
+    double steps = std::round(value / resolution);
+    double limit = std::ldexp(1.0, bits) - 1;
+    if (!(steps >= 0 && steps <= limit)) return false;
+    writer.write((uint64_t)steps, bits);
+    return true;
+}
+
+static bool writeRotation(ChBitWriter& writer, const double* e, int bits) {
+    double norm = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2] + e[3] * e[3]);
+    if (!(norm > 0) || !std::isfinite(norm)) return false;
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(e[i]) > std::fabs(e[largest])) largest = i;
+    }
+    // Flipped so the largest is positive, which is the same rotation
+    double scale = (e[largest] < 0 ? -1 : 1) / norm;
+    double steps = std::ldexp(1.0, bits) - 1;
+    writer.write(largest, 2);
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        // The other three are at most 1/sqrt(2), mapped onto [0, 1]
+        double unit = std::min(1.0, std::max(0.0, (e[i] * scale * COMPACT_SQRT2 + 1) / 2));
+        writer.write((uint32_t)std::round(unit * steps), bits);
+    }
+    return true;
+}
+
+static void readRotation(ChBitReader& reader, double* e, int bits) {
+    double steps = std::ldexp(1.0, bits) - 1;
+    int largest = reader.read<int>(2) & 3;
+    double sum = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        e[i] = (reader.read<uint32_t>(bits) / steps * 2 - 1) / COMPACT_SQRT2;
+        sum += e[i] * e[i];
+    }
+    e[largest] = std::sqrt(std::max(0.0, 1 - sum));
+}
+
+size_t compactVehicleBits(int wheels, const ChVehicleQuantization& quantization) {
+    return 2 * quantization.idBits + 32 + quantization.timeBits + quantization.speedBits + COMPACT_WHEEL_COUNT_BITS +
+           3 * quantization.positionBits + 3 * wheels * quantization.wheelBits +
+           (1 + wheels) * (2 + 3 * quantization.quaternionBits);
+}
+
+bool compactVehicles(ChronoMessages::MessagePacket& packet, const ChVehicleQuantization& quantization) {
+    int count = packet.vehiclemessages_size();
+    if (!validQuantization(quantization) || count >= (1 << COMPACT_COUNT_BITS)) return false;
+
+    // The sector is centred on the vehicles, and times are counted from the earliest
+    double origin[3] = {0, 0, 0};
+    double baseTime = 0;
+    for (int axis = 0; axis < 3 && count > 0; axis++) {
+        double low = INFINITY, high = -INFINITY;
+        for (const ChronoMessages::VehicleMessage& vehicle : packet.vehiclemessages()) {
+            const ChronoMessages::MVector& chassis = vehicle.chassiscom();
+            double value = axis == 0 ? chassis.x() : axis == 1 ? chassis.y() : chassis.z();
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+        origin[axis] = std::isfinite(low + high) ? low + (high - low) / 2 : 0;
+    }
+    if (count > 0) {
+        baseTime = packet.vehiclemessages(0).chtime();
+        for (const ChronoMessages::VehicleMessage& vehicle : packet.vehiclemessages()) {
+            baseTime = std::min(baseTime, vehicle.chtime());
+        }
+    }
+
+    size_t bits = COMPACT_HEADER_BITS;
+    for (const ChronoMessages::VehicleMessage& vehicle : packet.vehiclemessages()) {
+        int wheels = wheelCount(vehicle);
+        if (wheels < 0 || wheels > VEHICLE_MAX_WHEELS) return false;
+        bits += compactVehicleBits(wheels, quantization);
+    }
+
+    std::string buffer;
+    buffer.reserve(bits / 8 + 1);
+    ChBitWriter writer(buffer);
+    writer.write(count, COMPACT_COUNT_BITS);
+    for (int bits : {quantization.positionBits, quantization.wheelBits, quantization.quaternionBits,
+                     quantization.speedBits, quantization.timeBits, quantization.idBits}) {
+        writer.write(bits, COMPACT_WIDTH_BITS);
+    }
+    writer.writeRaw(quantization.positionResolution);
+    writer.writeRaw(quantization.wheelResolution);
+    writer.writeRaw(quantization.speedResolution);
+    writer.writeRaw(quantization.timeResolution);
+    for (double axis : origin) writer.writeRaw(axis);
+    writer.writeRaw(baseTime);
+
+    double idLimit = std::ldexp(1.0, quantization.idBits) - 1;
+    for (const ChronoMessages::VehicleMessage& vehicle : packet.vehiclemessages()) {
+        if (vehicle.connectionnumber() < 0 || vehicle.connectionnumber() > idLimit) return false;
+        if (vehicle.idnumber() < 0 || vehicle.idnumber() > idLimit) return false;
+        writer.write(vehicle.connectionnumber(), quantization.idBits);
+        writer.write(vehicle.idnumber(), quantization.idBits);
+        writer.write(vehicle.timestamp(), 32);
+        if (!writeUnsigned(writer, vehicle.chtime() - baseTime, quantization.timeResolution, quantization.timeBits) ||
+            !writeSigned(writer, vehicle.speed(), quantization.speedResolution, quantization.speedBits)) {
+            return false;
+        }
+
+        const ChronoMessages::MVector& chassis = vehicle.chassiscom();
+        double relative[3] = {chassis.x() - origin[0], chassis.y() - origin[1], chassis.z() - origin[2]};
+        // Wheels are placed against the chassis as the receiver will decode
+        // it, so chassis error doesn't add to theirs
+        double decoded[3];
+        for (int axis = 0; axis < 3; axis++) {
+            if (!writeSigned(writer, relative[axis], quantization.positionResolution, quantization.positionBits)) {
+                return false;
+            }
+            decoded[axis] = origin[axis] + std::round(relative[axis] / quantization.positionResolution) *
+                                               quantization.positionResolution;
+        }
+        int wheels = wheelCount(vehicle);
+        writer.write(wheels, COMPACT_WHEEL_COUNT_BITS);
+        const double* position = vehicle.wheelpositions().data();
+        for (int value = 0; value < WHEEL_POSITION_VALUES * wheels; value++) {
+            if (!writeSigned(writer, position[value] - decoded[value % WHEEL_POSITION_VALUES],
+                             quantization.wheelResolution, quantization.wheelBits)) {
+                return false;
+            }
+        }
+        const ChronoMessages::MQuaternion& chassisRotation = vehicle.chassisrot();
+        double e[4] = {chassisRotation.e0(), chassisRotation.e1(), chassisRotation.e2(), chassisRotation.e3()};
+        if (!writeRotation(writer, e, quantization.quaternionBits)) return false;
+        const double* rotation = vehicle.wheelrotations().data();
+        for (int wheel = 0; wheel < wheels; wheel++) {
+            if (!writeRotation(writer, rotation + WHEEL_ROTATION_VALUES * wheel, quantization.quaternionBits)) {
+                return false;
+            }
+        }
+    }
+    writer.finish();
+
+    packet.clear_vehiclemessages();
+    packet.set_compactvehicles(buffer);
+    return true;
+}
+
+bool expandVehicles(ChronoMessages::MessagePacket& packet) {
+    const std::string& buffer = packet.compactvehicles();
+    ChBitReader reader(buffer.data(), buffer.size());
+    int count = reader.read<uint32_t>(COMPACT_COUNT_BITS);
+    ChVehicleQuantization quantization;
+    quantization.positionBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.wheelBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.quaternionBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.speedBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.timeBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.idBits = reader.read<int>(COMPACT_WIDTH_BITS);
+    quantization.positionResolution = reader.readRaw<double>();
+    quantization.wheelResolution = reader.readRaw<double>();
+    quantization.speedResolution = reader.readRaw<double>();
+    quantization.timeResolution = reader.readRaw<double>();
+    double origin[3];
+    for (double& axis : origin) axis = reader.readRaw<double>();
+    double baseTime = reader.readRaw<double>();
+    if (reader.overrun() || !validQuantization(quantization)) return false;
+    if (COMPACT_HEADER_BITS + count * compactVehicleBits(0, quantization) > buffer.size() * 8) return false;
+
+    // Vehicles added before the field turns out short are taken back out, so
+    // none are added unless all of them can be
+    int existing = packet.vehiclemessages_size();
+    packet.mutable_vehiclemessages()->Reserve(existing + count);
+    for (int i = 0; i < count; i++) {
+        ChronoMessages::VehicleMessage* vehicle = packet.add_vehiclemessages();
+        vehicle->set_connectionnumber(reader.read<uint32_t>(quantization.idBits));
+        vehicle->set_idnumber(reader.read<uint32_t>(quantization.idBits));
+        vehicle->set_timestamp(reader.read<int32_t>(32));
+        vehicle->set_chtime(baseTime + reader.read<uint32_t>(quantization.timeBits) * quantization.timeResolution);
+        vehicle->set_speed(reader.read<int32_t>(quantization.speedBits) * quantization.speedResolution);
+
+        double decoded[3];
+        for (int axis = 0; axis < 3; axis++) {
+            decoded[axis] = origin[axis] + reader.read<int32_t>(quantization.positionBits) *
+                                               quantization.positionResolution;
+        }
+        ChronoMessages::MVector* chassis = vehicle->mutable_chassiscom();
+        chassis->set_x(decoded[0]);
+        chassis->set_y(decoded[1]);
+        chassis->set_z(decoded[2]);
+        int wheels = reader.read<uint32_t>(COMPACT_WHEEL_COUNT_BITS);
+        resizeWheels(vehicle, wheels);
+        double* position = vehicle->mutable_wheelpositions()->mutable_data();
+        for (int value = 0; value < WHEEL_POSITION_VALUES * wheels; value++) {
+            position[value] = decoded[value % WHEEL_POSITION_VALUES] +
+                              reader.read<int32_t>(quantization.wheelBits) * quantization.wheelResolution;
+        }
+        double e[4];
+        readRotation(reader, e, quantization.quaternionBits);
+        ChronoMessages::MQuaternion* chassisRotation = vehicle->mutable_chassisrot();
+        chassisRotation->set_e0(e[0]);
+        chassisRotation->set_e1(e[1]);
+        chassisRotation->set_e2(e[2]);
+        chassisRotation->set_e3(e[3]);
+        double* rotation = vehicle->mutable_wheelrotations()->mutable_data();
+        for (int wheel = 0; wheel < wheels; wheel++) {
+            readRotation(reader, rotation + WHEEL_ROTATION_VALUES * wheel, quantization.quaternionBits);
+        }
+    }
+    if (reader.overrun()) {
+        packet.mutable_vehiclemessages()->DeleteSubrange(existing, count);
+        return false;
+    }
+    packet.clear_compactvehicles();
+    return true;
+}
@@ -0,0 +1,109 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Quantized encoding of the vehicles in a MessagePacket, carried in its
+//  compactVehicles field instead of as VehicleMessages. A four wheeled vehicle
+//  takes under 64 bytes with the default quantization, against
+//  VEHICLE_MESSAGE_SIZE as a message, so a datagram holds a couple dozen.
+//
+//  The field is packed with ChBitWriter. It starts with a header:
+//
+//    bits  field
+//      16  vehicle count
+//     6x6  position, wheel, quaternion, speed, time and id bits
+//    64x4  position, wheel, speed and time resolutions, as doubles
+//    64x3  sector origin x, y, z, as doubles
+//      64  base chTime, as a double
+//
+//  followed by each vehicle in turn:
+//
+//    id bits        connection number
+//    id bits        id number
+//    32             timestamp
+//    time bits      chTime - base chTime, in time resolution steps
+//    speed bits     speed, signed, in speed resolution steps
+//    3 x position   chassis position - sector origin, signed, in position
+//                   resolution steps
+//    5              wheel count, n
+//    3n x wheel     each wheel's position - decoded chassis position, signed,
+//                   in wheel resolution steps, in the message's order
+//    (n + 1) x (2 + 3 x quaternion)
+//                   chassis, then wheel, rotations
+//
+//  A rotation is sent as the index of its largest component followed by the
+//  other three (smallest three), each scaled from [-1/sqrt(2), 1/sqrt(2)].
+//  The largest is recovered from the unit length, and made positive since q
+//  and -q are the same rotation.
+//
+// =============================================================================
+
+#ifndef CHCOMPACTVEHICLES_H
+#define CHCOMPACTVEHICLES_H
+
+#include <cstddef>
+
+#include "ChronoMessages.pb.h"
+
+// 1 mm over +/- 8.3 km of the sector origin
+#define COMPACT_POSITION_RESOLUTION 0.001
+#define COMPACT_POSITION_BITS 24
+// 2 mm over +/- 8.1 m of the chassis
+#define COMPACT_WHEEL_RESOLUTION 0.002
+#define COMPACT_WHEEL_BITS 13
+// Per component; at most 7e-4 off
+#define COMPACT_QUATERNION_BITS 10
+// 1 cm/s up to +/- 327 m/s
+#define COMPACT_SPEED_RESOLUTION 0.01
+#define COMPACT_SPEED_BITS 16
+// 1 ms over 4.6 hours past the packet's earliest chTime
+#define COMPACT_TIME_RESOLUTION 0.001
+#define COMPACT_TIME_BITS 24
+// Connection and id numbers up to 65535
+#define COMPACT_ID_BITS 16
+
+struct ChVehicleQuantization {
+    // The COMPACT_* defaults.
+    ChVehicleQuantization();
+
+    // Resolutions are in steps of meters, m/s and seconds. Bit counts are
+    // between 2 and 32 (1 and 32 for ids).
+    double positionResolution;
+    double wheelResolution;
+    double speedResolution;
+    double timeResolution;
+    int positionBits;
+    int wheelBits;
+    int quaternionBits;
+    int speedBits;
+    int timeBits;
+    int idBits;
+};
+
+// Moves the vehicles in packet into its compactVehicles field. Returns false,
+// leaving packet untouched, if any of them can't be represented: a value out
+// of range, a negative id, a zero or non-finite rotation, or wheel arrays that
+// disagree or hold more than VEHICLE_MAX_WHEELS wheels.
+bool compactVehicles(ChronoMessages::MessagePacket& packet,
+                     const ChVehicleQuantization& quantization = ChVehicleQuantization());
+
+// Moves the vehicles in packet's compactVehicles field back into its
+// vehicleMessages, after any already there. Returns false, leaving packet
+// untouched, if the field is malformed.
+bool expandVehicles(ChronoMessages::MessagePacket& packet);
+
+// Bits a vehicle with wheels wheels takes, not counting the header shared by
+// the packet.
+size_t compactVehicleBits(int wheels, const ChVehicleQuantization& quantization = ChVehicleQuantization());
+
+#endif // CHCOMPACTVEHICLES_H
@@ -0,0 +1,285 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+//
+//	Dictionary ChPacketCompressor uses by default, written by network-bench
+//  dictionary from 2160 payloads of recorded traffic. Regenerate it rather than
+//  editing it; a new dictionary gets a new id, so old and new ends of a
+//  connection just don't compress.
+//
+// =============================================================================
+
+#ifndef CHCOMPRESSIONDICTIONARY_H
+#define CHCOMPRESSIONDICTIONARY_H
+
+#define DEFAULT_COMPRESSION_DICTIONARY_ID 0x00c4e8dcu
+#define DEFAULT_COMPRESSION_DICTIONARY_SIZE 4096
+
+static const unsigned char defaultCompressionDictionaryBytes[DEFAULT_COMPRESSION_DICTIONARY_SIZE] = {
+    0x08, 0xb0, 0x0d, 0x10, 0x06, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88, 0x88, 0x88, 0xfc, 0x3f,
+    0x29, 0x61, 0x77, 0x88, 0x93, 0x1e, 0x65, 0x26, 0x40, 0x32, 0x1b, 0x09, 0x90, 0xcd, 0xcc, 0xde,
+    0x08, 0xa0, 0x0d, 0x10, 0x04, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0xfc, 0x3f,
+    0x29, 0xd2, 0x8c, 0x7f, 0x49, 0xf8, 0xeb, 0x24, 0x40, 0x32, 0x1b, 0x09, 0x5f, 0x05, 0x57, 0x7b,
+    0x08, 0xd0, 0x0b, 0x10, 0x05, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xf8, 0x3f,
+    0x29, 0xea, 0xba, 0x87, 0xdb, 0x16, 0xb3, 0x25, 0x40, 0x32, 0x1b, 0x09, 0x80, 0x3f, 0x97, 0xb8,
+    0x08, 0xc0, 0x0b, 0x10, 0x05, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88, 0x88, 0x88, 0xf8, 0x3f,
+    0x29, 0x22, 0x2a, 0x89, 0x3b, 0xd7, 0xb2, 0x25, 0x40, 0x32, 0x1b, 0x09, 0xe0, 0xac, 0xe1, 0xce,
+    0x08, 0xb0, 0x0b, 0x10, 0x03, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0xf8, 0x3f,
+    0x29, 0xc0, 0xfc, 0xf0, 0xf1, 0x91, 0x37, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xc0, 0x40, 0x37, 0xb3,
+    0x08, 0xe0, 0x09, 0x10, 0x04, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xf4, 0x3f,
+    0x29, 0xdb, 0x7a, 0xf8, 0x0e, 0x1a, 0xe3, 0x24, 0x40, 0x32, 0x1b, 0x09, 0x5c, 0xd1, 0x88, 0xd5,
+    0x08, 0xd0, 0x09, 0x10, 0x04, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88, 0x88, 0x88, 0xf4, 0x3f,
+    0x29, 0xaa, 0x57, 0x4e, 0x2f, 0xc0, 0xe0, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xb4, 0x79, 0x00, 0x33,
+    0x08, 0xc0, 0x09, 0x10, 0x02, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0xf4, 0x3f,
+    0x29, 0x70, 0x7b, 0xf4, 0x1d, 0x62, 0x63, 0x23, 0x40, 0x32, 0x1b, 0x09, 0xe3, 0xcf, 0x86, 0xc5,
+    0x08, 0xe0, 0x08, 0x10, 0x00, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xf2, 0x3f,
+    0x29, 0x89, 0xbb, 0x08, 0x7e, 0xc1, 0xd6, 0x21, 0x40, 0x32, 0x1b, 0x09, 0x92, 0xaf, 0x28, 0x9a,
+    0x08, 0xd0, 0x08, 0x10, 0x02, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xf2, 0x3f,
+    0x29, 0xa4, 0xda, 0x3e, 0x13, 0x37, 0x4e, 0x23, 0x40, 0x32, 0x1b, 0x09, 0xad, 0x77, 0x85, 0xdc,
+    0x08, 0xc0, 0x08, 0x10, 0x02, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0xf2, 0x3f,
+    0x29, 0xf2, 0xb6, 0x65, 0x25, 0xaa, 0x4a, 0x23, 0x40, 0x32, 0x1b, 0x09, 0xd1, 0xd1, 0xee, 0x22,
+    0x08, 0xf0, 0x07, 0x10, 0x02, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xf0, 0x3f,
+    0x29, 0xa7, 0x83, 0x51, 0x2d, 0x00, 0x37, 0x23, 0x40, 0x32, 0x1b, 0x09, 0x00, 0x15, 0x1b, 0x10,
+    0x08, 0xe0, 0x07, 0x10, 0x02, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88, 0x88, 0x88, 0xf0, 0x3f,
+    0x29, 0xc1, 0x2f, 0xe9, 0x79, 0xb1, 0x32, 0x23, 0x40, 0x32, 0x1b, 0x09, 0xf7, 0x03, 0xbb, 0xaf,
+    0x08, 0xd0, 0x07, 0x10, 0x01, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0xf0, 0x3f,
+    0x29, 0x3d, 0xe2, 0x4a, 0xdc, 0xd2, 0x70, 0x22, 0x40, 0x32, 0x1b, 0x09, 0xfe, 0x46, 0x0a, 0x4b,
+    0x08, 0xa0, 0x07, 0x10, 0x00, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee, 0xee, 0xee, 0xee, 0x3f,
+    0x29, 0xba, 0xb9, 0x3d, 0xd6, 0x5f, 0xa5, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xf8, 0x62, 0x9a, 0x69,
+    0x08, 0x90, 0x07, 0x10, 0x00, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xee, 0x3f,
+    0x29, 0x67, 0x42, 0x3e, 0xff, 0x77, 0xa0, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xe8, 0xc6, 0xab, 0xb8,
+    0x08, 0xe0, 0x06, 0x10, 0x00, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xec, 0x3f,
+    0x29, 0x84, 0xda, 0x85, 0x39, 0x10, 0x91, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xe6, 0x8f, 0x0e, 0xca,
+    0x08, 0xe0, 0x05, 0x10, 0x00, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88, 0x88, 0x88, 0xe8, 0x3f,
+    0x29, 0x07, 0x3e, 0xf5, 0xab, 0x31, 0x63, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xfe, 0x3e, 0x6b, 0x04,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x0e, 0x10, 0x0b, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xfe, 0x3f, 0x29, 0xfe, 0xbf, 0xf2, 0x0d, 0x85, 0x05, 0x2a, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x0e, 0x10, 0x05, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0xfe, 0x3f, 0x29, 0x65, 0x79, 0x6d, 0x9f, 0x65, 0x9a, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x0a, 0x10, 0x0d, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee,
+    0xee, 0xee, 0xf6, 0x3f, 0x29, 0xd3, 0x14, 0x4a, 0xe5, 0xe3, 0x99, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x0a, 0x10, 0x0d, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xf6, 0x3f, 0x29, 0x2e, 0xd3, 0xdf, 0x2f, 0x45, 0x97, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x0a, 0x10, 0x01, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0xf6, 0x3f, 0x29, 0xb6, 0xc3, 0x41, 0x49, 0x78, 0xb4, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x08, 0x10, 0x0b, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee,
+    0xee, 0xee, 0xf2, 0x3f, 0x29, 0x35, 0xbd, 0x17, 0xc1, 0xe2, 0xfd, 0x29, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x06, 0x10, 0x09, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xea, 0x3f, 0x29, 0x8b, 0xd3, 0x72, 0x38, 0xee, 0x23, 0x28, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x06, 0x10, 0x09, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0xea, 0x3f, 0x29, 0xd1, 0x00, 0x48, 0xe8, 0x23, 0x1e, 0x28, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x04, 0x10, 0x07, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0xe2, 0x3f, 0x29, 0xab, 0x5f, 0x50, 0xe8, 0xee, 0x40, 0x26, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x03, 0x10, 0x03, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88,
+    0x88, 0x88, 0xe0, 0x3f, 0x29, 0x43, 0x9e, 0xf0, 0x79, 0x3d, 0x35, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x0c, 0x10, 0x05, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee,
+    0xee, 0xee, 0xfa, 0x3f, 0x29, 0x83, 0xb1, 0xfd, 0x16, 0xf6, 0xaf, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x0c, 0x10, 0x05, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xfa, 0x3f, 0x29, 0xda, 0xa4, 0xd4, 0x4f, 0xd9, 0xb0, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x0c, 0x10, 0x05, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xfa, 0x3f, 0x29, 0xe0, 0xab, 0x02, 0x4b, 0x98, 0xb1, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x0c, 0x10, 0x03, 0x18, 0x00, 0x21, 0x22, 0x22, 0x22, 0x22,
+    0x22, 0x22, 0xfa, 0x3f, 0x29, 0xed, 0x11, 0x45, 0xb3, 0x51, 0x37, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x0a, 0x10, 0x03, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xf6, 0x3f, 0x29, 0x08, 0xca, 0x2a, 0x21, 0x40, 0x32, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x06, 0x10, 0x00, 0x18, 0x00, 0x21, 0x44, 0x44,
+    0x44, 0x44, 0x44, 0x44, 0xec, 0x3f, 0x29, 0x3d, 0x97, 0xa4, 0x19, 0xb4, 0x8b, 0x21, 0x40, 0x32,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x04, 0x10, 0x07, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xe2, 0x3f, 0x29, 0xb3, 0xa0, 0x3b, 0x21, 0x18, 0x48, 0x26, 0x40, 0x32, 0x1b, 0x09,
+    0xe2, 0x77, 0x3f, 0x41, 0x40, 0x19, 0x89, 0x53, 0x2a, 0xde, 0xed, 0x94, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0x28, 0x20, 0x72, 0x34, 0x5f, 0xff, 0xe9, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x05, 0x10, 0x03, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee,
+    0xee, 0xee, 0xe6, 0x3f, 0x29, 0xc0, 0x05, 0xd9, 0xd6, 0xa3, 0x88, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x02, 0x10, 0x07, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44,
+    0x44, 0x44, 0xd4, 0x3f, 0x29, 0xe6, 0x44, 0x85, 0x64, 0x84, 0xcd, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x05, 0x10, 0x01, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xe6, 0x3f, 0x29, 0xd8, 0x6b, 0x6b, 0x8a, 0x47, 0x07, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x04, 0x10, 0x03, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xe4, 0x3f, 0x29, 0x33, 0x5c, 0x9e, 0xe9, 0x2c, 0x6e, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0x08, 0xf0, 0x0e, 0x10, 0x06, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xff, 0x3f,
+    0x29, 0x69, 0xf3, 0x95, 0xc3, 0xaf, 0x45, 0x26, 0x40, 0x32, 0x1b, 0x09, 0x82, 0xb4, 0xb6, 0x35,
+    0x08, 0xd0, 0x0e, 0x10, 0x04, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xff, 0x3f,
+    0x29, 0x6e, 0xa5, 0xf2, 0x2a, 0x63, 0xd1, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xb9, 0x23, 0xd5, 0x78,
+    0x08, 0x80, 0x0d, 0x10, 0x04, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xfb, 0x3f,
+    0x29, 0x52, 0x62, 0x1b, 0x05, 0x03, 0xef, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xb9, 0xed, 0xdd, 0x6b,
+    0x08, 0xf0, 0x0c, 0x10, 0x04, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0xfb, 0x3f,
+    0x29, 0xd0, 0xfb, 0xb1, 0x8b, 0x52, 0xf0, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xcd, 0xa7, 0x36, 0xfb,
+    0x08, 0x90, 0x0b, 0x10, 0x02, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xf7, 0x3f,
+    0x29, 0x0e, 0x1d, 0x8b, 0x43, 0xec, 0x78, 0x23, 0x40, 0x32, 0x1b, 0x09, 0x55, 0xc3, 0x26, 0x00,
+    0x08, 0xa0, 0x09, 0x10, 0x00, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0xf3, 0x3f,
+    0x29, 0xee, 0xaa, 0x82, 0x3c, 0x1f, 0xe3, 0x21, 0x40, 0x32, 0x1b, 0x09, 0x5e, 0xe3, 0x32, 0x19,
+    0x08, 0x80, 0x09, 0x10, 0x02, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0x3f,
+    0x29, 0xd7, 0xb9, 0xcf, 0x81, 0x15, 0x58, 0x23, 0x40, 0x32, 0x1b, 0x09, 0xec, 0x32, 0xe3, 0xd0,
+    0x08, 0xb0, 0x07, 0x10, 0x02, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0xef, 0x3f,
+    0x29, 0xe0, 0xdd, 0x35, 0xfe, 0x0a, 0x25, 0x23, 0x40, 0x32, 0x1b, 0x09, 0x89, 0xeb, 0x9e, 0x89,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x0d, 0x10, 0x0d, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xfc, 0x3f, 0x29, 0x42, 0x9d, 0x76, 0x53, 0x85, 0x96, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x0c, 0x10, 0x0b, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xfb, 0x3f, 0x29, 0x2f, 0x6a, 0xb0, 0x87, 0x92, 0x1f, 0x2a, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x0b, 0x10, 0x0b, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xf8, 0x3f, 0x29, 0x7d, 0x37, 0xf0, 0xb3, 0x8e, 0x22, 0x2a, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x0b, 0x10, 0x0d, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77,
+    0x77, 0x77, 0xf7, 0x3f, 0x29, 0x60, 0x9c, 0x1d, 0x5b, 0xf2, 0x9b, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x09, 0x10, 0x09, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xf4, 0x3f, 0x29, 0x42, 0x70, 0x70, 0x12, 0xd7, 0x8e, 0x28, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x09, 0x10, 0x0b, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77,
+    0x77, 0x77, 0xf3, 0x3f, 0x29, 0xfe, 0x06, 0x9e, 0xd8, 0x11, 0x04, 0x2a, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x06, 0x10, 0x07, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb,
+    0xbb, 0xbb, 0xeb, 0x3f, 0x29, 0xe8, 0x3f, 0x3f, 0x51, 0x50, 0xb4, 0x26, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x05, 0x10, 0x05, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xe8, 0x3f, 0x29, 0x24, 0x2c, 0x9f, 0xf4, 0x32, 0x10, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x0e, 0x10, 0x00, 0x18, 0x00, 0x21, 0x77, 0x77,
+    0x77, 0x77, 0x77, 0x77, 0xff, 0x3f, 0x29, 0x47, 0x6d, 0xe1, 0x0f, 0x67, 0xd8, 0x21, 0x40, 0x32,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x0a, 0x10, 0x03, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xf7, 0x3f, 0x29, 0xf6, 0xc2, 0x12, 0xcc, 0x96, 0x34, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x06, 0x10, 0x07, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xeb, 0x3f, 0x29, 0xb6, 0xaf, 0x25, 0x4e, 0xbc, 0xae, 0x26, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x05, 0x10, 0x05, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77,
+    0x77, 0x77, 0xe7, 0x3f, 0x29, 0xfe, 0x1d, 0xe6, 0x38, 0xe8, 0x09, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x03, 0x10, 0x03, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xe0, 0x3f, 0x29, 0xe8, 0x76, 0x27, 0x2f, 0xc9, 0x2d, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x02, 0x10, 0x00, 0x18, 0x00, 0x21, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0xd3, 0x3f, 0x29, 0xd2, 0xd5, 0xad, 0x6c, 0x4e, 0x97, 0x20, 0x40, 0x32,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x04, 0x10, 0x05, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xe3, 0x3f, 0x29, 0x49, 0x87, 0xad, 0x04, 0x4c, 0xd4, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xd0, 0x3f, 0x29, 0x93, 0xd6, 0x2a, 0x5f, 0x1c, 0x3c, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x04, 0x10, 0x05, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb,
+    0xbb, 0xbb, 0xe3, 0x3f, 0x29, 0x87, 0x46, 0x13, 0xa1, 0x4c, 0xdb, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0x08, 0x80, 0x0e, 0x10, 0x06, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xfd, 0x3f,
+    0x29, 0x77, 0x4a, 0x9b, 0x98, 0x64, 0x5a, 0x26, 0x40, 0x32, 0x1b, 0x09, 0xc6, 0x4e, 0xf7, 0xe1,
+    0x08, 0x90, 0x08, 0x10, 0x04, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0xf1, 0x3f,
+    0x29, 0x3e, 0xfc, 0x4b, 0xd1, 0x1f, 0xba, 0x24, 0x40, 0x32, 0x1b, 0x09, 0xf8, 0x4b, 0x45, 0xd6,
+    0x08, 0x80, 0x07, 0x10, 0x04, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xed, 0x3f,
+    0x29, 0xbc, 0xe2, 0x32, 0x1a, 0x35, 0x91, 0x24, 0x40, 0x32, 0x1b, 0x09, 0x40, 0xf2, 0xd0, 0x39,
+    0x08, 0x70, 0x10, 0x02, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xbd, 0x3f, 0x29,
+    0xc6, 0x2a, 0xec, 0x58, 0x7a, 0xb6, 0x21, 0x40, 0x32, 0x1b, 0x09, 0x89, 0x2e, 0xba, 0x9c, 0x07,
+    0x08, 0x50, 0x10, 0x02, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0xb5, 0x3f, 0x29,
+    0x65, 0xe1, 0x1f, 0x4f, 0x7f, 0xa5, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xd4, 0x25, 0x36, 0xc9, 0xcf,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x0d, 0x10, 0x0f, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xfd, 0x3f, 0x29, 0xcd, 0x9a, 0x5e, 0x5f, 0x0e, 0x08, 0x2d, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x0c, 0x10, 0x0f, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xf9, 0x3f, 0x29, 0xa6, 0x8c, 0x0c, 0xbb, 0x0f, 0x19, 0x2d, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x0b, 0x10, 0x07, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xf9, 0x3f, 0x29, 0xa7, 0x0d, 0xee, 0x2d, 0x0a, 0x2e, 0x27, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x0a, 0x10, 0x0d, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xf5, 0x3f, 0x29, 0x73, 0xb7, 0x23, 0x2a, 0x5a, 0x90, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x0a, 0x10, 0x0d, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xf5, 0x3f, 0x29, 0x4c, 0xd5, 0xa1, 0xf9, 0x16, 0x94, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x08, 0x10, 0x00, 0x18, 0x00, 0x21, 0xde, 0xdd,
+    0xdd, 0xdd, 0xdd, 0xdd, 0xf1, 0x3f, 0x29, 0xfb, 0x7a, 0x1f, 0xf5, 0x1a, 0xcc, 0x21, 0x40, 0x32,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x06, 0x10, 0x00, 0x18, 0x00, 0x21, 0x55, 0x55,
+    0x55, 0x55, 0x55, 0x55, 0xed, 0x3f, 0x29, 0x4b, 0x92, 0x6f, 0xd4, 0x4f, 0x96, 0x21, 0x40, 0x32,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x05, 0x10, 0x05, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xe5, 0x3f, 0x29, 0x90, 0x5d, 0xa0, 0xa0, 0x77, 0xf6, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x03, 0x10, 0x03, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb,
+    0xbb, 0xbb, 0xdb, 0x3f, 0x29, 0xb0, 0x64, 0xb6, 0xd6, 0x4e, 0x0f, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x02, 0x10, 0x03, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77,
+    0x77, 0x77, 0xd7, 0x3f, 0x29, 0x05, 0x42, 0xad, 0xf9, 0xdf, 0xef, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x05, 0x10, 0x05, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xe5, 0x3f, 0x29, 0xa9, 0x3c, 0xb5, 0x2a, 0xce, 0xef, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x03, 0x10, 0x03, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xdd, 0x3f, 0x29, 0x7f, 0x42, 0x1f, 0xc5, 0xac, 0x1e, 0x23, 0x40, 0x32, 0x1b, 0x09,
+    0x08, 0xa0, 0x08, 0x10, 0x08, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0xf1, 0x3f,
+    0x29, 0x20, 0x28, 0x7b, 0x73, 0xd1, 0xb3, 0x27, 0x40, 0x32, 0x1b, 0x09, 0x72, 0x36, 0x84, 0x11,
+    0x08, 0x80, 0x06, 0x10, 0x06, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0xe9, 0x3f,
+    0x29, 0x5d, 0x3d, 0x36, 0x23, 0xed, 0xdf, 0x25, 0x40, 0x32, 0x1b, 0x09, 0xcc, 0x0b, 0xfe, 0xe3,
+    0x08, 0x90, 0x04, 0x10, 0x04, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0xe1, 0x3f,
+    0x29, 0x83, 0xbf, 0x70, 0x38, 0x60, 0x01, 0x24, 0x40, 0x32, 0x1b, 0x09, 0x0f, 0xd9, 0x1c, 0xb3,
+    0x08, 0x60, 0x10, 0x02, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0xb9, 0x3f, 0x29,
+    0x11, 0x2c, 0x45, 0xa5, 0xfe, 0xad, 0x21, 0x40, 0x32, 0x1b, 0x09, 0x15, 0xfc, 0x98, 0xc1, 0xf6,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x0d, 0x10, 0x07, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0xfd, 0x3f, 0x29, 0xd5, 0xbf, 0x4f, 0xbe, 0x40, 0x1a, 0x27, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x0c, 0x10, 0x0d, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0xf9, 0x3f, 0x29, 0x4a, 0x89, 0x69, 0x6e, 0x80, 0x9e, 0x2b, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x0a, 0x10, 0x05, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0xf5, 0x3f, 0x29, 0x4f, 0xd1, 0x42, 0x36, 0xc5, 0xa6, 0x25, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x02, 0x10, 0x03, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xd5, 0x3f, 0x29, 0xbe, 0x72, 0xb9, 0xfb, 0xd7, 0xdf, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0xc0, 0x86, 0xfe, 0x3a, 0x40, 0x19, 0x1c, 0x3e, 0xd0, 0x8e, 0x3c, 0x63, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0xf8, 0xa2, 0xdb, 0xe7, 0x54, 0x79, 0xed, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01, 0x12, 0xc2, 0x02, 0x08, 0x30, 0x10, 0x00, 0x18, 0x00,
+    0x21, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0xa9, 0x3f, 0x29, 0x64, 0xff, 0xa2, 0xde, 0x96, 0x19,
+    0x08, 0xd0, 0x0d, 0x10, 0x0a, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xfd, 0x3f,
+    0x29, 0xa1, 0xa3, 0x6a, 0x85, 0x00, 0x57, 0x29, 0x40, 0x32, 0x1b, 0x09, 0xde, 0x71, 0x5d, 0x17,
+    0x08, 0xe0, 0x0b, 0x10, 0x09, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xf9, 0x3f,
+    0x29, 0x80, 0xb1, 0x70, 0xa4, 0xf4, 0xa8, 0x28, 0x40, 0x32, 0x1b, 0x09, 0xc0, 0x9b, 0x69, 0x65,
+    0x08, 0xf0, 0x09, 0x10, 0x08, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xf5, 0x3f,
+    0x29, 0xaf, 0x9c, 0x30, 0x69, 0x13, 0xdb, 0x27, 0x40, 0x32, 0x1b, 0x09, 0x96, 0xcf, 0x6c, 0xc1,
+    0x08, 0x80, 0x08, 0x10, 0x07, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xf1, 0x3f,
+    0x29, 0x17, 0x84, 0x24, 0x7f, 0x62, 0xee, 0x26, 0x40, 0x32, 0x1b, 0x09, 0x4b, 0xd4, 0xca, 0xb5,
+    0x08, 0xf0, 0x05, 0x10, 0x06, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xe9, 0x3f,
+    0x29, 0x98, 0xe9, 0x92, 0x2b, 0xee, 0xd9, 0x25, 0x40, 0x32, 0x1b, 0x09, 0x5c, 0x81, 0x79, 0xf2,
+    0x08, 0x80, 0x04, 0x10, 0x05, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xe1, 0x3f,
+    0x29, 0x1d, 0xd8, 0x3d, 0x10, 0x81, 0xb7, 0x24, 0x40, 0x32, 0x1b, 0x09, 0x24, 0xd7, 0x39, 0xe1,
+    0x08, 0x40, 0x10, 0x04, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xb1, 0x3f, 0x29,
+    0x78, 0x3f, 0xda, 0x38, 0xde, 0x17, 0x23, 0x40, 0x32, 0x1b, 0x09, 0x3c, 0xb5, 0x7b, 0xec, 0x83,
+    0x08, 0x20, 0x10, 0x03, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xa1, 0x3f, 0x29,
+    0x43, 0xd8, 0x78, 0x2d, 0x62, 0x49, 0x22, 0x40, 0x32, 0x1b, 0x09, 0xc8, 0x6b, 0xa8, 0xfa, 0xb7,
+    0x08, 0x10, 0x10, 0x02, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x91, 0x3f, 0x29,
+    0x60, 0xab, 0x52, 0xb6, 0x69, 0x83, 0x21, 0x40, 0x32, 0x1b, 0x09, 0xa2, 0xc7, 0xa3, 0x5b, 0x54,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x02, 0x10, 0x01, 0x18, 0x00, 0x21, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0xd1, 0x3f, 0x29, 0x44, 0xd1, 0x38, 0x64, 0x5c, 0x44, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x03, 0x10, 0x03, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0xd9, 0x3f, 0x29, 0xf3, 0x79, 0xce, 0xc2, 0xb3, 0xff, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0x09, 0x72, 0x00, 0x3d, 0x40, 0x19, 0x85, 0x49, 0x0a, 0x60, 0xca, 0x7d, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0x9f, 0xad, 0x52, 0xfa, 0x6c, 0xfc, 0xec, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x59, 0xa1, 0xf7, 0x4b, 0xc0, 0x19, 0x2a, 0x4e, 0x24, 0x33, 0xda, 0xe6, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0x57, 0xaa, 0xe6, 0xc0, 0x05, 0x05, 0xec, 0xbf, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x8d, 0x8e, 0xb3, 0x33, 0x40, 0x19, 0x36, 0x43, 0xb0, 0xc9, 0x0a, 0x79, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0xad, 0x87, 0xe4, 0x2e, 0xe8, 0xf1, 0xee, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x7c, 0x86, 0x48, 0xc0, 0x19, 0xaa, 0x1f, 0xfc, 0x94, 0xfd, 0xf4, 0xe0, 0x3f, 0x5a, 0x24, 0x09,
+    0x4c, 0x70, 0x57, 0x77, 0xaf, 0x26, 0xee, 0xbf, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xa3, 0x49, 0x27, 0x2f, 0x40, 0x19, 0x76, 0x53, 0xea, 0x19, 0x52, 0xab, 0xe0, 0x3f, 0x5a, 0x24,
+    0x09, 0x7a, 0x62, 0x77, 0x95, 0xb4, 0x5c, 0xef, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x5c, 0xbd, 0xee, 0xca, 0x3f, 0x8a, 0x01, 0x80, 0x01, 0x8c, 0x06, 0xb5, 0x0f, 0x28, 0x4a, 0xe1,
+    0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x07, 0x10, 0x00, 0x18, 0x00, 0x21, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xf0, 0x3f, 0x29, 0xcf, 0x90, 0xf0, 0x48, 0xd5, 0xae, 0x21, 0x40, 0x32,
+    0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x02, 0x10, 0x00, 0x18, 0x00, 0x21, 0x22, 0x22,
+    0x22, 0x22, 0x22, 0x22, 0xd2, 0x3f, 0x29, 0x0e, 0x53, 0x55, 0x2d, 0x22, 0x8f, 0x20, 0x40, 0x32,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x03, 0x10, 0x01, 0x18, 0x00, 0x21, 0xef, 0xee, 0xee, 0xee,
+    0xee, 0xee, 0xde, 0x3f, 0x29, 0x21, 0xd1, 0x38, 0x28, 0x62, 0xab, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x04, 0x10, 0x05, 0x18, 0x00, 0x21, 0x44, 0x44, 0x44, 0x44,
+    0x44, 0x44, 0xe4, 0x3f, 0x29, 0xe8, 0x0e, 0x46, 0x2f, 0x38, 0xe2, 0x24, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x03, 0x10, 0x01, 0x18, 0x00, 0x21, 0xcd, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xdc, 0x3f, 0x29, 0x6e, 0xd4, 0x46, 0x71, 0x24, 0x9c, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x02, 0x10, 0x03, 0x18, 0x00, 0x21, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xd6, 0x3f, 0x29, 0x0c, 0xe7, 0xae, 0x38, 0xe2, 0xe7, 0x22, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x03, 0x10, 0x01, 0x18, 0x00, 0x21, 0xab, 0xaa, 0xaa, 0xaa,
+    0xaa, 0xaa, 0xda, 0x3f, 0x29, 0xbb, 0x75, 0x24, 0x63, 0xa7, 0x8c, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0x3f, 0x12, 0xc3, 0x02, 0x08, 0xf0, 0x02, 0x10, 0x01, 0x18, 0x00, 0x21, 0x89, 0x88, 0x88, 0x88,
+    0x88, 0x88, 0xd8, 0x3f, 0x29, 0xc6, 0x7b, 0x8d, 0x65, 0xef, 0x7c, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xd0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0xbc, 0xbb, 0xbb, 0xbb,
+    0xbb, 0xbb, 0xcb, 0x3f, 0x29, 0x76, 0x94, 0x20, 0xe6, 0x81, 0x2b, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xb0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0x77, 0x77, 0x77, 0x77,
+    0x77, 0x77, 0xc7, 0x3f, 0x29, 0xc8, 0xea, 0xf6, 0x1e, 0xc8, 0x1a, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0x90, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xc3, 0x3f, 0x29, 0xf2, 0x89, 0x7e, 0xcb, 0xf3, 0x09, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xe0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0xde, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xcd, 0x3f, 0x29, 0xc9, 0xae, 0x31, 0x58, 0xd3, 0x33, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xa0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0x55, 0x55, 0x55, 0x55,
+    0x55, 0x55, 0xc5, 0x3f, 0x29, 0x33, 0xf1, 0x57, 0xfa, 0x60, 0x12, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xbf, 0x12, 0xc3, 0x02, 0x08, 0xc0, 0x01, 0x10, 0x01, 0x18, 0x00, 0x21, 0x9a, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0xc9, 0x3f, 0x29, 0x88, 0x01, 0x64, 0xa0, 0x28, 0x23, 0x21, 0x40, 0x32, 0x1b, 0x09,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01, 0x12, 0xc3, 0x02, 0x08, 0x80, 0x01, 0x10, 0x00, 0x18,
+    0x00, 0x21, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0xc1, 0x3f, 0x29, 0x85, 0x13, 0xf9, 0x87, 0x10,
+    0x00, 0x00, 0x00, 0x00, 0xf0, 0x3f, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x19,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xdd, 0x24, 0x06, 0xf5, 0xc3, 0x9f, 0x1a, 0x2f, 0xdd, 0x24, 0x06, 0xf6, 0xb3, 0x47, 0xe1, 0x7a,
+    0x14, 0xae, 0x47, 0xf8, 0xc3, 0x9f, 0x1a, 0x2f, 0xdd, 0x24, 0x06, 0xf5, 0xa3, 0x35, 0x5f, 0x20,
+    0x08, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01, 0x3a, 0xa9, 0x08, 0x10, 0x00,
+    0x58, 0xa3, 0x40, 0x18, 0xc4, 0x9f, 0x1a, 0x2f, 0xdd, 0x24, 0x06, 0xf5, 0xc3, 0x9f, 0x1a, 0x2f,
+    0x09, 0x8f, 0xe4, 0x22, 0x63, 0x4e, 0xe1, 0xef, 0xbf, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x7c, 0x32, 0xd6, 0xc4,
+};
+
+#endif // CHCOMPRESSIONDICTIONARY_H
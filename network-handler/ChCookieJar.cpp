@@ -0,0 +1,99 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChCookieJar.
+//
+// =============================================================================
+
+#include "ChCookieJar.h"
+
+#include <chrono>
+#include <random>
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1; v1 = rotateLeft(v1, 13); v1 ^= v0; v0 = rotateLeft(v0, 32);
+    v2 += v3; v3 = rotateLeft(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotateLeft(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotateLeft(v1, 17); v1 ^= v2; v2 = rotateLeft(v2, 32);
+}
+
+// SipHash-2-4 of data under a 128 bit key, as specified by Aumasson and Bernstein
+static uint64_t sipHash(const uint64_t key[2], const uint8_t* data, size_t size) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+    size_t whole = size - size % 8;
+    for (size_t i = 0; i < whole; i += 8) {
+        uint64_t word = 0;
+        for (int j = 0; j < 8; j++) word |= (uint64_t)data[i + j] << (8 * j);
+        v3 ^= word;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+    uint64_t last = (uint64_t)size << 56;
+    for (size_t j = 0; j < size % 8; j++) last |= (uint64_t)data[whole + j] << (8 * j);
+    v3 ^= last;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) sipRound(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+ChCookieJar::ChCookieJar() {
+    std::random_device random;
+    for (auto& word : key) {
+        word = ((uint64_t)random() << 32) | random();
+    }
+}
+
+uint64_t ChCookieJar::issue(const boost::asio::ip::udp::endpoint& endpoint) {
+    return cookieFor(endpoint, currentPeriod());
+}
+
+bool ChCookieJar::check(const boost::asio::ip::udp::endpoint& endpoint, uint64_t cookie) {
+    uint64_t period = currentPeriod();
+    return cookie == cookieFor(endpoint, period) || cookie == cookieFor(endpoint, period - 1);
+}
+
+uint64_t ChCookieJar::cookieFor(const boost::asio::ip::udp::endpoint& endpoint, uint64_t period) {
+    // Address, port and period, packed into one message
+    uint8_t message[16 + 2 + 8];
+    size_t size = 0;
+    if (endpoint.address().is_v4()) {
+        auto bytes = endpoint.address().to_v4().to_bytes();
+        for (auto byte : bytes) message[size++] = byte;
+    } else {
+        auto bytes = endpoint.address().to_v6().to_bytes();
+        for (auto byte : bytes) message[size++] = byte;
+    }
+    message[size++] = endpoint.port() & 0xff;
+    message[size++] = endpoint.port() >> 8;
+    for (int i = 0; i < 8; i++) message[size++] = (uint8_t)(period >> (8 * i));
+    uint64_t cookie = sipHash(key, message, size);
+    // 0 means no cookie in a request
+    return cookie != 0 ? cookie : 1;
+}
+
+uint64_t ChCookieJar::currentPeriod() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count() / COOKIE_PERIOD;
+}
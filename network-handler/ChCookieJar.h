@@ -0,0 +1,54 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Stateless cookies for the connection handshake. A server answers a first
+//  connection request with a cookie computed from the requester's address, a
+//  secret and the current time period, and only grants a connection number
+//  to a request that echoes a valid one. Nothing is stored until then, so a
+//  flood of requests from forged addresses costs the server nothing but the
+//  replies, which are no larger than the requests.
+//
+//  Cookies are keyed SipHash-2-4 values and stay valid for between one and
+//  two COOKIE_PERIODs.
+//
+// =============================================================================
+
+#ifndef CHCOOKIEJAR_H
+#define CHCOOKIEJAR_H
+
+#include <boost/asio.hpp>
+#include <cstdint>
+
+// Length of the time period cookies are issued for, in milliseconds.
+#define COOKIE_PERIOD 5000
+
+class ChCookieJar {
+public:
+    // Draws a fresh secret, so cookies from another jar never validate.
+    ChCookieJar();
+
+    // Returns the cookie endpoint must echo to connect. Never 0.
+    uint64_t issue(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // True if cookie was issued to endpoint in this period or the last.
+    bool check(const boost::asio::ip::udp::endpoint& endpoint, uint64_t cookie);
+
+private:
+    uint64_t cookieFor(const boost::asio::ip::udp::endpoint& endpoint, uint64_t period);
+    static uint64_t currentPeriod();
+
+    uint64_t key[2];
+};
+
+#endif // CHCOOKIEJAR_H
@@ -0,0 +1,216 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of the datagram header and ChSequenceTracker.
+//
+// =============================================================================
+
+#include "ChDatagramHeader.h"
+
+#include <chrono>
+
+// Fields are assembled a byte at a time so the layout is the same on any host
+static void writeLittleEndian(char* buffer, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        buffer[i] = (char)(value >> (8 * i));
+    }
+}
+
+static uint64_t readLittleEndian(const char* buffer, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)(uint8_t)buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+void writeDatagramHeader(char* buffer, const ChDatagramHeader& header) {
+    writeLittleEndian(buffer, DATAGRAM_MAGIC, 2);
+    buffer[2] = DATAGRAM_VERSION;
+    buffer[3] = header.type;
+    writeLittleEndian(buffer + 4, header.flags, 2);
+    writeLittleEndian(buffer + 6, header.payloadSize, 2);
+    stampDatagramHeader(buffer, header.sequence, header.timestamp);
+}
+
+void stampDatagramHeader(char* buffer, uint32_t sequence, uint64_t timestamp) {
+    writeLittleEndian(buffer + 8, sequence, 4);
+    writeLittleEndian(buffer + 12, timestamp, 8);
+}
+
+bool readDatagramHeader(const char* buffer, size_t size, ChDatagramHeader& header) {
+    if (size < DATAGRAM_HEADER_SIZE) return false;
+    if (readLittleEndian(buffer, 2) != DATAGRAM_MAGIC || (uint8_t)buffer[2] != DATAGRAM_VERSION) return false;
+    header.type = buffer[3];
+    header.flags = readLittleEndian(buffer + 4, 2);
+    header.payloadSize = readLittleEndian(buffer + 6, 2);
+    header.sequence = readLittleEndian(buffer + 8, 4);
+    header.timestamp = readLittleEndian(buffer + 12, 8);
+    return header.payloadSize <= size - DATAGRAM_HEADER_SIZE;
+}
+
+void writeFragmentHeader(char* payload, const ChFragmentHeader& header) {
+    writeLittleEndian(payload, header.messageId, 4);
+    writeLittleEndian(payload + 4, header.index, 2);
+    writeLittleEndian(payload + 6, header.count, 2);
+    writeLittleEndian(payload + 8, header.messageSize, 4);
+}
+
+bool readFragmentHeader(const char* payload, size_t size, ChFragmentHeader& header) {
+    if (size < FRAGMENT_HEADER_SIZE) return false;
+    header.messageId = readLittleEndian(payload, 4);
+    header.index = readLittleEndian(payload + 4, 2);
+    header.count = readLittleEndian(payload + 6, 2);
+    header.messageSize = readLittleEndian(payload + 8, 4);
+    if (header.count == 0 || header.count > FRAGMENT_MAX_COUNT || header.index >= header.count) return false;
+    if (header.messageSize > FRAGMENT_MAX_MESSAGE_SIZE) return false;
+    // The last fragment has to be left with something
+    size_t pieceSize = (header.messageSize + header.count - 1) / header.count;
+    return header.messageSize > (size_t)(header.count - 1) * pieceSize;
+}
+
+uint16_t readDatagramFlags(const char* buffer) {
+    return readLittleEndian(buffer + 4, 2);
+}
+
+void writeReliableHeader(char* payload, const ChReliableHeader& header) {
+    writeLittleEndian(payload, header.sequence, 4);
+    stampReliableAck(payload, header.ack, header.ackBits);
+}
+
+bool readReliableHeader(const char* payload, size_t size, ChReliableHeader& header) {
+    if (size < RELIABLE_HEADER_SIZE) return false;
+    header.sequence = readLittleEndian(payload, 4);
+    header.ack = readLittleEndian(payload + 4, 4);
+    header.ackBits = readLittleEndian(payload + 8, 4);
+    return true;
+}
+
+void stampReliableAck(char* payload, uint32_t ack, uint32_t ackBits) {
+    writeLittleEndian(payload + 4, ack, 4);
+    writeLittleEndian(payload + 8, ackBits, 4);
+}
+
+void writeHandshake(char* buffer, uint8_t messageType, uint64_t value) {
+    writeHandshake(buffer, messageType, value, 0);
+}
+
+void writeHandshake(char* buffer, uint8_t messageType, uint64_t value, uint32_t dictionary) {
+    ChDatagramHeader header;
+    header.type = messageType;
+    header.flags = DATAGRAM_FLAG_HANDSHAKE | (dictionary ? DATAGRAM_FLAG_COMPRESSED : 0);
+    header.payloadSize = HANDSHAKE_PAYLOAD_SIZE;
+    header.sequence = dictionary;
+    header.timestamp = 0;
+    writeDatagramHeader(buffer, header);
+    writeLittleEndian(buffer + DATAGRAM_HEADER_SIZE, value, 8);
+}
+
+bool readHandshake(const char* buffer, size_t size, uint8_t& messageType, uint64_t& value) {
+    uint32_t dictionary;
+    return readHandshake(buffer, size, messageType, value, dictionary);
+}
+
+bool readHandshake(const char* buffer, size_t size, uint8_t& messageType, uint64_t& value, uint32_t& dictionary) {
+    ChDatagramHeader header;
+    if (!readDatagramHeader(buffer, size, header)) return false;
+    if (!(header.flags & DATAGRAM_FLAG_HANDSHAKE) || header.payloadSize != HANDSHAKE_PAYLOAD_SIZE) return false;
+    messageType = header.type;
+    value = readLittleEndian(buffer + DATAGRAM_HEADER_SIZE, 8);
+    dictionary = header.flags & DATAGRAM_FLAG_COMPRESSED ? header.sequence : 0;
+    return true;
+}
+
+size_t fragmentOffset(const ChFragmentHeader& header) {
+    return (size_t)header.index * ((header.messageSize + header.count - 1) / header.count);
+}
+
+size_t fragmentSize(const ChFragmentHeader& header) {
+    size_t pieceSize = (header.messageSize + header.count - 1) / header.count;
+    return header.index + 1 < header.count ? pieceSize : header.messageSize - fragmentOffset(header);
+}
+
+uint64_t datagramTimestamp() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+bool ChSequenceTracker::accept(const boost::asio::ip::udp::endpoint& endpoint, const ChDatagramHeader& header) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto found = sequences.find(endpoint);
+    // Wraparound-safe distance from the newest sequence number seen
+    int64_t ahead = 0;
+    if (found != sequences.end()) {
+        ahead = (int32_t)(header.sequence - found->second.stats.highestSequence);
+    }
+    // A first datagram, or one from a sender that has since restarted its count
+    if (found == sequences.end() || ahead > SEQUENCE_RESTART_GAP || ahead < -SEQUENCE_RESTART_GAP) {
+        Sequence& sequence = sequences[endpoint];
+        sequence.stats = ChSequenceStats();
+        sequence.stats.received = 1;
+        sequence.stats.highestSequence = header.sequence;
+        sequence.stats.lastTimestamp = header.timestamp;
+        sequence.latestSequence = header.sequence;
+        sequence.hasLatest = (header.flags & (DATAGRAM_FLAG_LATEST | DATAGRAM_FLAG_FRAGMENT)) == DATAGRAM_FLAG_LATEST;
+        return true;
+    }
+
+    Sequence& sequence = found->second;
+    sequence.stats.received++;
+    if (ahead > 0) {
+        sequence.stats.lost += ahead - 1;
+        sequence.stats.highestSequence = header.sequence;
+        sequence.stats.lastTimestamp = header.timestamp;
+    } else if (ahead < 0) {
+        // Fills a gap that was counted as lost
+        sequence.stats.reordered++;
+        if (sequence.stats.lost > 0) sequence.stats.lost--;
+    }
+
+    if (header.flags & DATAGRAM_FLAG_LATEST) {
+        if (sequence.hasLatest && (int32_t)(header.sequence - sequence.latestSequence) <= 0) {
+            sequence.stats.stale++;
+            return false;
+        }
+        if (!(header.flags & DATAGRAM_FLAG_FRAGMENT)) {
+            sequence.latestSequence = header.sequence;
+            sequence.hasLatest = true;
+        }
+    }
+    return true;
+}
+
+bool ChSequenceTracker::acceptLatest(const boost::asio::ip::udp::endpoint& endpoint, uint32_t sequence) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    Sequence& tracked = sequences[endpoint];
+    if (tracked.hasLatest && (int32_t)(sequence - tracked.latestSequence) <= 0) {
+        tracked.stats.stale++;
+        return false;
+    }
+    tracked.latestSequence = sequence;
+    tracked.hasLatest = true;
+    return true;
+}
+
+ChSequenceStats ChSequenceTracker::stats(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    auto found = sequences.find(endpoint);
+    if (found == sequences.end()) return ChSequenceStats();
+    return found->second.stats;
+}
+
+void ChSequenceTracker::remove(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    sequences.erase(endpoint);
+}
@@ -0,0 +1,232 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Fixed header every udp datagram starts with, and the per-endpoint sequence
+//  bookkeeping built on it. All fields are little-endian:
+//
+//    offset  size  field
+//         0     2  magic (DATAGRAM_MAGIC)
+//         2     1  version (DATAGRAM_VERSION)
+//         3     1  message type (MessageCodes.h)
+//         4     2  flags (DATAGRAM_FLAG_*)
+//         6     2  payload size in bytes
+//         8     4  sequence number, counted per destination by the sender
+//        12     8  sender's monotonic clock when sent, in microseconds
+//
+//  A datagram flagged DATAGRAM_FLAG_FRAGMENT carries one piece of a message
+//  too large for a single datagram. Its payload starts with a fragment
+//  header, and the payload size includes it:
+//
+//    offset  size  field
+//        20     4  message id, shared by every fragment of the message
+//        24     2  fragment index
+//        26     2  fragment count
+//        28     4  size of the whole message in bytes
+//
+//  Messages are split evenly: every fragment but the last holds the whole
+//  message size divided by the fragment count, rounded up.
+//
+//  A datagram flagged DATAGRAM_FLAG_RELIABLE belongs to the reliable channel
+//  (ChReliableChannel.h). Its payload starts with a reliable header, which
+//  the payload size also includes:
+//
+//    offset  size  field
+//        20     4  reliable sequence number, counted per destination
+//        24     4  next reliable sequence number expected from the receiver
+//        28     4  selective ack bits; bit i set means sequence number
+//                  (expected + 1 + i) has arrived
+//
+//  An ACK_MESSAGE datagram carries only the reliable header, whose reliable
+//  sequence number it leaves 0. Its datagram sequence number is stamped and
+//  counted in the receiver's loss statistics like any other.
+//
+//  A datagram flagged DATAGRAM_FLAG_HANDSHAKE sets up a connection
+//  (ChCookieJar.h). It carries no timestamp, no sequence number beyond the
+//  dictionary id below, and its payload is always 8 bytes:
+//
+//    CONNECTION_REQUEST    cookie from the last challenge, 0 on the first try
+//    CONNECTION_CHALLENGE  cookie to send back
+//    CONNECTION_ACCEPT     connection number
+//    CONNECTION_DECLINE    0
+//
+//  A CONNECTION_REQUEST flagged DATAGRAM_FLAG_COMPRESSED offers to exchange
+//  compressed payloads, and carries the id of the sender's dictionary
+//  (ChPacketCompressor.h) in its sequence number field. A CONNECTION_ACCEPT
+//  answers it with the same flag and id if the server holds that dictionary
+//  too, and without them otherwise.
+//
+//  Once both ends agree, a datagram flagged DATAGRAM_FLAG_COMPRESSED carries
+//  its message compressed. Only the message is: a fragmented one is
+//  compressed whole before it is split, and the fragment header describes the
+//  compressed message.
+//
+// =============================================================================
+
+#ifndef CHDATAGRAMHEADER_H
+#define CHDATAGRAMHEADER_H
+
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#define DATAGRAM_MAGIC 0x4843
+#define DATAGRAM_VERSION 1
+#define DATAGRAM_HEADER_SIZE 20
+
+// The payload is complete state that supersedes any earlier datagram carrying
+// this flag, so a late one can be dropped unparsed.
+#define DATAGRAM_FLAG_LATEST 0x0001
+
+// The payload is one fragment of a larger message.
+#define DATAGRAM_FLAG_FRAGMENT 0x0002
+
+// The payload is a reliable channel message or acknowledgement.
+#define DATAGRAM_FLAG_RELIABLE 0x0004
+
+// The datagram is part of the connection handshake.
+#define DATAGRAM_FLAG_HANDSHAKE 0x0008
+
+// The message is compressed, or on a handshake, compression is on offer.
+#define DATAGRAM_FLAG_COMPRESSED 0x0010
+
+#define FRAGMENT_HEADER_SIZE 12
+// Most fragments one message may be split into, and the largest message a
+// receiver will reassemble.
+#define FRAGMENT_MAX_COUNT 1024
+#define FRAGMENT_MAX_MESSAGE_SIZE (2 * 1024 * 1024)
+
+#define RELIABLE_HEADER_SIZE 12
+
+#define HANDSHAKE_PAYLOAD_SIZE 8
+#define HANDSHAKE_DATAGRAM_SIZE (DATAGRAM_HEADER_SIZE + HANDSHAKE_PAYLOAD_SIZE)
+
+// A sequence number this far behind the newest one is a restarted sender
+// rather than a late datagram.
+#define SEQUENCE_RESTART_GAP 4096
+
+struct ChDatagramHeader {
+    uint8_t type;
+    uint16_t flags;
+    uint16_t payloadSize;
+    uint32_t sequence;
+    uint64_t timestamp;
+};
+
+struct ChFragmentHeader {
+    uint32_t messageId;
+    uint16_t index;
+    uint16_t count;
+    uint32_t messageSize;
+};
+
+struct ChReliableHeader {
+    uint32_t sequence;
+    uint32_t ack;
+    uint32_t ackBits;
+};
+
+// Writes header into the first DATAGRAM_HEADER_SIZE bytes of buffer.
+void writeDatagramHeader(char* buffer, const ChDatagramHeader& header);
+
+// Overwrites just the sequence number and timestamp of a written header.
+void stampDatagramHeader(char* buffer, uint32_t sequence, uint64_t timestamp);
+
+// Reads the header at the start of a datagram. Returns false if the datagram
+// is too short, is from another protocol or version, or claims more payload
+// than it holds.
+bool readDatagramHeader(const char* buffer, size_t size, ChDatagramHeader& header);
+
+// Writes or reads the fragment header at the start of a fragment's payload.
+// Reading returns false if the payload is too short or the header describes
+// an impossible split.
+void writeFragmentHeader(char* payload, const ChFragmentHeader& header);
+bool readFragmentHeader(const char* payload, size_t size, ChFragmentHeader& header);
+
+// Returns the flags of a written header.
+uint16_t readDatagramFlags(const char* buffer);
+
+// Writes or reads the reliable header at the start of a reliable payload.
+void writeReliableHeader(char* payload, const ChReliableHeader& header);
+bool readReliableHeader(const char* payload, size_t size, ChReliableHeader& header);
+
+// Overwrites just the acknowledgement fields of a written reliable header.
+void stampReliableAck(char* payload, uint32_t ack, uint32_t ackBits);
+
+// Writes a whole handshake datagram of the given type into the first
+// HANDSHAKE_DATAGRAM_SIZE bytes of buffer.
+void writeHandshake(char* buffer, uint8_t messageType, uint64_t value);
+
+// Reads a handshake datagram. Returns false if it is anything else.
+bool readHandshake(const char* buffer, size_t size, uint8_t& messageType, uint64_t& value);
+
+// Same as above, offering or accepting compression against the dictionary
+// with the given id. An id of 0 offers none, and is what readHandshake gives
+// for a handshake that offers none.
+void writeHandshake(char* buffer, uint8_t messageType, uint64_t value, uint32_t dictionary);
+bool readHandshake(const char* buffer, size_t size, uint8_t& messageType, uint64_t& value, uint32_t& dictionary);
+
+// Where a fragment's piece of the message starts, and how many bytes it holds.
+size_t fragmentOffset(const ChFragmentHeader& header);
+size_t fragmentSize(const ChFragmentHeader& header);
+
+// Microseconds on the local monotonic clock, as stamped into headers.
+uint64_t datagramTimestamp();
+
+struct ChSequenceStats {
+    // Datagrams with a valid header
+    long received;
+    // Sequence numbers skipped and not yet seen
+    long lost;
+    // Datagrams that arrived after one with a higher sequence number
+    long reordered;
+    // Reordered DATAGRAM_FLAG_LATEST datagrams that were dropped
+    long stale;
+    uint32_t highestSequence;
+    uint64_t lastTimestamp;
+};
+
+// Tracks the sequence numbers arriving from each endpoint. Safe to call from
+// several receiving threads at once.
+class ChSequenceTracker {
+public:
+    // Records a received header. Returns false if the datagram is stale and
+    // should be dropped. A fragment is stale if newer complete state has
+    // arrived, but it only counts as state once its message is whole.
+    bool accept(const boost::asio::ip::udp::endpoint& endpoint, const ChDatagramHeader& header);
+
+    // Records a reassembled DATAGRAM_FLAG_LATEST message whose earliest
+    // fragment had the given sequence number. Returns false if it is stale.
+    bool acceptLatest(const boost::asio::ip::udp::endpoint& endpoint, uint32_t sequence);
+
+    // Counters for one endpoint; all zero if nothing has arrived from it.
+    ChSequenceStats stats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Forgets an endpoint, so a new sender there starts from scratch.
+    void remove(const boost::asio::ip::udp::endpoint& endpoint);
+
+private:
+    struct Sequence {
+        ChSequenceStats stats;
+        // Newest DATAGRAM_FLAG_LATEST sequence, which the staleness check uses
+        uint32_t latestSequence;
+        bool hasLatest;
+    };
+
+    std::mutex trackerMutex;
+    std::map<boost::asio::ip::udp::endpoint, Sequence> sequences;
+};
+
+#endif // CHDATAGRAMHEADER_H
@@ -0,0 +1,89 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChFragmentAssembler.
+//
+// =============================================================================
+
+#include "ChFragmentAssembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+ChFragmentAssembler::ChFragmentAssembler(ChPacketPool& pool, size_t slots, unsigned int timeout)
+    : pool(pool), timeout(timeout), partials(std::max(slots, (size_t)1)) {
+    for (auto& partial : partials) partial.active = false;
+    m_completed = 0;
+    m_expired = 0;
+}
+
+bool ChFragmentAssembler::add(const boost::asio::ip::udp::endpoint& endpoint, const ChFragmentHeader& fragment,
+                              uint32_t sequence, const char* data, size_t size, ChPacketHandle& message,
+                              uint32_t& firstSequence) {
+    if (size != fragmentSize(fragment)) return false;
+    std::lock_guard<std::mutex> lock(assemblerMutex);
+    Partial* partial = findPartial(endpoint, fragment, sequence);
+    // Duplicates and fragments that disagree with the rest of their message are ignored
+    if (partial == NULL || partial->received[fragment.index]) return false;
+
+    std::memcpy(partial->buffer.data() + fragmentOffset(fragment), data, size);
+    partial->received[fragment.index] = true;
+    partial->receivedCount++;
+    if ((int32_t)(sequence - partial->firstSequence) < 0) partial->firstSequence = sequence;
+    if (partial->receivedCount < fragment.count) return false;
+
+    message = std::move(partial->buffer);
+    firstSequence = partial->firstSequence;
+    partial->active = false;
+    m_completed++;
+    return true;
+}
+
+ChFragmentAssembler::Partial* ChFragmentAssembler::findPartial(const boost::asio::ip::udp::endpoint& endpoint,
+                                                               const ChFragmentHeader& fragment, uint32_t sequence) {
+    auto now = std::chrono::steady_clock::now();
+    Partial* free = NULL;
+    Partial* oldest = NULL;
+    for (auto& partial : partials) {
+        if (partial.active && partial.messageId == fragment.messageId && partial.endpoint == endpoint) {
+            if (partial.buffer.size() != fragment.messageSize || partial.received.size() != fragment.count) return NULL;
+            return &partial;
+        }
+        if (partial.active && now - partial.started > timeout) {
+            partial.active = false;
+            partial.buffer.reset();
+            m_expired++;
+        }
+        if (!partial.active) {
+            if (free == NULL) free = &partial;
+        } else if (oldest == NULL || partial.started < oldest->started) {
+            oldest = &partial;
+        }
+    }
+    // Every slot is waiting on fragments, so the one waiting longest gives way
+    if (free == NULL) {
+        free = oldest;
+        m_expired++;
+    }
+    free->active = true;
+    free->endpoint = endpoint;
+    free->messageId = fragment.messageId;
+    free->buffer = pool.acquire(fragment.messageSize);
+    free->buffer.resize(fragment.messageSize);
+    free->received.assign(fragment.count, false);
+    free->receivedCount = 0;
+    free->firstSequence = sequence;
+    free->started = now;
+    return free;
+}
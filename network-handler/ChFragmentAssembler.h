@@ -0,0 +1,79 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Reassembles messages that were split across several datagrams. At most a
+//  fixed number of messages are put back together at once; a message that
+//  hasn't completed within the timeout, or the oldest one when every slot is
+//  taken, is thrown away, so lost fragments never pin memory.
+//
+// =============================================================================
+
+#ifndef CHFRAGMENTASSEMBLER_H
+#define CHFRAGMENTASSEMBLER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "ChDatagramHeader.h"
+#include "ChPacketPool.h"
+
+// Messages that can be partly received at once.
+#define REASSEMBLY_SLOTS 16
+// How long a partly received message waits for the rest, in milliseconds.
+#define REASSEMBLY_TIMEOUT 500
+
+class ChFragmentAssembler {
+public:
+    ChFragmentAssembler(ChPacketPool& pool, size_t slots = REASSEMBLY_SLOTS, unsigned int timeout = REASSEMBLY_TIMEOUT);
+
+    // Adds the fragment in data, which arrived from endpoint with the given
+    // sequence number. Once its message is whole, returns true with message
+    // holding the reassembled payload and firstSequence the lowest sequence
+    // number among its fragments.
+    bool add(const boost::asio::ip::udp::endpoint& endpoint, const ChFragmentHeader& fragment, uint32_t sequence,
+             const char* data, size_t size, ChPacketHandle& message, uint32_t& firstSequence);
+
+    // Messages reassembled in full.
+    long completed() { return m_completed; }
+    // Partial messages thrown away to time out or make room.
+    long expired() { return m_expired; }
+
+private:
+    struct Partial {
+        bool active;
+        boost::asio::ip::udp::endpoint endpoint;
+        uint32_t messageId;
+        ChPacketHandle buffer;
+        std::vector<bool> received;
+        size_t receivedCount;
+        uint32_t firstSequence;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // Finds the slot holding this message, or starts it in a free slot.
+    Partial* findPartial(const boost::asio::ip::udp::endpoint& endpoint, const ChFragmentHeader& fragment,
+                         uint32_t sequence);
+
+    ChPacketPool& pool;
+    std::chrono::milliseconds timeout;
+    std::mutex assemblerMutex;
+    std::vector<Partial> partials;
+    std::atomic<long> m_completed;
+    std::atomic<long> m_expired;
+};
+
+#endif // CHFRAGMENTASSEMBLER_H
@@ -20,19 +20,36 @@
 // =============================================================================
 
 #include "ChNetworkHandler.h"
+#include "ChCompactVehicles.h"
 #include "MessageCodes.h"
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 
-ChNetworkHandler::ChNetworkHandler() : socket(*(new boost::asio::io_service)) {
+ChNetworkHandler::ChNetworkHandler() : socket(*(new boost::asio::io_service)), fragments(packets) {
     listener = nullptr;
     sender = nullptr;
     shutdown = false;
+    nextMessageId = 0;
+    batchSize = DEFAULT_BATCH_SIZE;
+    compressedMessages = 0;
+    compressedBytesIn = 0;
+    compressedBytesOut = 0;
+    peersForgotten = false;
+    for (int code = 0; code < 256; code++) trafficClasses[code] = defaultTrafficClass(code);
 }
 
 ChNetworkHandler::~ChNetworkHandler() {
     socket.close();
     shutdown = true;
+    {
+        // Releases any thread still waiting for a socket that never opened
+        std::lock_guard<std::mutex> lock(socketMutex);
+        initVar.notify_all();
+    }
     delete &socket.get_io_service();
     // Closing all message handling threads.
     if (listener != nullptr) {
@@ -45,170 +62,625 @@ ChNetworkHandler::~ChNetworkHandler() {
     }
 }
 
-void ChNetworkHandler::sendMessage(boost::asio::ip::udp::endpoint& endpoint, boost::asio::streambuf& message) {
-    boost::system::error_code error;
-    // Lock Starts
+void ChNetworkHandler::waitForSocket() {
     std::unique_lock<std::mutex> lock(socketMutex);
-    // Wait for the socket to be open before we try to send anything
-    initVar.wait(lock, [&] { return socket.is_open(); });
-    socket.send_to(message.data(), endpoint, 0, error);
-    // Lock Ends
-    lock.unlock();
+    initVar.wait(lock, [&] { return socket.is_open() || shutdown; });
+}
+
+bool ChNetworkHandler::waitReadable(boost::asio::ip::udp::socket& from, int timeout) {
+#ifdef __linux__
+    pollfd descriptor = {from.native_handle(), POLLIN, 0};
+    return poll(&descriptor, 1, timeout) > 0;
+#else
+    std::this_thread::yield();
+    return true;
+#endif
+}
+
+bool ChNetworkHandler::waitWritable() {
+#ifdef __linux__
+    pollfd descriptor = {socket.native_handle(), POLLOUT, 0};
+    return poll(&descriptor, 1, SOCKET_POLL_TIMEOUT) > 0;
+#else
+    std::this_thread::yield();
+    return true;
+#endif
+}
+
+void ChNetworkHandler::sendMessage(boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& message) {
+    boost::system::error_code error;
+    stampMessage(endpoint, message);
+    socket.send_to(boost::asio::buffer(message.data(), message.size()), endpoint, 0, error);
+    // A full send buffer is the only reason to wait; retry once there is room
+    while (error == boost::asio::error::would_block && socket.is_open() && !shutdown) {
+        waitWritable();
+        socket.send_to(boost::asio::buffer(message.data(), message.size()), endpoint, 0, error);
+    }
     if (error == boost::asio::error::host_not_found) {
         //TODO: Handle event by removing endpoint from world object or something
     }
 }
 
-std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>> ChNetworkHandler::receiveMessage() {
+DatagramPair ChNetworkHandler::receiveMessage() {
+    return receiveMessage(socket);
+}
+
+DatagramPair ChNetworkHandler::receiveMessage(boost::asio::ip::udp::socket& from) {
     boost::system::error_code error;
     boost::asio::ip::udp::endpoint endpoint;
-    size_t received;
-    auto buffer = std::make_shared<boost::asio::streambuf>();
-    // Lock Starts
+    size_t received = 0;
+    ChPacketHandle buffer;
     do {
-        std::unique_lock<std::mutex> lock(socketMutex);
-        // Wait for socket to be open before we try to receive
-        initVar.wait(lock, [&]{ return socket.is_open(); });
-        // Receives bytes into the udp stack without removing any
-        socket.receive(boost::asio::null_buffers(), 0, error);
-        //TODO: Handle error message here
+        // Sleeps in the kernel until a datagram shows up, without holding anything the sender needs
+        if (!waitReadable(from)) {
+            error = boost::asio::error::would_block;
+            continue;
+        }
         boost::system::error_code availableError;
-        int available = socket.available(availableError);
+        int available = from.available(availableError);
         // Once the udp stack has something, we receive it into the buffer and return.
         if (!availableError && available != 0) {
-            received = socket.receive_from(buffer->prepare(available), endpoint, 0, error);
+            buffer = packets.acquire(available);
+            received = from.receive_from(boost::asio::buffer(buffer.data(), buffer.capacity()), endpoint, 0, error);
+        } else error = boost::asio::error::would_block;
+        //TODO: Handle error message here
+    } while (error == boost::asio::error::would_block && from.is_open() && !shutdown);
+    if (!buffer) buffer = packets.acquire();
+    buffer.resize(received);
+    return DatagramPair(endpoint, std::move(buffer));
+}
+
+void ChNetworkHandler::setBatchSize(unsigned int size) {
+    batchSize = std::max(size, 1u);
+}
+
+ChPacketPool& ChNetworkHandler::packetPool() {
+    return packets;
+}
+
+ChArenaPool& ChNetworkHandler::arenaPool() {
+    return arenas;
+}
+
+ChSequenceStats ChNetworkHandler::sequenceStats(const boost::asio::ip::udp::endpoint& endpoint) {
+    return receiveSequences.stats(endpoint);
+}
+
+ChReliableStats ChNetworkHandler::reliableStats(const boost::asio::ip::udp::endpoint& endpoint) {
+    return reliable.stats(endpoint);
+}
+
+ChSendStats ChNetworkHandler::sendStats(const boost::asio::ip::udp::endpoint& endpoint) {
+    return sendScheduler.stats(endpoint);
+}
+
+void ChNetworkHandler::setTrafficClass(uint8_t messageType, int trafficClass) {
+    trafficClasses[messageType] = std::min(std::max(trafficClass, 0), TRAFFIC_CLASSES - 1);
+}
+
+int ChNetworkHandler::trafficClass(uint8_t messageType) {
+    return trafficClasses[messageType];
+}
+
+ChCompressionStats ChNetworkHandler::compressionStats() {
+    ChCompressionStats stats;
+    stats.messages = compressedMessages;
+    stats.bytesIn = compressedBytesIn;
+    stats.bytesOut = compressedBytesOut;
+    return stats;
+}
+
+ChPacketHandle ChNetworkHandler::serializeMessage(uint8_t messageType, google::protobuf::Message& message, uint16_t flags) {
+    size_t offset = DATAGRAM_HEADER_SIZE + (flags & DATAGRAM_FLAG_RELIABLE ? RELIABLE_HEADER_SIZE : 0);
+    size_t size = message.ByteSizeLong();
+    ChPacketHandle buffer = packets.acquire(offset + size);
+    ChDatagramHeader header;
+    header.type = messageType;
+    header.flags = flags;
+    header.payloadSize = offset - DATAGRAM_HEADER_SIZE + size;
+    header.sequence = 0;
+    header.timestamp = 0;
+    writeDatagramHeader(buffer.data(), header);
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8*>(buffer.data() + offset));
+    buffer.resize(offset + size);
+    return buffer;
+}
+
+ChPacketHandle ChNetworkHandler::compressMessage(const ChPacketHandle& message) {
+    size_t payloadSize = message.size() - DATAGRAM_HEADER_SIZE;
+    if (payloadSize < COMPRESSION_THRESHOLD) return message;
+    ChPacketHandle buffer = packets.acquire(message.size());
+    // Any output as large as the input is given up on
+    size_t compressedSize = compressor->compress(message.data() + DATAGRAM_HEADER_SIZE, payloadSize,
+                                                 buffer.data() + DATAGRAM_HEADER_SIZE, payloadSize - 1);
+    if (compressedSize == 0) return message;
+    ChDatagramHeader header;
+    readDatagramHeader(message.data(), message.size(), header);
+    header.flags |= DATAGRAM_FLAG_COMPRESSED;
+    header.payloadSize = compressedSize;
+    writeDatagramHeader(buffer.data(), header);
+    buffer.resize(DATAGRAM_HEADER_SIZE + compressedSize);
+    compressedMessages++;
+    compressedBytesIn += payloadSize;
+    compressedBytesOut += compressedSize;
+    return buffer;
+}
+
+ChPacketHandle ChNetworkHandler::copyPacket(const ChPacketHandle& packet) {
+    ChPacketHandle copy = packets.acquire(packet.size());
+    std::memcpy(copy.data(), packet.data(), packet.size());
+    copy.resize(packet.size());
+    return copy;
+}
+
+void ChNetworkHandler::stampMessage(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& message) {
+    if (message.size() < DATAGRAM_HEADER_SIZE) return;
+    // Handshake replies stay stateless, so they start no sequence for the endpoint
+    if (readDatagramFlags(message.data()) & DATAGRAM_FLAG_HANDSHAKE) return;
+    if (peersForgotten.exchange(false)) {
+        std::lock_guard<std::mutex> lock(forgottenMutex);
+        for (auto& forgotten : forgottenPeers) sendSequences.erase(forgotten);
+        forgottenPeers.clear();
+    }
+    stampDatagramHeader(message.data(), sendSequences[endpoint]++, datagramTimestamp());
+    if (readDatagramFlags(message.data()) & DATAGRAM_FLAG_RELIABLE) reliable.stamp(endpoint, message);
+}
+
+ChPacketHandle ChNetworkHandler::makeAck() {
+    ChPacketHandle buffer = packets.acquire(DATAGRAM_HEADER_SIZE + RELIABLE_HEADER_SIZE);
+    ChDatagramHeader header;
+    header.type = ACK_MESSAGE;
+    header.flags = DATAGRAM_FLAG_RELIABLE;
+    header.payloadSize = RELIABLE_HEADER_SIZE;
+    header.sequence = 0;
+    header.timestamp = 0;
+    writeDatagramHeader(buffer.data(), header);
+    ChReliableHeader reliableHeader = {0, 0, 0};
+    writeReliableHeader(buffer.data() + DATAGRAM_HEADER_SIZE, reliableHeader);
+    buffer.resize(DATAGRAM_HEADER_SIZE + RELIABLE_HEADER_SIZE);
+    return buffer;
+}
+
+void ChNetworkHandler::forgetPeer(const boost::asio::ip::udp::endpoint& endpoint) {
+    reliable.remove(endpoint);
+    receiveSequences.remove(endpoint);
+    sendScheduler.remove(endpoint);
+    std::lock_guard<std::mutex> lock(forgottenMutex);
+    forgottenPeers.push_back(endpoint);
+    peersForgotten = true;
+}
+
+void ChNetworkHandler::addRetransmits(std::vector<DatagramPair>& batch) {
+    if (!reliable.pending()) return;
+    auto now = std::chrono::steady_clock::now();
+    if (now - retransmitCheck < std::chrono::milliseconds(RELIABLE_TICK)) return;
+    retransmitCheck = now;
+    std::vector<boost::asio::ip::udp::endpoint> lost;
+    reliable.collectRetransmits(batch, lost);
+    for (auto& endpoint : lost) loseEndpoint(endpoint);
+}
+
+ChPacketHandle ChNetworkHandler::makeFragment(ChPacketHandle& message, uint16_t index, uint16_t count,
+                                              uint32_t messageId) {
+    ChDatagramHeader header;
+    readDatagramHeader(message.data(), message.size(), header);
+    ChFragmentHeader fragment;
+    fragment.messageId = messageId;
+    fragment.index = index;
+    fragment.count = count;
+    fragment.messageSize = message.size() - DATAGRAM_HEADER_SIZE;
+    size_t pieceSize = fragmentSize(fragment);
+
+    ChPacketHandle buffer = packets.acquire(DATAGRAM_HEADER_SIZE + FRAGMENT_HEADER_SIZE + pieceSize);
+    header.flags |= DATAGRAM_FLAG_FRAGMENT;
+    header.payloadSize = FRAGMENT_HEADER_SIZE + pieceSize;
+    writeDatagramHeader(buffer.data(), header);
+    writeFragmentHeader(buffer.data() + DATAGRAM_HEADER_SIZE, fragment);
+    std::memcpy(buffer.data() + DATAGRAM_HEADER_SIZE + FRAGMENT_HEADER_SIZE,
+                message.data() + DATAGRAM_HEADER_SIZE + fragmentOffset(fragment), pieceSize);
+    buffer.resize(DATAGRAM_HEADER_SIZE + header.payloadSize);
+    return buffer;
+}
+
+int ChNetworkHandler::readMessage(DatagramPair& recPair,
+                                  const std::function<void(uint8_t, const char*, int)>& deliver) {
+    ChPacketHandle& buffer = recPair.second;
+    ChDatagramHeader header;
+    if (!readDatagramHeader(buffer.data(), buffer.size(), header)) return MESSAGE_MALFORMED;
+    if (!receiveSequences.accept(recPair.first, header)) return MESSAGE_DROPPED;
+    if (header.flags & DATAGRAM_FLAG_RELIABLE) return readReliable(recPair, header, deliver);
+    const char* payload = buffer.data() + DATAGRAM_HEADER_SIZE;
+    int payloadSize = header.payloadSize;
+    if (!(header.flags & DATAGRAM_FLAG_FRAGMENT)) {
+        return deliverPayload(header.type, header.flags, payload, payloadSize, deliver);
+    }
+
+    ChFragmentHeader fragment;
+    if (!readFragmentHeader(payload, payloadSize, fragment)) return MESSAGE_MALFORMED;
+    ChPacketHandle message;
+    uint32_t firstSequence;
+    if (!fragments.add(recPair.first, fragment, header.sequence, payload + FRAGMENT_HEADER_SIZE,
+                       payloadSize - FRAGMENT_HEADER_SIZE, message, firstSequence)) {
+        return MESSAGE_READY;
+    }
+    // Whole state is only stale if newer state was completed before it
+    if ((header.flags & DATAGRAM_FLAG_LATEST) && !receiveSequences.acceptLatest(recPair.first, firstSequence)) {
+        return MESSAGE_DROPPED;
+    }
+    recPair.second = std::move(message);
+    return deliverPayload(header.type, header.flags, recPair.second.data(), recPair.second.size(), deliver);
+}
+
+int ChNetworkHandler::deliverPayload(uint8_t messageType, uint16_t flags, const char* payload, int payloadSize,
+                                     const std::function<void(uint8_t, const char*, int)>& deliver) {
+    if (!(flags & DATAGRAM_FLAG_COMPRESSED)) {
+        deliver(messageType, payload, payloadSize);
+        return MESSAGE_READY;
+    }
+    size_t size = ChPacketCompressor::decompressedSize(payload, payloadSize);
+    // Nothing larger is ever sent, so anything claiming to be isn't worth the memory
+    if (!compressor || size > FRAGMENT_MAX_MESSAGE_SIZE) return MESSAGE_MALFORMED;
+    ChPacketHandle message = packets.acquire(size);
+    if (!compressor->decompress(payload, payloadSize, message.data())) return MESSAGE_MALFORMED;
+    message.resize(size);
+    deliver(messageType, message.data(), size);
+    return MESSAGE_READY;
+}
+
+int ChNetworkHandler::readReliable(DatagramPair& recPair, const ChDatagramHeader& header,
+                                   const std::function<void(uint8_t, const char*, int)>& deliver) {
+    ChReliableHeader reliableHeader;
+    const char* payload = recPair.second.data() + DATAGRAM_HEADER_SIZE;
+    // Reliable messages are retransmitted whole, never fragmented or compressed
+    if (header.flags & (DATAGRAM_FLAG_FRAGMENT | DATAGRAM_FLAG_COMPRESSED)) return MESSAGE_MALFORMED;
+    if (!readReliableHeader(payload, header.payloadSize, reliableHeader)) return MESSAGE_MALFORMED;
+    reliable.acknowledge(recPair.first, reliableHeader);
+    if (header.type == ACK_MESSAGE) return MESSAGE_READY;
+
+    bool ackNeeded = reliable.receive(recPair.first, reliableHeader, recPair.second, [&deliver](ChPacketHandle& datagram) {
+        // Held datagrams had their headers checked when they arrived
+        ChDatagramHeader heldHeader;
+        readDatagramHeader(datagram.data(), datagram.size(), heldHeader);
+        deliver(heldHeader.type, datagram.data() + DATAGRAM_HEADER_SIZE + RELIABLE_HEADER_SIZE,
+                heldHeader.payloadSize - RELIABLE_HEADER_SIZE);
+    });
+    if (ackNeeded) queueDatagram(recPair.first, makeAck());
+    return MESSAGE_READY;
+}
+
+void ChNetworkHandler::sendMessages(std::vector<DatagramPair>& messages) {
+#ifdef __linux__
+    if (batchSize > 1) {
+        sendVectors.resize(batchSize);
+        sendHeaders.resize(batchSize);
+        // Stamped once up front so a retried send keeps its sequence number
+        for (auto& message : messages) {
+            stampMessage(message.first, message.second);
+        }
+        size_t sent = 0;
+        while (sent < messages.size() && socket.is_open() && !shutdown) {
+            size_t count = std::min(messages.size() - sent, (size_t)batchSize);
+            for (size_t i = 0; i < count; i++) {
+                boost::asio::ip::udp::endpoint& endpoint = messages[sent + i].first;
+                ChPacketHandle& buffer = messages[sent + i].second;
+                sendVectors[i].iov_base = buffer.data();
+                sendVectors[i].iov_len = buffer.size();
+                std::memset(&sendHeaders[i], 0, sizeof(mmsghdr));
+                sendHeaders[i].msg_hdr.msg_name = endpoint.data();
+                sendHeaders[i].msg_hdr.msg_namelen = endpoint.size();
+                sendHeaders[i].msg_hdr.msg_iov = &sendVectors[i];
+                sendHeaders[i].msg_hdr.msg_iovlen = 1;
+            }
+            int sentCount = sendmmsg(socket.native_handle(), sendHeaders.data(), count, 0);
+            if (sentCount > 0) {
+                sent += sentCount;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                waitWritable();
+            } else if (errno != EINTR) {
+                // The datagram at the head of the batch can't be sent; drop it so the rest still go out
+                sent++;
+            }
         }
-        //TODO: Handle error message again here
-    } while (error == boost::asio::error::would_block && socket.is_open() && !shutdown);
-    buffer->commit(received);
-    return std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>>(endpoint, buffer);
+        return;
+    }
+#endif
+    for (auto& message : messages) {
+        sendMessage(message.first, message.second);
+    }
+}
+
+size_t ChNetworkHandler::receiveMessages(std::vector<DatagramPair>& messages) {
+    return receiveMessages(socket, receiveScratch, messages);
 }
 
-ChClientHandler::ChClientHandler(std::string hostname, std::string port) :
+size_t ChNetworkHandler::receiveMessages(boost::asio::ip::udp::socket& from, ChReceiveBatch& scratch,
+                                         std::vector<DatagramPair>& messages) {
+#ifdef __linux__
+    if (batchSize > 1) {
+        size_t slabSize = packets.slabSize();
+        size_t overflowSize = MAX_DATAGRAM_SIZE > slabSize ? MAX_DATAGRAM_SIZE - slabSize : 0;
+        if (scratch.receiveHeaders.size() != batchSize) {
+            scratch.receiveBuffers.resize(batchSize);
+            scratch.overflowSlots.resize((size_t)batchSize * overflowSize);
+            scratch.receiveAddresses.resize(batchSize);
+            scratch.receiveVectors.resize(2 * batchSize);
+            scratch.receiveHeaders.resize(batchSize);
+        }
+        int received = 0;
+        while (from.is_open() && !shutdown) {
+            // Sleeps in the kernel until a datagram shows up, without holding anything the sender needs
+            if (!waitReadable(from)) continue;
+            for (size_t i = 0; i < batchSize; i++) {
+                // Slots handed out by the last call get a fresh pooled buffer
+                if (!scratch.receiveBuffers[i]) scratch.receiveBuffers[i] = packets.acquire();
+                scratch.receiveVectors[2 * i].iov_base = scratch.receiveBuffers[i].data();
+                scratch.receiveVectors[2 * i].iov_len = scratch.receiveBuffers[i].capacity();
+                scratch.receiveVectors[2 * i + 1].iov_base = scratch.overflowSlots.data() + i * overflowSize;
+                scratch.receiveVectors[2 * i + 1].iov_len = overflowSize;
+                std::memset(&scratch.receiveHeaders[i], 0, sizeof(mmsghdr));
+                scratch.receiveHeaders[i].msg_hdr.msg_name = &scratch.receiveAddresses[i];
+                scratch.receiveHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+                scratch.receiveHeaders[i].msg_hdr.msg_iov = &scratch.receiveVectors[2 * i];
+                scratch.receiveHeaders[i].msg_hdr.msg_iovlen = 2;
+            }
+            // Pulls everything the udp stack has, up to one batch, in one call
+            received = recvmmsg(from.native_handle(), scratch.receiveHeaders.data(), batchSize, MSG_DONTWAIT, nullptr);
+            if (received > 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) break;
+        }
+
+        for (int i = 0; i < received; i++) {
+            boost::asio::ip::udp::endpoint endpoint;
+            std::memcpy(endpoint.data(), &scratch.receiveAddresses[i], scratch.receiveHeaders[i].msg_hdr.msg_namelen);
+            endpoint.resize(scratch.receiveHeaders[i].msg_hdr.msg_namelen);
+            size_t length = scratch.receiveHeaders[i].msg_len;
+            if (length <= scratch.receiveBuffers[i].capacity()) {
+                // Common case: the datagram landed entirely in the pooled buffer
+                scratch.receiveBuffers[i].resize(length);
+                messages.push_back(DatagramPair(endpoint, std::move(scratch.receiveBuffers[i])));
+            } else {
+                // Spilled into the overflow slot, so stitch it into one large buffer
+                ChPacketHandle large = packets.acquire(length);
+                size_t head = scratch.receiveBuffers[i].capacity();
+                std::memcpy(large.data(), scratch.receiveBuffers[i].data(), head);
+                std::memcpy(large.data() + head, scratch.overflowSlots.data() + i * overflowSize, length - head);
+                large.resize(length);
+                messages.push_back(DatagramPair(endpoint, std::move(large)));
+            }
+        }
+        return received > 0 ? received : 0;
+    }
+#endif
+    messages.push_back(receiveMessage(from));
+    return 1;
+}
+
+ChClientHandler::ChClientHandler(std::string hostname, std::string port,
+                                 std::shared_ptr<const ChPacketCompressor> compressor) :
     ChNetworkHandler() {
-    // Lock begins -- the udp socket cannot open during the tcp connection process
+    // Lock begins -- the listener and sender wait until the handshake is done
     std::unique_lock<std::mutex> lock(socketMutex);
     m_connectionNumber = -1;
-    boost::asio::ip::tcp::resolver tcpResolver(socket.get_io_service());
-    boost::asio::ip::tcp::resolver::query tcpQuery(hostname, port);
-    uint8_t requestResponse;
-    boost::asio::ip::tcp::socket tcpSocket(socket.get_io_service());
+    superseded = 0;
+    compressing = false;
+    serverLost = false;
+    this->compressor = compressor;
     try {
-        boost::asio::ip::tcp::resolver::iterator endpointIterator = tcpResolver.resolve(tcpQuery);
-        boost::asio::connect(tcpSocket, endpointIterator);
-        uint8_t connectionRequest = CONNECTION_REQUEST;
-        tcpSocket.send(boost::asio::buffer(&connectionRequest, sizeof(uint8_t)));
-        tcpSocket.receive(boost::asio::buffer(&requestResponse, sizeof(uint8_t)));
-        // Any problems with network connection must throw
-    } catch (std::exception& err) { throw ConnectionException(FAILED_CONNECTION); }
-    // If the connection is refused, the clientHandler cannot be constructed
-    if(requestResponse == CONNECTION_DECLINE) throw ConnectionException(REFUSED_CONNECTION);
-    // After connection is accepted, other information can then be sent
-    if(requestResponse == CONNECTION_ACCEPT) {
-        uint32_t connectionNumber;
-        tcpSocket.receive(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
-        tcpSocket.close();
-        m_connectionNumber = connectionNumber;
-
         boost::asio::ip::udp::resolver udpResolver(socket.get_io_service());
         boost::asio::ip::udp::resolver::query udpQuery(boost::asio::ip::udp::v4(), hostname, port);
         serverEndpoint = *udpResolver.resolve(udpQuery);
         socket.open(boost::asio::ip::udp::v4());
+        socket.set_option(boost::asio::socket_base::receive_buffer_size(RECEIVE_BUFFER_SIZE));
         socket.non_blocking(true);
-        // TODO: Complete Handshake over udp.
-        initVar.notify_one();
-    } else throw ConnectionException(UNDETERMINED_CONNECTION);
+        // Any problems with network connection must throw
+    } catch (std::exception& err) { throw ConnectionException(FAILED_CONNECTION); }
+    int response = handshake();
+    // If the connection is refused, the clientHandler cannot be constructed
+    if (response == CONNECTION_DECLINE) throw ConnectionException(REFUSED_CONNECTION);
+    if (response != CONNECTION_ACCEPT) throw ConnectionException(FAILED_CONNECTION);
+    initVar.notify_all();
+}
+
+int ChClientHandler::handshake() {
+    char request[HANDSHAKE_DATAGRAM_SIZE];
+    char reply[HANDSHAKE_DATAGRAM_SIZE];
+    uint64_t cookie = 0;
+    uint32_t offered = compressor ? compressor->dictionaryId() : 0;
+    for (int attempt = 0; attempt < HANDSHAKE_ATTEMPTS; attempt++) {
+        writeHandshake(request, CONNECTION_REQUEST, cookie, offered);
+        boost::system::error_code error;
+        socket.send_to(boost::asio::buffer(request, sizeof(request)), serverEndpoint, 0, error);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HANDSHAKE_TIMEOUT);
+        bool challenged = false;
+        while (!challenged) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0 || !waitReadable(socket, left.count())) break;
+            boost::asio::ip::udp::endpoint from;
+            size_t received = socket.receive_from(boost::asio::buffer(reply, sizeof(reply)), from, 0, error);
+            // Anything but a handshake from the server is noise at this point
+            uint8_t messageType;
+            uint64_t value;
+            uint32_t dictionary;
+            if (error || from != serverEndpoint || !readHandshake(reply, received, messageType, value, dictionary)) {
+                continue;
+            }
+            if (messageType == CONNECTION_CHALLENGE) {
+                cookie = value;
+                challenged = true;
+            } else if (messageType == CONNECTION_ACCEPT) {
+                m_connectionNumber = (int)value;
+                compressing = offered != 0 && dictionary == offered;
+                return CONNECTION_ACCEPT;
+            } else if (messageType == CONNECTION_DECLINE) {
+                return CONNECTION_DECLINE;
+            }
+        }
+        // A challenge is answered right away; it doesn't use up an attempt
+        if (challenged) attempt--;
+    }
+    return NULL_MESSAGE;
 }
 
 ChClientHandler::~ChClientHandler() {
     shutdown = true;
-    sendQueue.dumpThreads();
+    sendScheduler.dumpThreads();
+    simUpdateQueue.dumpThreads();
+    DSRCUpdateQueue.dumpThreads();
     socket.close();
 }
 
+bool ChClientHandler::isConnected() {
+    return !serverLost;
+}
+
 int ChClientHandler::connectionNumber() {
     while (m_connectionNumber == -1);
     return m_connectionNumber;
 }
 
+bool ChClientHandler::compressionAgreed() {
+    return compressing;
+}
+
+bool ChClientHandler::compressesFor(const boost::asio::ip::udp::endpoint& endpoint) {
+    return compressing && endpoint == serverEndpoint;
+}
+
+void ChClientHandler::loseEndpoint(const boost::asio::ip::udp::endpoint& endpoint) {
+    if (endpoint == serverEndpoint) serverLost = true;
+}
+
 void ChClientHandler::beginListen() {
     listener = new std::thread([&, this] {
-        while (socket.is_open() && !shutdown) {
-            // This is a pair of a buffer and the endpoint it came from
-            auto recPair = receiveMessage();
-            //TODO: Handle endpoint information here
-            boost::asio::streambuf& buffer = *(recPair.second);
-            std::istream stream(&buffer);
-            // Every buffer will contain its message type in the first byte
-            uint8_t messageType;
-            stream >> messageType;
-
-            // Message is parsed based on its type.
-            switch (messageType) {
-                case MESSAGE_PACKET: {
-                    ChronoMessages::MessagePacket packet;
-                    packet.ParseFromIstream(&stream);
-                    for (size_t i = 0; i < packet.vehiclemessages_size(); i++) {
-                        auto vehicleMessage = std::make_shared<ChronoMessages::VehicleMessage>();
-                        vehicleMessage->CopyFrom(packet.vehiclemessages(i));
-                        simUpdateQueue.enqueue(vehicleMessage);
-                    }
-                    for (size_t i = 0; i < packet.dsrcmessages_size(); i++) {
-                        auto DMessage = std::make_shared<ChronoMessages::DSRCMessage>();
-                        DMessage->CopyFrom(packet.dsrcmessages(i));
-                        DSRCUpdateQueue.enqueue(DMessage);
-                    }
-                    break;
-                }
-                case VEHICLE_MESSAGE: {
-                    auto message = std::make_shared<ChronoMessages::VehicleMessage>();
-                    message->ParseFromIstream(&stream);
-                    simUpdateQueue.enqueue(message);
-                    break;
-                }
-                case DSRC_MESSAGE: {
-                    auto message = std::make_shared<ChronoMessages::DSRCMessage>();
-                    message->ParseFromIstream(&stream);
-                    DSRCUpdateQueue.enqueue(message);
-                    break;
+        waitForSocket();
+        try {
+            std::vector<DatagramPair> batch;
+            while (socket.is_open() && !shutdown) {
+                // Each entry is a pair of a buffer and the endpoint it came from
+                batch.clear();
+                receiveMessages(batch);
+                // Everything in the batch is parsed onto one arena
+                auto arena = arenas.acquire();
+                //TODO: Handle endpoint information here
+                for (auto& recPair : batch) {
+                    processMessage(recPair, arena);
                 }
-                default:
-                    // TODO: Deal with gibberish message.
-                    break;
             }
+        } catch (PredicateException& ex) {
         }
     });
 }
 
+void ChClientHandler::processMessage(DatagramPair& recPair, std::shared_ptr<google::protobuf::Arena>& arena) {
+    // Malformed datagrams, state the server has already replaced and pieces of
+    // unfinished messages are never parsed
+    readMessage(recPair, [this, &arena](uint8_t messageType, const char* payload, int payloadSize) {
+        // Nothing from a message that fails to parse is queued
+        try {
+            deliverMessage(messageType, payload, payloadSize, arena);
+        } catch (CommunicationException& ex) {
+        }
+    });
+}
+
+void ChClientHandler::deliverMessage(uint8_t messageType, const char* payload, int payloadSize,
+                                     std::shared_ptr<google::protobuf::Arena>& arena) {
+    // Message is parsed based on its type.
+    switch (messageType) {
+        case MessageTraits<ChronoMessages::MessagePacket>::code: {
+            auto packet = parseOnArena<ChronoMessages::MessagePacket>(serverEndpoint, payload, payloadSize, arena);
+            // TODO: Deal with gibberish message.
+            if (packet->has_compactvehicles() && !expandVehicles(*packet)) break;
+            // The packet's contents are handed out in place; each pointer keeps the arena alive
+            for (int i = 0; i < packet->vehiclemessages_size(); i++) {
+                simUpdateQueue.enqueue(std::shared_ptr<google::protobuf::Message>(packet, packet->mutable_vehiclemessages(i)));
+            }
+            for (int i = 0; i < packet->reducedvehicles_size(); i++) {
+                simUpdateQueue.enqueue(std::shared_ptr<google::protobuf::Message>(packet, packet->mutable_reducedvehicles(i)));
+            }
+            for (int i = 0; i < packet->dsrcmessages_size(); i++) {
+                DSRCUpdateQueue.enqueue(std::shared_ptr<ChronoMessages::DSRCMessage>(packet, packet->mutable_dsrcmessages(i)));
+            }
+            for (int i = 0; i < packet->removals_size(); i++) {
+                simUpdateQueue.enqueue(std::shared_ptr<google::protobuf::Message>(packet, packet->mutable_removals(i)));
+            }
+            // Later snapshots only need to carry what changed since this one
+            if (packet->has_snapshot()) {
+                ChronoMessages::SnapshotAck ack;
+                ack.set_connectionnumber(m_connectionNumber);
+                ack.set_idnumber(-1);
+                ack.set_snapshot(packet->snapshot());
+                pushMessage(ack);
+            }
+            break;
+        }
+        case MessageTraits<ChronoMessages::VehicleMessage>::code: {
+            simUpdateQueue.enqueue(parseOnArena<ChronoMessages::VehicleMessage>(serverEndpoint, payload, payloadSize, arena));
+            break;
+        }
+        case MessageTraits<ChronoMessages::ReducedVehicleMessage>::code: {
+            simUpdateQueue.enqueue(
+                parseOnArena<ChronoMessages::ReducedVehicleMessage>(serverEndpoint, payload, payloadSize, arena));
+            break;
+        }
+        case MessageTraits<ChronoMessages::DSRCMessage>::code: {
+            DSRCUpdateQueue.enqueue(parseOnArena<ChronoMessages::DSRCMessage>(serverEndpoint, payload, payloadSize, arena));
+            break;
+        }
+        case MessageTraits<ChronoMessages::ControlMessage>::code: {
+            simUpdateQueue.enqueue(parseOnArena<ChronoMessages::ControlMessage>(serverEndpoint, payload, payloadSize, arena));
+            break;
+        }
+        default:
+            // TODO: Deal with gibberish message.
+            break;
+    }
+}
+
 void ChClientHandler::beginSend() {
     sender = new std::thread([&, this] {
+        waitForSocket();
         try {
+            std::vector<DatagramPair> batch;
             // Constantly sends messages until handler is shut down or socket is closed
             while (socket.is_open() && !shutdown) {
-                auto buffer = sendQueue.dequeue();
-                sendMessage(serverEndpoint, *buffer);
+                // Takes a batch, highest traffic class first. With nothing ready it sleeps until
+                // something is queued or, while reliable messages are unacknowledged, the next
+                // tick to check their timers.
+                batch.clear();
+                takeMailbox();
+                auto wait = sendScheduler.collect(batch, batchSize);
+                addRetransmits(batch);
+                if (!batch.empty()) {
+                    sendMessages(batch);
+                    continue;
+                }
+                std::chrono::steady_clock::duration tick = std::chrono::milliseconds(RELIABLE_TICK);
+                if (reliable.pending()) wait = std::min(wait, tick);
+                sendScheduler.waitFor(wait);
             }
-        } catch (PredicateException ex) {
+        } catch (PredicateException& ex) {
         }
     });
 }
 
-void ChClientHandler::pushMessage(google::protobuf::Message& message) {
-    uint8_t messageType;
-    // Identify the type using protobuf's introspective functions
-    std::string type = message.GetDescriptor()->full_name();
-    if (type.compare(VEHICLE_MESSAGE_TYPE) == 0) messageType = VEHICLE_MESSAGE;
-    else if (type.compare(DSRC_MESSAGE_TYPE) == 0) messageType = DSRC_MESSAGE;
-    else if (type.compare(MESSAGE_PACKET_TYPE) == 0) messageType = MESSAGE_PACKET;
-    // TODO: else throw some exception about how this message type isn't supported.
-
-    auto buffer = std::make_shared<boost::asio::streambuf>();
-    std::ostream stream(buffer.get());
-    stream << messageType;
-    message.SerializeToOstream(&stream);
-    stream.flush();
+void ChClientHandler::takeMailbox() {
+    ChSendStats queued = sendScheduler.stats(serverEndpoint);
+    std::lock_guard<std::mutex> lock(mailboxMutex);
+    for (auto entry = mailbox.begin(); entry != mailbox.end();) {
+        // States already queued go out first; the mailbox keeps replacing its own meanwhile
+        if (queued.depthByClass[entry->second.trafficClass] > 0) {
+            entry++;
+            continue;
+        }
+        for (ChPacketHandle& datagram : entry->second.datagrams) {
+            sendScheduler.enqueue(serverEndpoint, std::move(datagram), entry->second.trafficClass);
+        }
+        entry = mailbox.erase(entry);
+    }
+}
 
-    sendQueue.enqueue(buffer);
+long ChClientHandler::supersededStates() {
+    return superseded;
 }
 
 std::shared_ptr<google::protobuf::Message> ChClientHandler::popSimMessage() {
@@ -223,131 +695,456 @@ std::shared_ptr<ChronoMessages::DSRCMessage> ChClientHandler::popDSRCMessage() {
     return DSRCUpdateQueue.dequeue();
 }
 
-ChServerHandler::ChServerHandler(World& world, ChSafeQueue<std::function<void()>>& worldQueue, unsigned short portNumber) : ChNetworkHandler(),
-    acceptor([&, this] {
-        // This acceptor code is executed on another thread once the constructor has finished
-        // Mutex locks and waits for socket to open
-        std::unique_lock<std::mutex> lock(socketMutex);
-        initVar.wait(lock, [&]{ return socket.is_open(); });
-        connectionCount = 0;
-
-        boost::asio::ip::tcp::acceptor acceptor(socket.get_io_service(), boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 8082));
-        acceptor.non_blocking(true);
-
-        // Mutex unlocks
-        lock.unlock();
-
-        // Listen for new connections, accepting them over tcp
-        while (socket.is_open() && !shutdown) {
-            boost::asio::ip::tcp::socket tcpSocket(socket.get_io_service());
-            boost::system::error_code acceptError;
-            acceptor.accept(tcpSocket, acceptError);
-            // TODO: Do something with this accept error thing
-            if (acceptError != boost::asio::error::would_block){
-                uint8_t requestMessage;
-                tcpSocket.receive(boost::asio::buffer(&requestMessage, sizeof(uint8_t)));
-                if (requestMessage == CONNECTION_REQUEST) {
-                    uint8_t acceptMessage = CONNECTION_ACCEPT;
-                    tcpSocket.send(boost::asio::buffer(&acceptMessage, sizeof(uint8_t)));
-                    tcpSocket.send(boost::asio::buffer((uint32_t *)(&connectionCount), sizeof(uint32_t)));
-                    worldQueue.enqueue([&world, c=connectionCount] { world.registerConnectionNumber(c); });
-                    connectionCount++;
-                } else {
-                    uint8_t declineMessage = CONNECTION_DECLINE;
-                    tcpSocket.send(boost::asio::buffer(&declineMessage, sizeof(uint8_t)));
-                }
-            }
-            tcpSocket.close();
-        }
-        acceptor.close();
-    } ) {
+bool ChClientHandler::disconnect(unsigned int timeout) {
+    ChronoMessages::ControlMessage message;
+    message.set_connectionnumber(m_connectionNumber);
+    message.set_idnumber(-1);
+    message.set_action(ChronoMessages::ControlMessage::DISCONNECT);
+    pushMessage(message);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (reliable.stats(serverEndpoint).outstanding > 0) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Giving up on the server also leaves nothing outstanding
+    return !serverLost;
+}
+
+void ChClientHandler::queueDatagram(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram) {
+    sendScheduler.enqueue(endpoint, std::move(datagram), TRAFFIC_CONTROL);
+}
+
+ChServerHandler::ChServerHandler(World& world, ChRingQueue<std::function<void()>>& worldQueue, unsigned short portNumber,
+                                 unsigned int ioThreads, unsigned int listenerShards)
+    : ChNetworkHandler(), world(world), worldQueue(worldQueue) {
+    this->ioThreads = ioThreads;
+    this->listenerShards = ioThreads == THREADED_SERVER ? std::max(listenerShards, 1u) : 1;
+    connectionCount = 0;
+    receiveDrops = 0;
+    malformedDatagrams = 0;
+    unconnectedDatagrams = 0;
+    flushScheduled = false;
+    sending = false;
+    retransmitArmed = false;
+    paceArmed = false;
     // Constructor beginning
     // Lock mutex
     std::unique_lock<std::mutex> lock(socketMutex);
     socket.open(boost::asio::ip::udp::v4());
+#ifdef __linux__
+    if (this->listenerShards > 1) socket.set_option(reuse_port(true));
+#else
+    this->listenerShards = 1;
+#endif
     socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), portNumber));
+    socket.set_option(boost::asio::socket_base::receive_buffer_size(RECEIVE_BUFFER_SIZE));
     socket.non_blocking(true);
+#ifdef __linux__
+    // Every shard binds whatever port the first socket ended up with
+    for (unsigned int k = 1; k < this->listenerShards; k++) {
+        shardSockets.emplace_back(new boost::asio::ip::udp::socket(socket.get_io_service()));
+        shardSockets.back()->open(boost::asio::ip::udp::v4());
+        shardSockets.back()->set_option(reuse_port(true));
+        shardSockets.back()->bind(socket.local_endpoint());
+        shardSockets.back()->set_option(boost::asio::socket_base::receive_buffer_size(RECEIVE_BUFFER_SIZE));
+        shardSockets.back()->non_blocking(true);
+    }
+#endif
     lock.unlock();
-    initVar.notify_one();
+    initVar.notify_all();
+
+    if (ioThreads != THREADED_SERVER) {
+        // The work object keeps the pool threads running while nothing is outstanding
+        boost::asio::io_service& ioService = socket.get_io_service();
+        ioWork.reset(new boost::asio::io_service::work(ioService));
+        socketStrand.reset(new boost::asio::io_service::strand(ioService));
+        retransmitTimer.reset(new boost::asio::steady_timer(ioService));
+        paceTimer.reset(new boost::asio::steady_timer(ioService));
+        for (unsigned int i = 0; i < ioThreads; i++) {
+            ioPool.emplace_back([&ioService] { ioService.run(); });
+        }
+    }
 }
 
 ChServerHandler::~ChServerHandler() {
-    socket.close();
-    acceptor.join();
-    while (!sendQueue.empty());
+    if (ioThreads == THREADED_SERVER) {
+        // Let queued packets go out before the socket closes
+        while (!sendScheduler.empty() && sender != nullptr) std::this_thread::yield();
+        socket.close();
+    } else {
+        // Let queued packets go out before the pool stops
+        while (!sendScheduler.empty() && sending) std::this_thread::yield();
+        shutdown = true;
+        socket.get_io_service().stop();
+        for (auto& thread : ioPool) thread.join();
+    }
     shutdown = true;
-    sendQueue.dumpThreads();
+    sendScheduler.dumpThreads();
+    receiveQueue.dumpThreads();
+    for (auto& shard : shardListeners) shard.join();
+    for (auto& shardSocket : shardSockets) shardSocket->close();
     socket.close();
 }
 
-void ChServerHandler::beginListen() {
-    listener = new std::thread([&, this] {
-        // Constantly receives until shutdown
-        while (socket.is_open() && !shutdown) {
-            auto recpair = receiveMessage();
-            receiveQueue.enqueue(recpair);
+void ChServerHandler::listenOnShard(boost::asio::ip::udp::socket& from) {
+    waitForSocket();
+    try {
+        ChReceiveBatch scratch;
+        std::vector<DatagramPair> batch;
+        // Constantly receives until shutdown, parsing here so parsing scales with the shards too
+        while (from.is_open() && !shutdown) {
+            batch.clear();
+            receiveMessages(from, scratch, batch);
+            // Everything in the batch is parsed onto one arena
+            auto arena = arenas.acquire();
+            for (auto& recPair : batch) {
+                queueMessage(recPair, arena);
+            }
         }
-    });
+    } catch (PredicateException& ex) {
+    }
+}
+
+void ChServerHandler::answerConnection(DatagramPair& recPair) {
+    boost::asio::ip::udp::endpoint& endpoint = recPair.first;
+    uint8_t messageType;
+    uint64_t value;
+    uint32_t dictionary;
+    if (!readHandshake(recPair.second.data(), recPair.second.size(), messageType, value, dictionary)) return;
+    // Replies are never larger than the request, so a forged source gains nothing
+    ChPacketHandle reply = packets.acquire(HANDSHAKE_DATAGRAM_SIZE);
+    reply.resize(HANDSHAKE_DATAGRAM_SIZE);
+    if (messageType != CONNECTION_REQUEST) {
+        writeHandshake(reply.data(), CONNECTION_DECLINE, 0);
+    } else if (!cookies.check(endpoint, value)) {
+        // Nothing is kept for a request until it echoes its cookie
+        writeHandshake(reply.data(), CONNECTION_CHALLENGE, cookies.issue(endpoint));
+    } else {
+        int connectionNumber = connectionOf(endpoint);
+        bool compressed = compressor && dictionary == compressor->dictionaryId();
+        // Whatever was kept for a known endpoint belongs to the sender it had
+        // before this handshake, so it starts over, keeping its number
+        if (connectionNumber >= 0) forgetEndpoint(endpoint);
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            auto found = connections.find(endpoint);
+            if (found == connections.end()) {
+                found = connections.emplace(endpoint, connectionNumber >= 0 ? connectionNumber : connectionCount++).first;
+            }
+            connectionNumber = found->second;
+            // Whatever it offers when it reconnects replaces what it agreed to before
+            if (compressed) {
+                compressedEndpoints.insert(endpoint);
+            } else {
+                compressedEndpoints.erase(endpoint);
+            }
+        }
+        // Registering is a no-op while the endpoint is still in the world, and
+        // brings it back if it disconnected and is connecting again
+        World& registrar = world;
+        boost::asio::ip::udp::endpoint registered = endpoint;
+        worldQueue.enqueue([&registrar, registered, connectionNumber]() mutable {
+            registrar.registerConnectionNumber(connectionNumber);
+            registrar.registerEndpoint(registered, connectionNumber);
+        });
+        writeHandshake(reply.data(), CONNECTION_ACCEPT, connectionNumber, compressed ? dictionary : 0);
+    }
+    sendHandshake(endpoint, std::move(reply));
+}
+
+void ChServerHandler::sendHandshake(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& reply) {
+    if (ioThreads == THREADED_SERVER) {
+        // The sender's batch scratch belongs to its own thread, so the listener sends this one itself
+        boost::system::error_code error;
+        socket.send_to(boost::asio::buffer(reply.data(), reply.size()), endpoint, 0, error);
+        return;
+    }
+    auto datagram = std::make_shared<DatagramPair>(endpoint, std::move(reply));
+    socketStrand->post([this, datagram] { asyncSend(*datagram); });
+}
+
+void ChServerHandler::asyncReceive() {
+    if (shutdown) return;
+    if (!receiveSlot.buffer) receiveSlot.buffer = packets.acquire();
+    std::array<boost::asio::mutable_buffer, 2> buffers = {{
+        boost::asio::buffer(receiveSlot.buffer.data(), receiveSlot.buffer.capacity()),
+        boost::asio::buffer(receiveSlot.overflow)
+    }};
+    socket.async_receive_from(buffers, receiveSlot.endpoint, socketStrand->wrap(
+        [this](const boost::system::error_code& error, size_t length) {
+        if (error) {
+            // Errors a later datagram can clear, like an ICMP unreachable for
+            // something sent earlier, re-arm. Anything else, such as a closed
+            // socket, would only fail again straight away.
+            if (error == boost::asio::error::connection_refused || error == boost::asio::error::connection_reset ||
+                error == boost::asio::error::message_size || error == boost::asio::error::interrupted ||
+                error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+                asyncReceive();
+            }
+            return;
+        }
+        ChPacketHandle buffer;
+        if (length <= receiveSlot.buffer.capacity()) {
+            receiveSlot.buffer.resize(length);
+            buffer = std::move(receiveSlot.buffer);
+        } else {
+            // Spilled into the overflow buffer, so stitch it into one large buffer
+            buffer = packets.acquire(length);
+            size_t head = receiveSlot.buffer.capacity();
+            std::memcpy(buffer.data(), receiveSlot.buffer.data(), head);
+            std::memcpy(buffer.data() + head, receiveSlot.overflow.data(), length - head);
+            buffer.resize(length);
+        }
+        auto datagram = std::make_shared<DatagramPair>(receiveSlot.endpoint, std::move(buffer));
+        // Re-arm before parsing, which any pool thread can do off the strand
+        asyncReceive();
+        socket.get_io_service().post([this, datagram] {
+            auto arena = arenas.acquire();
+            try {
+                queueMessage(*datagram, arena);
+            } catch (PredicateException& ex) {
+            }
+        });
+    }));
+}
+
+void ChServerHandler::scheduleFlush() {
+    // Only one flush is queued at a time; it picks up everything pushed before it runs
+    if (!flushScheduled.exchange(true)) {
+        socket.get_io_service().post(socketStrand->wrap([this] { flushSends(); }));
+    }
+}
+
+void ChServerHandler::flushSends() {
+    flushScheduled = false;
+    std::vector<DatagramPair> batch;
+    auto wait = std::chrono::steady_clock::duration::max();
+    do {
+        batch.clear();
+        wait = sendScheduler.collect(batch, batchSize);
+        for (auto& datagram : batch) asyncSend(datagram);
+    } while (!batch.empty());
+    // Comes back for whatever the token buckets held back
+    if (wait != std::chrono::steady_clock::duration::max() && !paceArmed && !shutdown) {
+        paceArmed = true;
+        paceTimer->expires_from_now(wait);
+        paceTimer->async_wait(socketStrand->wrap([this](const boost::system::error_code& error) {
+            paceArmed = false;
+            if (error != boost::asio::error::operation_aborted) flushSends();
+        }));
+    }
+    armRetransmit();
+}
+
+void ChServerHandler::asyncSend(DatagramPair& sendPair) {
+    // The completion handler keeps the buffer alive until the send finishes
+    auto datagram = std::make_shared<DatagramPair>(std::move(sendPair));
+    stampMessage(datagram->first, datagram->second);
+    socket.async_send_to(boost::asio::buffer(datagram->second.data(), datagram->second.size()), datagram->first,
+                         [datagram](const boost::system::error_code&, size_t) {});
+}
+
+void ChServerHandler::armRetransmit() {
+    if (retransmitArmed || !reliable.pending() || shutdown) return;
+    retransmitArmed = true;
+    retransmitTimer->expires_from_now(std::chrono::milliseconds(RELIABLE_TICK));
+    retransmitTimer->async_wait(socketStrand->wrap([this](const boost::system::error_code& error) {
+        retransmitArmed = false;
+        if (error == boost::asio::error::operation_aborted) return;
+        std::vector<DatagramPair> batch;
+        addRetransmits(batch);
+        for (auto& datagram : batch) asyncSend(datagram);
+        armRetransmit();
+    }));
+}
+
+void ChServerHandler::queueDatagram(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram) {
+    sendScheduler.enqueue(endpoint, std::move(datagram), TRAFFIC_CONTROL);
+    if (sending) scheduleFlush();
+}
+
+void ChServerHandler::broadcastSerialized(const std::vector<boost::asio::ip::udp::endpoint>& endpoints,
+                                          const ChSerializedMessage& message) {
+    for (const boost::asio::ip::udp::endpoint& endpoint : endpoints) {
+        bool compressed = !message.compressedDatagrams.empty() && compressesFor(endpoint);
+        if (!compressed && message.datagrams.empty()) {
+            sendScheduler.countOversized(endpoint);
+            continue;
+        }
+        for (const ChPacketHandle& datagram : compressed ? message.compressedDatagrams : message.datagrams) {
+            ChPacketHandle buffer = copyPacket(datagram);
+            // Each endpoint's reliable channel tracks and stamps its own copy
+            if (message.reliable) reliable.track(endpoint, buffer);
+            sendScheduler.enqueue(endpoint, std::move(buffer), message.trafficClass);
+        }
+    }
+    if (sending) scheduleFlush();
+}
+
+void ChServerHandler::setSendRate(const boost::asio::ip::udp::endpoint& endpoint, double bytesPerSecond,
+                                  size_t burst) {
+    sendScheduler.setRate(endpoint, bytesPerSecond, burst);
+    if (sending) scheduleFlush();
+}
+
+void ChServerHandler::setDefaultSendRate(double bytesPerSecond, size_t burst) {
+    sendScheduler.setDefaultRate(bytesPerSecond, burst);
+    if (sending) scheduleFlush();
+}
+
+void ChServerHandler::setCompressor(std::shared_ptr<const ChPacketCompressor> compressor) {
+    this->compressor = compressor;
+}
+
+bool ChServerHandler::compressesFor(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    return compressedEndpoints.count(endpoint) > 0;
+}
+
+void ChServerHandler::beginListen() {
+    if (ioThreads != THREADED_SERVER) {
+        size_t slabSize = packets.slabSize();
+        receiveSlot.overflow.resize(MAX_DATAGRAM_SIZE > slabSize ? MAX_DATAGRAM_SIZE - slabSize : 0);
+        socketStrand->post([this] { asyncReceive(); });
+        return;
+    }
+    // An unsharded server is just one shard on socket
+    for (unsigned int k = 0; k < listenerShards; k++) {
+        boost::asio::ip::udp::socket& from = k == 0 ? socket : *shardSockets[k - 1];
+        shardListeners.emplace_back(&ChServerHandler::listenOnShard, this, std::ref(from));
+    }
 }
 
 void ChServerHandler::beginSend() {
+    if (ioThreads != THREADED_SERVER) {
+        sending = true;
+        scheduleFlush();
+        return;
+    }
     sender = new std::thread([&, this] {
+        waitForSocket();
         try {
+            std::vector<DatagramPair> batch;
             // Constantly sends until shutdown
             while (socket.is_open() && !shutdown) {
-                auto sendPair = sendQueue.dequeue();
-                sendMessage(sendPair.first, *sendPair.second);
+                // Takes a batch in turn from every endpoint with something ready. With nothing
+                // ready it sleeps until something is queued, a token bucket refills, or, while
+                // reliable messages are unacknowledged, the next tick to check their timers.
+                batch.clear();
+                auto wait = sendScheduler.collect(batch, batchSize);
+                addRetransmits(batch);
+                if (!batch.empty()) {
+                    sendMessages(batch);
+                    continue;
+                }
+                std::chrono::steady_clock::duration tick = std::chrono::milliseconds(RELIABLE_TICK);
+                if (reliable.pending()) wait = std::min(wait, tick);
+                sendScheduler.waitFor(wait);
             }
         } catch (PredicateException& ex) {
-            //std::cout << "caught" << std::endl;
         }
     });
 }
 
 std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>> ChServerHandler::popMessage() {
-    auto recPair = receiveQueue.dequeue();
-    boost::asio::streambuf& buffer = *(recPair.second);
-    std::istream stream(&buffer);
-    uint8_t messageType;
-    stream >> messageType;
+    return receiveQueue.dequeue();
+}
+
+void ChServerHandler::queueMessage(DatagramPair& recPair, std::shared_ptr<google::protobuf::Arena>& arena) {
+    boost::asio::ip::udp::endpoint& endpoint = recPair.first;
+    // Handshakes are answered before any per-endpoint state is touched
+    if (recPair.second.size() >= DATAGRAM_HEADER_SIZE &&
+        (readDatagramFlags(recPair.second.data()) & DATAGRAM_FLAG_HANDSHAKE)) {
+        answerConnection(recPair);
+        return;
+    }
+    // Sequence, reliable and fragment state is only ever kept for connected endpoints
+    if (connectionOf(endpoint) < 0) {
+        unconnectedDatagrams++;
+        return;
+    }
+    // Superseded state is dropped before it costs a parse
+    int result = readMessage(recPair, [this, &endpoint, &arena](uint8_t messageType, const char* payload, int payloadSize) {
+        try {
+            pushReceived(parseMessage(endpoint, messageType, payload, payloadSize, arena));
+        } catch (CommunicationException& ex) {
+            malformedDatagrams++;
+        }
+    });
+    // Anyone can send anything to the port, so garbage never reaches popMessage
+    if (result == MESSAGE_MALFORMED) malformedDatagrams++;
+}
+
+void ChServerHandler::pushReceived(MessagePair&& message) {
+    // A listener thread can wait for popMessage to catch up, but the io pool
+    // also runs every send, ack and retransmit, so async mode drops instead
+    if (ioThreads == THREADED_SERVER) {
+        receiveQueue.enqueue(std::move(message));
+    } else if (!receiveQueue.tryEnqueue(std::move(message))) {
+        receiveDrops++;
+    }
+}
+
+int ChServerHandler::connectionOf(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    auto found = connections.find(endpoint);
+    return found == connections.end() ? -1 : found->second;
+}
+
+void ChServerHandler::forgetEndpoint(const boost::asio::ip::udp::endpoint& endpoint) {
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        connections.erase(endpoint);
+        compressedEndpoints.erase(endpoint);
+    }
+    forgetPeer(endpoint);
+}
+
+void ChServerHandler::loseEndpoint(const boost::asio::ip::udp::endpoint& endpoint) {
+    int connectionNumber = connectionOf(endpoint);
+    forgetEndpoint(endpoint);
+    if (connectionNumber < 0) return;
+    auto control = std::make_shared<ChronoMessages::ControlMessage>();
+    control->set_connectionnumber(connectionNumber);
+    control->set_idnumber(-1);
+    control->set_action(ChronoMessages::ControlMessage::DISCONNECT);
+    pushReceived(MessagePair(endpoint, control));
+}
+
+long ChServerHandler::droppedMessages() {
+    return receiveDrops;
+}
+
+long ChServerHandler::malformedMessages() {
+    return malformedDatagrams;
+}
 
+long ChServerHandler::unconnectedMessages() {
+    return unconnectedDatagrams;
+}
+
+MessagePair ChServerHandler::parseMessage(boost::asio::ip::udp::endpoint& endpoint, uint8_t messageType,
+                                          const char* payload, int payloadSize,
+                                          std::shared_ptr<google::protobuf::Arena>& arena) {
     // Parse message according to type
     switch (messageType) {
-        case MESSAGE_PACKET: {
-            auto packet = std::make_shared<ChronoMessages::MessagePacket>();
-            packet->ParseFromIstream(&stream);
-            return std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>>(recPair.first, packet);
-        }
-        case VEHICLE_MESSAGE: {
-            auto message = std::make_shared<ChronoMessages::VehicleMessage>();
-            message->ParseFromIstream(&stream);
-            return std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>>(recPair.first, message);
-        }
-        case DSRC_MESSAGE: {
-            auto message = std::make_shared<ChronoMessages::DSRCMessage>();
-            message->ParseFromIstream(&stream);
-            return std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>>(recPair.first, message);
+        case MessageTraits<ChronoMessages::MessagePacket>::code: {
+            auto packet = parseOnArena<ChronoMessages::MessagePacket>(endpoint, payload, payloadSize, arena);
+            if (packet->has_compactvehicles() && !expandVehicles(*packet)) throw CommunicationException(endpoint);
+            return MessagePair(endpoint, packet);
         }
+        case MessageTraits<ChronoMessages::VehicleMessage>::code:
+            return MessagePair(endpoint, parseOnArena<ChronoMessages::VehicleMessage>(endpoint, payload, payloadSize, arena));
+        case MessageTraits<ChronoMessages::ReducedVehicleMessage>::code:
+            return MessagePair(endpoint, parseOnArena<ChronoMessages::ReducedVehicleMessage>(endpoint, payload, payloadSize, arena));
+        case MessageTraits<ChronoMessages::DSRCMessage>::code:
+            return MessagePair(endpoint, parseOnArena<ChronoMessages::DSRCMessage>(endpoint, payload, payloadSize, arena));
+        case MessageTraits<ChronoMessages::ControlMessage>::code:
+            return MessagePair(endpoint, parseOnArena<ChronoMessages::ControlMessage>(endpoint, payload, payloadSize, arena));
+        case MessageTraits<ChronoMessages::SnapshotAck>::code:
+            return MessagePair(endpoint, parseOnArena<ChronoMessages::SnapshotAck>(endpoint, payload, payloadSize, arena));
         default:
-            throw CommunicationException(recPair.first);
+            throw CommunicationException(endpoint);
             break;
     }
 }
-
-void ChServerHandler::pushMessage(boost::asio::ip::udp::endpoint& endpoint, google::protobuf::Message& message) {
-    // Uses protobuf's introspective functions to determine type and enqueue message
-    uint8_t messageType;
-    std::string type = message.GetDescriptor()->full_name();
-    if (type.compare(VEHICLE_MESSAGE_TYPE) == 0) messageType = VEHICLE_MESSAGE;
-    else if (type.compare(DSRC_MESSAGE_TYPE) == 0) messageType = DSRC_MESSAGE;
-    else if (type.compare(MESSAGE_PACKET_TYPE) == 0) messageType = MESSAGE_PACKET;
-    // TODO: else throw some exception about how this message type isn't supported.
-
-    auto buffer = std::make_shared<boost::asio::streambuf>();
-    std::ostream stream(buffer.get());
-    stream << messageType;
-    message.SerializeToOstream(&stream);
-    stream.flush();
-
-    sendQueue.enqueue(std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>>(endpoint, buffer));
-}
@@ -25,18 +25,113 @@
 
 #include <google/protobuf/message.h>
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
 #include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#endif
 
 #include "MessageCodes.h"
+#include "MessageTraits.h"
 #include "ChronoMessages.pb.h"
-#include "ChSafeQueue.h"
+#include "ChRingQueue.h"
+#include "ChPacketPool.h"
+#include "ChArenaPool.h"
+#include "ChDatagramHeader.h"
+#include "ChFragmentAssembler.h"
+#include "ChReliableChannel.h"
+#include "ChCookieJar.h"
+#include "ChSendScheduler.h"
+#include "ChPacketCompressor.h"
 #include "World.h"
 
 #define REFUSED_CONNECTION 0
 #define UNDETERMINED_CONNECTION 1
 #define FAILED_CONNECTION 2
 
+// Number of datagrams moved per recvmmsg/sendmmsg call unless set otherwise.
+#define DEFAULT_BATCH_SIZE 32
+// Largest payload a single UDP datagram can carry.
+#define MAX_DATAGRAM_SIZE 65507
+// Longest a socket wait blocks before rechecking for shutdown, in milliseconds.
+#define SOCKET_POLL_TIMEOUT 100
+// Connection requests a client sends before giving up, and how long it waits
+// for an answer to each one, in milliseconds.
+#define HANDSHAKE_ATTEMPTS 10
+#define HANDSHAKE_TIMEOUT 100
+// Runs ChServerHandler on its dedicated listener and sender threads.
+#define THREADED_SERVER 0
+// Most message bytes one fragment carries, keeping each fragment in one pooled
+// buffer and one ethernet frame.
+#define FRAGMENT_PAYLOAD_SIZE (PACKET_SLAB_SIZE - DATAGRAM_HEADER_SIZE - FRAGMENT_HEADER_SIZE)
+
+// Socket receive buffer requested so a whole fragmented world packet can
+// queue up; the kernel caps it at net.core.rmem_max.
+#define RECEIVE_BUFFER_SIZE (4 * 1024 * 1024)
+
+// How long ChClientHandler::disconnect waits for the server, in milliseconds.
+#define DISCONNECT_TIMEOUT 1000
+
+// Outcomes of reading a received datagram
+#define MESSAGE_READY 0
+#define MESSAGE_DROPPED 1
+#define MESSAGE_MALFORMED 2
+
+typedef std::pair<boost::asio::ip::udp::endpoint, ChPacketHandle> DatagramPair;
+typedef std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>> MessagePair;
+
+#ifdef __linux__
+// Lets several sockets bind the same port; the kernel spreads datagrams across
+// them by hashing each sender's address, so one client always hits one socket.
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+// Scratch space for one thread's recvmmsg calls.
+struct ChReceiveBatch {
+#ifdef __linux__
+    // Pooled buffers recvmmsg fills directly, one per batch slot
+    std::vector<ChPacketHandle> receiveBuffers;
+    // Catches the tail of any datagram too large for a pooled buffer
+    std::vector<char> overflowSlots;
+    std::vector<sockaddr_storage> receiveAddresses;
+    std::vector<iovec> receiveVectors;
+    std::vector<mmsghdr> receiveHeaders;
+#endif
+};
+
+// A message serialized and split into datagrams once, to be sent to any
+// number of endpoints. Its datagrams are never sent themselves; each endpoint
+// gets copies it can stamp with its own sequence numbers, so one can be kept
+// and sent again for as long as the message is current. No datagrams means
+// it was too large to fragment.
+struct ChSerializedMessage {
+    int trafficClass;
+    bool reliable;
+    std::vector<ChPacketHandle> datagrams;
+    // The same message compressed, for endpoints that agreed to compression.
+    // Empty if it wasn't worth compressing.
+    std::vector<ChPacketHandle> compressedDatagrams;
+};
+
+// Messages a handler compressed before sending them, and their payload bytes
+// before and after.
+struct ChCompressionStats {
+    long messages;
+    long bytesIn;
+    long bytesOut;
+};
+
 class ChNetworkHandler {
 public:
     ChNetworkHandler();
@@ -48,37 +143,228 @@ public:
     // Begins sending messages.
     virtual void beginSend() = 0;
 
+    // Sets the most datagrams the listener and sender move per system call.
+    // A size of 1 uses one receive_from/send_to per datagram. Must be called
+    // before beginListen and beginSend.
+    void setBatchSize(unsigned int size);
+
+    // Pool every packet buffer sent or received by this handler comes from.
+    ChPacketPool& packetPool();
+
+    // Pool of arenas received messages are parsed onto.
+    ChArenaPool& arenaPool();
+
+    // Loss, reordering and staleness counted for datagrams from endpoint.
+    ChSequenceStats sequenceStats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Reliable channel counters for messages to and from endpoint.
+    ChReliableStats reliableStats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Queue depth, drop and send counters for endpoint.
+    ChSendStats sendStats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Sends messages of messageType in trafficClass from now on, instead of
+    // the class their MessageTraits give them.
+    void setTrafficClass(uint8_t messageType, int trafficClass);
+    int trafficClass(uint8_t messageType);
+
+    // Compression counters for messages this handler sent.
+    ChCompressionStats compressionStats();
+
 protected:
+    // Waits up to timeout milliseconds for a socket to become readable.
+    // Returns false on timeout.
+    bool waitReadable(boost::asio::ip::udp::socket& from, int timeout = SOCKET_POLL_TIMEOUT);
+
+    // Blocks until the socket has been opened or the handler is shutting down.
+    // The listener and sender call this once when they start; after that the
+    // send and receive paths share no locks.
+    void waitForSocket();
+
     // Sends message in buffer
-    void sendMessage(boost::asio::ip::udp::endpoint& endpoint, boost::asio::streambuf& message);
+    void sendMessage(boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& message);
+
+    // Writes a datagram header and message into a pooled buffer, leaving room
+    // for a reliable header if flags has DATAGRAM_FLAG_RELIABLE. The sequence
+    // number and timestamp are filled in when the buffer is sent.
+    ChPacketHandle serializeMessage(uint8_t messageType, google::protobuf::Message& message, uint16_t flags = 0);
+
+    // Serializes message with the flags its MessageTraits call for and calls
+    // visit with each datagram to send to endpoint. Reliable messages are
+    // handed to the reliable channel and never fragmented, since they are
+    // retransmitted whole.
+    template<class T, class Visitor> void prepareMessage(const boost::asio::ip::udp::endpoint& endpoint, T& message,
+                                                         Visitor visit);
+
+    // Header flags a message of type T is sent with.
+    template<class T> static uint16_t messageFlags();
+
+    // Compresses a datagram serializeMessage wrote if its payload is at least
+    // COMPRESSION_THRESHOLD bytes and comes out smaller, and returns it as is
+    // otherwise. Never called for reliable messages, which are retransmitted
+    // whole and too small to gain anything.
+    ChPacketHandle compressMessage(const ChPacketHandle& message);
+
+    // Whether messages to endpoint go out compressed, as agreed in the
+    // handshake.
+    virtual bool compressesFor(const boost::asio::ip::udp::endpoint& endpoint) = 0;
+
+    // Copies a serialized datagram into a pooled buffer of its own, for a
+    // second destination to stamp independently.
+    ChPacketHandle copyPacket(const ChPacketHandle& packet);
+
+    // Gives a buffer about to go to endpoint that endpoint's next sequence
+    // number and the current time, and a reliable one the latest
+    // acknowledgements for endpoint. Only ever called from the sending thread.
+    void stampMessage(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& message);
+
+    // Builds an acknowledgement; its fields are filled in when it is sent.
+    ChPacketHandle makeAck();
+
+    // Drops the reliable channel, sequence numbers and queued datagrams kept
+    // for endpoint, so anything sending from there again starts from scratch.
+    // Safe to call from any thread; the sending thread drops its sequence
+    // number for endpoint before it next stamps a datagram.
+    void forgetPeer(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Queues a datagram the handler generates itself, like an acknowledgement.
+    virtual void queueDatagram(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram) = 0;
+
+    // Adds reliable messages whose retransmit timers have run out to a batch
+    // about to be sent, checking at most once per RELIABLE_TICK, and calls
+    // loseEndpoint for each endpoint the reliable channel gave up on. Only
+    // ever called from the sending thread.
+    void addRetransmits(std::vector<DatagramPair>& batch);
+
+    // Called on the sending thread once endpoint has left a reliable message
+    // unacknowledged RELIABLE_MAX_TRANSMISSIONS times. The reliable channel
+    // has already dropped it.
+    virtual void loseEndpoint(const boost::asio::ip::udp::endpoint& endpoint) = 0;
+
+    // Calls visit with the serialized message, or with each of its fragments
+    // if it doesn't fit in one pooled buffer. Returns false without calling
+    // visit if it is too large for any receiver to put back together.
+    template<class Visitor> bool forEachFragment(ChPacketHandle& message, Visitor visit);
+
+    // Copies one piece of a serialized message into a datagram of its own.
+    ChPacketHandle makeFragment(ChPacketHandle& message, uint16_t index, uint16_t count, uint32_t messageId);
+
+    // Reads the header of a received datagram, records its sequence number and
+    // calls deliver with each message it completes: none for stale state,
+    // acknowledgements and pieces of unfinished messages, and several when a
+    // reliable message fills a gap. A fragment that completes its message
+    // swaps the reassembled message into recPair. Returns MESSAGE_MALFORMED if
+    // the datagram can't be read, MESSAGE_DROPPED if it is stale, and
+    // MESSAGE_READY otherwise.
+    int readMessage(DatagramPair& recPair,
+                    const std::function<void(uint8_t messageType, const char* payload, int payloadSize)>& deliver);
+
+    // Parses a message from endpoint straight out of a receive buffer onto
+    // arena, throwing CommunicationException if it can't be parsed. The
+    // returned pointer shares ownership of the arena.
+    template<class T> static std::shared_ptr<T> parseOnArena(const boost::asio::ip::udp::endpoint& endpoint,
+                                                             const char* payload, int payloadSize,
+                                                             std::shared_ptr<google::protobuf::Arena>& arena);
 
     // Returns buffer with message waiting to be commited to the input sequence
-    std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>> receiveMessage();
+    DatagramPair receiveMessage();
+    DatagramPair receiveMessage(boost::asio::ip::udp::socket& from);
+
+    // Sends every message in the batch, up to batchSize per system call.
+    void sendMessages(std::vector<DatagramPair>& messages);
+
+    // Blocks until at least one message is waiting, then appends up to
+    // batchSize messages to the batch. Returns the number received.
+    size_t receiveMessages(std::vector<DatagramPair>& messages);
+
+    // Same as above for another socket, with the caller's own scratch space so
+    // several threads can receive at once.
+    size_t receiveMessages(boost::asio::ip::udp::socket& from, ChReceiveBatch& scratch,
+                           std::vector<DatagramPair>& messages);
 
     boost::asio::ip::udp::socket socket;
+    // Only guard opening the socket, never individual sends or receives
     std::mutex socketMutex;
     std::condition_variable initVar;
     std::thread* listener;
     std::thread* sender;
-    bool shutdown;
+    std::atomic<bool> shutdown;
+    unsigned int batchSize;
+    ChPacketPool packets;
+    ChArenaPool arenas;
+    ChSequenceTracker receiveSequences;
+    ChFragmentAssembler fragments;
+    std::atomic<uint32_t> nextMessageId;
+    ChReliableChannel reliable;
+    // Outgoing datagrams, queued per endpoint and traffic class
+    ChSendScheduler sendScheduler;
+    // Null unless compression is on offer; set before listening or sending
+    std::shared_ptr<const ChPacketCompressor> compressor;
+
+private:
+    // The part of readMessage that handles DATAGRAM_FLAG_RELIABLE datagrams.
+    int readReliable(DatagramPair& recPair, const ChDatagramHeader& header,
+                     const std::function<void(uint8_t messageType, const char* payload, int payloadSize)>& deliver);
+
+    // Calls deliver with a whole message, decompressing it first if flags
+    // says it is compressed. Returns MESSAGE_MALFORMED if it won't decompress.
+    int deliverPayload(uint8_t messageType, uint16_t flags, const char* payload, int payloadSize,
+                       const std::function<void(uint8_t messageType, const char* payload, int payloadSize)>& deliver);
+
+    // Waits up to SOCKET_POLL_TIMEOUT for the socket to become writable.
+    // Returns false on timeout.
+    bool waitWritable();
+
+    ChReceiveBatch receiveScratch;
+    // Traffic class of each message code
+    std::atomic<int> trafficClasses[256];
+    std::atomic<long> compressedMessages;
+    std::atomic<long> compressedBytesIn;
+    std::atomic<long> compressedBytesOut;
+    // When the sending thread last looked for retransmits
+    std::chrono::steady_clock::time_point retransmitCheck;
+    // Next sequence number for each destination
+    std::map<boost::asio::ip::udp::endpoint, uint32_t> sendSequences;
+    // Endpoints forgetPeer dropped whose sequence numbers the sending thread
+    // still has to drop
+    std::mutex forgottenMutex;
+    std::vector<boost::asio::ip::udp::endpoint> forgottenPeers;
+    std::atomic<bool> peersForgotten;
+#ifdef __linux__
+    std::vector<iovec> sendVectors;
+    std::vector<mmsghdr> sendHeaders;
+#endif
 };
 
 class ChClientHandler : public ChNetworkHandler {
 public:
-    ChClientHandler(std::string hostname, std::string port);
+    // Connects to the server's udp port, throwing ConnectionException if the
+    // server declines or never answers. With a compressor, offers to exchange
+    // compressed messages; they are if the server holds the same dictionary.
+    ChClientHandler(std::string hostname, std::string port,
+                    std::shared_ptr<const ChPacketCompressor> compressor = nullptr);
     ~ChClientHandler();
 
+    // False once the server has stopped acknowledging reliable messages.
     bool isConnected();
     int connectionNumber();
 
+    // Whether the server agreed to compression.
+    bool compressionAgreed();
+
     // Begins receiving messages.
     void beginListen();
 
     // Begins sending messages.
     void beginSend();
 
-    // Pushes message to be sent.
-    void pushMessage(google::protobuf::Message& message);
+    // Pushes message to be sent. T must have a MessageTraits specialization.
+    // A keyed state waits in the mailbox, replacing any older state with the
+    // same key that hasn't gone out yet.
+    template<class T> void pushMessage(T& message);
+
+    // Number of keyed states replaced in the mailbox before they were sent.
+    long supersededStates();
 
     // Returns message related to physical simulation.
     std::shared_ptr<google::protobuf::Message> popSimMessage();
@@ -89,17 +375,72 @@ public:
     // Returns simulated DSRC message.
     std::shared_ptr<ChronoMessages::DSRCMessage> popDSRCMessage();
 
+    // Tells the server this client is leaving and waits up to timeout
+    // milliseconds for it to acknowledge. The handler must be sending and
+    // listening. Returns false if the server never acknowledged.
+    bool disconnect(unsigned int timeout = DISCONNECT_TIMEOUT);
+
+protected:
+    void queueDatagram(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram);
+    bool compressesFor(const boost::asio::ip::udp::endpoint& endpoint);
+    void loseEndpoint(const boost::asio::ip::udp::endpoint& endpoint);
+
 private:
-    ChSafeQueue<std::shared_ptr<boost::asio::streambuf>> sendQueue;
-    ChSafeQueue<std::shared_ptr<google::protobuf::Message>> simUpdateQueue;
-    ChSafeQueue<std::shared_ptr<ChronoMessages::DSRCMessage>> DSRCUpdateQueue;
+    // Runs the connection handshake on the socket before the listener and
+    // sender start. Returns CONNECTION_ACCEPT with the connection number set,
+    // CONNECTION_DECLINE, or NULL_MESSAGE if the server never answered.
+    int handshake();
+
+    // Parses one datagram from the server onto the batch's arena and queues
+    // its contents.
+    void processMessage(DatagramPair& recPair, std::shared_ptr<google::protobuf::Arena>& arena);
+
+    // Parses one message from the server onto arena and queues its contents,
+    // throwing CommunicationException if it can't be parsed.
+    void deliverMessage(uint8_t messageType, const char* payload, int payloadSize,
+                        std::shared_ptr<google::protobuf::Arena>& arena);
+
+    // Queues message for the sender, or for a keyed state, leaves it in the
+    // mailbox.
+    template<class T> void postMessage(T& message, std::false_type);
+    template<class T> void postMessage(T& message, std::true_type);
+
+    // Moves mailbox states into the scheduler for each class with nothing
+    // left queued, so whatever is sent next is the newest state.
+    void takeMailbox();
+
+    // The datagrams of one serialized state, and the class they go in
+    struct MailboxEntry {
+        std::vector<ChPacketHandle> datagrams;
+        int trafficClass;
+    };
+
+    ChRingQueue<std::shared_ptr<google::protobuf::Message>> simUpdateQueue;
+    ChRingQueue<std::shared_ptr<ChronoMessages::DSRCMessage>> DSRCUpdateQueue;
     boost::asio::ip::udp::endpoint serverEndpoint;
     int m_connectionNumber;
+    bool compressing;
+    std::atomic<bool> serverLost;
+    // Newest unsent state for each key
+    std::mutex mailboxMutex;
+    std::map<std::pair<int, int>, MailboxEntry> mailbox;
+    std::atomic<long> superseded;
 };
 
 class ChServerHandler : public ChNetworkHandler {
 public:
-    ChServerHandler(World& world, ChSafeQueue<std::function<void()>>& worldQueue, unsigned short portNumber);
+    // With ioThreads set to THREADED_SERVER the handler runs its own listener
+    // and sender threads. Any other value runs it asynchronously on that many
+    // threads sharing the handler's io_service. Clients connect over the same
+    // udp port, once the handler is listening and sending.
+    //
+    // In threaded mode, listenerShards above 1 binds that many SO_REUSEPORT
+    // sockets to the port, each with its own receive and parse thread. The
+    // kernel keeps each client on one socket, so a client's messages still
+    // pop in the order they arrived. Sharding is Linux only and ignored in
+    // async mode.
+    ChServerHandler(World& world, ChRingQueue<std::function<void()>>& worldQueue, unsigned short portNumber,
+                    unsigned int ioThreads = THREADED_SERVER, unsigned int listenerShards = 1);
     ~ChServerHandler();
 
     // Begins receiving messages.
@@ -108,18 +449,257 @@ public:
     // Begins sending messages.
     void beginSend();
 
-    // Returns message recieved from the network.
+    // Returns message recieved from the network. Datagrams that can't be read
+    // or parsed never get this far; they are counted in malformedMessages.
     std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>> popMessage();
 
-    // Pushes message to queue to be sent.
-    void pushMessage(boost::asio::ip::udp::endpoint& endpoint, google::protobuf::Message& message);
+    // Pushes message to queue to be sent. T must have a MessageTraits
+    // specialization.
+    template<class T> void pushMessage(boost::asio::ip::udp::endpoint& endpoint, T& message);
+
+    // Pushes message to every endpoint in endpoints, serializing it only once.
+    template<class T> void broadcastMessage(const std::vector<boost::asio::ip::udp::endpoint>& endpoints, T& message);
+
+    // Serializes message for broadcastSerialized. T must have a MessageTraits
+    // specialization.
+    template<class T> std::shared_ptr<const ChSerializedMessage> serializeBroadcast(T& message);
+
+    // Pushes a copy of every datagram in message to each endpoint in
+    // endpoints. message is left as it was, to broadcast again.
+    void broadcastSerialized(const std::vector<boost::asio::ip::udp::endpoint>& endpoints,
+                             const ChSerializedMessage& message);
+
+    // Caps the bandwidth sent to endpoint at bytesPerSecond, pacing it with a
+    // token bucket burst bytes deep. 0 leaves endpoint unpaced, whatever the
+    // default.
+    void setSendRate(const boost::asio::ip::udp::endpoint& endpoint, double bytesPerSecond,
+                     size_t burst = SEND_BURST_SIZE);
+
+    // Cap for every endpoint without one of its own. Defaults to
+    // SEND_DEFAULT_RATE.
+    void setDefaultSendRate(double bytesPerSecond, size_t burst = SEND_BURST_SIZE);
+
+    // Connection number endpoint was given when it completed the handshake,
+    // or -1 if it never did. Safe to call from any thread, unlike the world.
+    int connectionOf(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Forgets everything kept for endpoint: its connection number, whether it
+    // compresses, its reliable channel, its sequence numbers and anything
+    // still queued for it. Called once it disconnects; anything it sends
+    // afterwards is dropped until it completes a new handshake.
+    void forgetEndpoint(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Messages received in async mode and dropped because popMessage had
+    // fallen a full receive queue behind.
+    long droppedMessages();
+
+    // Datagrams dropped because their header or message couldn't be read.
+    long malformedMessages();
+
+    // Datagrams other than handshakes dropped because their endpoint hadn't
+    // completed one.
+    long unconnectedMessages();
+
+    // Offers compression with compressor to every client that connects
+    // offering the same dictionary. Must be called before beginListen.
+    void setCompressor(std::shared_ptr<const ChPacketCompressor> compressor);
+
+protected:
+    void queueDatagram(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram);
+    bool compressesFor(const boost::asio::ip::udp::endpoint& endpoint);
+    // Forgets endpoint and hands popMessage a DISCONNECT from it, so the
+    // world drops it as though it had left.
+    void loseEndpoint(const boost::asio::ip::udp::endpoint& endpoint);
+
 private:
-    ChSafeQueue<std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>>> receiveQueue;
-    ChSafeQueue<std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<boost::asio::streambuf>>> sendQueue;
-    std::thread acceptor;
-    int connectionCount;
+    // The outstanding async receive and the buffers it lands in.
+    struct ReceiveSlot {
+        ChPacketHandle buffer;
+        std::vector<char> overflow;
+        boost::asio::ip::udp::endpoint endpoint;
+    };
+
+    // Receives and parses everything arriving on one listener socket.
+    void listenOnShard(boost::asio::ip::udp::socket& from);
+
+    // Turns a received message into a protobuf message on arena, throwing
+    // CommunicationException if it can't be parsed.
+    MessagePair parseMessage(boost::asio::ip::udp::endpoint& endpoint, uint8_t messageType, const char* payload,
+                             int payloadSize, std::shared_ptr<google::protobuf::Arena>& arena);
+
+    // Parses and queues one received datagram. Ones from endpoints that
+    // never connected are counted in unconnectedDatagrams and dropped before
+    // anything is kept for them, ones that fail to parse are counted in
+    // malformedDatagrams and dropped, and stale ones are dropped.
+    void queueMessage(DatagramPair& recPair, std::shared_ptr<google::protobuf::Arena>& arena);
+
+    // Hands a parsed message to popMessage. Blocks while the receive queue is
+    // full in threaded mode; async mode counts it in receiveDrops instead.
+    void pushReceived(MessagePair&& message);
+
+    // Answers a handshake datagram: a challenge for a request without a
+    // valid cookie, the connection number for one with, and a decline for
+    // anything else. A new connection is registered with the world along with
+    // the endpoint it came from, and compresses if it offered to with the
+    // server's dictionary.
+    void answerConnection(DatagramPair& recPair);
+
+    // Sends a handshake reply straight away instead of through the send
+    // scheduler, which keeps nothing for endpoints that haven't connected.
+    // A reply lost to a full send buffer is asked for again.
+    void sendHandshake(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& reply);
+
+    // Async mode: keeps one receive outstanding on socketStrand, re-arming it
+    // from its completion handler, and posts each datagram to the pool to be
+    // parsed off the strand.
+    void asyncReceive();
+
+    // Async mode: drains the send scheduler into async_send_to on
+    // socketStrand, and arms paceTimer to come back for whatever its token
+    // buckets held back.
+    void scheduleFlush();
+    void flushSends();
+
+    // Async mode: stamps and sends one datagram. Runs on socketStrand.
+    void asyncSend(DatagramPair& datagram);
+
+    // Async mode: while reliable messages are unacknowledged, keeps a timer
+    // on socketStrand that sends them again when they are due.
+    void armRetransmit();
+
+    World& world;
+    ChRingQueue<std::function<void()>>& worldQueue;
+    // Messages the listeners have already parsed
+    ChRingQueue<MessagePair> receiveQueue;
+    std::atomic<long> receiveDrops;
+    std::atomic<long> malformedDatagrams;
+    std::atomic<long> unconnectedDatagrams;
+    std::atomic<int> connectionCount;
+    ChCookieJar cookies;
+    // Endpoints that completed the handshake, so a repeated request whose
+    // accept was lost gets the same number again
+    std::mutex connectionMutex;
+    std::map<boost::asio::ip::udp::endpoint, int> connections;
+    // Connected endpoints that agreed to compression, also under connectionMutex
+    std::set<boost::asio::ip::udp::endpoint> compressedEndpoints;
+
+    unsigned int ioThreads;
+    std::vector<std::thread> ioPool;
+    std::unique_ptr<boost::asio::io_service::work> ioWork;
+    // Async mode starts every receive and send on socket through this strand,
+    // since asio sockets aren't safe to use from several threads at once
+    std::unique_ptr<boost::asio::io_service::strand> socketStrand;
+    // Only touched on socketStrand
+    ReceiveSlot receiveSlot;
+    std::atomic<bool> flushScheduled;
+    std::atomic<bool> sending;
+    std::unique_ptr<boost::asio::steady_timer> retransmitTimer;
+    std::unique_ptr<boost::asio::steady_timer> paceTimer;
+    // Only touched on socketStrand
+    bool retransmitArmed;
+    bool paceArmed;
+
+    // Shard 0 is socket; these are shards 1 through listenerShards - 1
+    unsigned int listenerShards;
+    std::vector<std::unique_ptr<boost::asio::ip::udp::socket>> shardSockets;
+    std::vector<std::thread> shardListeners;
 };
 
+template<class Visitor> bool ChNetworkHandler::forEachFragment(ChPacketHandle& message, Visitor visit) {
+    if (message.size() <= PACKET_SLAB_SIZE) {
+        visit(message);
+        return true;
+    }
+    size_t payloadSize = message.size() - DATAGRAM_HEADER_SIZE;
+    size_t count = (payloadSize + FRAGMENT_PAYLOAD_SIZE - 1) / FRAGMENT_PAYLOAD_SIZE;
+    if (count > FRAGMENT_MAX_COUNT || payloadSize > FRAGMENT_MAX_MESSAGE_SIZE) return false;
+    uint32_t messageId = nextMessageId++;
+    for (size_t i = 0; i < count; i++) {
+        ChPacketHandle fragment = makeFragment(message, i, count, messageId);
+        visit(fragment);
+    }
+    return true;
+}
+
+template<class T> uint16_t ChNetworkHandler::messageFlags() {
+    return (MessageTraits<T>::latestState ? DATAGRAM_FLAG_LATEST : 0) |
+           (MessageTraits<T>::reliable ? DATAGRAM_FLAG_RELIABLE : 0);
+}
+
+template<class T, class Visitor> void ChNetworkHandler::prepareMessage(const boost::asio::ip::udp::endpoint& endpoint,
+                                                                      T& message, Visitor visit) {
+    ChPacketHandle buffer = serializeMessage(MessageTraits<T>::code, message, messageFlags<T>());
+    if (MessageTraits<T>::reliable) {
+        reliable.track(endpoint, buffer);
+        visit(buffer);
+        return;
+    }
+    if (compressor && compressesFor(endpoint)) buffer = compressMessage(buffer);
+    if (!forEachFragment(buffer, visit)) sendScheduler.countOversized(endpoint);
+}
+
+template<class T> void ChClientHandler::pushMessage(T& message) {
+    postMessage(message, std::integral_constant<bool, MessageTraits<T>::keyedState>());
+}
+
+template<class T> void ChClientHandler::postMessage(T& message, std::false_type) {
+    int messageClass = trafficClass(MessageTraits<T>::code);
+    prepareMessage(serverEndpoint, message, [this, messageClass](ChPacketHandle& datagram) {
+        sendScheduler.enqueue(serverEndpoint, std::move(datagram), messageClass);
+    });
+}
+
+template<class T> void ChClientHandler::postMessage(T& message, std::true_type) {
+    MailboxEntry entry;
+    entry.trafficClass = trafficClass(MessageTraits<T>::code);
+    prepareMessage(serverEndpoint, message, [&entry](ChPacketHandle& datagram) {
+        entry.datagrams.push_back(std::move(datagram));
+    });
+    {
+        std::lock_guard<std::mutex> lock(mailboxMutex);
+        MailboxEntry& slot = mailbox[MessageTraits<T>::stateKey(message)];
+        if (!slot.datagrams.empty()) superseded++;
+        slot = std::move(entry);
+    }
+    sendScheduler.wake();
+}
+
+template<class T> void ChServerHandler::pushMessage(boost::asio::ip::udp::endpoint& endpoint, T& message) {
+    int messageClass = trafficClass(MessageTraits<T>::code);
+    prepareMessage(endpoint, message, [this, &endpoint, messageClass](ChPacketHandle& datagram) {
+        sendScheduler.enqueue(endpoint, std::move(datagram), messageClass);
+    });
+    if (sending) scheduleFlush();
+}
+
+template<class T> void ChServerHandler::broadcastMessage(const std::vector<boost::asio::ip::udp::endpoint>& endpoints,
+                                                         T& message) {
+    if (endpoints.empty()) return;
+    broadcastSerialized(endpoints, *serializeBroadcast(message));
+}
+
+template<class T> std::shared_ptr<const ChSerializedMessage> ChServerHandler::serializeBroadcast(T& message) {
+    auto serialized = std::make_shared<ChSerializedMessage>();
+    serialized->trafficClass = trafficClass(MessageTraits<T>::code);
+    serialized->reliable = MessageTraits<T>::reliable;
+    ChPacketHandle buffer = serializeMessage(MessageTraits<T>::code, message, messageFlags<T>());
+    if (MessageTraits<T>::reliable) {
+        // Retransmitted whole, so never fragmented
+        serialized->datagrams.push_back(buffer);
+    } else {
+        // Left empty if it is too large to fragment, which broadcastSerialized counts against every endpoint
+        forEachFragment(buffer, [&serialized](ChPacketHandle& datagram) { serialized->datagrams.push_back(datagram); });
+        // Compressed once too, whether or not anyone it goes to takes it
+        ChPacketHandle compressed = compressor ? compressMessage(buffer) : buffer;
+        if (compressed.data() != buffer.data()) {
+            forEachFragment(compressed, [&serialized](ChPacketHandle& datagram) {
+                serialized->compressedDatagrams.push_back(datagram);
+            });
+        }
+    }
+    return serialized;
+}
+
 class ConnectionException : public std::exception {
 public:
     ConnectionException(int type) : std::exception() {
@@ -163,4 +743,14 @@ private:
     boost::asio::ip::udp::endpoint m_endpoint;
 };
 
+// Defined after CommunicationException, which it throws
+template<class T> std::shared_ptr<T> ChNetworkHandler::parseOnArena(const boost::asio::ip::udp::endpoint& endpoint,
+                                                                  const char* payload, int payloadSize,
+                                                                  std::shared_ptr<google::protobuf::Arena>& arena) {
+    T* message = google::protobuf::Arena::CreateMessage<T>(arena.get());
+    // What failed to parse stays on the arena until it is reset
+    if (!message->ParseFromArray(payload, payloadSize)) throw CommunicationException(endpoint);
+    return std::shared_ptr<T>(arena, message);
+}
+
 #endif // CHNETWORKHANDLER_H
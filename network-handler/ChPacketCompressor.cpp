@@ -0,0 +1,224 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChPacketCompressor and dictionary training.
+//
+// =============================================================================
+
+#include "ChPacketCompressor.h"
+#include "ChCompressionDictionary.h"
+
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+// Raw deflate with the largest window, so the whole dictionary stays in reach
+#define DEFLATE_WINDOW_BITS -15
+#define DEFLATE_MEMORY_LEVEL 8
+
+// Training scores stretches of TRAINING_SEGMENT_SIZE bytes, starting every
+// TRAINING_STRIDE bytes, by the repeated TRAINING_GRAM_SIZE byte sequences
+// they hold.
+#define TRAINING_GRAM_SIZE 8
+#define TRAINING_SEGMENT_SIZE 32
+#define TRAINING_STRIDE 4
+
+// One deflate and one inflate stream per thread. Setting up a stream costs
+// far more than compressing a datagram, so they are reset between payloads
+// instead, and any compressor can use them since the dictionary is set again
+// every time.
+struct zlibStreams {
+    z_stream deflater;
+    z_stream inflater;
+    // Level deflater was last set to, -1 until it is initialized
+    int deflateLevel;
+    bool inflateReady;
+
+    zlibStreams() : deflateLevel(-1), inflateReady(false) {
+        std::memset(&deflater, 0, sizeof(deflater));
+        std::memset(&inflater, 0, sizeof(inflater));
+    }
+
+    ~zlibStreams() {
+        if (deflateLevel >= 0) deflateEnd(&deflater);
+        if (inflateReady) inflateEnd(&inflater);
+    }
+};
+
+static zlibStreams& threadStreams() {
+    static thread_local zlibStreams streams;
+    return streams;
+}
+
+ChPacketCompressor::ChPacketCompressor(const std::string& dictionary, int level)
+    : dictionary(dictionary), level(level) {
+    // FNV-1a
+    id = 2166136261u;
+    for (char byte : dictionary) {
+        id ^= (uint8_t)byte;
+        id *= 16777619u;
+    }
+    if (id == 0) id = 1;
+}
+
+uint32_t ChPacketCompressor::dictionaryId() const {
+    return id;
+}
+
+size_t ChPacketCompressor::compress(const char* data, size_t size, char* out, size_t capacity) const {
+    if (capacity <= COMPRESSION_PREFIX_SIZE || size > UINT32_MAX) return 0;
+    zlibStreams& streams = threadStreams();
+    z_stream& stream = streams.deflater;
+    if (streams.deflateLevel < 0) {
+        if (deflateInit2(&stream, level, Z_DEFLATED, DEFLATE_WINDOW_BITS, DEFLATE_MEMORY_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return 0;
+        }
+        streams.deflateLevel = level;
+    } else {
+        deflateReset(&stream);
+        // Right after a reset this only changes the level, it flushes nothing
+        if (streams.deflateLevel != level && deflateParams(&stream, level, Z_DEFAULT_STRATEGY) == Z_OK) {
+            streams.deflateLevel = level;
+        }
+    }
+    if (!dictionary.empty()) {
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()), dictionary.size());
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef*>(out + COMPRESSION_PREFIX_SIZE);
+    stream.avail_out = capacity - COMPRESSION_PREFIX_SIZE;
+    // Anything short of the end means it ran out of room
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) return 0;
+    for (int i = 0; i < COMPRESSION_PREFIX_SIZE; i++) out[i] = (char)(size >> (8 * i));
+    return COMPRESSION_PREFIX_SIZE + stream.total_out;
+}
+
+size_t ChPacketCompressor::decompressedSize(const char* data, size_t size) {
+    if (size < COMPRESSION_PREFIX_SIZE) return 0;
+    size_t expanded = 0;
+    for (int i = 0; i < COMPRESSION_PREFIX_SIZE; i++) expanded |= (size_t)(uint8_t)data[i] << (8 * i);
+    return expanded;
+}
+
+bool ChPacketCompressor::decompress(const char* data, size_t size, char* out) const {
+    size_t expected = decompressedSize(data, size);
+    if (expected == 0) return false;
+    zlibStreams& streams = threadStreams();
+    z_stream& stream = streams.inflater;
+    if (!streams.inflateReady) {
+        if (inflateInit2(&stream, DEFLATE_WINDOW_BITS) != Z_OK) return false;
+        streams.inflateReady = true;
+    } else {
+        inflateReset(&stream);
+    }
+    // A raw stream takes its dictionary up front rather than asking for it
+    if (!dictionary.empty() &&
+        inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.data()), dictionary.size()) != Z_OK) {
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + COMPRESSION_PREFIX_SIZE));
+    stream.avail_in = size - COMPRESSION_PREFIX_SIZE;
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    stream.avail_out = expected;
+    return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == expected && stream.avail_in == 0;
+}
+
+static uint64_t gramAt(const std::string& sample, size_t offset) {
+    uint64_t gram;
+    std::memcpy(&gram, sample.data() + offset, TRAINING_GRAM_SIZE);
+    return gram;
+}
+
+// A stretch of one sample that could go in the dictionary
+struct trainingSegment {
+    long score;
+    size_t sample;
+    size_t offset;
+};
+
+struct segmentOrder {
+    // Highest score first, earliest stretch breaking ties so training is
+    // deterministic
+    bool operator()(const trainingSegment& a, const trainingSegment& b) const {
+        if (a.score != b.score) return a.score < b.score;
+        if (a.sample != b.sample) return a.sample > b.sample;
+        return a.offset > b.offset;
+    }
+};
+
+// Sum of the counts of the distinct grams in a segment that repeat
+static long segmentScore(const std::string& sample, size_t offset, std::unordered_map<uint64_t, long>& counts) {
+    uint64_t seen[TRAINING_SEGMENT_SIZE];
+    int distinct = 0;
+    long score = 0;
+    for (size_t i = offset; i + TRAINING_GRAM_SIZE <= offset + TRAINING_SEGMENT_SIZE; i++) {
+        uint64_t gram = gramAt(sample, i);
+        if (std::find(seen, seen + distinct, gram) != seen + distinct) continue;
+        seen[distinct++] = gram;
+        long count = counts[gram];
+        if (count > 1) score += count;
+    }
+    return score;
+}
+
+std::string trainCompressionDictionary(const std::vector<std::string>& samples, size_t size) {
+    std::unordered_map<uint64_t, long> counts;
+    for (const std::string& sample : samples) {
+        for (size_t i = 0; i + TRAINING_GRAM_SIZE <= sample.size(); i++) counts[gramAt(sample, i)]++;
+    }
+    std::priority_queue<trainingSegment, std::vector<trainingSegment>, segmentOrder> candidates;
+    for (size_t s = 0; s < samples.size(); s++) {
+        for (size_t offset = 0; offset + TRAINING_SEGMENT_SIZE <= samples[s].size(); offset += TRAINING_STRIDE) {
+            trainingSegment segment = {segmentScore(samples[s], offset, counts), s, offset};
+            if (segment.score > 0) candidates.push(segment);
+        }
+    }
+
+    // Greedy cover: take the best segment, then stop counting what it holds.
+    // Scores only ever fall, so a segment whose score still holds when it
+    // comes off the queue is the best one left.
+    std::vector<trainingSegment> taken;
+    taken.reserve(size / TRAINING_SEGMENT_SIZE);
+    while (!candidates.empty() && (taken.size() + 1) * TRAINING_SEGMENT_SIZE <= size) {
+        trainingSegment segment = candidates.top();
+        candidates.pop();
+        long score = segmentScore(samples[segment.sample], segment.offset, counts);
+        if (score < segment.score) {
+            segment.score = score;
+            if (score > 0) candidates.push(segment);
+            continue;
+        }
+        taken.push_back(segment);
+        for (size_t i = segment.offset; i + TRAINING_GRAM_SIZE <= segment.offset + TRAINING_SEGMENT_SIZE; i++) {
+            counts[gramAt(samples[segment.sample], i)] = 0;
+        }
+    }
+
+    std::string dictionary;
+    dictionary.reserve(taken.size() * TRAINING_SEGMENT_SIZE);
+    for (auto segment = taken.rbegin(); segment != taken.rend(); ++segment) {
+        dictionary.append(samples[segment->sample], segment->offset, TRAINING_SEGMENT_SIZE);
+    }
+    return dictionary;
+}
+
+const std::string& defaultCompressionDictionary() {
+    static const std::string dictionary(reinterpret_cast<const char*>(defaultCompressionDictionaryBytes),
+                                        DEFAULT_COMPRESSION_DICTIONARY_SIZE);
+    return dictionary;
+}
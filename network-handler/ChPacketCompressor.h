@@ -0,0 +1,90 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Compression of message payloads against a preset dictionary. A datagram
+//  is far too short for a compressor to learn much from it alone, so each one
+//  is deflated as if it followed the dictionary: field tags, message lengths
+//  and the doubles every vehicle shares are matched against the dictionary
+//  from the first byte. Each payload is compressed on its own, so a lost
+//  datagram costs nothing but itself.
+//
+//  A compressed payload is raw deflate (zlib, no header or checksum) preceded
+//  by its size before compression, 4 bytes little-endian.
+//
+//  Sender and receiver must hold the same dictionary; the handshake compares
+//  dictionaryId()s before either side compresses anything (ChDatagramHeader.h).
+//
+// =============================================================================
+
+#ifndef CHPACKETCOMPRESSOR_H
+#define CHPACKETCOMPRESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Payloads shorter than this are sent as they are; deflate saves next to
+// nothing on them and a single VehicleMessage already fits in one datagram.
+#define COMPRESSION_THRESHOLD 256
+// zlib level, 1 (fastest) to 9 (smallest)
+#define COMPRESSION_LEVEL 1
+// Largest dictionary trainCompressionDictionary builds unless asked otherwise
+#define COMPRESSION_DICTIONARY_SIZE 4096
+#define COMPRESSION_PREFIX_SIZE 4
+
+class ChPacketCompressor {
+public:
+    // Compresses against dictionary at zlib level level. Only the last 32 kB
+    // of a longer dictionary are used.
+    explicit ChPacketCompressor(const std::string& dictionary, int level = COMPRESSION_LEVEL);
+
+    // Hash of the dictionary, never 0, that the two ends of a connection
+    // compare to know they hold the same one.
+    uint32_t dictionaryId() const;
+
+    // Compresses size bytes from data into out, which has room for capacity
+    // bytes. Returns the compressed size, prefix included, or 0 if it doesn't
+    // fit in capacity. Safe to call from several threads at once.
+    size_t compress(const char* data, size_t size, char* out, size_t capacity) const;
+
+    // Size a compressed payload expands to, or 0 if it is too short to say.
+    static size_t decompressedSize(const char* data, size_t size);
+
+    // Expands size bytes of a compressed payload into out, which has room for
+    // decompressedSize(data, size). Returns false if data is malformed or
+    // expands to some other size. Data compressed against another dictionary
+    // can expand to garbage instead, which is why the handshake compares
+    // dictionaries. Safe to call from several threads at once.
+    bool decompress(const char* data, size_t size, char* out) const;
+
+private:
+    std::string dictionary;
+    int level;
+    uint32_t id;
+};
+
+// Builds a dictionary of at most size bytes out of samples, payloads as they
+// would be sent. It is made of the stretches of the samples that cover the
+// most often repeated byte sequences, the most useful last, where deflate
+// reaches them with the shortest distances. Train it on recorded traffic.
+std::string trainCompressionDictionary(const std::vector<std::string>& samples,
+                                       size_t size = COMPRESSION_DICTIONARY_SIZE);
+
+// Dictionary trained on recorded traffic and shipped with the library
+// (ChCompressionDictionary.h), so every build holds the same bytes and
+// DEFAULT_COMPRESSION_DICTIONARY_ID.
+const std::string& defaultCompressionDictionary();
+
+#endif // CHPACKETCOMPRESSOR_H
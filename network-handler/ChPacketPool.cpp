@@ -0,0 +1,119 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChPacketPool and ChPacketHandle.
+//
+// =============================================================================
+
+#include "ChPacketPool.h"
+
+#include <algorithm>
+
+ChPacketHandle::ChPacketHandle() : slab(nullptr) {}
+
+ChPacketHandle::ChPacketHandle(ChPacketSlab* slab) : slab(slab) {}
+
+ChPacketHandle::ChPacketHandle(const ChPacketHandle& other) : slab(other.slab) {
+    if (slab != nullptr) slab->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+ChPacketHandle::ChPacketHandle(ChPacketHandle&& other) : slab(other.slab) {
+    other.slab = nullptr;
+}
+
+ChPacketHandle::~ChPacketHandle() {
+    reset();
+}
+
+ChPacketHandle& ChPacketHandle::operator=(const ChPacketHandle& other) {
+    if (other.slab != nullptr) other.slab->refs.fetch_add(1, std::memory_order_relaxed);
+    reset();
+    slab = other.slab;
+    return *this;
+}
+
+ChPacketHandle& ChPacketHandle::operator=(ChPacketHandle&& other) {
+    if (this != &other) {
+        reset();
+        slab = other.slab;
+        other.slab = nullptr;
+    }
+    return *this;
+}
+
+void ChPacketHandle::reset() {
+    if (slab != nullptr && slab->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        slab->pool->recycle(slab);
+    }
+    slab = nullptr;
+}
+
+ChPacketPool::ChPacketPool(size_t slabCount, size_t slabSize) : freeSlabs(slabCount) {
+    m_slabSize = slabSize;
+    m_slabCount = slabCount;
+    m_hits = 0;
+    m_misses = 0;
+    m_inUse = 0;
+    m_highWaterMark = 0;
+    // Every pooled slab lives in one contiguous region
+    region = new char[slabCount * slabSize];
+    slabs = new ChPacketSlab[slabCount];
+    for (size_t i = 0; i < slabCount; i++) {
+        slabs[i].data = region + i * slabSize;
+        slabs[i].size = 0;
+        slabs[i].capacity = slabSize;
+        slabs[i].refs = 0;
+        slabs[i].pooled = true;
+        slabs[i].pool = this;
+        freeSlabs.tryEnqueue(&slabs[i]);
+    }
+}
+
+ChPacketPool::~ChPacketPool() {
+    delete[] slabs;
+    delete[] region;
+}
+
+ChPacketHandle ChPacketPool::acquire(size_t size) {
+    ChPacketSlab* slab = nullptr;
+    if (size <= m_slabSize && freeSlabs.tryDequeue(slab)) {
+        m_hits++;
+    } else {
+        // Oversized request or empty free list, so this one comes from the heap
+        m_misses++;
+        size_t capacity = std::max(size, m_slabSize);
+        slab = new ChPacketSlab;
+        slab->data = new char[capacity];
+        slab->capacity = capacity;
+        slab->pooled = false;
+        slab->pool = this;
+    }
+    slab->size = 0;
+    slab->refs.store(1, std::memory_order_relaxed);
+
+    long held = ++m_inUse;
+    long mark = m_highWaterMark.load(std::memory_order_relaxed);
+    while (held > mark && !m_highWaterMark.compare_exchange_weak(mark, held));
+    return ChPacketHandle(slab);
+}
+
+void ChPacketPool::recycle(ChPacketSlab* slab) {
+    m_inUse--;
+    if (slab->pooled) {
+        freeSlabs.tryEnqueue(slab);
+    } else {
+        delete[] slab->data;
+        delete slab;
+    }
+}
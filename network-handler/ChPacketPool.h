@@ -0,0 +1,114 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Pool of preallocated, MTU-sized packet buffers. Buffers are handed out as
+//  refcounted ChPacketHandles and go back on the pool's free list when the last
+//  handle lets go of them, so steady-state traffic never touches the heap.
+//  Requests larger than a slab, or made while the free list is empty, fall
+//  back to a heap allocation and are counted as misses.
+//
+// =============================================================================
+
+#ifndef CHPACKETPOOL_H
+#define CHPACKETPOOL_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "ChRingQueue.h"
+
+// Largest UDP payload that fits in a 1500 byte ethernet frame.
+#define PACKET_SLAB_SIZE 1472
+#define PACKET_POOL_SLABS 2048
+
+class ChPacketPool;
+
+struct ChPacketSlab {
+    char* data;
+    size_t size;
+    size_t capacity;
+    std::atomic<int> refs;
+    // False for overflow buffers that are freed instead of recycled
+    bool pooled;
+    ChPacketPool* pool;
+};
+
+class ChPacketHandle {
+public:
+    ChPacketHandle();
+    explicit ChPacketHandle(ChPacketSlab* slab);
+    ChPacketHandle(const ChPacketHandle& other);
+    ChPacketHandle(ChPacketHandle&& other);
+    ~ChPacketHandle();
+
+    ChPacketHandle& operator=(const ChPacketHandle& other);
+    ChPacketHandle& operator=(ChPacketHandle&& other);
+
+    char* data() const { return slab->data; }
+
+    // Number of bytes holding packet contents.
+    size_t size() const { return slab->size; }
+    void resize(size_t size) { slab->size = size; }
+    size_t capacity() const { return slab->capacity; }
+
+    explicit operator bool() const { return slab != nullptr; }
+
+    // Drops this handle's reference early.
+    void reset();
+
+private:
+    ChPacketSlab* slab;
+};
+
+class ChPacketPool {
+public:
+    ChPacketPool(size_t slabCount = PACKET_POOL_SLABS, size_t slabSize = PACKET_SLAB_SIZE);
+    ~ChPacketPool();
+
+    ChPacketPool(const ChPacketPool&) = delete;
+    ChPacketPool& operator=(const ChPacketPool&) = delete;
+
+    // Returns an empty buffer with room for at least size bytes.
+    ChPacketHandle acquire(size_t size = 0);
+
+    size_t slabSize() { return m_slabSize; }
+
+    // Buffers served from the free list.
+    long hits() { return m_hits; }
+    // Buffers that had to be heap allocated.
+    long misses() { return m_misses; }
+    // Buffers currently held by handles.
+    long inUse() { return m_inUse; }
+    // Most buffers ever held at once.
+    long highWaterMark() { return m_highWaterMark; }
+
+private:
+    friend class ChPacketHandle;
+
+    // Called when the last handle to a slab goes away.
+    void recycle(ChPacketSlab* slab);
+
+    size_t m_slabSize;
+    size_t m_slabCount;
+    char* region;
+    ChPacketSlab* slabs;
+    ChRingQueue<ChPacketSlab*> freeSlabs;
+
+    std::atomic<long> m_hits;
+    std::atomic<long> m_misses;
+    std::atomic<long> m_inUse;
+    std::atomic<long> m_highWaterMark;
+};
+
+#endif
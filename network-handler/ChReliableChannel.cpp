@@ -0,0 +1,213 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChReliableChannel.
+//
+// =============================================================================
+
+#include "ChReliableChannel.h"
+#include "MessageCodes.h"
+
+#include <algorithm>
+#include <cmath>
+
+ChReliableChannel::Peer::Peer() {
+    nextSequence = 0;
+    measured = false;
+    roundTrip = 0;
+    variance = 0;
+    timeout = RELIABLE_INITIAL_TIMEOUT;
+    expected = 0;
+    ackQueued = false;
+    stats = ChReliableStats();
+}
+
+ChReliableChannel::ChReliableChannel(int maxTransmissions) {
+    unacknowledged = 0;
+    this->maxTransmissions = std::max(maxTransmissions, 1);
+}
+
+void ChReliableChannel::track(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& datagram) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    Peer& peer = peers[endpoint];
+    ChReliableHeader header;
+    header.sequence = peer.nextSequence++;
+    header.ack = 0;
+    header.ackBits = 0;
+    writeReliableHeader(datagram.data() + DATAGRAM_HEADER_SIZE, header);
+
+    Outstanding message;
+    message.sequence = header.sequence;
+    message.datagram = datagram;
+    message.acknowledged = false;
+    message.transmissions = 0;
+    peer.outstanding.push_back(std::move(message));
+    peer.stats.sent++;
+    peer.stats.outstanding++;
+    unacknowledged++;
+}
+
+void ChReliableChannel::stamp(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& datagram) {
+    ChDatagramHeader datagramHeader;
+    ChReliableHeader header;
+    if (!readDatagramHeader(datagram.data(), datagram.size(), datagramHeader)) return;
+    if (!readReliableHeader(datagram.data() + DATAGRAM_HEADER_SIZE, datagramHeader.payloadSize, header)) return;
+
+    std::lock_guard<std::mutex> lock(channelMutex);
+    Peer& peer = peers[endpoint];
+    uint32_t ackBits = 0;
+    for (uint32_t i = 0; i < 32 && !peer.held.empty(); i++) {
+        if (peer.held.count(peer.expected + 1 + i)) ackBits |= 1u << i;
+    }
+    stampReliableAck(datagram.data() + DATAGRAM_HEADER_SIZE, peer.expected, ackBits);
+    peer.ackQueued = false;
+    if (datagramHeader.type == ACK_MESSAGE || peer.outstanding.empty()) return;
+
+    // Outstanding messages are contiguous in sequence, so the offset finds it
+    size_t index = header.sequence - peer.outstanding.front().sequence;
+    if (index >= peer.outstanding.size()) return;
+    Outstanding& message = peer.outstanding[index];
+    if (message.acknowledged) return;
+    auto now = std::chrono::steady_clock::now();
+    // Each retransmission doubles the wait before the next one
+    double timeout = std::min(peer.timeout * std::pow(2.0, message.transmissions), (double)RELIABLE_MAX_TIMEOUT);
+    if (message.transmissions > 0) peer.stats.retransmitted++;
+    message.transmissions++;
+    message.sentAt = now;
+    message.deadline = now + std::chrono::microseconds((long)(timeout * 1000));
+}
+
+void ChReliableChannel::acknowledge(const boost::asio::ip::udp::endpoint& endpoint, const ChReliableHeader& header) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    auto found = peers.find(endpoint);
+    if (found == peers.end()) return;
+    Peer& peer = found->second;
+    auto now = std::chrono::steady_clock::now();
+    bool sampled = false;
+    std::chrono::steady_clock::time_point newestSend;
+    for (auto& message : peer.outstanding) {
+        if (message.acknowledged || message.transmissions == 0) continue;
+        int32_t ahead = (int32_t)(message.sequence - header.ack);
+        bool received = ahead < 0 || (ahead >= 1 && ahead <= 32 && (header.ackBits & (1u << (ahead - 1))));
+        if (!received) continue;
+        // A retransmitted message can't tell which send was acknowledged, so it isn't timed
+        if (message.transmissions == 1 && (!sampled || message.sentAt > newestSend)) {
+            newestSend = message.sentAt;
+            sampled = true;
+        }
+        message.acknowledged = true;
+        message.datagram.reset();
+        peer.stats.outstanding--;
+        unacknowledged--;
+    }
+    while (!peer.outstanding.empty() && peer.outstanding.front().acknowledged) {
+        peer.outstanding.pop_front();
+    }
+    if (sampled) {
+        measure(peer, std::chrono::duration<double, std::milli>(now - newestSend).count());
+    }
+}
+
+void ChReliableChannel::measure(Peer& peer, double sample) {
+    // Smoothed round trip and mean deviation, as TCP estimates them
+    if (!peer.measured) {
+        peer.roundTrip = sample;
+        peer.variance = sample / 2;
+        peer.measured = true;
+    } else {
+        peer.variance = 0.75 * peer.variance + 0.25 * std::abs(peer.roundTrip - sample);
+        peer.roundTrip = 0.875 * peer.roundTrip + 0.125 * sample;
+    }
+    peer.timeout = std::max((double)RELIABLE_MIN_TIMEOUT,
+                            std::min(peer.roundTrip + 4 * peer.variance, (double)RELIABLE_MAX_TIMEOUT));
+}
+
+bool ChReliableChannel::receive(const boost::asio::ip::udp::endpoint& endpoint, const ChReliableHeader& header,
+                                ChPacketHandle& datagram, const std::function<void(ChPacketHandle&)>& deliver) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    Peer& peer = peers[endpoint];
+    int32_t ahead = (int32_t)(header.sequence - peer.expected);
+    if (ahead == 0) {
+        deliver(datagram);
+        peer.stats.delivered++;
+        peer.expected++;
+        // Hands out everything that was waiting on this one
+        auto next = peer.held.find(peer.expected);
+        while (next != peer.held.end()) {
+            deliver(next->second);
+            peer.held.erase(next);
+            peer.stats.delivered++;
+            peer.expected++;
+            next = peer.held.find(peer.expected);
+        }
+    } else if (ahead < 0) {
+        peer.stats.duplicates++;
+    } else if (ahead <= RELIABLE_HOLD_LIMIT) {
+        if (!peer.held.emplace(header.sequence, datagram).second) peer.stats.duplicates++;
+    }
+    // Duplicates are acknowledged too, since the last acknowledgement may have been lost
+    if (peer.ackQueued) return false;
+    peer.ackQueued = true;
+    return true;
+}
+
+void ChReliableChannel::collectRetransmits(std::vector<Datagram>& datagrams,
+                                           std::vector<boost::asio::ip::udp::endpoint>& lost) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto peerPair = peers.begin(); peerPair != peers.end();) {
+        Peer& peer = peerPair->second;
+        size_t collected = datagrams.size();
+        bool given = false;
+        for (auto& message : peer.outstanding) {
+            if (message.acknowledged || message.transmissions == 0 || now < message.deadline) continue;
+            // The receiver can never deliver past this message, so nothing else to it is worth sending
+            if (message.transmissions >= maxTransmissions) {
+                given = true;
+                break;
+            }
+            datagrams.push_back(Datagram(peerPair->first, message.datagram));
+        }
+        if (!given) {
+            peerPair++;
+            continue;
+        }
+        datagrams.erase(datagrams.begin() + collected, datagrams.end());
+        lost.push_back(peerPair->first);
+        unacknowledged -= peer.stats.outstanding;
+        peerPair = peers.erase(peerPair);
+    }
+}
+
+bool ChReliableChannel::pending() {
+    return unacknowledged > 0;
+}
+
+ChReliableStats ChReliableChannel::stats(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    auto found = peers.find(endpoint);
+    if (found == peers.end()) return ChReliableStats();
+    ChReliableStats stats = found->second.stats;
+    stats.roundTrip = found->second.roundTrip;
+    stats.timeout = found->second.timeout;
+    return stats;
+}
+
+void ChReliableChannel::remove(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    auto found = peers.find(endpoint);
+    if (found == peers.end()) return;
+    unacknowledged -= found->second.stats.outstanding;
+    peers.erase(found);
+}
@@ -0,0 +1,152 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Reliable, ordered delivery over the handler's udp socket. Each message is
+//  kept until the receiver acknowledges it, and is sent again whenever its
+//  retransmit timer runs out. The timer follows the measured round trip time.
+//  Receivers acknowledge cumulatively plus a bitfield of the messages they
+//  hold past a gap, so only what was actually lost is sent again. Messages
+//  that arrive past a gap wait for it to fill, and are then delivered in
+//  order. A receiver that never acknowledges a message is given up on as a
+//  whole, since nothing it is sent afterwards could be delivered.
+//
+// =============================================================================
+
+#ifndef CHRELIABLECHANNEL_H
+#define CHRELIABLECHANNEL_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ChDatagramHeader.h"
+#include "ChPacketPool.h"
+
+// Retransmit timeout before any round trip has been measured, and the bounds
+// on it afterwards, in milliseconds.
+#define RELIABLE_INITIAL_TIMEOUT 200
+#define RELIABLE_MIN_TIMEOUT 10
+#define RELIABLE_MAX_TIMEOUT 2000
+// Times a message is sent before the receiver is given up on, unless set
+// otherwise.
+#define RELIABLE_MAX_TRANSMISSIONS 10
+// How far past a gap a receiver holds messages; later ones are dropped and
+// sent again once the gap fills.
+#define RELIABLE_HOLD_LIMIT 256
+// How often a sender with unacknowledged messages checks their timers, in
+// milliseconds.
+#define RELIABLE_TICK 5
+
+struct ChReliableStats {
+    // Messages handed to the channel for this endpoint
+    long sent;
+    // Datagrams sent again after their timer ran out
+    long retransmitted;
+    // Messages sent and not yet acknowledged
+    long outstanding;
+    // Messages received from this endpoint and delivered in order
+    long delivered;
+    // Messages received again after they were delivered or while held
+    long duplicates;
+    // Smoothed round trip time and current retransmit timeout, in milliseconds
+    double roundTrip;
+    double timeout;
+};
+
+class ChReliableChannel {
+public:
+    typedef std::pair<boost::asio::ip::udp::endpoint, ChPacketHandle> Datagram;
+
+    // Gives up on an endpoint once a message to it has been sent
+    // maxTransmissions times without being acknowledged.
+    ChReliableChannel(int maxTransmissions = RELIABLE_MAX_TRANSMISSIONS);
+
+    // Gives a serialized reliable datagram the next sequence number to
+    // endpoint and keeps it until it is acknowledged.
+    void track(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& datagram);
+
+    // Fills in the acknowledgement fields of a reliable datagram about to go
+    // to endpoint, and starts its retransmit timer. Only ever called from the
+    // sending thread.
+    void stamp(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle& datagram);
+
+    // Retires the messages to endpoint that a received header acknowledges.
+    void acknowledge(const boost::asio::ip::udp::endpoint& endpoint, const ChReliableHeader& header);
+
+    // Records a reliable message from endpoint. Calls deliver with it and with
+    // any held messages it unblocks, in order, under the channel's lock.
+    // Returns true if an acknowledgement needs to be queued for endpoint; one
+    // already queued and not yet sent covers this message too.
+    bool receive(const boost::asio::ip::udp::endpoint& endpoint, const ChReliableHeader& header,
+                 ChPacketHandle& datagram, const std::function<void(ChPacketHandle&)>& deliver);
+
+    // Appends every sent message whose retransmit timer has run out. An
+    // endpoint with a message that has run out of transmissions is removed
+    // instead and appended to lost. Only ever called from the sending thread.
+    void collectRetransmits(std::vector<Datagram>& datagrams, std::vector<boost::asio::ip::udp::endpoint>& lost);
+
+    // True while any sent message is waiting to be acknowledged.
+    bool pending();
+
+    // Counters for one endpoint; all zero if nothing went to or came from it.
+    ChReliableStats stats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Forgets an endpoint, dropping anything still unacknowledged.
+    void remove(const boost::asio::ip::udp::endpoint& endpoint);
+
+private:
+    struct Outstanding {
+        uint32_t sequence;
+        ChPacketHandle datagram;
+        bool acknowledged;
+        int transmissions;
+        std::chrono::steady_clock::time_point sentAt;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct Peer {
+        Peer();
+
+        // Sending side
+        uint32_t nextSequence;
+        // Oldest first; acknowledged ones are popped once they reach the front
+        std::deque<Outstanding> outstanding;
+        bool measured;
+        double roundTrip;
+        double variance;
+        double timeout;
+
+        // Receiving side
+        uint32_t expected;
+        std::map<uint32_t, ChPacketHandle> held;
+        bool ackQueued;
+
+        ChReliableStats stats;
+    };
+
+    // Folds one round trip sample into the peer's retransmit timeout.
+    static void measure(Peer& peer, double sample);
+
+    std::mutex channelMutex;
+    std::map<boost::asio::ip::udp::endpoint, Peer> peers;
+    std::atomic<long> unacknowledged;
+    int maxTransmissions;
+};
+
+#endif // CHRELIABLECHANNEL_H
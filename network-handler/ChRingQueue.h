@@ -0,0 +1,320 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Bounded, lock-free multi-producer/multi-consumer ring queue. Each slot
+//  carries a sequence number that producers and consumers claim with a single
+//  compare-and-swap, so the fast path never takes a lock. Threads only park on
+//  a condition variable when the queue is full (producers) or empty
+//  (consumers), and the opposite side only touches the mutex if somebody is
+//  actually parked. Elements are moved in and out; nothing is heap allocated
+//  after construction.
+//
+// =============================================================================
+
+#ifndef CHRINGQUEUE_H
+#define CHRINGQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "ChSafeQueue.h"
+
+#define RING_QUEUE_DEFAULT_CAPACITY 4096
+#define RING_QUEUE_CACHE_LINE 64
+#define RING_QUEUE_SPIN_COUNT 64
+
+template<class T> class ChRingQueue {
+public:
+    // Capacity is rounded up to the next power of two.
+    explicit ChRingQueue(size_t capacity = RING_QUEUE_DEFAULT_CAPACITY);
+    ~ChRingQueue();
+
+    ChRingQueue(const ChRingQueue&) = delete;
+    ChRingQueue& operator=(const ChRingQueue&) = delete;
+
+    // Blocks while the queue is full. Throws PredicateException once the
+    // queue has been dumped.
+    void enqueue(T&& obj);
+    void enqueue(const T& obj);
+
+    // Blocks while the queue is empty. Throws PredicateException once the
+    // queue has been dumped.
+    T dequeue();
+
+    // Non-blocking variants. Return false instead of waiting.
+    bool tryEnqueue(T&& obj);
+    bool tryEnqueue(const T& obj);
+    bool tryDequeue(T& obj);
+
+    // Wait at most timeout. Return false if it expires first.
+    template<class Rep, class Period> bool enqueueFor(T&& obj, const std::chrono::duration<Rep, Period>& timeout);
+    template<class Rep, class Period> bool dequeueFor(T& obj, const std::chrono::duration<Rep, Period>& timeout);
+
+    // Approximate while other threads are active.
+    int size();
+    bool empty();
+    size_t capacity();
+
+    // Wakes every blocked thread and makes all further blocking calls throw.
+    void dumpThreads();
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    template<class U> bool push(U&& obj);
+    bool pop(T& obj);
+    void notify(std::atomic<int>& waiters, std::condition_variable& var);
+
+    Cell* cells;
+    size_t mask;
+
+    // Producers and consumers hammer the two positions from different cores,
+    // so a full line of padding keeps each on a cache line of its own. This is
+    // padding rather than alignas because handlers holding queues are created
+    // with plain new, which ignores over-alignment before C++17.
+    char enqueuePad[RING_QUEUE_CACHE_LINE];
+    std::atomic<size_t> enqueuePos;
+    char dequeuePad[RING_QUEUE_CACHE_LINE];
+    std::atomic<size_t> dequeuePos;
+    char waitPad[RING_QUEUE_CACHE_LINE];
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::atomic<int> consumersWaiting;
+    std::atomic<int> producersWaiting;
+    std::atomic<bool> dump;
+};
+
+template<class T> ChRingQueue<T>::ChRingQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    mask = size - 1;
+    cells = new Cell[size];
+    for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+    consumersWaiting.store(0);
+    producersWaiting.store(0);
+    dump.store(false);
+}
+
+template<class T> ChRingQueue<T>::~ChRingQueue() {
+    // Destroy anything still sitting in the ring
+    T obj;
+    while (pop(obj));
+    delete[] cells;
+}
+
+template<class T> template<class U> bool ChRingQueue<T>::push(U&& obj) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            // Slot is free for this lap; claim it
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // Slot still holds last lap's element, the ring is full
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    new (&cell->storage) T(std::forward<U>(obj));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T> bool ChRingQueue<T>::pop(T& obj) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // Nothing published in this slot yet, the ring is empty
+            return false;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    T* stored = reinterpret_cast<T*>(&cell->storage);
+    obj = std::move(*stored);
+    stored->~T();
+    // Hand the slot back to producers for the next lap
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T> void ChRingQueue<T>::notify(std::atomic<int>& waiters, std::condition_variable& var) {
+    // The mutex is only touched when a thread is actually parked. Taking it
+    // before notifying closes the window between the waiter's last check and
+    // its wait.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load() > 0) {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        var.notify_one();
+    }
+}
+
+template<class T> bool ChRingQueue<T>::tryEnqueue(T&& obj) {
+    if (dump) throw PredicateException();
+    if (!push(std::move(obj))) return false;
+    notify(consumersWaiting, notEmpty);
+    return true;
+}
+
+template<class T> bool ChRingQueue<T>::tryEnqueue(const T& obj) {
+    if (dump) throw PredicateException();
+    if (!push(obj)) return false;
+    notify(consumersWaiting, notEmpty);
+    return true;
+}
+
+template<class T> bool ChRingQueue<T>::tryDequeue(T& obj) {
+    if (!pop(obj)) return false;
+    notify(producersWaiting, notFull);
+    return true;
+}
+
+template<class T> void ChRingQueue<T>::enqueue(T&& obj) {
+    for (int i = 0; i < RING_QUEUE_SPIN_COUNT; i++) {
+        if (tryEnqueue(std::move(obj))) return;
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    producersWaiting++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    while (!dump && !(pushed = push(std::move(obj)))) {
+        notFull.wait(lock);
+    }
+    producersWaiting--;
+    lock.unlock();
+    // Only throw if the element didn't make it in; one pushed just as the
+    // queue was dumped is already there for consumers to drain.
+    if (!pushed) throw PredicateException();
+    notify(consumersWaiting, notEmpty);
+}
+
+template<class T> void ChRingQueue<T>::enqueue(const T& obj) {
+    enqueue(T(obj));
+}
+
+template<class T> T ChRingQueue<T>::dequeue() {
+    T obj;
+    if (dump) throw PredicateException();
+    for (int i = 0; i < RING_QUEUE_SPIN_COUNT; i++) {
+        if (tryDequeue(obj)) return obj;
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    consumersWaiting++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    while (!dump && !(popped = pop(obj))) {
+        notEmpty.wait(lock);
+    }
+    consumersWaiting--;
+    lock.unlock();
+    // An element already popped is handed over rather than thrown away
+    if (!popped) throw PredicateException();
+    notify(producersWaiting, notFull);
+    return obj;
+}
+
+template<class T> template<class Rep, class Period>
+bool ChRingQueue<T>::enqueueFor(T&& obj, const std::chrono::duration<Rep, Period>& timeout) {
+    if (tryEnqueue(std::move(obj))) return true;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    producersWaiting++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    while (!dump && !(pushed = push(std::move(obj)))) {
+        if (notFull.wait_until(lock, deadline) == std::cv_status::timeout) {
+            pushed = push(std::move(obj));
+            break;
+        }
+    }
+    producersWaiting--;
+    lock.unlock();
+    if (!pushed && dump) throw PredicateException();
+    if (pushed) notify(consumersWaiting, notEmpty);
+    return pushed;
+}
+
+template<class T> template<class Rep, class Period>
+bool ChRingQueue<T>::dequeueFor(T& obj, const std::chrono::duration<Rep, Period>& timeout) {
+    if (dump) throw PredicateException();
+    if (tryDequeue(obj)) return true;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    consumersWaiting++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    while (!dump && !(popped = pop(obj))) {
+        if (notEmpty.wait_until(lock, deadline) == std::cv_status::timeout) {
+            popped = pop(obj);
+            break;
+        }
+    }
+    consumersWaiting--;
+    lock.unlock();
+    if (!popped && dump) throw PredicateException();
+    if (popped) notify(producersWaiting, notFull);
+    return popped;
+}
+
+template<class T> int ChRingQueue<T>::size() {
+    size_t tail = dequeuePos.load(std::memory_order_relaxed);
+    size_t head = enqueuePos.load(std::memory_order_relaxed);
+    return head > tail ? (int)(head - tail) : 0;
+}
+
+template<class T> bool ChRingQueue<T>::empty() {
+    return size() == 0;
+}
+
+template<class T> size_t ChRingQueue<T>::capacity() {
+    return mask + 1;
+}
+
+template<class T> void ChRingQueue<T>::dumpThreads() {
+    dump = true;
+    std::lock_guard<std::mutex> lock(mutex);
+    notEmpty.notify_all();
+    notFull.notify_all();
+}
+
+#endif
@@ -0,0 +1,275 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChSendScheduler.
+//
+// =============================================================================
+
+#include "ChSendScheduler.h"
+#include "ChSafeQueue.h"
+
+#include <algorithm>
+
+ChSendScheduler::Flow::Flow() {
+    for (int c = 0; c < TRAFFIC_CLASSES; c++) {
+        deficits[c] = 0;
+        active[c] = false;
+    }
+    ownRate = false;
+    rate = 0;
+    burst = SEND_BURST_SIZE;
+    tokens = SEND_BURST_SIZE;
+    refilled = std::chrono::steady_clock::now();
+    lastQueued = refilled;
+    stats = ChSendStats();
+}
+
+ChSendScheduler::ChSendScheduler() {
+    totalDepth = 0;
+    fresh = false;
+    dump = false;
+    defaultRate = SEND_DEFAULT_RATE;
+    defaultBurst = SEND_BURST_SIZE;
+    lastDropped = std::chrono::steady_clock::now();
+}
+
+void ChSendScheduler::enqueue(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram,
+                              int trafficClass) {
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    if (dump) throw PredicateException();
+    trafficClass = std::min(std::max(trafficClass, 0), TRAFFIC_CLASSES - 1);
+    Flow& flow = flowFor(endpoint);
+    std::deque<ChPacketHandle>& queue = flow.queues[trafficClass];
+    if (queue.size() >= SEND_QUEUE_LIMIT) {
+        auto oldest = std::find_if(queue.begin(), queue.end(), [](ChPacketHandle& queued) {
+            return !(readDatagramFlags(queued.data()) & DATAGRAM_FLAG_RELIABLE);
+        });
+        flow.stats.dropped++;
+        flow.stats.droppedByClass[trafficClass]++;
+        if (oldest != queue.end()) {
+            flow.stats.depth--;
+            flow.stats.depthByClass[trafficClass]--;
+            flow.stats.queuedBytes -= oldest->size();
+            totalDepth--;
+            queue.erase(oldest);
+        } else if (!(readDatagramFlags(datagram.data()) & DATAGRAM_FLAG_RELIABLE)) {
+            // Nothing but reliable datagrams queued, so the new one goes instead
+            return;
+        }
+    }
+    flow.stats.depth++;
+    flow.stats.depthByClass[trafficClass]++;
+    flow.stats.queuedBytes += datagram.size();
+    flow.stats.peakDepth = std::max(flow.stats.peakDepth, flow.stats.depth);
+    totalDepth++;
+    flow.lastQueued = std::chrono::steady_clock::now();
+    queue.push_back(std::move(datagram));
+    if (!flow.active[trafficClass]) {
+        // A class starts waiting for its turn when its first datagram arrives
+        if (active[trafficClass].empty()) lastServed[trafficClass] = std::chrono::steady_clock::now();
+        flow.active[trafficClass] = true;
+        flow.deficits[trafficClass] = 0;
+        active[trafficClass].push_back(&flow);
+    }
+    fresh = true;
+    lock.unlock();
+    queued.notify_one();
+}
+
+std::chrono::steady_clock::duration ChSendScheduler::collect(std::vector<Datagram>& batch, size_t max) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    fresh = false;
+    auto now = std::chrono::steady_clock::now();
+    auto wait = std::chrono::steady_clock::duration::max();
+    // Classes whose every endpoint is waiting on its bucket sit out the rest of this call
+    bool blocked[TRAFFIC_CLASSES] = {};
+    auto starved = now - std::chrono::milliseconds(TRAFFIC_MAX_WAIT);
+    if (now - lastDropped >= std::chrono::milliseconds(SEND_FLOW_IDLE)) dropIdle(now);
+    while (batch.size() < max) {
+        int chosen = -1;
+        // A class kept waiting too long goes ahead of the ones above it
+        for (int c = 0; c < TRAFFIC_CLASSES && chosen < 0; c++) {
+            if (!blocked[c] && !active[c].empty() && lastServed[c] < starved) chosen = c;
+        }
+        for (int c = 0; c < TRAFFIC_CLASSES && chosen < 0; c++) {
+            if (!blocked[c] && !active[c].empty()) chosen = c;
+        }
+        if (chosen < 0) break;
+        if (serveTurn(chosen, batch, max, now, wait)) {
+            lastServed[chosen] = now;
+        } else {
+            blocked[chosen] = true;
+        }
+    }
+    return wait;
+}
+
+bool ChSendScheduler::serveTurn(int trafficClass, std::vector<Datagram>& batch, size_t max,
+                                std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration& wait) {
+    std::deque<Flow*>& round = active[trafficClass];
+    for (size_t tried = 0; tried < round.size(); tried++) {
+        Flow& flow = *round.front();
+        round.pop_front();
+        std::deque<ChPacketHandle>& queue = flow.queues[trafficClass];
+        refill(flow, now);
+        size_t headSize = queue.front().size();
+        // A full bucket lets through a datagram bigger than the bucket
+        if (flow.rate > 0 && flow.tokens < headSize && flow.tokens < flow.burst) {
+            double seconds = (std::min((double)headSize, flow.burst) - flow.tokens) / flow.rate;
+            wait = std::min(wait, std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(seconds)));
+            round.push_back(&flow);
+            continue;
+        }
+        long& deficit = flow.deficits[trafficClass];
+        deficit += SEND_QUANTUM;
+        while (!queue.empty() && batch.size() < max) {
+            size_t size = queue.front().size();
+            if ((long)size > deficit) break;
+            if (flow.rate > 0 && flow.tokens < size && flow.tokens < flow.burst) break;
+            deficit -= size;
+            if (flow.rate > 0) flow.tokens -= size;
+            flow.stats.depth--;
+            flow.stats.depthByClass[trafficClass]--;
+            flow.stats.queuedBytes -= size;
+            flow.stats.sent++;
+            flow.stats.sentBytes += size;
+            totalDepth--;
+            batch.push_back(Datagram(flow.endpoint, std::move(queue.front())));
+            queue.pop_front();
+        }
+        if (queue.empty()) {
+            // An idle endpoint doesn't bank its unused turn
+            flow.active[trafficClass] = false;
+            deficit = 0;
+        } else {
+            round.push_back(&flow);
+        }
+        return true;
+    }
+    return false;
+}
+
+void ChSendScheduler::waitFor(std::chrono::steady_clock::duration timeout) {
+    std::unique_lock<std::mutex> lock(schedulerMutex);
+    if (timeout == std::chrono::steady_clock::duration::max()) {
+        queued.wait(lock, [this] { return fresh || dump; });
+    } else {
+        queued.wait_for(lock, timeout, [this] { return fresh || dump; });
+    }
+    if (dump) throw PredicateException();
+}
+
+void ChSendScheduler::wake() {
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        fresh = true;
+    }
+    queued.notify_one();
+}
+
+void ChSendScheduler::setRate(const boost::asio::ip::udp::endpoint& endpoint, double bytesPerSecond, size_t burst) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    Flow& flow = flowFor(endpoint);
+    flow.ownRate = true;
+    flow.rate = bytesPerSecond;
+    flow.burst = burst;
+    flow.tokens = burst;
+}
+
+void ChSendScheduler::setDefaultRate(double bytesPerSecond, size_t burst) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    defaultRate = bytesPerSecond;
+    defaultBurst = burst;
+    for (auto& flowPair : flows) {
+        Flow& flow = flowPair.second;
+        if (flow.ownRate) continue;
+        flow.rate = bytesPerSecond;
+        flow.burst = burst;
+        flow.tokens = std::min(flow.tokens, flow.burst);
+    }
+}
+
+void ChSendScheduler::countOversized(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    flowFor(endpoint).stats.oversized++;
+}
+
+void ChSendScheduler::remove(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    auto found = flows.find(endpoint);
+    if (found == flows.end()) return;
+    Flow& flow = found->second;
+    for (int c = 0; c < TRAFFIC_CLASSES; c++) {
+        if (flow.active[c]) active[c].erase(std::find(active[c].begin(), active[c].end(), &flow));
+    }
+    totalDepth -= flow.stats.depth;
+    flows.erase(found);
+}
+
+ChSendStats ChSendScheduler::stats(const boost::asio::ip::udp::endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    auto found = flows.find(endpoint);
+    if (found == flows.end()) return ChSendStats();
+    ChSendStats stats = found->second.stats;
+    stats.rate = found->second.rate;
+    return stats;
+}
+
+bool ChSendScheduler::empty() {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    return totalDepth == 0;
+}
+
+void ChSendScheduler::dumpThreads() {
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        dump = true;
+    }
+    queued.notify_all();
+}
+
+void ChSendScheduler::refill(Flow& flow, std::chrono::steady_clock::time_point now) {
+    if (flow.rate > 0) {
+        double elapsed = std::chrono::duration<double>(now - flow.refilled).count();
+        flow.tokens = std::min(flow.burst, flow.tokens + elapsed * flow.rate);
+    }
+    flow.refilled = now;
+}
+
+ChSendScheduler::Flow& ChSendScheduler::flowFor(const boost::asio::ip::udp::endpoint& endpoint) {
+    auto found = flows.find(endpoint);
+    if (found != flows.end()) return found->second;
+    Flow& flow = flows[endpoint];
+    flow.endpoint = endpoint;
+    flow.rate = defaultRate;
+    flow.burst = defaultBurst;
+    flow.tokens = defaultBurst;
+    return flow;
+}
+
+void ChSendScheduler::dropIdle(std::chrono::steady_clock::time_point now) {
+    lastDropped = now;
+    auto idle = now - std::chrono::milliseconds(SEND_FLOW_IDLE);
+    for (auto flowPair = flows.begin(); flowPair != flows.end();) {
+        Flow& flow = flowPair->second;
+        refill(flow, now);
+        // A paced flow is kept until a new one would start with no more tokens than it has
+        if (flow.ownRate || flow.stats.depth > 0 || flow.lastQueued > idle || (flow.rate > 0 && flow.tokens < flow.burst)) {
+            flowPair++;
+            continue;
+        }
+        flowPair = flows.erase(flowPair);
+    }
+}
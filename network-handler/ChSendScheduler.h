@@ -0,0 +1,197 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Outgoing datagrams queued per endpoint and traffic class. Classes are
+//  served in strict priority order, so control traffic and vehicle state go
+//  out ahead of a DSRC flood. A class that has waited TRAFFIC_MAX_WAIT
+//  without a turn gets one ahead of the higher classes, so it is slowed but
+//  never starved. Within a class, endpoints take turns by deficit round
+//  robin, so a burst to one client can't hold up everyone else's updates.
+//  Each endpoint can also be paced by a token bucket, which caps its
+//  bandwidth and spreads large messages out instead of putting them on the
+//  wire back to back.
+//
+//  Each endpoint's queue for each class is bounded. When it is full, its
+//  oldest unreliable datagram is dropped to make room, since newer state
+//  supersedes it. Reliable datagrams are never dropped here; the reliable
+//  channel is already waiting on them. An endpoint that has had nothing
+//  queued for SEND_FLOW_IDLE and has no rate of its own is dropped with its
+//  counters, so endpoints that come and go don't pile up.
+//
+// =============================================================================
+
+#ifndef CHSENDSCHEDULER_H
+#define CHSENDSCHEDULER_H
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ChDatagramHeader.h"
+#include "ChPacketPool.h"
+#include "MessageCodes.h"
+
+// Datagrams one endpoint can have waiting in one class before the oldest are
+// dropped.
+#define SEND_QUEUE_LIMIT 1024
+// Bytes each endpoint may send per round robin turn.
+#define SEND_QUANTUM PACKET_SLAB_SIZE
+// Token bucket depth, in bytes: how much an endpoint can send at once after
+// being idle.
+#define SEND_BURST_SIZE (64 * 1024)
+// Bandwidth cap for endpoints without one of their own, in bytes per second.
+// 0 leaves them unpaced.
+#define SEND_DEFAULT_RATE 0
+// Longest a traffic class with something queued goes without a turn, in
+// milliseconds.
+#define TRAFFIC_MAX_WAIT 20
+// How long an endpoint goes with nothing queued before it is dropped, in
+// milliseconds.
+#define SEND_FLOW_IDLE 1000
+
+struct ChSendStats {
+    // Datagrams and bytes waiting to be sent right now
+    long depth;
+    long queuedBytes;
+    // Most datagrams that have been waiting at once
+    long peakDepth;
+    // Datagrams and bytes handed to the sender
+    long sent;
+    long sentBytes;
+    // Datagrams dropped because the queue was full
+    long dropped;
+    // Messages dropped before they were queued because they were too large
+    // to fragment
+    long oversized;
+    // Depth and drops split by traffic class
+    long depthByClass[TRAFFIC_CLASSES];
+    long droppedByClass[TRAFFIC_CLASSES];
+    // Current cap in bytes per second, 0 if unpaced
+    double rate;
+};
+
+class ChSendScheduler {
+public:
+    typedef std::pair<boost::asio::ip::udp::endpoint, ChPacketHandle> Datagram;
+
+    ChSendScheduler();
+
+    // Queues a serialized datagram for endpoint in a traffic class, dropping
+    // the oldest unreliable datagram in that queue if it is full. Wakes a
+    // waiting sender.
+    void enqueue(const boost::asio::ip::udp::endpoint& endpoint, ChPacketHandle&& datagram,
+                 int trafficClass = TRAFFIC_BULK);
+
+    // Appends up to max datagrams, highest class first, taking turns between
+    // endpoints and only as many as their buckets allow. Returns how long
+    // until a paced datagram left waiting can go, or duration::max() if none
+    // is.
+    std::chrono::steady_clock::duration collect(std::vector<Datagram>& batch, size_t max);
+
+    // Blocks until a datagram is queued after the last collect, or timeout
+    // runs out. A timeout of duration::max() waits indefinitely. Throws
+    // PredicateException once the scheduler has been dumped.
+    void waitFor(std::chrono::steady_clock::duration timeout);
+
+    // Wakes a waiting sender as though a datagram were queued, for callers
+    // holding datagrams of their own back until it is ready for them.
+    void wake();
+
+    // Caps endpoint's bandwidth at bytesPerSecond, or uncaps it with 0.
+    void setRate(const boost::asio::ip::udp::endpoint& endpoint, double bytesPerSecond,
+                 size_t burst = SEND_BURST_SIZE);
+
+    // Cap for every endpoint that doesn't have one of its own.
+    void setDefaultRate(double bytesPerSecond, size_t burst = SEND_BURST_SIZE);
+
+    // Counts a message for endpoint that was too large to fragment, so was
+    // never queued.
+    void countOversized(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Drops endpoint's flow, along with anything still queued for it and its
+    // rate.
+    void remove(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Counters for one endpoint; all zero if nothing was queued for it, or
+    // it was dropped for being idle.
+    ChSendStats stats(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // True when nothing is waiting for any endpoint.
+    bool empty();
+
+    // Wakes a waiting sender and makes every further wait throw.
+    void dumpThreads();
+
+private:
+    struct Flow {
+        Flow();
+
+        boost::asio::ip::udp::endpoint endpoint;
+        std::deque<ChPacketHandle> queues[TRAFFIC_CLASSES];
+        // Bytes this endpoint may still send in its current turn in each class
+        long deficits[TRAFFIC_CLASSES];
+        // Whether it is in each class's round robin
+        bool active[TRAFFIC_CLASSES];
+
+        // Token bucket; a rate of 0 is unpaced
+        bool ownRate;
+        double rate;
+        double burst;
+        double tokens;
+        std::chrono::steady_clock::time_point refilled;
+
+        // When the endpoint last had something queued
+        std::chrono::steady_clock::time_point lastQueued;
+
+        ChSendStats stats;
+    };
+
+    // Tops up a flow's bucket for the time since it was last topped up.
+    static void refill(Flow& flow, std::chrono::steady_clock::time_point now);
+
+    // Gives the next endpoint in trafficClass's round robin that its bucket
+    // lets send its turn. Returns false if every one is waiting on its
+    // bucket, lowering wait to when the first can go.
+    bool serveTurn(int trafficClass, std::vector<Datagram>& batch, size_t max,
+                   std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration& wait);
+
+    // Flow for endpoint, created with the default rate if it doesn't exist.
+    Flow& flowFor(const boost::asio::ip::udp::endpoint& endpoint);
+
+    // Drops every flow that has been idle for SEND_FLOW_IDLE, has no rate of
+    // its own and whose bucket has filled back up.
+    void dropIdle(std::chrono::steady_clock::time_point now);
+
+    std::mutex schedulerMutex;
+    std::condition_variable queued;
+    std::map<boost::asio::ip::udp::endpoint, Flow> flows;
+    // Round robin order of endpoints with something waiting, per class
+    std::deque<Flow*> active[TRAFFIC_CLASSES];
+    // When each class last had a turn, or started waiting for one
+    std::chrono::steady_clock::time_point lastServed[TRAFFIC_CLASSES];
+    // When collect last looked for idle flows
+    std::chrono::steady_clock::time_point lastDropped;
+    long totalDepth;
+    // Set by enqueue, cleared by collect
+    bool fresh;
+    bool dump;
+    double defaultRate;
+    double defaultBurst;
+};
+
+#endif // CHSENDSCHEDULER_H
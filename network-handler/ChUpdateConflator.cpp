@@ -0,0 +1,88 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Implementation of ChUpdateConflator.
+//
+// =============================================================================
+
+#include "ChUpdateConflator.h"
+
+#include <limits>
+
+ChUpdateConflator::ChUpdateConflator() {
+    pendingCount = 0;
+    supersededCount = 0;
+}
+
+bool ChUpdateConflator::offer(const Key& key, double time, const boost::asio::ip::udp::endpoint& endpoint,
+                              std::shared_ptr<google::protobuf::Message> message) {
+    std::lock_guard<std::mutex> lock(conflatorMutex);
+    auto found = elements.find(key);
+    if (found == elements.end()) {
+        Element& element = elements[key];
+        element.update = Update(endpoint, message);
+        element.time = time;
+        element.pending = true;
+        pendingCount++;
+        return true;
+    }
+    Element& element = found->second;
+    // Older than what is pending or already applied
+    if (time < element.time) {
+        supersededCount++;
+        return false;
+    }
+    element.update = Update(endpoint, message);
+    element.time = time;
+    if (element.pending) {
+        supersededCount++;
+        return false;
+    }
+    element.pending = true;
+    pendingCount++;
+    return true;
+}
+
+ChUpdateConflator::Update ChUpdateConflator::take(const Key& key) {
+    std::lock_guard<std::mutex> lock(conflatorMutex);
+    auto found = elements.find(key);
+    if (found == elements.end() || !found->second.pending) return Update();
+    Element& element = found->second;
+    element.pending = false;
+    pendingCount--;
+    // The time stays behind so later stragglers are still recognized
+    Update update = element.update;
+    element.update = Update();
+    return update;
+}
+
+void ChUpdateConflator::forget(int connectionNumber) {
+    std::lock_guard<std::mutex> lock(conflatorMutex);
+    auto first = elements.lower_bound(Key(connectionNumber, std::numeric_limits<int>::min()));
+    auto last = elements.upper_bound(Key(connectionNumber, std::numeric_limits<int>::max()));
+    for (auto element = first; element != last; element++) {
+        if (element->second.pending) pendingCount--;
+    }
+    elements.erase(first, last);
+}
+
+long ChUpdateConflator::superseded() {
+    std::lock_guard<std::mutex> lock(conflatorMutex);
+    return supersededCount;
+}
+
+size_t ChUpdateConflator::pending() {
+    std::lock_guard<std::mutex> lock(conflatorMutex);
+    return pendingCount;
+}
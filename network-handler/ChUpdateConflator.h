@@ -0,0 +1,76 @@
+// =============================================================================
+// PROJECT CHRONO - http://projectchrono.org
+//
+// Copyright (c) 2014 projectchrono.org
+// All right reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution and at
+// http://projectchrono.org/license-chrono.txt.
+//
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Inbound stage holding at most one pending update per world element, keyed
+//  by connection number and id number. An update offered while an older one
+//  for the same element is still pending replaces it, so when the world
+//  thread falls behind it applies only the newest state instead of every
+//  obsolete one in turn. Updates are ordered by their simulation time, so one
+//  that arrives out of order behind a newer state is discarded too.
+//
+// =============================================================================
+
+#ifndef CHUPDATECONFLATOR_H
+#define CHUPDATECONFLATOR_H
+
+#include <boost/asio.hpp>
+#include <google/protobuf/message.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+class ChUpdateConflator {
+public:
+    typedef std::pair<int, int> Key;
+    typedef std::pair<boost::asio::ip::udp::endpoint, std::shared_ptr<google::protobuf::Message>> Update;
+
+    ChUpdateConflator();
+
+    // Offers the update for key sent from endpoint at simulation time time.
+    // Returns true if nothing was pending for key, in which case the caller
+    // must arrange for take to be called. Returns false if the update was
+    // merged into one already pending, or discarded as older than the
+    // element's newest state.
+    bool offer(const Key& key, double time, const boost::asio::ip::udp::endpoint& endpoint,
+               std::shared_ptr<google::protobuf::Message> message);
+
+    // Removes and returns key's pending update. The message is null if
+    // nothing is pending.
+    Update take(const Key& key);
+
+    // Drops every element owned by connectionNumber, pending or not.
+    void forget(int connectionNumber);
+
+    // Updates replaced or discarded before reaching the world.
+    long superseded();
+
+    // Elements with an update waiting to be taken.
+    size_t pending();
+
+private:
+    struct Element {
+        Update update;
+        // Simulation time of the pending update, or of the last one taken
+        double time;
+        bool pending;
+    };
+
+    std::mutex conflatorMutex;
+    std::map<Key, Element> elements;
+    size_t pendingCount;
+    long supersededCount;
+};
+
+#endif // CHUPDATECONFLATOR_H
@@ -0,0 +1,1443 @@
+// =============================================================================
+// Authors: Dylan Hatch
+// =============================================================================
+//
+//	Benchmarks for the network-handler hot paths. Run with no arguments to run
+//  every benchmark, or pass the name of a single benchmark to run only that one.
+//
+// =============================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ChNetworkHandler.h"
+#include "ChCompactVehicles.h"
+#include "ChPacketCompressor.h"
+#include "ChRingQueue.h"
+#include "ChSafeQueue.h"
+#include "ChUpdateConflator.h"
+#include "VehicleWheels.h"
+
+#define QUEUE_BENCH_ITEMS 1000000
+#define SOCKET_BENCH_PORT 8090
+#define SOCKET_BENCH_SECONDS 2.0
+#define LATENCY_BENCH_SAMPLES 2000
+#define LATENCY_BENCH_INTERVAL_US 500
+#define REACTOR_BENCH_FLOODERS 2
+#define REACTOR_BENCH_PAYLOAD 300
+#define SHARD_BENCH_CLIENTS 8
+#define PARSE_BENCH_ITERATIONS 20000
+#define PARSE_BENCH_VEHICLES 20
+#define CONNECT_BENCH_ROUNDS 3
+#define CLASS_BENCH_RATE (4 * 1024 * 1024)
+#define CLASS_BENCH_DSRC_PER_SECOND 10000
+#define CLASS_BENCH_DSRC_PAYLOAD 1000
+#define MAILBOX_BENCH_RATE (100 * 1024)
+#define CONFLATE_BENCH_VEHICLES 10
+#define CONFLATE_BENCH_TASK_US 200
+#define SNAPSHOT_BENCH_SEND_RATE 100
+#define SNAPSHOT_BENCH_TICK 60
+#define CACHE_BENCH_CLIENTS 64
+#define CACHE_BENCH_TICKS 240
+#define WORLD_BENCH_OPERATIONS 200000
+#define WORLD_BENCH_PER_CONNECTION 10
+#define DELTA_BENCH_VEHICLES 64
+#define DELTA_BENCH_TICKS 120
+#define COMPACT_BENCH_VEHICLES 100000
+#define WHEEL_BENCH_VEHICLES 100000
+#define COMPRESSION_BENCH_VEHICLES 16
+#define COMPRESSION_BENCH_TICKS 240
+#define COMPRESSION_BENCH_ROUNDS 20
+
+typedef std::chrono::steady_clock benchClock;
+
+double secondsSince(benchClock::time_point start) {
+    return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
+// CPU time consumed by the calling thread, in seconds.
+double threadCpuSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Bare handler that exposes the socket paths so they can be driven directly.
+class BenchHandler : public ChNetworkHandler {
+public:
+    BenchHandler(unsigned short portNumber, unsigned int batch) : ChNetworkHandler() {
+        std::unique_lock<std::mutex> lock(socketMutex);
+        socket.open(boost::asio::ip::udp::v4());
+        socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), portNumber));
+        socket.set_option(boost::asio::socket_base::receive_buffer_size(8 * 1024 * 1024));
+        socket.non_blocking(true);
+        setBatchSize(batch);
+        lock.unlock();
+        initVar.notify_all();
+    }
+
+    void beginListen() {}
+    void beginSend() {}
+    void stop() { shutdown = true; }
+
+    // Nothing sent here is reliable, so there is never anything to acknowledge
+    void queueDatagram(const boost::asio::ip::udp::endpoint&, ChPacketHandle&&) {}
+    bool compressesFor(const boost::asio::ip::udp::endpoint&) { return false; }
+    void loseEndpoint(const boost::asio::ip::udp::endpoint&) {}
+
+    // Completes a server's handshake from this handler's socket, since the
+    // server drops anything else from endpoints that haven't.
+    bool connect(const boost::asio::ip::udp::endpoint& server) {
+        char request[HANDSHAKE_DATAGRAM_SIZE];
+        char reply[HANDSHAKE_DATAGRAM_SIZE];
+        uint64_t cookie = 0;
+        for (int attempt = 0; attempt < HANDSHAKE_ATTEMPTS; attempt++) {
+            writeHandshake(request, CONNECTION_REQUEST, cookie);
+            boost::system::error_code error;
+            socket.send_to(boost::asio::buffer(request, sizeof(request)), server, 0, error);
+            if (!waitReadable(socket, HANDSHAKE_TIMEOUT)) continue;
+            boost::asio::ip::udp::endpoint from;
+            size_t received = socket.receive_from(boost::asio::buffer(reply, sizeof(reply)), from, 0, error);
+            uint8_t messageType;
+            uint64_t value;
+            if (error || !readHandshake(reply, received, messageType, value)) continue;
+            if (messageType == CONNECTION_ACCEPT) return true;
+            if (messageType == CONNECTION_CHALLENGE) cookie = value;
+        }
+        return false;
+    }
+
+    using ChNetworkHandler::sendMessages;
+    using ChNetworkHandler::receiveMessages;
+    using ChNetworkHandler::serializeMessage;
+    using ChNetworkHandler::parseOnArena;
+
+    // Send and receive the way the handler used to, taking turns on socketMutex.
+    void sendMessagesLocked(std::vector<DatagramPair>& messages) {
+        std::lock_guard<std::mutex> lock(socketMutex);
+        sendMessages(messages);
+    }
+    size_t receiveMessagesLocked(std::vector<DatagramPair>& messages) {
+        std::lock_guard<std::mutex> lock(socketMutex);
+        return receiveMessages(messages);
+    }
+};
+
+// Returns the value below which the given fraction of the sorted samples fall.
+double percentile(std::vector<double>& sorted, double fraction) {
+    size_t index = std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+    return sorted[index];
+}
+
+// Pushes QUEUE_BENCH_ITEMS shared_ptrs through the queue from the given number
+// of producer threads into a single consumer, like the handler queues.
+template<class Queue> double benchQueue(Queue& queue, int producers) {
+    auto payload = std::make_shared<uint64_t>(0);
+    int perProducer = QUEUE_BENCH_ITEMS / producers;
+    int total = perProducer * producers;
+
+    auto start = benchClock::now();
+    std::thread consumer([&] {
+        for (int i = 0; i < total; i++) {
+            auto item = queue.dequeue();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < perProducer; i++) {
+                queue.enqueue(payload);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    consumer.join();
+    return total / secondsSince(start);
+}
+
+void queueBenchmark() {
+    std::cout << "Queue benchmark (" << QUEUE_BENCH_ITEMS << " items, 1 consumer)" << std::endl;
+    std::cout << std::setw(10) << "producers" << std::setw(18) << "ChSafeQueue op/s" << std::setw(18)
+              << "ChRingQueue op/s" << std::setw(10) << "speedup" << std::endl;
+    for (int producers = 1; producers <= 8; producers *= 2) {
+        ChSafeQueue<std::shared_ptr<uint64_t>> safeQueue;
+        ChRingQueue<std::shared_ptr<uint64_t>> ringQueue;
+        double safeRate = benchQueue(safeQueue, producers);
+        double ringRate = benchQueue(ringQueue, producers);
+        std::cout << std::setw(10) << producers << std::setw(18) << (long)safeRate << std::setw(18) << (long)ringRate
+                  << std::setw(9) << std::setprecision(3) << ringRate / safeRate << "x" << std::endl;
+    }
+}
+
+// CPU time consumed by every thread in the process, in seconds.
+double processCpuSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Blasts vehicle-sized datagrams over loopback for a fixed time and reports
+// how many packets each side moves per second of its own CPU time.
+void batchBenchmark() {
+    std::cout << "Loopback batch benchmark (" << VEHICLE_MESSAGE_SIZE << " byte datagrams, " << SOCKET_BENCH_SECONDS
+              << " s per row)" << std::endl;
+    std::cout << std::setw(8) << "batch" << std::setw(14) << "sent/s" << std::setw(14) << "received/s" << std::setw(20)
+              << "send pkts/core-s" << std::setw(20) << "recv pkts/core-s" << std::endl;
+    unsigned int batches[] = {1, 8, 32, 64};
+    for (unsigned int batch : batches) {
+        BenchHandler receiver(SOCKET_BENCH_PORT, batch);
+        BenchHandler sender(0, batch);
+        boost::asio::ip::udp::endpoint target(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT);
+
+        std::atomic<bool> sending(true);
+        long sent = 0, received = 0;
+        double sendCpu = 0, receiveCpu = 0;
+        std::thread listener([&] {
+            std::vector<DatagramPair> messages;
+            double cpuStart = threadCpuSeconds();
+            while (sending) {
+                messages.clear();
+                received += receiver.receiveMessages(messages);
+            }
+            receiveCpu = threadCpuSeconds() - cpuStart;
+        });
+
+        std::vector<DatagramPair> messages;
+        for (unsigned int i = 0; i < batch; i++) {
+            ChPacketHandle buffer = sender.packetPool().acquire(VEHICLE_MESSAGE_SIZE);
+            buffer.resize(VEHICLE_MESSAGE_SIZE);
+            messages.push_back(DatagramPair(target, buffer));
+        }
+        auto start = benchClock::now();
+        double cpuStart = threadCpuSeconds();
+        while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+            sender.sendMessages(messages);
+            sent += messages.size();
+        }
+        sendCpu = threadCpuSeconds() - cpuStart;
+        double elapsed = secondsSince(start);
+        sending = false;
+        receiver.stop();
+        listener.join();
+
+        std::cout << std::setw(8) << batch << std::setw(14) << (long)(sent / elapsed) << std::setw(14)
+                  << (long)(received / elapsed) << std::setw(20) << (long)(sent / sendCpu) << std::setw(20)
+                  << (long)(received / receiveCpu) << std::endl;
+    }
+}
+
+// Times how long one outbound world-sized packet takes to leave the socket
+// while the same socket is flooded with inbound vehicle updates, once with the
+// send and receive paths sharing socketMutex as they used to, and once full
+// duplex.
+void latencyBenchmark() {
+    std::cout << "Outbound latency under inbound flood (" << LATENCY_BENCH_SAMPLES << " sends, "
+              << LATENCY_BENCH_INTERVAL_US << " us apart)" << std::endl;
+    std::cout << std::setw(14) << "path" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12)
+              << "max us" << std::setw(14) << "received/s" << std::endl;
+    bool modes[] = {true, false};
+    for (bool shared : modes) {
+        BenchHandler server(SOCKET_BENCH_PORT, DEFAULT_BATCH_SIZE);
+        BenchHandler flooder(0, DEFAULT_BATCH_SIZE);
+        boost::asio::ip::udp::endpoint serverEndpoint(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT);
+        boost::asio::ip::udp::endpoint clientEndpoint(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT + 1);
+
+        std::atomic<bool> running(true);
+        long received = 0;
+        std::thread listener([&] {
+            std::vector<DatagramPair> messages;
+            while (running) {
+                messages.clear();
+                received += shared ? server.receiveMessagesLocked(messages) : server.receiveMessages(messages);
+            }
+        });
+        std::thread flood([&] {
+            std::vector<DatagramPair> messages;
+            for (int i = 0; i < DEFAULT_BATCH_SIZE; i++) {
+                ChPacketHandle buffer = flooder.packetPool().acquire(VEHICLE_MESSAGE_SIZE);
+                buffer.resize(VEHICLE_MESSAGE_SIZE);
+                messages.push_back(DatagramPair(serverEndpoint, buffer));
+            }
+            while (running) flooder.sendMessages(messages);
+        });
+
+        // Nobody listens on the client port; loopback drops the packets once sent
+        std::vector<DatagramPair> world;
+        ChPacketHandle packet = server.packetPool().acquire(PACKET_SLAB_SIZE);
+        packet.resize(PACKET_SLAB_SIZE);
+        world.push_back(DatagramPair(clientEndpoint, packet));
+        std::vector<double> latencies;
+        auto start = benchClock::now();
+        for (int i = 0; i < LATENCY_BENCH_SAMPLES; i++) {
+            auto sendStart = benchClock::now();
+            if (shared) server.sendMessagesLocked(world);
+            else server.sendMessages(world);
+            latencies.push_back(secondsSince(sendStart) * 1e6);
+            std::this_thread::sleep_for(std::chrono::microseconds(LATENCY_BENCH_INTERVAL_US));
+        }
+        double elapsed = secondsSince(start);
+        running = false;
+        server.stop();
+        flooder.stop();
+        listener.join();
+        flood.join();
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::setw(14) << (shared ? "shared mutex" : "full duplex") << std::fixed << std::setprecision(1)
+                  << std::setw(12) << percentile(latencies, 0.5) << std::setw(12) << percentile(latencies, 0.99)
+                  << std::setw(12) << latencies.back() << std::setw(14) << (long)(received / elapsed) << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+std::string serverMode(unsigned int ioThreads) {
+    return ioThreads == THREADED_SERVER ? "threaded" : "async x" + std::to_string(ioThreads);
+}
+
+// Compares the threaded ChServerHandler against the asynchronous one: how much
+// CPU each burns with no traffic, and how many messages popMessage hands out
+// per second while several senders flood the server.
+void reactorBenchmark() {
+    World world;
+    ChRingQueue<std::function<void()>> worldQueue;
+    unsigned int modes[] = {THREADED_SERVER, 1, 2, 4, 8};
+
+    std::cout << "Idle server CPU (" << SOCKET_BENCH_SECONDS << " s, % of one core)" << std::endl;
+    std::cout << std::setw(10) << "mode" << std::setw(10) << "cpu %" << std::endl;
+    for (unsigned int ioThreads : modes) {
+        ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, ioThreads);
+        server.beginListen();
+        server.beginSend();
+        double cpuStart = processCpuSeconds();
+        auto start = benchClock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(SOCKET_BENCH_SECONDS));
+        double usage = (processCpuSeconds() - cpuStart) / secondsSince(start);
+        std::cout << std::setw(10) << serverMode(ioThreads) << std::setw(10) << std::fixed << std::setprecision(1)
+                  << usage * 100 << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    std::cout << "Server throughput (" << REACTOR_BENCH_FLOODERS << " senders, " << SOCKET_BENCH_SECONDS
+              << " s per row)" << std::endl;
+    std::cout << std::setw(10) << "mode" << std::setw(14) << "popped/s" << std::setw(16) << "popped/core-s"
+              << std::setw(12) << "dropped" << std::endl;
+    ChronoMessages::DSRCMessage message;
+    message.set_timestamp(0);
+    message.set_chtime(0);
+    message.set_idnumber(0);
+    message.mutable_vehiclepos()->set_x(0);
+    message.mutable_vehiclepos()->set_y(0);
+    message.mutable_vehiclepos()->set_z(0);
+    message.set_buffer(std::string(REACTOR_BENCH_PAYLOAD, 'x'));
+    for (unsigned int ioThreads : modes) {
+        ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, ioThreads);
+        server.beginListen();
+        server.beginSend();
+        boost::asio::ip::udp::endpoint target(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT);
+
+        std::atomic<bool> flooding(true);
+        std::vector<std::thread> flooders;
+        for (int f = 0; f < REACTOR_BENCH_FLOODERS; f++) {
+            flooders.emplace_back([&] {
+                BenchHandler flooder(0, DEFAULT_BATCH_SIZE);
+                flooder.connect(target);
+                std::vector<DatagramPair> messages;
+                for (int i = 0; i < DEFAULT_BATCH_SIZE; i++) {
+                    messages.push_back(DatagramPair(target, flooder.serializeMessage(DSRC_MESSAGE, message)));
+                }
+                while (flooding) flooder.sendMessages(messages);
+            });
+        }
+
+        // The flood keeps the receive queue busy, so popMessage never blocks for long
+        long popped = 0;
+        double cpuStart = processCpuSeconds();
+        auto start = benchClock::now();
+        while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+            server.popMessage();
+            popped++;
+        }
+        double elapsed = secondsSince(start);
+        double cpu = processCpuSeconds() - cpuStart;
+        flooding = false;
+        for (auto& flooder : flooders) flooder.join();
+
+        std::cout << std::setw(10) << serverMode(ioThreads) << std::setw(14) << (long)(popped / elapsed)
+                  << std::setw(16) << (long)(popped / cpu) << std::setw(12) << server.droppedMessages() << std::endl;
+    }
+}
+
+// Loads a sharded server from SHARD_BENCH_CLIENTS clients, each on its own
+// port and numbering its messages, and checks that every client's messages
+// still pop in order while throughput grows with the shard count.
+void shardBenchmark() {
+    World world;
+    ChRingQueue<std::function<void()>> worldQueue;
+    std::cout << "Sharded listeners (" << SHARD_BENCH_CLIENTS << " clients, " << SOCKET_BENCH_SECONDS << " s per row)"
+              << std::endl;
+    std::cout << std::setw(8) << "shards" << std::setw(14) << "popped/s" << std::setw(14) << "reordered" << std::endl;
+    unsigned int shardCounts[] = {1, 2, 4};
+    for (unsigned int shards : shardCounts) {
+        ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, THREADED_SERVER, shards);
+        server.beginListen();
+        server.beginSend();
+        boost::asio::ip::udp::endpoint target(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT);
+
+        std::atomic<bool> flooding(true);
+        std::vector<std::thread> clients;
+        for (int c = 0; c < SHARD_BENCH_CLIENTS; c++) {
+            clients.emplace_back([&] {
+                BenchHandler client(0, DEFAULT_BATCH_SIZE);
+                client.connect(target);
+                ChronoMessages::DSRCMessage message;
+                message.set_timestamp(0);
+                message.set_chtime(0);
+                message.mutable_vehiclepos()->set_x(0);
+                message.mutable_vehiclepos()->set_y(0);
+                message.mutable_vehiclepos()->set_z(0);
+                message.set_buffer(std::string(REACTOR_BENCH_PAYLOAD, 'x'));
+                std::vector<DatagramPair> messages;
+                int sequence = 0;
+                while (flooding) {
+                    messages.clear();
+                    for (int i = 0; i < DEFAULT_BATCH_SIZE; i++) {
+                        message.set_idnumber(sequence++);
+                        messages.push_back(DatagramPair(target, client.serializeMessage(DSRC_MESSAGE, message)));
+                    }
+                    client.sendMessages(messages);
+                }
+            });
+        }
+
+        // Dropped datagrams only leave gaps; a lower number than last time means reordering
+        std::map<unsigned short, int> lastSequence;
+        long popped = 0, reordered = 0;
+        auto start = benchClock::now();
+        while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+            MessagePair recPair = server.popMessage();
+            int sequence = std::static_pointer_cast<ChronoMessages::DSRCMessage>(recPair.second)->idnumber();
+            auto last = lastSequence.find(recPair.first.port());
+            if (last != lastSequence.end() && sequence <= last->second) reordered++;
+            lastSequence[recPair.first.port()] = sequence;
+            popped++;
+        }
+        double elapsed = secondsSince(start);
+        flooding = false;
+        for (auto& client : clients) client.join();
+
+        std::cout << std::setw(8) << shards << std::setw(14) << (long)(popped / elapsed) << std::setw(14) << reordered
+                  << std::endl;
+    }
+}
+
+static void fillVector(ChronoMessages::MVector* vector, double value) {
+    vector->set_x(value);
+    vector->set_y(value);
+    vector->set_z(value);
+}
+
+static void fillQuaternion(ChronoMessages::MQuaternion* quaternion) {
+    quaternion->set_e0(1);
+    quaternion->set_e1(0);
+    quaternion->set_e2(0);
+    quaternion->set_e3(0);
+}
+
+static void fillVehicle(ChronoMessages::VehicleMessage* vehicle, int idNumber, int wheels = 4) {
+    vehicle->set_timestamp(0);
+    vehicle->set_connectionnumber(0);
+    vehicle->set_idnumber(idNumber);
+    vehicle->set_chtime(idNumber);
+    vehicle->set_speed(10);
+    fillVector(vehicle->mutable_chassiscom(), idNumber);
+    fillQuaternion(vehicle->mutable_chassisrot());
+    resizeWheels(vehicle, wheels);
+    double* position = vehicle->mutable_wheelpositions()->mutable_data();
+    double* rotation = vehicle->mutable_wheelrotations()->mutable_data();
+    for (int wheel = 0; wheel < wheels; wheel++) {
+        for (int axis = 0; axis < WHEEL_POSITION_VALUES; axis++) *position++ = idNumber + 1 + wheel;
+        *rotation++ = 1;
+        for (int axis = 1; axis < WHEEL_ROTATION_VALUES; axis++) *rotation++ = 0;
+    }
+}
+
+void unpackHeap(std::shared_ptr<ChronoMessages::VehicleMessage>& vehicle,
+                std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    out.push_back(vehicle);
+}
+
+void unpackHeap(std::shared_ptr<ChronoMessages::MessagePacket>& packet,
+                std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    for (int i = 0; i < packet->vehiclemessages_size(); i++) {
+        auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+        vehicle->CopyFrom(packet->vehiclemessages(i));
+        out.push_back(vehicle);
+    }
+}
+
+void unpackArena(std::shared_ptr<ChronoMessages::VehicleMessage>& vehicle,
+                 std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    out.push_back(vehicle);
+}
+
+void unpackArena(std::shared_ptr<ChronoMessages::MessagePacket>& packet,
+                 std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    for (int i = 0; i < packet->vehiclemessages_size(); i++) {
+        out.push_back(std::shared_ptr<google::protobuf::Message>(packet, packet->mutable_vehiclemessages(i)));
+    }
+}
+
+// Parses and unpacks the same bytes the way the handlers used to: through an
+// istream onto the heap, copying every vehicle out of a packet.
+template<class T> double parseHeap(std::string& bytes, std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    auto start = benchClock::now();
+    for (int i = 0; i < PARSE_BENCH_ITERATIONS; i++) {
+        boost::asio::streambuf streambuf;
+        streambuf.sputn(bytes.data(), bytes.size());
+        std::istream stream(&streambuf);
+        auto message = std::make_shared<T>();
+        message->ParseFromIstream(&stream);
+        unpackHeap(message, out);
+        out.clear();
+    }
+    return PARSE_BENCH_ITERATIONS / secondsSince(start);
+}
+
+template<class T> double parseArena(ChArenaPool& pool, std::string& bytes,
+                                    std::vector<std::shared_ptr<google::protobuf::Message>>& out) {
+    boost::asio::ip::udp::endpoint endpoint;
+    auto start = benchClock::now();
+    for (int i = 0; i < PARSE_BENCH_ITERATIONS; i++) {
+        auto arena = pool.acquire();
+        auto message = BenchHandler::parseOnArena<T>(endpoint, bytes.data(), bytes.size(), arena);
+        unpackArena(message, out);
+        out.clear();
+    }
+    return PARSE_BENCH_ITERATIONS / secondsSince(start);
+}
+
+// Compares the old istream, heap and copy path for received messages against
+// parsing straight from the buffer onto a pooled arena.
+void parseBenchmark() {
+    ChronoMessages::VehicleMessage vehicle;
+    fillVehicle(&vehicle, 0);
+    ChronoMessages::MessagePacket packet;
+    packet.set_connectionnumber(0);
+    for (int i = 0; i < PARSE_BENCH_VEHICLES; i++) fillVehicle(packet.add_vehiclemessages(), i);
+    std::string vehicleBytes = vehicle.SerializeAsString();
+    std::string packetBytes = packet.SerializeAsString();
+
+    ChArenaPool pool;
+    std::vector<std::shared_ptr<google::protobuf::Message>> out;
+    std::cout << "Message parsing (" << PARSE_BENCH_ITERATIONS << " messages per row)" << std::endl;
+    std::cout << std::setw(22) << "message" << std::setw(14) << "heap msg/s" << std::setw(14) << "arena msg/s"
+              << std::setw(10) << "speedup" << std::endl;
+    double heapRate = parseHeap<ChronoMessages::VehicleMessage>(vehicleBytes, out);
+    double arenaRate = parseArena<ChronoMessages::VehicleMessage>(pool, vehicleBytes, out);
+    std::cout << std::setw(22) << "VehicleMessage" << std::setw(14) << (long)heapRate << std::setw(14)
+              << (long)arenaRate << std::setw(9) << std::setprecision(3) << arenaRate / heapRate << "x" << std::endl;
+    heapRate = parseHeap<ChronoMessages::MessagePacket>(packetBytes, out);
+    arenaRate = parseArena<ChronoMessages::MessagePacket>(pool, packetBytes, out);
+    std::cout << std::setw(22) << ("MessagePacket x" + std::to_string(PARSE_BENCH_VEHICLES)) << std::setw(14)
+              << (long)heapRate << std::setw(14) << (long)arenaRate << std::setw(9) << std::setprecision(3)
+              << arenaRate / heapRate << "x" << std::endl;
+    std::cout << "arena pool hits " << pool.hits() << ", misses " << pool.misses() << std::endl;
+}
+
+// Starts N clients at once against a fresh server and times how long the
+// whole storm takes to connect, and how long each client waited.
+void connectBenchmark() {
+    World world;
+    ChRingQueue<std::function<void()>> worldQueue;
+    unsigned int modes[] = {THREADED_SERVER, 2};
+    int storms[] = {10, 50, 200};
+
+    std::cout << "Connection storm (best of " << CONNECT_BENCH_ROUNDS << " rounds)" << std::endl;
+    std::cout << std::setw(10) << "mode" << std::setw(10) << "clients" << std::setw(12) << "total ms"
+              << std::setw(12) << "mean ms" << std::setw(12) << "p99 ms" << std::setw(10) << "failed" << std::endl;
+    for (unsigned int ioThreads : modes) {
+        for (int clients : storms) {
+            double bestTotal = 0;
+            std::vector<double> bestWaits;
+            int bestFailed = 0;
+            for (int round = 0; round < CONNECT_BENCH_ROUNDS; round++) {
+                ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, ioThreads);
+                server.beginListen();
+                server.beginSend();
+
+                std::atomic<bool> go(false);
+                std::atomic<int> failed(0);
+                std::vector<double> waits(clients);
+                std::vector<std::unique_ptr<ChClientHandler>> handlers(clients);
+                std::vector<std::thread> threads;
+                for (int c = 0; c < clients; c++) {
+                    threads.emplace_back([&, c] {
+                        while (!go) std::this_thread::yield();
+                        auto start = benchClock::now();
+                        try {
+                            handlers[c].reset(new ChClientHandler("localhost", std::to_string(SOCKET_BENCH_PORT)));
+                        } catch (ConnectionException& ex) {
+                            failed++;
+                        }
+                        waits[c] = secondsSince(start) * 1000;
+                    });
+                }
+                auto start = benchClock::now();
+                go = true;
+                for (auto& thread : threads) thread.join();
+                double total = secondsSince(start) * 1000;
+                if (round == 0 || total < bestTotal) {
+                    bestTotal = total;
+                    bestWaits = waits;
+                    bestFailed = failed;
+                }
+            }
+            std::sort(bestWaits.begin(), bestWaits.end());
+            double mean = 0;
+            for (double wait : bestWaits) mean += wait;
+            mean /= clients;
+            std::cout << std::setw(10) << serverMode(ioThreads) << std::setw(10) << clients << std::fixed
+                      << std::setprecision(2) << std::setw(12) << bestTotal << std::setw(12) << mean << std::setw(12)
+                      << percentile(bestWaits, 0.99) << std::setw(10) << bestFailed << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+}
+
+// Microseconds since start, small enough for the int32 timestamp fields.
+static int32_t benchMicros(benchClock::time_point start) {
+    return (int32_t)std::chrono::duration_cast<std::chrono::microseconds>(benchClock::now() - start).count();
+}
+
+// Pushes a DSRC flood, a vehicle update every millisecond and a control
+// message every 10 ms from a server to one client paced well below the
+// offered load, and times how long each class takes to pop. Runs once
+// with the default traffic classes and once with every message in one class,
+// the way every message used to share one queue.
+void classBenchmark() {
+    World world;
+    ChRingQueue<std::function<void()>> worldQueue;
+    std::string classNames[] = {"control", "state", "dsrc"};
+    uint8_t classCodes[] = {CONTROL_MESSAGE, VEHICLE_MESSAGE, DSRC_MESSAGE};
+    bool modes[] = {true, false};
+
+    std::cout << "Latency by traffic class (" << CLASS_BENCH_DSRC_PER_SECOND << " DSRC/s paced to "
+              << CLASS_BENCH_RATE / 1024 << " kB/s, " << SOCKET_BENCH_SECONDS << " s per row)" << std::endl;
+    std::cout << std::setw(10) << "queues" << std::setw(10) << "class" << std::setw(12) << "p50 ms" << std::setw(12)
+              << "p99 ms" << std::setw(12) << "max ms" << std::setw(10) << "popped" << std::setw(10) << "dropped"
+              << std::endl;
+    for (bool classed : modes) {
+        ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, THREADED_SERVER);
+        if (!classed) {
+            for (uint8_t code : classCodes) server.setTrafficClass(code, TRAFFIC_BULK);
+        }
+        server.beginListen();
+        server.beginSend();
+
+        // A real client on the other end, so reliable control messages are acknowledged
+        ChClientHandler client("localhost", std::to_string(SOCKET_BENCH_PORT));
+        client.beginListen();
+        client.beginSend();
+        ChronoMessages::VehicleMessage hello;
+        fillVehicle(&hello, 0);
+        client.pushMessage(hello);
+        boost::asio::ip::udp::endpoint target = server.popMessage().first;
+        server.setSendRate(target, CLASS_BENCH_RATE);
+
+        // Each message carries the time it was pushed, so the consumers need nothing shared
+        auto start = benchClock::now();
+        std::vector<double> latencies[3];
+        std::atomic<bool> receiving(true);
+        std::thread simConsumer([&] {
+            while (receiving) {
+                std::shared_ptr<google::protobuf::Message> message = client.popSimMessage();
+                int32_t now = benchMicros(start);
+                if (!receiving) break;
+                auto control = std::dynamic_pointer_cast<ChronoMessages::ControlMessage>(message);
+                auto vehicle = std::dynamic_pointer_cast<ChronoMessages::VehicleMessage>(message);
+                if (control) latencies[0].push_back((now - control->connectionnumber()) / 1000.0);
+                if (vehicle) latencies[1].push_back((now - vehicle->timestamp()) / 1000.0);
+            }
+        });
+        std::thread DSRCConsumer([&] {
+            while (receiving) {
+                std::shared_ptr<ChronoMessages::DSRCMessage> message = client.popDSRCMessage();
+                int32_t now = benchMicros(start);
+                if (!receiving) break;
+                latencies[2].push_back((now - message->timestamp()) / 1000.0);
+            }
+        });
+
+        ChronoMessages::ControlMessage control;
+        control.set_action(ChronoMessages::ControlMessage::REMOVE_VEHICLE);
+        control.set_idnumber(0);
+        ChronoMessages::VehicleMessage vehicle;
+        fillVehicle(&vehicle, 0);
+        ChronoMessages::DSRCMessage dsrc;
+        dsrc.set_chtime(0);
+        dsrc.set_idnumber(0);
+        dsrc.mutable_vehiclepos()->set_x(0);
+        dsrc.mutable_vehiclepos()->set_y(0);
+        dsrc.mutable_vehiclepos()->set_z(0);
+        dsrc.set_buffer(std::string(CLASS_BENCH_DSRC_PAYLOAD, 'x'));
+        long pushed[3] = {0, 0, 0};
+        while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+            double elapsed = secondsSince(start);
+            while (pushed[2] < elapsed * CLASS_BENCH_DSRC_PER_SECOND) {
+                dsrc.set_timestamp(benchMicros(start));
+                server.pushMessage(target, dsrc);
+                pushed[2]++;
+            }
+            if (pushed[1] < elapsed * 1000) {
+                vehicle.set_timestamp(benchMicros(start));
+                server.pushMessage(target, vehicle);
+                pushed[1]++;
+            }
+            if (pushed[0] < elapsed * 100) {
+                control.set_connectionnumber(benchMicros(start));
+                server.pushMessage(target, control);
+                pushed[0]++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        // Let the queues drain, then wake the consumers with one more of each
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        ChSendStats stats = server.sendStats(target);
+        receiving = false;
+        server.pushMessage(target, vehicle);
+        server.pushMessage(target, dsrc);
+        simConsumer.join();
+        DSRCConsumer.join();
+
+        for (int c = 0; c < 3; c++) {
+            std::vector<double>& sorted = latencies[c];
+            std::sort(sorted.begin(), sorted.end());
+            if (sorted.empty()) sorted.push_back(0);
+            long dropped = classed ? stats.droppedByClass[server.trafficClass(classCodes[c])] : 0;
+            std::cout << std::setw(10) << (classed ? "classes" : "single") << std::setw(10) << classNames[c]
+                      << std::fixed << std::setprecision(2) << std::setw(12) << percentile(sorted, 0.5)
+                      << std::setw(12) << percentile(sorted, 0.99) << std::setw(12) << sorted.back() << std::setw(10)
+                      << latencies[c].size() << std::setw(10) << dropped << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+        if (!classed) std::cout << "single queue dropped " << stats.droppedByClass[TRAFFIC_BULK] << std::endl;
+    }
+}
+
+// Client whose sends are paced, to stand in for a congested link.
+class PacedClient : public ChClientHandler {
+public:
+    PacedClient(std::string hostname, std::string port, double bytesPerSecond) : ChClientHandler(hostname, port) {
+        sendScheduler.setDefaultRate(bytesPerSecond, PACKET_SLAB_SIZE);
+    }
+};
+
+// Pushes a vehicle state every millisecond, like the vehicle clients do at
+// send_steps = 1, through a client paced to a third of that, and measures
+// how old each state is when the server pops it.
+void mailboxBenchmark() {
+    World world;
+    ChRingQueue<std::function<void()>> worldQueue;
+    ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT, THREADED_SERVER);
+    server.beginListen();
+    server.beginSend();
+    PacedClient client("localhost", std::to_string(SOCKET_BENCH_PORT), MAILBOX_BENCH_RATE);
+    client.beginListen();
+    client.beginSend();
+
+    // Each state carries the time it was pushed; idnumber -1 ends the run
+    auto start = benchClock::now();
+    std::vector<double> staleness;
+    std::thread consumer([&] {
+        while (true) {
+            auto vehicle = std::dynamic_pointer_cast<ChronoMessages::VehicleMessage>(server.popMessage().second);
+            if (!vehicle) continue;
+            if (vehicle->idnumber() < 0) break;
+            staleness.push_back((benchMicros(start) - vehicle->timestamp()) / 1000.0);
+        }
+    });
+
+    ChronoMessages::VehicleMessage vehicle;
+    fillVehicle(&vehicle, 0);
+    long pushed = 0;
+    while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+        if (pushed < secondsSince(start) * 1000) {
+            vehicle.set_timestamp(benchMicros(start));
+            client.pushMessage(vehicle);
+            pushed++;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    vehicle.set_idnumber(-1);
+    client.pushMessage(vehicle);
+    consumer.join();
+
+    std::sort(staleness.begin(), staleness.end());
+    if (staleness.empty()) staleness.push_back(0);
+    std::cout << "Vehicle state staleness (1 kHz pushed, paced to " << MAILBOX_BENCH_RATE / 1024 << " kB/s, "
+              << SOCKET_BENCH_SECONDS << " s)" << std::endl;
+    std::cout << std::setw(10) << "pushed" << std::setw(10) << "popped" << std::setw(12) << "superseded"
+              << std::setw(12) << "p50 ms" << std::setw(12) << "p99 ms" << std::setw(12) << "max ms" << std::endl;
+    std::cout << std::setw(10) << pushed << std::setw(10) << staleness.size() << std::setw(12)
+              << client.supersededStates() << std::fixed << std::setprecision(2) << std::setw(12)
+              << percentile(staleness, 0.5) << std::setw(12) << percentile(staleness, 0.99) << std::setw(12)
+              << staleness.back() << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Feeds CONFLATE_BENCH_VEHICLES vehicles' updates at 1 kHz each into a world
+// thread that takes CONFLATE_BENCH_TASK_US per task, half the rate they
+// arrive at, once with a task per update as CAVE-Server used to queue them
+// and once through a ChUpdateConflator. Reports how many updates reach the
+// world and how old they are when they do.
+void conflateBenchmark() {
+    std::cout << "World updates with a slow world thread (" << CONFLATE_BENCH_VEHICLES << " vehicles at 1 kHz, "
+              << CONFLATE_BENCH_TASK_US << " us per task, " << SOCKET_BENCH_SECONDS << " s)" << std::endl;
+    std::cout << std::setw(12) << "path" << std::setw(10) << "offered" << std::setw(10) << "applied"
+              << std::setw(12) << "superseded" << std::setw(12) << "p50 ms" << std::setw(12) << "p99 ms" << std::endl;
+    bool modes[] = {false, true};
+    for (bool conflate : modes) {
+        ChRingQueue<std::function<void()>> worldQueue;
+        ChUpdateConflator conflator;
+        boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), SOCKET_BENCH_PORT);
+        // Stands in for the world's element table; the busy wait stands in for the rest of the world's work
+        std::map<ChUpdateConflator::Key, std::shared_ptr<google::protobuf::Message>> elements;
+
+        // Each update carries the time it arrived; a negative id ends the run
+        auto start = benchClock::now();
+        std::vector<double> staleness;
+        std::atomic<bool> done(false);
+        std::thread worldThread([&] {
+            while (!done) worldQueue.dequeue()();
+        });
+        auto apply = [&](std::shared_ptr<ChronoMessages::VehicleMessage> vehicle) {
+            if (vehicle->idnumber() < 0) {
+                done = true;
+                return;
+            }
+            elements[ChUpdateConflator::Key(0, vehicle->idnumber())] = vehicle;
+            staleness.push_back((benchMicros(start) - vehicle->timestamp()) / 1000.0);
+            auto busy = benchClock::now();
+            while (secondsSince(busy) * 1e6 < CONFLATE_BENCH_TASK_US);
+        };
+
+        long offered = 0;
+        auto offer = [&](int idNumber, double chTime) {
+            auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+            fillVehicle(vehicle.get(), idNumber);
+            vehicle->set_chtime(chTime);
+            vehicle->set_timestamp(benchMicros(start));
+            if (!conflate) {
+                worldQueue.enqueue([&, vehicle] { apply(vehicle); });
+                return;
+            }
+            ChUpdateConflator::Key key(0, idNumber);
+            if (conflator.offer(key, chTime, endpoint, vehicle)) {
+                worldQueue.enqueue([&, key] {
+                    auto newest = conflator.take(key).second;
+                    if (newest) apply(std::static_pointer_cast<ChronoMessages::VehicleMessage>(newest));
+                });
+            }
+        };
+        while (secondsSince(start) < SOCKET_BENCH_SECONDS) {
+            double elapsed = secondsSince(start);
+            while (offered < elapsed * 1000) {
+                for (int v = 0; v < CONFLATE_BENCH_VEHICLES; v++) offer(v, offered * 1e-3);
+                offered++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        offer(-1, 0);
+        worldThread.join();
+
+        std::sort(staleness.begin(), staleness.end());
+        if (staleness.empty()) staleness.push_back(0);
+        std::cout << std::setw(12) << (conflate ? "conflated" : "task each") << std::setw(10)
+                  << offered * CONFLATE_BENCH_VEHICLES << std::setw(10) << staleness.size() << std::setw(12)
+                  << conflator.superseded() << std::fixed << std::setprecision(2) << std::setw(12)
+                  << percentile(staleness, 0.5) << std::setw(12) << percentile(staleness, 0.99) << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+// Connects clients, one vehicle each, from a forked process, so the benchmark
+// process only spends CPU on the server, and has each send its vehicle
+// SNAPSHOT_BENCH_SEND_RATE times a second until killed.
+pid_t forkVehicleClients(int clients) {
+    pid_t child = fork();
+    if (child != 0) return child;
+    std::vector<std::unique_ptr<ChClientHandler>> handlers;
+    try {
+        for (int c = 0; c < clients; c++) {
+            handlers.emplace_back(new ChClientHandler("localhost", std::to_string(SOCKET_BENCH_PORT)));
+            handlers.back()->beginSend();
+        }
+    } catch (ConnectionException& ex) {
+        _exit(1);
+    }
+    ChronoMessages::VehicleMessage vehicle;
+    fillVehicle(&vehicle, 0);
+    auto next = benchClock::now();
+    for (double chTime = 0;; chTime += 1.0 / SNAPSHOT_BENCH_SEND_RATE) {
+        vehicle.set_chtime(chTime);
+        for (auto& handler : handlers) {
+            vehicle.set_connectionnumber(handler->connectionNumber());
+            handler->pushMessage(vehicle);
+        }
+        next += std::chrono::microseconds(1000000 / SNAPSHOT_BENCH_SEND_RATE);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// Server CPU against client count, once answering every received update
+// with a world packet the way CAVE-Server used to, and once broadcasting a
+// snapshot SNAPSHOT_BENCH_TICK times a second.
+void snapshotBenchmark() {
+    int counts[] = {4, 16, 64};
+    bool modes[] = {true, false};
+    std::cout << "Server CPU by client count (each sending " << SNAPSHOT_BENCH_SEND_RATE << " Hz, "
+              << SOCKET_BENCH_SECONDS << " s per row, % of one core)" << std::endl;
+    std::cout << std::setw(12) << "mode" << std::setw(10) << "clients" << std::setw(10) << "cpu %" << std::setw(12)
+              << "packets/s" << std::setw(14) << "datagrams/s" << std::endl;
+    for (bool replyEach : modes) {
+        for (int clients : counts) {
+            World world;
+            ChRingQueue<std::function<void()>> worldQueue;
+            ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT);
+            server.beginListen();
+            server.beginSend();
+            pid_t child = forkVehicleClients(clients);
+
+            // The world, update and snapshot threads of CAVE-Server, stripped down
+            std::atomic<bool> running(true);
+            std::atomic<long> built(0);
+            std::thread worldThread([&] {
+                while (running) worldQueue.dequeue()();
+            });
+            std::thread updater([&] {
+                while (running) {
+                    auto messagePair = server.popMessage();
+                    auto vehicle = std::dynamic_pointer_cast<ChronoMessages::VehicleMessage>(messagePair.second);
+                    if (!vehicle) continue;
+                    boost::asio::ip::udp::endpoint endpoint = messagePair.first;
+                    worldQueue.enqueue([&, vehicle, endpoint]() mutable {
+                        endpointProfile* profile = world.verifyConnection(vehicle->connectionnumber(), endpoint);
+                        if (profile == NULL) return;
+                        world.updateElement(vehicle, profile, vehicle->idnumber());
+                        if (!replyEach) return;
+                        server.pushMessage(endpoint, *world.generateWorldPacket());
+                        built++;
+                    });
+                }
+            });
+            std::thread ticker([&] {
+                auto next = benchClock::now();
+                while (running && !replyEach) {
+                    next += std::chrono::microseconds(1000000 / SNAPSHOT_BENCH_TICK);
+                    std::this_thread::sleep_until(next);
+                    worldQueue.enqueue([&] {
+                        server.broadcastMessage(world.registeredEndpoints(), *world.generateWorldPacket());
+                        built++;
+                    });
+                }
+            });
+
+            // Measured once every client is connected and sending
+            while (world.connectionCount() < clients) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            ChSendStats before = server.sendStats(world.registeredEndpoints()[0]);
+            long builtBefore = built;
+            double cpuStart = processCpuSeconds();
+            auto start = benchClock::now();
+            std::this_thread::sleep_for(std::chrono::duration<double>(SOCKET_BENCH_SECONDS));
+            double elapsed = secondsSince(start);
+            double usage = (processCpuSeconds() - cpuStart) / elapsed;
+            long packets = built - builtBefore;
+            long datagrams = server.sendStats(world.registeredEndpoints()[0]).sent - before.sent;
+
+            // The clients keep the updater fed until it sees running is off
+            running = false;
+            updater.join();
+            ticker.join();
+            worldQueue.enqueue([] {});
+            worldThread.join();
+            kill(child, SIGKILL);
+            waitpid(child, NULL, 0);
+
+            std::cout << std::setw(12) << (replyEach ? "reply each" : "tick") << std::setw(10) << clients
+                      << std::fixed << std::setprecision(1) << std::setw(10) << usage * 100 << std::setw(12)
+                      << (long)(packets / elapsed) << std::setw(14) << (long)(datagrams * clients / elapsed)
+                      << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+}
+
+// World thread time spent on each snapshot tick, once serializing a fresh
+// world packet every tick and once reusing the serialization while the world
+// is unchanged. Vehicles are moved every changeEvery ticks, so the rows go from
+// a world changing every tick to a mostly parked one.
+void cacheBenchmark() {
+    boost::asio::io_service ioService;
+    std::vector<std::unique_ptr<boost::asio::ip::udp::socket>> receivers;
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    for (int i = 0; i < CACHE_BENCH_CLIENTS; i++) {
+        receivers.emplace_back(new boost::asio::ip::udp::socket(
+            ioService, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+        endpoints.push_back(receivers.back()->local_endpoint());
+    }
+    int changes[] = {1, 4, 16};
+    bool modes[] = {false, true};
+    std::cout << "Snapshot tick cost, " << CACHE_BENCH_CLIENTS << " clients with a vehicle each (us per tick)"
+              << std::endl;
+    std::cout << std::setw(10) << "mode" << std::setw(14) << "change every" << std::setw(10) << "mean"
+              << std::setw(10) << "p99" << std::setw(12) << "serialized" << std::endl;
+    for (bool cached : modes) {
+        for (int changeEvery : changes) {
+            World world;
+            ChRingQueue<std::function<void()>> worldQueue;
+            ChServerHandler server(world, worldQueue, SOCKET_BENCH_PORT);
+            server.beginSend();
+            std::vector<endpointProfile*> profiles;
+            for (int i = 0; i < CACHE_BENCH_CLIENTS; i++) {
+                world.registerConnectionNumber(i);
+                world.registerEndpoint(endpoints[i], i);
+                profiles.push_back(world.verifyConnection(i, endpoints[i]));
+            }
+
+            std::shared_ptr<const ChSerializedMessage> snapshot;
+            uint64_t snapshotVersion = 0;
+            int serialized = 0;
+            std::vector<double> ticks;
+            auto next = benchClock::now();
+            for (int tick = 0; tick < CACHE_BENCH_TICKS; tick++) {
+                if (tick % changeEvery == 0) {
+                    for (int i = 0; i < CACHE_BENCH_CLIENTS; i++) {
+                        auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+                        fillVehicle(vehicle.get(), 0);
+                        vehicle->set_connectionnumber(i);
+                        vehicle->set_chtime(tick);
+                        world.updateElement(vehicle, profiles[i], 0);
+                    }
+                }
+                // The snapshot task, timed as the world thread would run it
+                auto start = benchClock::now();
+                if (!cached || !snapshot || world.version() != snapshotVersion) {
+                    snapshot = server.serializeBroadcast(*world.generateWorldPacket());
+                    snapshotVersion = world.version();
+                    serialized++;
+                }
+                server.broadcastSerialized(world.registeredEndpoints(), *snapshot);
+                ticks.push_back(secondsSince(start) * 1e6);
+                next += std::chrono::microseconds(1000000 / SNAPSHOT_BENCH_TICK);
+                std::this_thread::sleep_until(next);
+            }
+
+            double mean = 0;
+            for (double t : ticks) mean += t;
+            mean /= ticks.size();
+            std::sort(ticks.begin(), ticks.end());
+            std::cout << std::setw(10) << (cached ? "cached" : "rebuild") << std::setw(14) << changeEvery
+                      << std::fixed << std::setprecision(1) << std::setw(10) << mean << std::setw(10)
+                      << percentile(ticks, 0.99) << std::setw(12) << serialized << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+}
+
+// Cost of the World operations the server runs per message, at world sizes
+// from a handful of vehicles to thousands. Each connection owns
+// WORLD_BENCH_PER_CONNECTION vehicles, touched in random order.
+void worldBenchmark() {
+    int sizes[] = {10, 100, 1000, 10000};
+    std::cout << "World operations by element count (ns per element, packet in us)" << std::endl;
+    std::cout << std::setw(10) << "elements" << std::setw(10) << "insert" << std::setw(10) << "update"
+              << std::setw(10) << "lookup" << std::setw(10) << "churn" << std::setw(10) << "packet"
+              << std::setw(10) << "near" << std::setw(12) << "disconnect" << std::endl;
+    auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+    fillVehicle(vehicle.get(), 0);
+    std::mt19937 random(1);
+    for (int size : sizes) {
+        World world;
+        int connections = std::max(1, size / WORLD_BENCH_PER_CONNECTION);
+        std::vector<endpointProfile*> profiles;
+        for (int i = 0; i < connections; i++) {
+            boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 10000 + i);
+            world.registerConnectionNumber(i);
+            world.registerEndpoint(endpoint, i);
+            profiles.push_back(world.verifyConnection(i, endpoint));
+        }
+        std::vector<std::pair<int, int>> keys;
+        for (int i = 0; i < size; i++) keys.push_back(std::make_pair(i % connections, i / connections));
+
+        auto start = benchClock::now();
+        for (auto& key : keys) world.updateElement(vehicle, profiles[key.first], key.second);
+        double insert = secondsSince(start) * 1e9 / size;
+
+        std::vector<std::pair<int, int>> order;
+        for (int i = 0; i < WORLD_BENCH_OPERATIONS; i++) order.push_back(keys[random() % size]);
+        start = benchClock::now();
+        for (auto& key : order) world.updateElement(vehicle, profiles[key.first], key.second);
+        double update = secondsSince(start) * 1e9 / order.size();
+
+        long found = 0;
+        start = benchClock::now();
+        for (auto& key : order) found += world.getElement(key.first, key.second) != NULL;
+        double lookup = secondsSince(start) * 1e9 / order.size();
+
+        // A vehicle leaving and a new one joining in its place
+        start = benchClock::now();
+        for (auto& key : order) {
+            world.removeElement(key.second, profiles[key.first]);
+            world.updateElement(vehicle, profiles[key.first], key.second);
+        }
+        double churn = secondsSince(start) * 1e9 / order.size();
+
+        int packets = std::max(10, WORLD_BENCH_OPERATIONS / 10 / size);
+        start = benchClock::now();
+        for (int i = 0; i < packets; i++) found += world.generateWorldPacket()->vehiclemessages_size();
+        double packet = secondsSince(start) * 1e6 / packets;
+
+        // Every vehicle sits at the same spot, so each query matches all of them
+        start = benchClock::now();
+        for (int i = 0; i < packets; i++) found += world.vehiclesWithin(0, 0, 0, 1).size();
+        double near = secondsSince(start) * 1e9 / packets / size;
+
+        start = benchClock::now();
+        for (endpointProfile* profile : profiles) world.removeConnection(profile);
+        double disconnect = secondsSince(start) * 1e9 / size;
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(1) << std::setw(10) << insert
+                  << std::setw(10) << update << std::setw(10) << lookup << std::setw(10) << churn << std::setw(10)
+                  << packet << std::setw(10) << near << std::setw(12) << disconnect << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        if (found == 0) std::cout << "world lost its elements" << std::endl;
+    }
+}
+
+// Snapshot bytes each client is sent per tick, as full world packets and as
+// deltas against the previous tick's snapshot, which every client is taken to
+// have acknowledged. Every vehicle reports each tick, but only the moving
+// share of them goes anywhere; the rest are parked with only their clocks
+// running.
+void deltaBenchmark() {
+    double movingShares[] = {1.0, 0.25, 0.1, 0.0};
+    std::cout << "Snapshot bytes per client per tick, " << DELTA_BENCH_VEHICLES << " vehicles" << std::endl;
+    std::cout << std::setw(10) << "moving %" << std::setw(10) << "full" << std::setw(10) << "delta"
+              << std::setw(10) << "ratio" << std::endl;
+    for (double movingShare : movingShares) {
+        World world;
+        std::vector<endpointProfile*> profiles;
+        for (int i = 0; i < DELTA_BENCH_VEHICLES; i++) {
+            boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 10000 + i);
+            world.registerConnectionNumber(i);
+            world.registerEndpoint(endpoint, i);
+            profiles.push_back(world.verifyConnection(i, endpoint));
+        }
+        int moving = (int)(movingShare * DELTA_BENCH_VEHICLES);
+        auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+        fillVehicle(vehicle.get(), 0);
+        long fullBytes = 0;
+        long deltaBytes = 0;
+        uint64_t acknowledged = 0;
+        for (int tick = 0; tick <= DELTA_BENCH_TICKS; tick++) {
+            for (int i = 0; i < DELTA_BENCH_VEHICLES; i++) {
+                vehicle->set_connectionnumber(i);
+                vehicle->set_chtime(tick);
+                vehicle->mutable_chassiscom()->set_x(i < moving ? tick : 0);
+                world.updateElement(vehicle, profiles[i], 0);
+            }
+            auto delta = world.generateDeltaPacket(acknowledged);
+            acknowledged = delta->snapshot();
+            // The first tick brings every client up from nothing either way
+            if (tick == 0) continue;
+            fullBytes += world.generateWorldPacket()->ByteSizeLong();
+            deltaBytes += delta->ByteSizeLong();
+        }
+        std::cout << std::setw(10) << (int)(movingShare * 100) << std::setw(10) << fullBytes / DELTA_BENCH_TICKS
+                  << std::setw(10) << deltaBytes / DELTA_BENCH_TICKS << std::fixed << std::setprecision(1)
+                  << std::setw(10) << (double)fullBytes / std::max(1L, deltaBytes) << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+// Bytes each vehicle takes in a snapshot as VehicleMessages and quantized
+// into compactVehicles (ChCompactVehicles.h), counting each packet's share of
+// the compact header, and the time to pack and unpack one. The last line is
+// how many vehicles one unfragmented datagram holds either way.
+void compactBenchmark() {
+    int counts[] = {1, 8, 20, 64, 500};
+    std::cout << "Snapshot bytes per vehicle, compact encoding at " << compactVehicleBits(4) << " bits per four wheeled vehicle"
+              << std::endl;
+    std::cout << std::setw(10) << "vehicles" << std::setw(10) << "message" << std::setw(10) << "compact"
+              << std::setw(12) << "pack ns" << std::setw(12) << "unpack ns" << std::endl;
+    for (int count : counts) {
+        ChronoMessages::MessagePacket packet;
+        packet.set_connectionnumber(0);
+        for (int i = 0; i < count; i++) fillVehicle(packet.add_vehiclemessages(), i);
+        double messageBytes = (double)packet.ByteSizeLong() / count;
+        int rounds = std::max(1, COMPACT_BENCH_VEHICLES / count);
+        double compactBytes = 0;
+        double packTime = 0;
+        double unpackTime = 0;
+        for (int round = 0; round < rounds; round++) {
+            ChronoMessages::MessagePacket compact(packet);
+            auto start = std::chrono::steady_clock::now();
+            compactVehicles(compact);
+            auto packed = std::chrono::steady_clock::now();
+            compactBytes = (double)compact.ByteSizeLong() / count;
+            expandVehicles(compact);
+            auto unpacked = std::chrono::steady_clock::now();
+            packTime += std::chrono::duration<double, std::nano>(packed - start).count();
+            unpackTime += std::chrono::duration<double, std::nano>(unpacked - packed).count();
+        }
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(1) << std::setw(10) << messageBytes
+                  << std::setw(10) << compactBytes << std::setw(12) << packTime / rounds / count << std::setw(12)
+                  << unpackTime / rounds / count << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // Packets grow a vehicle at a time until they no longer fit
+    size_t payload = PACKET_SLAB_SIZE - DATAGRAM_HEADER_SIZE;
+    int fit[2] = {0, 0};
+    for (int compact = 0; compact < 2; compact++) {
+        ChronoMessages::MessagePacket packet;
+        packet.set_connectionnumber(0);
+        while (true) {
+            fillVehicle(packet.add_vehiclemessages(), fit[compact]);
+            ChronoMessages::MessagePacket sent(packet);
+            if (compact) compactVehicles(sent);
+            if (sent.ByteSizeLong() > payload) break;
+            fit[compact]++;
+        }
+    }
+    std::cout << "Vehicles per " << payload << " byte datagram: " << fit[0] << " as messages, " << fit[1]
+              << " compact" << std::endl;
+}
+
+// Bytes and time per wheel to serialize and parse vehicles with more and more
+// axles, from the HMMWV's two up to eight, both as messages and compacted.
+// None of it should grow faster than the number of wheels.
+void wheelBenchmark() {
+    int axles[] = {2, 3, 4, 8};
+    std::cout << "Cost per wheel by number of axles" << std::endl;
+    std::cout << std::setw(8) << "axles" << std::setw(10) << "bytes" << std::setw(10) << "compact" << std::setw(14)
+              << "serialize ns" << std::setw(10) << "parse ns" << std::endl;
+    for (int axle : axles) {
+        int wheels = 2 * axle;
+        ChronoMessages::VehicleMessage vehicle;
+        fillVehicle(&vehicle, 0, wheels);
+        // Measured against a wheelless vehicle, so only the wheels are counted
+        ChronoMessages::VehicleMessage chassis(vehicle);
+        resizeWheels(&chassis, 0);
+        double bytes = (double)(vehicle.ByteSizeLong() - chassis.ByteSizeLong()) / wheels;
+        double compact = (double)(compactVehicleBits(wheels) - compactVehicleBits(0)) / 8 / wheels;
+
+        std::string buffer;
+        ChronoMessages::VehicleMessage parsed;
+        auto start = benchClock::now();
+        for (int i = 0; i < WHEEL_BENCH_VEHICLES; i++) vehicle.SerializeToString(&buffer);
+        double serialize = secondsSince(start);
+        start = benchClock::now();
+        for (int i = 0; i < WHEEL_BENCH_VEHICLES; i++) parsed.ParseFromString(buffer);
+        double parse = secondsSince(start);
+        std::cout << std::setw(8) << axle << std::fixed << std::setprecision(1) << std::setw(10) << bytes
+                  << std::setw(10) << compact << std::setw(14) << serialize * 1e9 / WHEEL_BENCH_VEHICLES / wheels
+                  << std::setw(10) << parse * 1e9 / WHEEL_BENCH_VEHICLES / wheels << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+// Recorded traffic of vehicles driving laps: each vehicle's own update, and
+// the world packet every client is sent, whole and compacted, every tick.
+// Values carry full double precision, as sent.
+static void recordTraffic(std::vector<std::string>& vehicles, std::vector<std::string>& packets,
+                          std::vector<std::string>& compact) {
+    World world;
+    std::vector<endpointProfile*> profiles;
+    for (int i = 0; i < COMPRESSION_BENCH_VEHICLES; i++) {
+        boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 10000 + i);
+        world.registerConnectionNumber(i);
+        world.registerEndpoint(endpoint, i);
+        profiles.push_back(world.verifyConnection(i, endpoint));
+    }
+    auto vehicle = std::make_shared<ChronoMessages::VehicleMessage>();
+    fillVehicle(vehicle.get(), 0);
+    for (int tick = 0; tick < COMPRESSION_BENCH_TICKS; tick++) {
+        double time = tick / 60.0;
+        for (int i = 0; i < COMPRESSION_BENCH_VEHICLES; i++) {
+            double heading = 0.3 * time + 0.4 * i;
+            double speed = 8 + 0.37 * i + std::sin(time);
+            ChronoMessages::MVector* chassis = vehicle->mutable_chassiscom();
+            vehicle->set_connectionnumber(i);
+            vehicle->set_timestamp(tick * 16);
+            vehicle->set_chtime(time);
+            vehicle->set_speed(speed);
+            chassis->set_x(40 * std::cos(heading) + 3.1 * i);
+            chassis->set_y(40 * std::sin(heading) - 1.7 * i);
+            chassis->set_z(0.52 + 0.01 * std::sin(7 * time + i));
+            vehicle->mutable_chassisrot()->set_e0(std::cos(heading / 2));
+            vehicle->mutable_chassisrot()->set_e3(std::sin(heading / 2));
+            double* position = vehicle->mutable_wheelpositions()->mutable_data();
+            double* rotation = vehicle->mutable_wheelrotations()->mutable_data();
+            for (int wheel = 0; wheel < 4; wheel++) {
+                double spin = speed * time / 0.47 + wheel;
+                position[3 * wheel] = chassis->x() + (wheel < 2 ? 1.6 : -1.6) * std::cos(heading);
+                position[3 * wheel + 1] = chassis->y() + (wheel % 2 ? 0.9 : -0.9) * std::sin(heading);
+                position[3 * wheel + 2] = chassis->z() - 0.3;
+                rotation[4 * wheel] = std::cos(heading / 2) * std::cos(spin / 2);
+                rotation[4 * wheel + 1] = -std::sin(heading / 2) * std::sin(spin / 2);
+                rotation[4 * wheel + 2] = std::cos(heading / 2) * std::sin(spin / 2);
+                rotation[4 * wheel + 3] = std::sin(heading / 2) * std::cos(spin / 2);
+            }
+            vehicles.push_back(vehicle->SerializeAsString());
+            world.updateElement(vehicle, profiles[i], 0);
+        }
+        auto packet = world.generateWorldPacket();
+        packets.push_back(packet->SerializeAsString());
+        compactVehicles(*packet);
+        compact.push_back(packet->SerializeAsString());
+    }
+}
+
+// Compression ratio, and time to compress and decompress one payload, for
+// recorded traffic with no dictionary, the default one, and one trained on
+// the first half of the recording. Every line is measured on the second half.
+// Payloads under COMPRESSION_THRESHOLD are counted as sent as they are.
+void compressionBenchmark() {
+    std::vector<std::string> traffic[3];
+    recordTraffic(traffic[0], traffic[1], traffic[2]);
+    const char* names[] = {"vehicles", "world", "compact"};
+    std::cout << "Compression at level " << COMPRESSION_LEVEL << ", threshold " << COMPRESSION_THRESHOLD << " bytes, "
+              << COMPRESSION_BENCH_VEHICLES << " vehicles" << std::endl;
+    std::cout << std::setw(10) << "traffic" << std::setw(12) << "dictionary" << std::setw(10) << "bytes"
+              << std::setw(8) << "ratio" << std::setw(14) << "compress ns" << std::setw(16) << "decompress ns"
+              << std::endl;
+    for (int kind = 0; kind < 3; kind++) {
+        size_t half = traffic[kind].size() / 2;
+        std::vector<std::string> training(traffic[kind].begin(), traffic[kind].begin() + half);
+        std::vector<std::string> measured(traffic[kind].begin() + half, traffic[kind].end());
+        const char* dictionaryNames[] = {"none", "default", "trained"};
+        std::string dictionaries[] = {"", defaultCompressionDictionary(), trainCompressionDictionary(training)};
+        for (int d = 0; d < 3; d++) {
+            ChPacketCompressor compressor(dictionaries[d]);
+            std::vector<char> compressed(MAX_DATAGRAM_SIZE);
+            std::vector<char> expanded(MAX_DATAGRAM_SIZE);
+            long bytesIn = 0;
+            long bytesOut = 0;
+            double compressTime = 0;
+            double decompressTime = 0;
+            for (int round = 0; round < COMPRESSION_BENCH_ROUNDS; round++) {
+                for (const std::string& payload : measured) {
+                    size_t size = 0;
+                    if (payload.size() >= COMPRESSION_THRESHOLD) {
+                        auto start = benchClock::now();
+                        // Only worth sending if it comes out smaller, as the handler does
+                        size = compressor.compress(payload.data(), payload.size(), compressed.data(),
+                                                   payload.size() - 1);
+                        auto packed = benchClock::now();
+                        if (size) compressor.decompress(compressed.data(), size, expanded.data());
+                        auto unpacked = benchClock::now();
+                        compressTime += std::chrono::duration<double, std::nano>(packed - start).count();
+                        decompressTime += std::chrono::duration<double, std::nano>(unpacked - packed).count();
+                    }
+                    if (round > 0) continue;
+                    bytesIn += payload.size();
+                    bytesOut += size ? size : payload.size();
+                }
+            }
+            double payloads = (double)COMPRESSION_BENCH_ROUNDS * measured.size();
+            std::cout << std::setw(10) << names[kind] << std::setw(12) << dictionaryNames[d] << std::setw(10)
+                      << bytesIn / (long)measured.size() << std::fixed << std::setprecision(2) << std::setw(8)
+                      << (double)bytesIn / bytesOut << std::setprecision(0) << std::setw(14) << compressTime / payloads
+                      << std::setw(16) << decompressTime / payloads << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+}
+
+// Trains a dictionary on the first half of recorded traffic, the half the
+// compression benchmark doesn't measure, and writes it out as
+// ChCompressionDictionary.h.
+void writeCompressionDictionary() {
+    std::vector<std::string> traffic[3];
+    recordTraffic(traffic[0], traffic[1], traffic[2]);
+    std::vector<std::string> training;
+    for (auto& kind : traffic) training.insert(training.end(), kind.begin(), kind.begin() + kind.size() / 2);
+    std::string dictionary = trainCompressionDictionary(training);
+    ChPacketCompressor compressor(dictionary);
+    std::cout << std::hex << std::setfill('0');
+    std::cout << "// =============================================================================\n"
+              << "// PROJECT CHRONO - http://projectchrono.org\n"
+              << "//\n"
+              << "// Copyright (c) 2014 projectchrono.org\n"
+              << "// All right reserved.\n"
+              << "//\n"
+              << "// Use of this source code is governed by a BSD-style license that can be found\n"
+              << "// in the LICENSE file at the top level of the distribution and at\n"
+              << "// http://projectchrono.org/license-chrono.txt.\n"
+              << "//\n"
+              << "// =============================================================================\n"
+              << "//\n"
+              << "//\tDictionary ChPacketCompressor uses by default, written by network-bench\n"
+              << "//  dictionary from " << std::dec << training.size() << std::hex
+              << " payloads of recorded traffic. Regenerate it rather than\n"
+              << "//  editing it; a new dictionary gets a new id, so old and new ends of a\n"
+              << "//  connection just don't compress.\n"
+              << "//\n"
+              << "// =============================================================================\n"
+              << "\n"
+              << "#ifndef CHCOMPRESSIONDICTIONARY_H\n"
+              << "#define CHCOMPRESSIONDICTIONARY_H\n"
+              << "\n"
+              << "#define DEFAULT_COMPRESSION_DICTIONARY_ID 0x" << std::setw(8) << compressor.dictionaryId() << "u\n"
+              << "#define DEFAULT_COMPRESSION_DICTIONARY_SIZE " << std::dec << dictionary.size() << std::hex << "\n"
+              << "\n"
+              << "static const unsigned char defaultCompressionDictionaryBytes[DEFAULT_COMPRESSION_DICTIONARY_SIZE] = {";
+    for (size_t i = 0; i < dictionary.size(); i++) {
+        std::cout << (i % 16 ? " " : "\n    ") << "0x" << std::setw(2) << (int)(uint8_t)dictionary[i] << ",";
+    }
+    std::cout << "\n};\n"
+              << "\n"
+              << "#endif // CHCOMPRESSIONDICTIONARY_H\n";
+    std::cout << std::dec << std::setfill(' ');
+}
+
+int main(int argc, char** argv) {
+    std::string only = argc > 1 ? argv[1] : "";
+    if (only.empty() || only == "queue") queueBenchmark();
+    if (only.empty() || only == "batch") batchBenchmark();
+    if (only.empty() || only == "latency") latencyBenchmark();
+    if (only.empty() || only == "reactor") reactorBenchmark();
+    if (only.empty() || only == "shards") shardBenchmark();
+    if (only.empty() || only == "parse") parseBenchmark();
+    if (only.empty() || only == "connect") connectBenchmark();
+    if (only.empty() || only == "classes") classBenchmark();
+    if (only.empty() || only == "mailbox") mailboxBenchmark();
+    if (only.empty() || only == "conflate") conflateBenchmark();
+    if (only.empty() || only == "snapshot") snapshotBenchmark();
+    if (only.empty() || only == "cache") cacheBenchmark();
+    if (only.empty() || only == "world") worldBenchmark();
+    if (only.empty() || only == "delta") deltaBenchmark();
+    if (only.empty() || only == "compact") compactBenchmark();
+    if (only.empty() || only == "wheels") wheelBenchmark();
+    if (only.empty() || only == "compression") compressionBenchmark();
+    // Not a benchmark, so only when asked for
+    if (only == "dictionary") writeCompressionDictionary();
+    return 0;
+}
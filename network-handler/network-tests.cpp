@@ -6,14 +6,25 @@
 //
 // =============================================================================
 
+#include <cmath>
 #include <iostream>
+#include <random>
+#include <sstream>
 #include <thread>
+#include <vector>
 #include "ChNetworkHandler.h"
+#include "ChBitPacker.h"
+#include "ChCompactVehicles.h"
+#include "ChCompressionDictionary.h"
+#include "ChPacketCompressor.h"
+#include "ChUpdateConflator.h"
 #include "ChronoMessages.pb.h"
 #include "MessageCodes.h"
 #include "MessageConversions.h"
+#include "VehicleWheels.h"
+#include "WheelKinematics.h"
 #include "World.h"
-#include "ChSafeQueue.h"
+#include "ChRingQueue.h"
 
 #include "chrono/core/ChFileutils.h"
 #include "chrono/core/ChStream.h"
@@ -104,23 +115,728 @@ void generateTestDSRCMessage(ChronoMessages::DSRCMessage *message, HMMWV_Full& m
     message->set_buffer(DMessage);
 }
 
-void serializeDSRC(std::ostream& stream, ChronoMessages::DSRCMessage& message) {
-    uint8_t messageType = DSRC_MESSAGE;
-    stream << messageType;
+// Sequence number for the next datagram the tests send by hand
+uint32_t testSequence = 0;
+
+void serializeWithHeader(std::ostream& stream, uint8_t messageType, google::protobuf::Message& message) {
+    ChDatagramHeader header;
+    header.type = messageType;
+    header.flags = 0;
+    header.payloadSize = message.ByteSize();
+    header.sequence = testSequence++;
+    header.timestamp = datagramTimestamp();
+    char headerBytes[DATAGRAM_HEADER_SIZE];
+    writeDatagramHeader(headerBytes, header);
+    stream.write(headerBytes, DATAGRAM_HEADER_SIZE);
     message.SerializeToOstream(&stream);
     stream.flush();
 }
 
+// Commits a received datagram to buffer, then reads its header and parses
+// the payload into message.
+bool parseWithHeader(boost::asio::streambuf& buffer, size_t size, uint8_t& messageType, google::protobuf::Message& message) {
+    buffer.commit(size);
+    const char* data = boost::asio::buffer_cast<const char*>(buffer.data());
+    ChDatagramHeader header;
+    bool valid = readDatagramHeader(data, size, header);
+    if (valid) valid = message.ParseFromArray(data + DATAGRAM_HEADER_SIZE, header.payloadSize);
+    buffer.consume(size);
+    messageType = valid ? header.type : NULL_MESSAGE;
+    return valid;
+}
+
+// A bare reliable datagram with its sequence and ack fields zeroed
+ChPacketHandle makeReliableDatagram(ChPacketPool& pool, uint8_t messageType) {
+    ChPacketHandle datagram = pool.acquire(DATAGRAM_HEADER_SIZE + RELIABLE_HEADER_SIZE);
+    ChDatagramHeader header = {messageType, DATAGRAM_FLAG_RELIABLE, RELIABLE_HEADER_SIZE, 0, 0};
+    writeDatagramHeader(datagram.data(), header);
+    ChReliableHeader reliableHeader = {0, 0, 0};
+    writeReliableHeader(datagram.data() + DATAGRAM_HEADER_SIZE, reliableHeader);
+    datagram.resize(DATAGRAM_HEADER_SIZE + RELIABLE_HEADER_SIZE);
+    return datagram;
+}
+
+// An unreliable datagram of size bytes, header included, tagged with sequence
+ChPacketHandle makeSizedDatagram(ChPacketPool& pool, size_t size, uint32_t sequence) {
+    ChPacketHandle datagram = pool.acquire(size);
+    ChDatagramHeader header = {VEHICLE_MESSAGE, 0, (uint16_t)(size - DATAGRAM_HEADER_SIZE), sequence, 0};
+    writeDatagramHeader(datagram.data(), header);
+    datagram.resize(size);
+    return datagram;
+}
+
+// Sends a handshake datagram from socket and waits for the one that answers
+// it. Returns false if the reply isn't a handshake.
+bool exchangeHandshake(boost::asio::ip::udp::socket& socket, boost::asio::ip::udp::endpoint& to, uint8_t messageType,
+                       uint64_t value, uint8_t& replyType, uint64_t& replyValue) {
+    char datagram[HANDSHAKE_DATAGRAM_SIZE];
+    writeHandshake(datagram, messageType, value);
+    socket.send_to(boost::asio::buffer(datagram, sizeof(datagram)), to);
+    boost::asio::ip::udp::endpoint from;
+    size_t size = socket.receive_from(boost::asio::buffer(datagram, sizeof(datagram)), from);
+    return readHandshake(datagram, size, replyType, replyValue);
+}
+
+// Plays the server's side of a handshake on socket: waits for a request and
+// answers it with replyType and value. Returns the requester's endpoint.
+boost::asio::ip::udp::endpoint answerHandshake(boost::asio::ip::udp::socket& socket, uint8_t replyType, uint64_t value) {
+    char datagram[HANDSHAKE_DATAGRAM_SIZE];
+    boost::asio::ip::udp::endpoint from;
+    uint8_t messageType;
+    uint64_t cookie;
+    do {
+        size_t size = socket.receive_from(boost::asio::buffer(datagram, sizeof(datagram)), from);
+        if (!readHandshake(datagram, size, messageType, cookie)) messageType = NULL_MESSAGE;
+    } while (messageType != CONNECTION_REQUEST);
+    writeHandshake(datagram, replyType, value);
+    socket.send_to(boost::asio::buffer(datagram, sizeof(datagram)), from);
+    return from;
+}
+
+void serializeDSRC(std::ostream& stream, ChronoMessages::DSRCMessage& message) {
+    serializeWithHeader(stream, DSRC_MESSAGE, message);
+}
+
 void serializeVehicle(std::ostream& stream, ChronoMessages::VehicleMessage& message) {
-    uint8_t messageType = VEHICLE_MESSAGE;
-    stream << messageType;
-    message.SerializeToOstream(&stream);
-    stream.flush();
+    serializeWithHeader(stream, VEHICLE_MESSAGE, message);
 }
 
 int main(int argc, char **argv) {
     World world;
-    ChSafeQueue<std::function<void()>> worldQueue;
+    ChRingQueue<std::function<void()>> worldQueue;
+
+    // Queue tests ////////////////////////////////////////////////////////////////////////
+    ChRingQueue<int> ringQueue(4);
+    bool pushedAll = ringQueue.tryEnqueue(1) && ringQueue.tryEnqueue(2) && ringQueue.tryEnqueue(3) && ringQueue.tryEnqueue(4);
+    bool pushedFull = ringQueue.tryEnqueue(5);
+    if (pushedAll && !pushedFull && ringQueue.size() == 4 && ringQueue.dequeue() == 1 && ringQueue.dequeue() == 2) {
+        std::cout << "PASSED -- Queue test 1" << std::endl;
+    } else std::cout << "FAILED -- Queue test 1" << std::endl;
+
+    int timedOut;
+    ringQueue.dequeue();
+    ringQueue.dequeue();
+    if (!ringQueue.dequeueFor(timedOut, std::chrono::milliseconds(10)) && ringQueue.empty()) {
+        std::cout << "PASSED -- Queue test 2" << std::endl;
+    } else std::cout << "FAILED -- Queue test 2" << std::endl;
+
+    std::vector<std::thread> producers;
+    long queueSum = 0;
+    for (int p = 0; p < 4; p++) {
+        producers.emplace_back([&ringQueue] {
+            for (int i = 1; i <= 10000; i++) ringQueue.enqueue(i);
+        });
+    }
+    for (int i = 0; i < 40000; i++) queueSum += ringQueue.dequeue();
+    for (auto& producer : producers) producer.join();
+    if (queueSum == 4 * 50005000L && ringQueue.empty()) {
+        std::cout << "PASSED -- Queue test 3" << std::endl;
+    } else std::cout << "FAILED -- Queue test 3" << std::endl;
+
+    std::thread blocked([&ringQueue] {
+        try {
+            ringQueue.dequeue();
+            std::cout << "FAILED -- Queue test 4" << std::endl;
+        } catch (PredicateException& exp) {
+            std::cout << "PASSED -- Queue test 4" << std::endl;
+        }
+    });
+    ringQueue.dumpThreads();
+    blocked.join();
+
+    // Pool tests ///////////////////////////////////////////////////////////////////////
+    ChPacketPool pool(2, 64);
+    {
+        ChPacketHandle first = pool.acquire(32);
+        ChPacketHandle shared = first;
+        ChPacketHandle second = pool.acquire();
+        first.reset();
+        if (pool.hits() == 2 && pool.misses() == 0 && pool.inUse() == 2 && shared.capacity() == 64) {
+            std::cout << "PASSED -- Pool test 1" << std::endl;
+        } else std::cout << "FAILED -- Pool test 1" << std::endl;
+
+        ChPacketHandle emptyPool = pool.acquire();
+        ChPacketHandle oversized = pool.acquire(1000);
+        if (pool.misses() == 2 && oversized.capacity() >= 1000 && pool.highWaterMark() == 4) {
+            std::cout << "PASSED -- Pool test 2" << std::endl;
+        } else std::cout << "FAILED -- Pool test 2" << std::endl;
+    }
+    ChPacketHandle recycled = pool.acquire();
+    if (pool.inUse() == 1 && pool.hits() == 3 && pool.misses() == 2) {
+        std::cout << "PASSED -- Pool test 3" << std::endl;
+    } else std::cout << "FAILED -- Pool test 3" << std::endl;
+    recycled.reset();
+
+    ChArenaPool arenaPool(1);
+    {
+        ChronoMessages::DSRCMessage arenaSource;
+        arenaSource.set_timestamp(0);
+        arenaSource.set_chtime(0);
+        arenaSource.set_idnumber(7);
+        arenaSource.mutable_vehiclepos()->set_x(0);
+        arenaSource.mutable_vehiclepos()->set_y(0);
+        arenaSource.mutable_vehiclepos()->set_z(0);
+        arenaSource.set_buffer("arena");
+        std::string arenaBytes = arenaSource.SerializeAsString();
+
+        auto arena = arenaPool.acquire();
+        ChronoMessages::DSRCMessage* onArena = google::protobuf::Arena::CreateMessage<ChronoMessages::DSRCMessage>(arena.get());
+        onArena->ParseFromArray(arenaBytes.data(), arenaBytes.size());
+        std::shared_ptr<ChronoMessages::DSRCMessage> parsed(arena, onArena);
+        arena.reset();
+        auto unpooled = arenaPool.acquire();
+        if (parsed->buffer() == "arena" && parsed->GetArena() != NULL && arenaPool.inUse() == 1 && arenaPool.misses() == 1) {
+            std::cout << "PASSED -- Arena pool test 1" << std::endl;
+        } else std::cout << "FAILED -- Arena pool test 1" << std::endl;
+    }
+    if (arenaPool.inUse() == 0 && arenaPool.acquire() && arenaPool.hits() == 2) {
+        std::cout << "PASSED -- Arena pool test 2" << std::endl;
+    } else std::cout << "FAILED -- Arena pool test 2" << std::endl;
+
+    // Message traits tests /////////////////////////////////////////////////////////////
+    ChronoMessages::VehicleMessage traitsVehicle;
+    ChronoMessages::DSRCMessage traitsDSRC;
+    ChronoMessages::MessagePacket traitsPacket;
+    ChronoMessages::SnapshotAck traitsAck;
+    ChronoMessages::ReducedVehicleMessage traitsReduced;
+    ChronoMessages::MVector traitsVector;
+    if (messageCode(traitsVehicle) == VEHICLE_MESSAGE && messageCode(traitsDSRC) == DSRC_MESSAGE &&
+        messageCode(traitsPacket) == MESSAGE_PACKET && messageCode(traitsAck) == SNAPSHOT_ACK &&
+        messageCode(traitsReduced) == REDUCED_VEHICLE_MESSAGE && messageCode(traitsVector) == NULL_MESSAGE) {
+        std::cout << "PASSED -- Message traits test 1" << std::endl;
+    } else std::cout << "FAILED -- Message traits test 1" << std::endl;
+
+    if (defaultTrafficClass(CONTROL_MESSAGE) == TRAFFIC_CONTROL && defaultTrafficClass(ACK_MESSAGE) == TRAFFIC_CONTROL &&
+        defaultTrafficClass(VEHICLE_MESSAGE) == TRAFFIC_STATE && defaultTrafficClass(DSRC_MESSAGE) == TRAFFIC_DSRC &&
+        defaultTrafficClass(SNAPSHOT_ACK) == TRAFFIC_CONTROL && defaultTrafficClass(HEARTBEAT) == TRAFFIC_BULK &&
+        defaultTrafficClass(REDUCED_VEHICLE_MESSAGE) == TRAFFIC_STATE) {
+        std::cout << "PASSED -- Message traits test 2" << std::endl;
+    } else std::cout << "FAILED -- Message traits test 2" << std::endl;
+
+    // Datagram header tests ////////////////////////////////////////////////////////////
+    char headerBytes[DATAGRAM_HEADER_SIZE + 4];
+    ChDatagramHeader written;
+    written.type = MESSAGE_PACKET;
+    written.flags = DATAGRAM_FLAG_LATEST;
+    written.payloadSize = 4;
+    written.sequence = 0xfffffffe;
+    written.timestamp = 0x0102030405060708;
+    writeDatagramHeader(headerBytes, written);
+    ChDatagramHeader read;
+    bool readBack = readDatagramHeader(headerBytes, sizeof(headerBytes), read);
+    bool truncated = readDatagramHeader(headerBytes, sizeof(headerBytes) - 1, read);
+    headerBytes[2] = DATAGRAM_VERSION + 1;
+    bool wrongVersion = readDatagramHeader(headerBytes, sizeof(headerBytes), read);
+    headerBytes[2] = DATAGRAM_VERSION;
+    readDatagramHeader(headerBytes, sizeof(headerBytes), read);
+    if (readBack && !truncated && !wrongVersion && (uint8_t)headerBytes[0] == 0x43 && read.type == MESSAGE_PACKET &&
+        read.flags == DATAGRAM_FLAG_LATEST && read.sequence == 0xfffffffe && read.timestamp == 0x0102030405060708) {
+        std::cout << "PASSED -- Datagram header test 1" << std::endl;
+    } else std::cout << "FAILED -- Datagram header test 1" << std::endl;
+
+    // Sequence numbers wrap from 0xfffffffe to 2; 0 and 1 arrive after 2, and
+    // only the one carrying state is dropped
+    ChSequenceTracker tracker;
+    boost::asio::ip::udp::endpoint trackedEndpoint(boost::asio::ip::address_v4::loopback(), 9000);
+    bool acceptedAll = tracker.accept(trackedEndpoint, read);
+    read.sequence = 0xffffffff;
+    acceptedAll = acceptedAll && tracker.accept(trackedEndpoint, read);
+    read.sequence = 2;
+    acceptedAll = acceptedAll && tracker.accept(trackedEndpoint, read);
+    read.sequence = 0;
+    bool lateAccepted = tracker.accept(trackedEndpoint, read);
+    read.flags = 0;
+    read.sequence = 1;
+    bool lateEventAccepted = tracker.accept(trackedEndpoint, read);
+    ChSequenceStats trackedStats = tracker.stats(trackedEndpoint);
+    if (acceptedAll && !lateAccepted && lateEventAccepted && trackedStats.received == 5 && trackedStats.lost == 0 &&
+        trackedStats.reordered == 2 && trackedStats.stale == 1 && trackedStats.highestSequence == 2) {
+        std::cout << "PASSED -- Datagram header test 2" << std::endl;
+    } else std::cout << "FAILED -- Datagram header test 2" << std::endl;
+
+    // Fragment tests ///////////////////////////////////////////////////////////////////
+    ChPacketPool fragmentPool;
+    ChFragmentAssembler assembler(fragmentPool, 1);
+    std::string whole(5000, 'x');
+    for (size_t i = 0; i < whole.size(); i++) whole[i] = 'a' + i % 26;
+    ChFragmentHeader piece;
+    piece.messageId = 1;
+    piece.count = 4;
+    piece.messageSize = whole.size();
+    ChPacketHandle reassembled;
+    uint32_t firstSequence = 0;
+    int completedEarly = 0;
+    // Arrives out of order with a duplicate
+    uint16_t arrivalOrder[] = {2, 0, 2, 3, 1};
+    for (uint16_t index : arrivalOrder) {
+        piece.index = index;
+        bool done = assembler.add(trackedEndpoint, piece, 10 + index, whole.data() + fragmentOffset(piece),
+                                  fragmentSize(piece), reassembled, firstSequence);
+        if (done && index != 1) completedEarly++;
+    }
+    if (completedEarly == 0 && reassembled && std::string(reassembled.data(), reassembled.size()) == whole &&
+        firstSequence == 10 && assembler.completed() == 1) {
+        std::cout << "PASSED -- Fragment test 1" << std::endl;
+    } else std::cout << "FAILED -- Fragment test 1" << std::endl;
+
+    // With one slot, a second message pushes out the unfinished first one
+    piece.index = 0;
+    assembler.add(trackedEndpoint, piece, 20, whole.data(), fragmentSize(piece), reassembled, firstSequence);
+    piece.messageId = 2;
+    piece.count = 1;
+    bool secondDone = assembler.add(trackedEndpoint, piece, 21, whole.data(), whole.size(), reassembled, firstSequence);
+    if (secondDone && assembler.expired() == 1 && assembler.completed() == 2) {
+        std::cout << "PASSED -- Fragment test 2" << std::endl;
+    } else std::cout << "FAILED -- Fragment test 2" << std::endl;
+
+    // Reliable channel tests ///////////////////////////////////////////////////////////
+    ChPacketPool reliablePool;
+    ChReliableChannel sendingChannel;
+    ChReliableChannel receivingChannel;
+    boost::asio::ip::udp::endpoint sendingEndpoint(boost::asio::ip::address_v4::loopback(), 9001);
+    boost::asio::ip::udp::endpoint receivingEndpoint(boost::asio::ip::address_v4::loopback(), 9002);
+    std::vector<ChReliableChannel::Datagram> inFlight;
+    std::vector<boost::asio::ip::udp::endpoint> lostEndpoints;
+    for (int i = 0; i < 20; i++) {
+        ChPacketHandle datagram = makeReliableDatagram(reliablePool, CONTROL_MESSAGE);
+        sendingChannel.track(receivingEndpoint, datagram);
+        inFlight.push_back(ChReliableChannel::Datagram(receivingEndpoint, datagram));
+    }
+    std::vector<uint32_t> deliveredOrder;
+    auto recordDelivery = [&deliveredOrder](ChPacketHandle& datagram) {
+        ChReliableHeader delivered;
+        readReliableHeader(datagram.data() + DATAGRAM_HEADER_SIZE, RELIABLE_HEADER_SIZE, delivered);
+        deliveredOrder.push_back(delivered.sequence);
+    };
+    // Every third message is lost the first time it is sent
+    for (int round = 0; round < 100 && sendingChannel.pending(); round++) {
+        for (auto& datagram : inFlight) {
+            sendingChannel.stamp(datagram.first, datagram.second);
+            ChReliableHeader reliableHeader;
+            readReliableHeader(datagram.second.data() + DATAGRAM_HEADER_SIZE, RELIABLE_HEADER_SIZE, reliableHeader);
+            if (round == 0 && reliableHeader.sequence % 3 == 1) continue;
+            receivingChannel.receive(sendingEndpoint, reliableHeader, datagram.second, recordDelivery);
+        }
+        ChPacketHandle ack = makeReliableDatagram(reliablePool, ACK_MESSAGE);
+        receivingChannel.stamp(sendingEndpoint, ack);
+        ChReliableHeader ackHeader;
+        readReliableHeader(ack.data() + DATAGRAM_HEADER_SIZE, RELIABLE_HEADER_SIZE, ackHeader);
+        sendingChannel.acknowledge(receivingEndpoint, ackHeader);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(RELIABLE_TICK));
+        inFlight.clear();
+        sendingChannel.collectRetransmits(inFlight, lostEndpoints);
+    }
+    bool inOrder = deliveredOrder.size() == 20;
+    for (size_t i = 0; i < deliveredOrder.size(); i++) inOrder &= deliveredOrder[i] == i;
+    ChReliableStats sendingStats = sendingChannel.stats(receivingEndpoint);
+    // Selective acks mean only the 7 lost messages are sent again
+    if (inOrder && sendingStats.outstanding == 0 && sendingStats.retransmitted == 7 && lostEndpoints.empty()) {
+        std::cout << "PASSED -- Reliable channel test 1" << std::endl;
+    } else std::cout << "FAILED -- Reliable channel test 1" << std::endl;
+
+    // A retransmission of something already delivered is acknowledged but not delivered again
+    ChPacketHandle repeated = makeReliableDatagram(reliablePool, CONTROL_MESSAGE);
+    ChReliableHeader repeatedHeader = {5, 0, 0};
+    writeReliableHeader(repeated.data() + DATAGRAM_HEADER_SIZE, repeatedHeader);
+    bool ackRequested = receivingChannel.receive(sendingEndpoint, repeatedHeader, repeated, recordDelivery);
+    ChReliableStats receivingStats = receivingChannel.stats(sendingEndpoint);
+    if (ackRequested && deliveredOrder.size() == 20 && receivingStats.duplicates == 1 && receivingStats.delivered == 20) {
+        std::cout << "PASSED -- Reliable channel test 2" << std::endl;
+    } else std::cout << "FAILED -- Reliable channel test 2" << std::endl;
+
+    // A message that is never delivered gives up on its receiver, along with the rest of what it was sent
+    ChReliableChannel impatientChannel(3);
+    inFlight.clear();
+    for (int i = 0; i < 2; i++) {
+        ChPacketHandle datagram = makeReliableDatagram(reliablePool, CONTROL_MESSAGE);
+        impatientChannel.track(receivingEndpoint, datagram);
+        inFlight.push_back(ChReliableChannel::Datagram(receivingEndpoint, datagram));
+    }
+    int transmissions = 0;
+    auto giveUpDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (lostEndpoints.empty() && std::chrono::steady_clock::now() < giveUpDeadline) {
+        for (auto& datagram : inFlight) {
+            impatientChannel.stamp(datagram.first, datagram.second);
+            transmissions++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(RELIABLE_TICK));
+        inFlight.clear();
+        impatientChannel.collectRetransmits(inFlight, lostEndpoints);
+    }
+    if (transmissions == 6 && inFlight.empty() && lostEndpoints.size() == 1 && lostEndpoints[0] == receivingEndpoint &&
+        !impatientChannel.pending() && impatientChannel.stats(receivingEndpoint).sent == 0) {
+        std::cout << "PASSED -- Reliable channel test 3" << std::endl;
+    } else std::cout << "FAILED -- Reliable channel test 3" << std::endl;
+
+    // Send scheduler tests /////////////////////////////////////////////////////////////
+    ChSendScheduler scheduler;
+    boost::asio::ip::udp::endpoint busyEndpoint(boost::asio::ip::address_v4::loopback(), 9003);
+    boost::asio::ip::udp::endpoint quietEndpoint(boost::asio::ip::address_v4::loopback(), 9004);
+    for (uint32_t i = 0; i < 100; i++) scheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, 1000, i));
+    for (uint32_t i = 0; i < 5; i++) scheduler.enqueue(quietEndpoint, makeSizedDatagram(reliablePool, 1000, i));
+    // The quiet endpoint's datagrams take turns with the burst instead of waiting behind it
+    std::vector<ChSendScheduler::Datagram> scheduled;
+    scheduler.collect(scheduled, 10);
+    int quietScheduled = 0;
+    for (auto& datagram : scheduled) quietScheduled += datagram.first == quietEndpoint;
+    if (scheduled.size() == 10 && quietScheduled == 5 && scheduler.stats(busyEndpoint).depth == 95) {
+        std::cout << "PASSED -- Send scheduler test 1" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 1" << std::endl;
+
+    // 20 kB/s with a 2 kB bucket lets two 1000 byte datagrams out, then one every 50 ms
+    ChSendScheduler pacedScheduler;
+    pacedScheduler.setRate(busyEndpoint, 20000, 2000);
+    for (uint32_t i = 0; i < 5; i++) pacedScheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, 1000, i));
+    scheduled.clear();
+    auto paceWait = pacedScheduler.collect(scheduled, 32);
+    size_t burstSent = scheduled.size();
+    double waitMs = std::chrono::duration<double, std::milli>(paceWait).count();
+    std::this_thread::sleep_for(paceWait);
+    pacedScheduler.collect(scheduled, 32);
+    if (burstSent == 2 && waitMs > 40 && waitMs <= 50 && scheduled.size() == 3) {
+        std::cout << "PASSED -- Send scheduler test 2" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 2" << std::endl;
+
+    // A full queue drops its oldest unreliable datagrams
+    ChSendScheduler fullScheduler;
+    for (uint32_t i = 0; i < SEND_QUEUE_LIMIT + 10; i++) {
+        fullScheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, DATAGRAM_HEADER_SIZE, i));
+    }
+    ChSendStats fullStats = fullScheduler.stats(busyEndpoint);
+    scheduled.clear();
+    fullScheduler.collect(scheduled, 1);
+    ChDatagramHeader oldestKept;
+    readDatagramHeader(scheduled[0].second.data(), scheduled[0].second.size(), oldestKept);
+    if (fullStats.depth == SEND_QUEUE_LIMIT && fullStats.dropped == 10 && oldestKept.sequence == 10) {
+        std::cout << "PASSED -- Send scheduler test 3" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 3" << std::endl;
+
+    // Control traffic queued behind DSRC still goes out first
+    ChSendScheduler classScheduler;
+    for (uint32_t i = 0; i < 5; i++) {
+        classScheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, 200, i), TRAFFIC_DSRC);
+    }
+    for (uint32_t i = 0; i < 5; i++) {
+        classScheduler.enqueue(quietEndpoint, makeSizedDatagram(reliablePool, 200, 100 + i), TRAFFIC_CONTROL);
+    }
+    scheduled.clear();
+    classScheduler.collect(scheduled, 5);
+    bool controlFirst = scheduled.size() == 5;
+    for (auto& datagram : scheduled) controlFirst &= datagram.first == quietEndpoint;
+    if (controlFirst && classScheduler.stats(busyEndpoint).depthByClass[TRAFFIC_DSRC] == 5) {
+        std::cout << "PASSED -- Send scheduler test 4" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 4" << std::endl;
+
+    // Bulk traffic gets a turn once it has waited TRAFFIC_MAX_WAIT, however busy the classes above are
+    ChSendScheduler starvedScheduler;
+    starvedScheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, 200, 0), TRAFFIC_BULK);
+    for (uint32_t i = 0; i < 200; i++) {
+        starvedScheduler.enqueue(quietEndpoint, makeSizedDatagram(reliablePool, 200, i), TRAFFIC_STATE);
+    }
+    // A sender collecting a few at a time keeps the state class busy
+    long stateLeft = 0;
+    while (starvedScheduler.stats(busyEndpoint).depthByClass[TRAFFIC_BULK] > 0) {
+        scheduled.clear();
+        starvedScheduler.collect(scheduled, 4);
+        stateLeft = starvedScheduler.stats(quietEndpoint).depthByClass[TRAFFIC_STATE];
+        if (stateLeft == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (starvedScheduler.stats(busyEndpoint).depthByClass[TRAFFIC_BULK] == 0 && stateLeft > 0) {
+        std::cout << "PASSED -- Send scheduler test 5" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 5" << std::endl;
+
+    // An endpoint left idle is dropped, unless it was given a rate of its own
+    ChSendScheduler idleScheduler;
+    idleScheduler.setRate(quietEndpoint, 20000, 2000);
+    idleScheduler.enqueue(busyEndpoint, makeSizedDatagram(reliablePool, 200, 0));
+    scheduled.clear();
+    idleScheduler.collect(scheduled, 4);
+    bool idleCounted = scheduled.size() == 1 && idleScheduler.stats(busyEndpoint).sent == 1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(SEND_FLOW_IDLE + 10));
+    idleScheduler.collect(scheduled, 4);
+    if (idleCounted && idleScheduler.stats(busyEndpoint).sent == 0 && idleScheduler.stats(quietEndpoint).rate == 20000) {
+        std::cout << "PASSED -- Send scheduler test 6" << std::endl;
+    } else std::cout << "FAILED -- Send scheduler test 6" << std::endl;
+
+    // Update conflator tests ////////////////////////////////////////////////////////////
+    ChUpdateConflator conflator;
+    boost::asio::ip::udp::endpoint updateEndpoint(boost::asio::ip::address_v4::loopback(), 9000);
+    ChUpdateConflator::Key vehicleKey(3, 1);
+    std::vector<std::shared_ptr<google::protobuf::Message>> updates;
+    for (int i = 0; i < 4; i++) {
+        auto update = std::make_shared<ChronoMessages::VehicleMessage>();
+        update->set_chtime(i);
+        updates.push_back(update);
+    }
+    // Only the first offer needs a task; the rest fold into it, and an older one is dropped
+    bool scheduled1 = conflator.offer(vehicleKey, 1, updateEndpoint, updates[1]);
+    bool scheduled2 = conflator.offer(vehicleKey, 3, updateEndpoint, updates[3]);
+    bool scheduled3 = conflator.offer(vehicleKey, 2, updateEndpoint, updates[2]);
+    bool otherScheduled = conflator.offer(ChUpdateConflator::Key(3, 2), 0, updateEndpoint, updates[0]);
+    ChUpdateConflator::Update newest = conflator.take(vehicleKey);
+    if (scheduled1 && !scheduled2 && !scheduled3 && otherScheduled && newest.second == updates[3] &&
+        newest.first == updateEndpoint && conflator.superseded() == 2 && conflator.pending() == 1) {
+        std::cout << "PASSED -- Update conflator test 1" << std::endl;
+    } else std::cout << "FAILED -- Update conflator test 1" << std::endl;
+
+    // A straggler older than the applied state never comes back out, and a disconnect forgets everything
+    bool stragglerScheduled = conflator.offer(vehicleKey, 2, updateEndpoint, updates[2]);
+    bool emptyTake = !conflator.take(vehicleKey).second;
+    conflator.forget(3);
+    bool rescheduled = conflator.offer(vehicleKey, 0, updateEndpoint, updates[0]);
+    if (!stragglerScheduled && emptyTake && rescheduled && conflator.pending() == 1) {
+        std::cout << "PASSED -- Update conflator test 2" << std::endl;
+    } else std::cout << "FAILED -- Update conflator test 2" << std::endl;
+
+    // Compact vehicle tests ////////////////////////////////////////////////////////////
+    std::string bits;
+    ChBitWriter bitWriter(bits);
+    bitWriter.write(5, 3);
+    bitWriter.write(-300, 10);
+    bitWriter.write(0xdeadbeefu, 32);
+    bitWriter.writeRaw(-2.5);
+    bitWriter.finish();
+    ChBitReader bitReader(bits.data(), bits.size());
+    bool bitsRead = bitReader.read<unsigned>(3) == 5 && bitReader.read<int>(10) == -300 &&
+                    bitReader.read<uint32_t>(32) == 0xdeadbeefu && bitReader.readRaw<double>() == -2.5;
+    bool bitsOverrun = !bitReader.overrun();
+    bitReader.read<int>(8);
+    bitsOverrun = bitsOverrun && bitReader.overrun();
+    if (bitsRead && bitsOverrun && bits.size() == 14 && bitWriter.bitCount() == 112) {
+        std::cout << "PASSED -- Compact vehicle test 1" << std::endl;
+    } else std::cout << "FAILED -- Compact vehicle test 1" << std::endl;
+
+    // Every field comes back within half a step of what was sent, and rotations within the smallest three's error
+    std::mt19937 random(22);
+    std::uniform_real_distribution<double> spread(-1, 1);
+    auto fillVector = [&](ChronoMessages::MVector* vector, double x, double y, double z, double range) {
+        vector->set_x(x + range * spread(random));
+        vector->set_y(y + range * spread(random));
+        vector->set_z(z + range * spread(random));
+    };
+    auto fillRotation = [&](ChronoMessages::MQuaternion* quaternion) {
+        double e[4] = {spread(random), spread(random), spread(random), spread(random)};
+        double norm = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2] + e[3] * e[3]);
+        quaternion->set_e0(e[0] / norm);
+        quaternion->set_e1(e[1] / norm);
+        quaternion->set_e2(e[2] / norm);
+        quaternion->set_e3(e[3] / norm);
+    };
+    // Wheel i of a vehicle's arrays, in and out
+    auto setWheel = [](ChronoMessages::VehicleMessage* vehicle, int i, const ChronoMessages::MVector& position,
+                       const ChronoMessages::MQuaternion& rotation) {
+        double* p = vehicle->mutable_wheelpositions()->mutable_data() + WHEEL_POSITION_VALUES * i;
+        double* r = vehicle->mutable_wheelrotations()->mutable_data() + WHEEL_ROTATION_VALUES * i;
+        p[0] = position.x();
+        p[1] = position.y();
+        p[2] = position.z();
+        r[0] = rotation.e0();
+        r[1] = rotation.e1();
+        r[2] = rotation.e2();
+        r[3] = rotation.e3();
+    };
+    auto wheelPosition = [](const ChronoMessages::VehicleMessage& vehicle, int i) {
+        ChronoMessages::MVector position;
+        position.set_x(vehicle.wheelpositions(WHEEL_POSITION_VALUES * i));
+        position.set_y(vehicle.wheelpositions(WHEEL_POSITION_VALUES * i + 1));
+        position.set_z(vehicle.wheelpositions(WHEEL_POSITION_VALUES * i + 2));
+        return position;
+    };
+    auto wheelRotation = [](const ChronoMessages::VehicleMessage& vehicle, int i) {
+        ChronoMessages::MQuaternion rotation;
+        rotation.set_e0(vehicle.wheelrotations(WHEEL_ROTATION_VALUES * i));
+        rotation.set_e1(vehicle.wheelrotations(WHEEL_ROTATION_VALUES * i + 1));
+        rotation.set_e2(vehicle.wheelrotations(WHEEL_ROTATION_VALUES * i + 2));
+        rotation.set_e3(vehicle.wheelrotations(WHEEL_ROTATION_VALUES * i + 3));
+        return rotation;
+    };
+    auto fillCompactVehicle = [&](ChronoMessages::VehicleMessage* vehicle, int i, int wheels) {
+        vehicle->set_timestamp(-i);
+        vehicle->set_connectionnumber(i / 4);
+        vehicle->set_idnumber(i % 4);
+        vehicle->set_chtime(1000 + 10 * spread(random));
+        vehicle->set_speed(40 * spread(random));
+        fillVector(vehicle->mutable_chassiscom(), 1500, -300, 2, 2000);
+        fillRotation(vehicle->mutable_chassisrot());
+        const ChronoMessages::MVector& chassis = vehicle->chassiscom();
+        resizeWheels(vehicle, wheels);
+        for (int wheel = 0; wheel < wheels; wheel++) {
+            ChronoMessages::MVector position;
+            ChronoMessages::MQuaternion rotation;
+            fillVector(&position, chassis.x(), chassis.y(), chassis.z(), 3);
+            fillRotation(&rotation);
+            setWheel(vehicle, wheel, position, rotation);
+        }
+    };
+    auto vectorError = [](const ChronoMessages::MVector& a, const ChronoMessages::MVector& b) {
+        return std::max(std::fabs(a.x() - b.x()), std::max(std::fabs(a.y() - b.y()), std::fabs(a.z() - b.z())));
+    };
+    // q and -q are the same rotation
+    auto rotationError = [](const ChronoMessages::MQuaternion& a, const ChronoMessages::MQuaternion& b) {
+        double sign = a.e0() * b.e0() + a.e1() * b.e1() + a.e2() * b.e2() + a.e3() * b.e3() < 0 ? -1 : 1;
+        return std::max(std::max(std::fabs(a.e0() - sign * b.e0()), std::fabs(a.e1() - sign * b.e1())),
+                        std::max(std::fabs(a.e2() - sign * b.e2()), std::fabs(a.e3() - sign * b.e3())));
+    };
+    // Worst error over every field of every vehicle in two packets, in units of each field's bound
+    auto compactError = [&](const ChronoMessages::MessagePacket& sent, const ChronoMessages::MessagePacket& received,
+                            const ChVehicleQuantization& quantization) -> double {
+        double rotationBound = 3 / (std::sqrt(2.0) * (std::ldexp(1.0, quantization.quaternionBits) - 1));
+        double worst = sent.vehiclemessages_size() == received.vehiclemessages_size() ? 0 : INFINITY;
+        for (int i = 0; i < sent.vehiclemessages_size() && worst < INFINITY; i++) {
+            const ChronoMessages::VehicleMessage& a = sent.vehiclemessages(i);
+            const ChronoMessages::VehicleMessage& b = received.vehiclemessages(i);
+            if (a.timestamp() != b.timestamp() || a.connectionnumber() != b.connectionnumber() ||
+                a.idnumber() != b.idnumber()) {
+                return INFINITY;
+            }
+            worst = std::max(worst, std::fabs(a.chtime() - b.chtime()) / (quantization.timeResolution / 2));
+            worst = std::max(worst, std::fabs(a.speed() - b.speed()) / (quantization.speedResolution / 2));
+            worst = std::max(worst, vectorError(a.chassiscom(), b.chassiscom()) / (quantization.positionResolution / 2));
+            worst = std::max(worst, rotationError(a.chassisrot(), b.chassisrot()) / rotationBound);
+            if (wheelCount(a) != wheelCount(b)) return INFINITY;
+            for (int wheel = 0; wheel < wheelCount(a); wheel++) {
+                worst = std::max(worst, vectorError(wheelPosition(a, wheel), wheelPosition(b, wheel)) /
+                                            (quantization.wheelResolution / 2));
+                worst = std::max(worst, rotationError(wheelRotation(a, wheel), wheelRotation(b, wheel)) / rotationBound);
+            }
+        }
+        return worst;
+    };
+    ChronoMessages::MessagePacket compactSent;
+    compactSent.set_connectionnumber(0);
+    // Two to eight wheels, like the HMMWV up to the MAN 10t
+    for (int i = 0; i < 200; i++) fillCompactVehicle(compactSent.add_vehiclemessages(), i, 2 * (1 + i % 4));
+    ChronoMessages::ControlMessage* compactRemoval = compactSent.add_removals();
+    compactRemoval->set_connectionnumber(9);
+    compactRemoval->set_idnumber(7);
+    compactRemoval->set_action(ChronoMessages::ControlMessage::REMOVE_VEHICLE);
+    ChronoMessages::MessagePacket compactPacket(compactSent);
+    bool compacted = compactVehicles(compactPacket) && compactPacket.vehiclemessages_size() == 0;
+    ChronoMessages::MessagePacket compactReceived;
+    bool compactParsed = compactReceived.ParseFromString(compactPacket.SerializeAsString());
+    bool expanded = compactParsed && expandVehicles(compactReceived) && !compactReceived.has_compactvehicles();
+    double defaultError = compactError(compactSent, compactReceived, ChVehicleQuantization());
+    if (compacted && expanded && defaultError <= 1 + 1e-6 && compactReceived.removals_size() == 1 &&
+        compactVehicleBits(4) < 64 * 8) {
+        std::cout << "PASSED -- Compact vehicle test 2" << std::endl;
+    } else std::cout << "FAILED -- Compact vehicle test 2: " << defaultError << std::endl;
+
+    // A smaller budget costs accuracy only within its own bounds, a value out of range leaves the packet as it was,
+    // and a truncated field is refused whole
+    ChVehicleQuantization coarse;
+    coarse.quaternionBits = 6;
+    coarse.positionResolution = 0.01;
+    ChronoMessages::MessagePacket coarsePacket(compactSent);
+    bool coarseCompacted = compactVehicles(coarsePacket, coarse) &&
+                           coarsePacket.compactvehicles().size() < compactPacket.compactvehicles().size();
+    bool coarseExpanded = expandVehicles(coarsePacket);
+    double coarseError = compactError(compactSent, coarsePacket, coarse);
+    ChronoMessages::MessagePacket farPacket(compactSent);
+    farPacket.mutable_vehiclemessages(5)->set_wheelpositions(1, 1e4);
+    bool farRefused = !compactVehicles(farPacket) && farPacket.vehiclemessages_size() == 200 && !farPacket.has_compactvehicles();
+    ChronoMessages::MessagePacket unevenPacket(compactSent);
+    unevenPacket.mutable_vehiclemessages(7)->add_wheelrotations(1);
+    farRefused = farRefused && !compactVehicles(unevenPacket) && !unevenPacket.has_compactvehicles();
+    ChronoMessages::MessagePacket truncatedPacket(compactPacket);
+    truncatedPacket.mutable_compactvehicles()->resize(compactPacket.compactvehicles().size() / 2);
+    bool truncatedRefused = !expandVehicles(truncatedPacket) && truncatedPacket.vehiclemessages_size() == 0 &&
+                            truncatedPacket.has_compactvehicles();
+    if (coarseCompacted && coarseExpanded && coarseError <= 1 + 1e-6 && farRefused && truncatedRefused) {
+        std::cout << "PASSED -- Compact vehicle test 3" << std::endl;
+    } else std::cout << "FAILED -- Compact vehicle test 3: " << coarseError << std::endl;
+
+    // Wheel kinematics tests ///////////////////////////////////////////////////////////
+    // Wheels posed from spin, steer and travel reduce back to them, and rebuild to the same poses, in less space
+    vehicleGeometry kinematicsGeometry;
+    double hardpoints[4][3] = {{1.7, -0.9, -0.1}, {1.7, 0.9, -0.1}, {-1.6, -0.9, -0.1}, {-1.6, 0.9, -0.1}};
+    for (auto& hardpoint : hardpoints) {
+        ChronoMessages::MVector vector;
+        vector.set_x(hardpoint[0]);
+        vector.set_y(hardpoint[1]);
+        vector.set_z(hardpoint[2]);
+        kinematicsGeometry.hardpoints.push_back(vector);
+    }
+    double kinematicsError = 0;
+    bool kinematicsSmaller = true;
+    for (int i = 0; i < 100; i++) {
+        ChronoMessages::VehicleMessage posed;
+        fillCompactVehicle(&posed, i, 4);
+        double spin[4], steer[4], travel[4];
+        for (int wheel = 0; wheel < 4; wheel++) {
+            spin[wheel] = 3 * spread(random);
+            steer[wheel] = wheel < 2 ? 0.6 * spread(random) : 0;
+            travel[wheel] = 0.2 * spread(random);
+            ChronoMessages::MVector position;
+            ChronoMessages::MQuaternion rotation;
+            rebuildWheel(posed.chassiscom(), posed.chassisrot(), kinematicsGeometry.hardpoints[wheel], spin[wheel],
+                         steer[wheel], travel[wheel], &position, &rotation);
+            setWheel(&posed, wheel, position, rotation);
+        }
+        ChronoMessages::ReducedVehicleMessage reduced;
+        ChronoMessages::VehicleMessage rebuilt;
+        if (!reduceVehicleMessage(posed, kinematicsGeometry, &reduced) ||
+            !rebuildVehicleMessage(reduced, kinematicsGeometry, &rebuilt)) {
+            kinematicsError = INFINITY;
+            break;
+        }
+        for (int wheel = 0; wheel < 4; wheel++) {
+            kinematicsError = std::max(kinematicsError, std::fabs(reduced.wheelspin(wheel) - spin[wheel]));
+            kinematicsError = std::max(kinematicsError, std::fabs(reduced.wheelsteer(wheel) - steer[wheel]));
+            kinematicsError = std::max(kinematicsError, std::fabs(reduced.wheeltravel(wheel) - travel[wheel]));
+        }
+        for (int wheel = 0; wheel < 4; wheel++) {
+            kinematicsError = std::max(kinematicsError, vectorError(wheelPosition(posed, wheel), wheelPosition(rebuilt, wheel)));
+            kinematicsError = std::max(kinematicsError, rotationError(wheelRotation(posed, wheel), wheelRotation(rebuilt, wheel)));
+        }
+        kinematicsSmaller = kinematicsSmaller && reduced.ByteSize() < posed.ByteSize();
+    }
+    if (kinematicsError < 1e-9 && kinematicsSmaller) {
+        std::cout << "PASSED -- Wheel kinematics test 1" << std::endl;
+    } else std::cout << "FAILED -- Wheel kinematics test 1: " << kinematicsError << std::endl;
+
+    // A vehicle at rest gives back its own hardpoints, and a wheel the message or geometry lacks isn't rebuilt
+    ChronoMessages::VehicleMessage resting;
+    fillCompactVehicle(&resting, 0, 4);
+    for (int wheel = 0; wheel < 4; wheel++) {
+        ChronoMessages::MVector position;
+        ChronoMessages::MQuaternion rotation;
+        rebuildWheel(resting.chassiscom(), resting.chassisrot(), kinematicsGeometry.hardpoints[wheel], 0, 0, 0,
+                     &position, &rotation);
+        setWheel(&resting, wheel, position, rotation);
+    }
+    vehicleGeometry restingGeometry = geometryFromVehicleMessage(resting);
+    double restingError = restingGeometry.hardpoints.size() == 4 ? 0 : INFINITY;
+    for (size_t wheel = 0; wheel < restingGeometry.hardpoints.size(); wheel++) {
+        restingError = std::max(restingError, vectorError(restingGeometry.hardpoints[wheel], kinematicsGeometry.hardpoints[wheel]));
+    }
+    ChronoMessages::ReducedVehicleMessage partial;
+    partial.add_wheelspin(0);
+    partial.add_wheelsteer(0);
+    partial.add_wheeltravel(0);
+    ChronoMessages::MVector partialPosition;
+    ChronoMessages::MQuaternion partialRotation;
+    ChronoMessages::VehicleMessage partialVehicle;
+    if (restingError < 1e-9 && rebuildWheel(partial, kinematicsGeometry, 0, &partialPosition, &partialRotation) &&
+        !rebuildWheel(partial, kinematicsGeometry, 1, &partialPosition, &partialRotation) &&
+        !rebuildWheel(partial, kinematicsGeometry, -1, &partialPosition, &partialRotation) &&
+        !rebuildVehicleMessage(partial, kinematicsGeometry, &partialVehicle)) {
+        std::cout << "PASSED -- Wheel kinematics test 2" << std::endl;
+    } else std::cout << "FAILED -- Wheel kinematics test 2: " << restingError << std::endl;
+
+    // A vehicle reduced against one model's hardpoints carries that model, and isn't rebuilt on another's
+    vehicleGeometry hmmwvGeometry = geometryFromVehicleMessage(resting, VEHICLE_MODEL_HMMWV);
+    vehicleGeometry otherGeometry = geometryFromVehicleMessage(resting, VEHICLE_MODEL_HMMWV + 1);
+    ChronoMessages::ReducedVehicleMessage modelled;
+    ChronoMessages::VehicleMessage modelledVehicle;
+    if (reduceVehicleMessage(resting, hmmwvGeometry, &modelled) && modelled.model() == VEHICLE_MODEL_HMMWV &&
+        rebuildVehicleMessage(modelled, hmmwvGeometry, &modelledVehicle) &&
+        !rebuildVehicleMessage(modelled, otherGeometry, &modelledVehicle) &&
+        !rebuildWheel(modelled, otherGeometry, 0, &partialPosition, &partialRotation) &&
+        !rebuildWheel(modelled, kinematicsGeometry, 0, &partialPosition, &partialRotation)) {
+        std::cout << "PASSED -- Wheel kinematics test 3" << std::endl;
+    } else std::cout << "FAILED -- Wheel kinematics test 3" << std::endl;
 
     // Client connection tests //////////////////////////////////////////////////////////
     try {
@@ -132,6 +848,9 @@ int main(int argc, char **argv) {
         } else std::cout << "FAILED -- Client connection test 1: " << exp.what() << std::endl;
     }
     boost::asio::io_service ioService;
+    boost::asio::ip::udp::socket fakeServer(ioService);
+    fakeServer.open(boost::asio::ip::udp::v4());
+    fakeServer.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 8082));
 
     std::thread client1([&] {
         try {
@@ -144,22 +863,9 @@ int main(int argc, char **argv) {
         }
     });
 
-    boost::asio::ip::tcp::acceptor acceptor(ioService, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 8082));
-    boost::asio::ip::tcp::socket tcpSocket1(ioService);
-    acceptor.accept(tcpSocket1);
-
-
-    uint8_t requestMessage;
-    tcpSocket1.receive(boost::asio::buffer(&requestMessage, sizeof(uint8_t)));
-    uint8_t declineMessage = CONNECTION_DECLINE;
-    tcpSocket1.send(boost::asio::buffer(&declineMessage, sizeof(uint8_t)));
-
+    answerHandshake(fakeServer, CONNECTION_DECLINE, 0);
     client1.join();
 
-    tcpSocket1.close();
-
-    boost::asio::ip::tcp::socket tcpSocket2(ioService);
-
     std::thread client2([&] {
         try {
             ChClientHandler clientHandler("localhost", "8082");
@@ -171,62 +877,233 @@ int main(int argc, char **argv) {
         }
     });
 
-    acceptor.accept(tcpSocket2);
-    tcpSocket2.receive(boost::asio::buffer(&requestMessage, sizeof(uint8_t)));
-    uint8_t acceptMessage = CONNECTION_ACCEPT;
-    tcpSocket2.send(boost::asio::buffer(&acceptMessage, sizeof(uint8_t)));
-    uint32_t connectionNumber = 0;
-    tcpSocket2.send(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
+    answerHandshake(fakeServer, CONNECTION_ACCEPT, 0);
     client2.join();
-    tcpSocket2.close();
-    acceptor.close();
+
+    // Client mailbox tests //////////////////////////////////////////////////////////
+    // States pushed before the sender starts wait in the mailbox, and only the newest of each vehicle goes out
+    HMMWV_Full mailboxHMMWV = generateTestVehicle();
+    ChronoMessages::VehicleMessage mailboxVehicle = generateVehicleMessageFromWheeledVehicle(&mailboxHMMWV.GetVehicle(), 0, 0);
+    std::atomic<bool> mailboxRead(false);
+    long supersededCount = 0;
+    std::thread client3([&] {
+        ChClientHandler clientHandler("localhost", "8082");
+        ChronoMessages::VehicleMessage state = mailboxVehicle;
+        state.set_idnumber(1);
+        for (int i = 0; i < 50; i++) {
+            state.set_speed(i);
+            clientHandler.pushMessage(state);
+        }
+        state.set_idnumber(2);
+        clientHandler.pushMessage(state);
+        supersededCount = clientHandler.supersededStates();
+        clientHandler.beginSend();
+        while (!mailboxRead) std::this_thread::yield();
+    });
+
+    answerHandshake(fakeServer, CONNECTION_ACCEPT, 0);
+    std::map<int, double> sentSpeeds;
+    int sentStates = 0;
+    fakeServer.non_blocking(true);
+    auto mailboxDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < mailboxDeadline) {
+        char datagram[PACKET_SLAB_SIZE];
+        boost::asio::ip::udp::endpoint from;
+        boost::system::error_code error;
+        size_t size = fakeServer.receive_from(boost::asio::buffer(datagram, sizeof(datagram)), from, 0, error);
+        if (error) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        ChDatagramHeader header;
+        ChronoMessages::VehicleMessage received;
+        if (readDatagramHeader(datagram, size, header) && header.type == VEHICLE_MESSAGE &&
+            received.ParseFromArray(datagram + DATAGRAM_HEADER_SIZE, header.payloadSize)) {
+            sentStates++;
+            sentSpeeds[received.idnumber()] = received.speed();
+        }
+    }
+    mailboxRead = true;
+    client3.join();
+    if (sentStates == 2 && sentSpeeds[1] == 49 && sentSpeeds.count(2) == 1 && supersededCount == 49) {
+        std::cout << "PASSED -- Client mailbox test 1" << std::endl;
+    } else std::cout << "FAILED -- Client mailbox test 1" << std::endl;
+    fakeServer.close();
 
     // Server connection tests ///////////////////////////////////////////////////////////////////
     ChServerHandler *serverHandler = new ChServerHandler(world, worldQueue, 8082);
+    serverHandler->beginListen();
+    serverHandler->beginSend();
 
-    boost::asio::ip::tcp::socket tcpSocket3(ioService);
-    boost::asio::ip::tcp::resolver tcpResolver(ioService);
-    boost::asio::ip::tcp::resolver::query tcpQuery("localhost", "8082");
-    uint8_t requestResponse;
-    boost::asio::ip::tcp::resolver::iterator endpointIterator = tcpResolver.resolve(tcpQuery);
-    boost::asio::connect(tcpSocket3, endpointIterator);
-
-    uint8_t connectionRequest = CONNECTION_REQUEST;
-    tcpSocket3.send(boost::asio::buffer(&connectionRequest, sizeof(uint8_t)));
-    tcpSocket3.receive(boost::asio::buffer(&requestResponse, sizeof(uint8_t)));
-    if(requestResponse == CONNECTION_ACCEPT) {
-        uint32_t connectionNumber;
-        tcpSocket3.receive(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
-        if (connectionNumber == 0) {
-            std::cout << "PASSED -- Server connection test 1" << std::endl;
-        } else std::cout << "FAILED -- Server connection test 1" << std::endl;
+    boost::asio::ip::udp::resolver udpResolver(ioService);
+    boost::asio::ip::udp::resolver::query udpQuery(boost::asio::ip::udp::v4(), "localhost", "8082");
+    boost::asio::ip::udp::endpoint serverEndpoint = *udpResolver.resolve(udpQuery);
+    boost::asio::ip::udp::socket requester1(ioService);
+    boost::asio::ip::udp::socket requester2(ioService);
+    requester1.open(boost::asio::ip::udp::v4());
+    requester2.open(boost::asio::ip::udp::v4());
+
+    // A first request is only challenged; echoing the cookie connects
+    uint8_t replyType;
+    uint64_t cookie = 0;
+    uint64_t connectionNumber = 0;
+    bool challenged = exchangeHandshake(requester1, serverEndpoint, CONNECTION_REQUEST, 0, replyType, cookie) &&
+                      replyType == CONNECTION_CHALLENGE && cookie != 0;
+    if (challenged && exchangeHandshake(requester1, serverEndpoint, CONNECTION_REQUEST, cookie, replyType, connectionNumber) &&
+        replyType == CONNECTION_ACCEPT && connectionNumber == 0) {
+        std::cout << "PASSED -- Server connection test 1" << std::endl;
     } else std::cout << "FAILED -- Server connection test 1" << std::endl;
 
-    boost::asio::connect(tcpSocket3, endpointIterator);
-    tcpSocket3.send(boost::asio::buffer(&connectionRequest, sizeof(uint8_t)));
-    tcpSocket3.receive(boost::asio::buffer(&requestResponse, sizeof(uint8_t)));
-    if(requestResponse == CONNECTION_ACCEPT) {
-        uint32_t connectionNumber;
-        tcpSocket3.receive(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
-        if (connectionNumber == 1) {
-            std::cout << "PASSED -- Server connection test 2" << std::endl;
-        } else std::cout << "FAILED -- Server connection test 2" << std::endl;
+    uint64_t otherCookie = 0;
+    exchangeHandshake(requester2, serverEndpoint, CONNECTION_REQUEST, 0, replyType, otherCookie);
+    if (exchangeHandshake(requester2, serverEndpoint, CONNECTION_REQUEST, otherCookie, replyType, connectionNumber) &&
+        replyType == CONNECTION_ACCEPT && connectionNumber == 1) {
+        std::cout << "PASSED -- Server connection test 2" << std::endl;
     } else std::cout << "FAILED -- Server connection test 2" << std::endl;
 
-    boost::asio::connect(tcpSocket3, endpointIterator);
-    connectionRequest = 100;
-    tcpSocket3.send(boost::asio::buffer(&connectionRequest, sizeof(uint8_t)));
-    tcpSocket3.receive(boost::asio::buffer(&requestResponse, sizeof(uint8_t)));
-    if(requestResponse == CONNECTION_DECLINE) {
+    uint64_t declineValue;
+    if (exchangeHandshake(requester1, serverEndpoint, 100, 0, replyType, declineValue) && replyType == CONNECTION_DECLINE) {
         std::cout << "PASSED -- Server connection test 3" << std::endl;
     } else std::cout << "FAILED -- Server connection test 3" << std::endl;
 
-    tcpSocket3.close();
+    // Another endpoint's cookie is challenged again, and a repeated request keeps its number
+    uint64_t rechallenge = 0;
+    bool stolenRefused = exchangeHandshake(requester2, serverEndpoint, CONNECTION_REQUEST, cookie, replyType, rechallenge) &&
+                         replyType == CONNECTION_CHALLENGE && rechallenge == otherCookie;
+    if (stolenRefused && exchangeHandshake(requester1, serverEndpoint, CONNECTION_REQUEST, cookie, replyType, connectionNumber) &&
+        replyType == CONNECTION_ACCEPT && connectionNumber == 0) {
+        std::cout << "PASSED -- Server connection test 4" << std::endl;
+    } else std::cout << "FAILED -- Server connection test 4" << std::endl;
+
+    // Each number belongs to the endpoint that completed the handshake for it
+    boost::asio::ip::address loopback = boost::asio::ip::address_v4::loopback();
+    boost::asio::ip::udp::endpoint requesterEndpoint1(loopback, requester1.local_endpoint().port());
+    boost::asio::ip::udp::endpoint requesterEndpoint2(loopback, requester2.local_endpoint().port());
+    boost::asio::ip::udp::endpoint strangerEndpoint(loopback, 1);
+    if (serverHandler->connectionOf(requesterEndpoint1) == 0 && serverHandler->connectionOf(requesterEndpoint2) == 1 &&
+        serverHandler->connectionOf(strangerEndpoint) == -1) {
+        std::cout << "PASSED -- Server connection test 5" << std::endl;
+    } else std::cout << "FAILED -- Server connection test 5" << std::endl;
+
+    // Garbage, messages of no known type and payloads that don't parse are
+    // dropped, and what follows them still arrives
+    ChronoMessages::DSRCMessage afterGarbage;
+    afterGarbage.set_idnumber(0);
+    afterGarbage.set_timestamp(0);
+    afterGarbage.set_chtime(0);
+    afterGarbage.mutable_vehiclepos()->set_x(0);
+    afterGarbage.mutable_vehiclepos()->set_y(0);
+    afterGarbage.mutable_vehiclepos()->set_z(0);
+    afterGarbage.set_buffer("after garbage");
+    std::ostringstream unknownType;
+    std::ostringstream unparsable;
+    std::ostringstream wellFormed;
+    serializeWithHeader(unknownType, 200, afterGarbage);
+    serializeWithHeader(unparsable, DSRC_MESSAGE, afterGarbage);
+    serializeWithHeader(wellFormed, DSRC_MESSAGE, afterGarbage);
+    std::string garbled = unparsable.str();
+    garbled.replace(DATAGRAM_HEADER_SIZE, std::string::npos, garbled.size() - DATAGRAM_HEADER_SIZE, '\xff');
+    requester1.send_to(boost::asio::buffer("x", 1), serverEndpoint);
+    requester1.send_to(boost::asio::buffer(unknownType.str()), serverEndpoint);
+    requester1.send_to(boost::asio::buffer(garbled), serverEndpoint);
+    requester1.send_to(boost::asio::buffer(wellFormed.str()), serverEndpoint);
+    auto afterGarbagePair = serverHandler->popMessage();
+    auto receivedAfterGarbage = std::dynamic_pointer_cast<ChronoMessages::DSRCMessage>(afterGarbagePair.second);
+    if (receivedAfterGarbage && receivedAfterGarbage->buffer() == "after garbage" &&
+        serverHandler->malformedMessages() == 3) {
+        std::cout << "PASSED -- Server connection test 6" << std::endl;
+    } else std::cout << "FAILED -- Server connection test 6: " << serverHandler->malformedMessages() << std::endl;
+
+    // A forgotten endpoint keeps nothing, and connecting again gives it a new number
+    bool hadSequence = serverHandler->sequenceStats(requesterEndpoint1).received > 0;
+    serverHandler->forgetEndpoint(requesterEndpoint1);
+    bool forgotten = serverHandler->connectionOf(requesterEndpoint1) == -1 &&
+                     serverHandler->sequenceStats(requesterEndpoint1).received == 0 &&
+                     serverHandler->connectionOf(requesterEndpoint2) == 1;
+    if (hadSequence && forgotten &&
+        exchangeHandshake(requester1, serverEndpoint, CONNECTION_REQUEST, cookie, replyType, connectionNumber) &&
+        replyType == CONNECTION_ACCEPT && connectionNumber == 2) {
+        std::cout << "PASSED -- Server connection test 7" << std::endl;
+    } else std::cout << "FAILED -- Server connection test 7" << std::endl;
+
+    // Only handshakes are answered for an endpoint that never connected; anything else is dropped unread
+    boost::asio::ip::udp::socket stranger(ioService);
+    stranger.open(boost::asio::ip::udp::v4());
+    std::ostringstream fromStranger;
+    std::ostringstream fromConnected;
+    afterGarbage.set_buffer("from a stranger");
+    serializeWithHeader(fromStranger, DSRC_MESSAGE, afterGarbage);
+    afterGarbage.set_buffer("from a connection");
+    serializeWithHeader(fromConnected, DSRC_MESSAGE, afterGarbage);
+    stranger.send_to(boost::asio::buffer(fromStranger.str()), serverEndpoint);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    requester2.send_to(boost::asio::buffer(fromConnected.str()), serverEndpoint);
+    auto connectedPair = serverHandler->popMessage();
+    auto receivedConnected = std::dynamic_pointer_cast<ChronoMessages::DSRCMessage>(connectedPair.second);
+    boost::asio::ip::udp::endpoint strangerSender(loopback, stranger.local_endpoint().port());
+    if (receivedConnected && receivedConnected->buffer() == "from a connection" &&
+        serverHandler->unconnectedMessages() == 1 && serverHandler->sequenceStats(strangerSender).received == 0) {
+        std::cout << "PASSED -- Server connection test 8" << std::endl;
+    } else std::cout << "FAILED -- Server connection test 8" << std::endl;
+    stranger.close();
+
+    requester1.close();
+    requester2.close();
+
+    // One serialization reaches every endpoint, each numbered in its own sequence
+    boost::asio::ip::udp::socket listener1(ioService, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    boost::asio::ip::udp::socket listener2(ioService, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    std::vector<boost::asio::ip::udp::endpoint> listeners = {listener1.local_endpoint(), listener2.local_endpoint()};
+    ChronoMessages::MessagePacket broadcastPacket;
+    broadcastPacket.set_connectionnumber(-1);
+    serverHandler->broadcastMessage(listeners, broadcastPacket);
+    serverHandler->broadcastMessage(listeners, broadcastPacket);
+    bool broadcastReceived = true;
+    for (boost::asio::ip::udp::socket* listener : {&listener1, &listener2}) {
+        for (uint32_t sequence = 0; sequence < 2; sequence++) {
+            char datagram[PACKET_SLAB_SIZE];
+            boost::asio::ip::udp::endpoint from;
+            size_t size = listener->receive_from(boost::asio::buffer(datagram, sizeof(datagram)), from);
+            ChDatagramHeader header;
+            ChronoMessages::MessagePacket received;
+            broadcastReceived = broadcastReceived && readDatagramHeader(datagram, size, header) &&
+                                header.type == MESSAGE_PACKET && header.sequence == sequence &&
+                                received.ParseFromArray(datagram + DATAGRAM_HEADER_SIZE, header.payloadSize) &&
+                                received.connectionnumber() == -1;
+        }
+    }
+    if (broadcastReceived) {
+        std::cout << "PASSED -- Server broadcast test 1" << std::endl;
+    } else std::cout << "FAILED -- Server broadcast test 1" << std::endl;
+
+    // A cached serialization goes out again without being stamped itself
+    std::shared_ptr<const ChSerializedMessage> cached = serverHandler->serializeBroadcast(broadcastPacket);
+    serverHandler->broadcastSerialized(listeners, *cached);
+    serverHandler->broadcastSerialized(listeners, *cached);
+    bool cachedReceived = cached->datagrams.size() == 1;
+    for (boost::asio::ip::udp::socket* listener : {&listener1, &listener2}) {
+        for (uint32_t sequence = 2; sequence < 4; sequence++) {
+            char datagram[PACKET_SLAB_SIZE];
+            boost::asio::ip::udp::endpoint from;
+            size_t size = listener->receive_from(boost::asio::buffer(datagram, sizeof(datagram)), from);
+            ChDatagramHeader header;
+            cachedReceived = cachedReceived && readDatagramHeader(datagram, size, header) &&
+                             header.type == MESSAGE_PACKET && header.sequence == sequence;
+        }
+    }
+    ChDatagramHeader cachedHeader;
+    cachedReceived = cachedReceived && readDatagramHeader(cached->datagrams[0].data(), cached->datagrams[0].size(), cachedHeader) &&
+                     cachedHeader.sequence == 0;
+    if (cachedReceived) {
+        std::cout << "PASSED -- Server broadcast test 2" << std::endl;
+    } else std::cout << "FAILED -- Server broadcast test 2" << std::endl;
+    listener1.close();
+    listener2.close();
 
     // Server-client integration test
     ChClientHandler *clientHandler = new ChClientHandler("localhost", "8082");
 
-    if (clientHandler->connectionNumber() == 2) {
+    if (clientHandler->connectionNumber() == 3) {
         std::cout << "PASSED -- Server-client integration test 1" << std::endl;
     } else std::cout << "FAILED -- Server-client integration test 1" << std::endl;
 
@@ -234,6 +1111,8 @@ int main(int argc, char **argv) {
     delete serverHandler;
 
     ChServerHandler *serverHandler2 = new ChServerHandler(world, worldQueue, 8082);
+    serverHandler2->beginListen();
+    serverHandler2->beginSend();
     ChClientHandler *clientHandler2 = new ChClientHandler("localhost", "8082");
 
     if (clientHandler2->connectionNumber() == 0) {
@@ -243,9 +1122,259 @@ int main(int argc, char **argv) {
     delete clientHandler2;
     delete serverHandler2;
 
+    // Asynchronous server tests
+    ChServerHandler *asyncServer = new ChServerHandler(world, worldQueue, 8082, 2);
+    asyncServer->beginListen();
+    asyncServer->beginSend();
+    ChClientHandler *asyncClient = new ChClientHandler("localhost", "8082");
+    asyncClient->beginListen();
+    asyncClient->beginSend();
+
+    if (asyncClient->connectionNumber() == 0) {
+        std::cout << "PASSED -- Async server test 1" << std::endl;
+    } else std::cout << "FAILED -- Async server test 1" << std::endl;
+
+    ChronoMessages::MessagePacket asyncPacket;
+    asyncPacket.set_connectionnumber(0);
+    ChronoMessages::DSRCMessage* asyncDSRC = asyncPacket.add_dsrcmessages();
+    asyncDSRC->set_timestamp(0);
+    asyncDSRC->set_chtime(0);
+    asyncDSRC->set_idnumber(0);
+    asyncDSRC->mutable_vehiclepos()->set_x(0);
+    asyncDSRC->mutable_vehiclepos()->set_y(0);
+    asyncDSRC->mutable_vehiclepos()->set_z(0);
+    asyncDSRC->set_buffer("async");
+    asyncClient->pushMessage(asyncPacket);
+
+    auto asyncPair = asyncServer->popMessage();
+    if (asyncPair.second->DebugString().compare(asyncPacket.DebugString()) == 0) {
+        std::cout << "PASSED -- Async server test 2" << std::endl;
+    } else std::cout << "FAILED -- Async server test 2" << std::endl;
+
+    asyncServer->pushMessage(asyncPair.first, asyncPacket);
+    if (asyncClient->popDSRCMessage()->buffer().compare("async") == 0) {
+        std::cout << "PASSED -- Async server test 3" << std::endl;
+    } else std::cout << "FAILED -- Async server test 3" << std::endl;
+
+    delete asyncClient;
+    delete asyncServer;
+
+    // Sharded server tests
+    ChServerHandler *shardedServer = new ChServerHandler(world, worldQueue, 8082, THREADED_SERVER, 4);
+    shardedServer->beginListen();
+    shardedServer->beginSend();
+    ChClientHandler *shardedClient = new ChClientHandler("localhost", "8082");
+    shardedClient->beginListen();
+    shardedClient->beginSend();
+
+    bool inOrder = true;
+    for (int i = 0; i < 10; i++) {
+        asyncDSRC->set_idnumber(i);
+        shardedClient->pushMessage(asyncPacket);
+    }
+    for (int i = 0; i < 10; i++) {
+        auto shardedPair = shardedServer->popMessage();
+        auto shardedPacket = std::static_pointer_cast<ChronoMessages::MessagePacket>(shardedPair.second);
+        inOrder &= shardedPacket->dsrcmessages(0).idnumber() == i;
+    }
+    if (inOrder) {
+        std::cout << "PASSED -- Sharded server test 1" << std::endl;
+    } else std::cout << "FAILED -- Sharded server test 1" << std::endl;
+
+    delete shardedClient;
+    delete shardedServer;
+
+    // Fragmented world packets
+    ChServerHandler *fragmentServer = new ChServerHandler(world, worldQueue, 8082);
+    fragmentServer->beginListen();
+    fragmentServer->beginSend();
+    ChClientHandler *fragmentClient = new ChClientHandler("localhost", "8082");
+    fragmentClient->beginListen();
+    fragmentClient->beginSend();
+
+    HMMWV_Full fragmentHMMWV = generateTestVehicle();
+    ChronoMessages::VehicleMessage fragmentVehicle = generateVehicleMessageFromWheeledVehicle(&fragmentHMMWV.GetVehicle(), 0, 0);
+    fragmentClient->pushMessage(fragmentVehicle);
+    auto fragmentPair = fragmentServer->popMessage();
+
+    int vehicleCounts[] = {10, 100, 1000};
+    int fragmentTest = 3;
+    for (int vehicleCount : vehicleCounts) {
+        ChronoMessages::MessagePacket worldPacket;
+        worldPacket.set_connectionnumber(-1);
+        for (int i = 0; i < vehicleCount; i++) {
+            fragmentVehicle.set_idnumber(i);
+            *worldPacket.add_vehiclemessages() = fragmentVehicle;
+        }
+        fragmentServer->pushMessage(fragmentPair.first, worldPacket);
+        bool allArrived = true;
+        for (int i = 0; i < vehicleCount; i++) {
+            auto vehicle = std::static_pointer_cast<ChronoMessages::VehicleMessage>(fragmentClient->popSimMessage());
+            allArrived &= vehicle->idnumber() == i;
+        }
+        if (allArrived) {
+            std::cout << "PASSED -- Fragment test " << fragmentTest << ": " << vehicleCount << " vehicles" << std::endl;
+        } else std::cout << "FAILED -- Fragment test " << fragmentTest << ": " << vehicleCount << " vehicles" << std::endl;
+        fragmentTest++;
+    }
+
+    // Past FRAGMENT_MAX_MESSAGE_SIZE nothing is sent, but the drop is counted
+    ChronoMessages::MessagePacket oversizedPacket;
+    oversizedPacket.set_connectionnumber(-1);
+    for (int i = 0; i < 10000; i++) {
+        fragmentVehicle.set_idnumber(i);
+        *oversizedPacket.add_vehiclemessages() = fragmentVehicle;
+    }
+    std::vector<boost::asio::ip::udp::endpoint> oversizedTargets(1, fragmentPair.first);
+    long sentBefore = fragmentServer->sendStats(fragmentPair.first).sent;
+    fragmentServer->pushMessage(fragmentPair.first, oversizedPacket);
+    fragmentServer->broadcastMessage(oversizedTargets, oversizedPacket);
+    ChSendStats oversizedStats = fragmentServer->sendStats(fragmentPair.first);
+    if (oversizedStats.oversized == 2 && oversizedStats.depth == 0 && oversizedStats.sent == sentBefore) {
+        std::cout << "PASSED -- Fragment test " << fragmentTest << ": oversized" << std::endl;
+    } else std::cout << "FAILED -- Fragment test " << fragmentTest << ": oversized" << std::endl;
+
+    delete fragmentClient;
+    delete fragmentServer;
+
+    // Compression tests ////////////////////////////////////////////////////////////////
+    ChronoMessages::MessagePacket compressedPacket;
+    compressedPacket.set_connectionnumber(-1);
+    for (int i = 0; i < 100; i++) {
+        fragmentVehicle.set_idnumber(i);
+        *compressedPacket.add_vehiclemessages() = fragmentVehicle;
+    }
+    std::string packetBytes = compressedPacket.SerializeAsString();
+    auto compressor = std::make_shared<ChPacketCompressor>(defaultCompressionDictionary());
+    std::vector<char> compressedBytes(packetBytes.size());
+    size_t compressedSize = compressor->compress(packetBytes.data(), packetBytes.size(), compressedBytes.data(),
+                                                 compressedBytes.size());
+    std::vector<char> expandedBytes(ChPacketCompressor::decompressedSize(compressedBytes.data(), compressedSize));
+    bool roundTrip = compressedSize > 0 && expandedBytes.size() == packetBytes.size() &&
+                     compressor->decompress(compressedBytes.data(), compressedSize, expandedBytes.data()) &&
+                     std::string(expandedBytes.begin(), expandedBytes.end()) == packetBytes;
+    // Cut short, corrupted, or with no room to compress into
+    bool truncated = !compressor->decompress(compressedBytes.data(), compressedSize / 2, expandedBytes.data());
+    compressedBytes[compressedSize / 2] ^= 0x5a;
+    bool corrupted = !compressor->decompress(compressedBytes.data(), compressedSize, expandedBytes.data()) ||
+                     std::string(expandedBytes.begin(), expandedBytes.end()) != packetBytes;
+    bool tooSmall = compressor->compress(packetBytes.data(), packetBytes.size(), compressedBytes.data(), 16) == 0;
+    // The shipped dictionary is the one its id says
+    bool shipped = compressor->dictionaryId() == DEFAULT_COMPRESSION_DICTIONARY_ID;
+    if (roundTrip && compressedSize < packetBytes.size() && truncated && corrupted && tooSmall && shipped) {
+        std::cout << "PASSED -- Compression test 1" << std::endl;
+    } else std::cout << "FAILED -- Compression test 1: " << compressedSize << " of " << packetBytes.size() << std::endl;
+
+    // Both ends offer the same dictionary, so world packets and vehicle updates go compressed
+    ChServerHandler *compressionServer = new ChServerHandler(world, worldQueue, 8082);
+    compressionServer->setCompressor(compressor);
+    compressionServer->beginListen();
+    compressionServer->beginSend();
+    ChClientHandler *compressionClient = new ChClientHandler("localhost", "8082", compressor);
+    compressionClient->beginListen();
+    compressionClient->beginSend();
+    compressionClient->pushMessage(fragmentVehicle);
+    compressionClient->pushMessage(compressedPacket);
+    std::shared_ptr<ChronoMessages::VehicleMessage> compressedVehicle;
+    std::shared_ptr<ChronoMessages::MessagePacket> receivedPacket;
+    boost::asio::ip::udp::endpoint compressionEndpoint;
+    for (int i = 0; i < 2; i++) {
+        auto compressedPair = compressionServer->popMessage();
+        compressionEndpoint = compressedPair.first;
+        auto vehicle = std::dynamic_pointer_cast<ChronoMessages::VehicleMessage>(compressedPair.second);
+        auto packet = std::dynamic_pointer_cast<ChronoMessages::MessagePacket>(compressedPair.second);
+        if (vehicle) compressedVehicle = vehicle;
+        if (packet) receivedPacket = packet;
+    }
+    compressionServer->pushMessage(compressionEndpoint, compressedPacket);
+    bool packetArrived = true;
+    for (int i = 0; i < 100; i++) {
+        auto vehicle = std::static_pointer_cast<ChronoMessages::VehicleMessage>(compressionClient->popSimMessage());
+        packetArrived &= vehicle->idnumber() == i;
+    }
+    ChCompressionStats serverStats = compressionServer->compressionStats();
+    if (compressionClient->compressionAgreed() && compressedVehicle &&
+        compressedVehicle->SerializeAsString() == fragmentVehicle.SerializeAsString() && receivedPacket &&
+        receivedPacket->SerializeAsString() == packetBytes && packetArrived &&
+        compressionClient->compressionStats().messages >= 1 && serverStats.messages == 1 &&
+        serverStats.bytesOut < serverStats.bytesIn) {
+        std::cout << "PASSED -- Compression test 2" << std::endl;
+    } else std::cout << "FAILED -- Compression test 2" << std::endl;
+
+    // A client holding another dictionary is answered uncompressed
+    auto otherCompressor = std::make_shared<ChPacketCompressor>("another dictionary");
+    ChClientHandler *otherClient = new ChClientHandler("localhost", "8082", otherCompressor);
+    otherClient->beginListen();
+    otherClient->beginSend();
+    otherClient->pushMessage(fragmentVehicle);
+    auto otherPair = compressionServer->popMessage();
+    compressionServer->pushMessage(otherPair.first, compressedPacket);
+    bool otherArrived = true;
+    for (int i = 0; i < 100; i++) {
+        auto vehicle = std::static_pointer_cast<ChronoMessages::VehicleMessage>(otherClient->popSimMessage());
+        otherArrived &= vehicle->idnumber() == i;
+    }
+    if (!otherClient->compressionAgreed() && otherPair.second && otherArrived &&
+        otherClient->compressionStats().messages == 0 && compressionServer->compressionStats().messages == 1) {
+        std::cout << "PASSED -- Compression test 3" << std::endl;
+    } else std::cout << "FAILED -- Compression test 3" << std::endl;
+
+    delete otherClient;
+    delete compressionClient;
+    delete compressionServer;
+
+    // Control messages over the reliable channel
+    ChServerHandler *reliableServer = new ChServerHandler(world, worldQueue, 8082);
+    reliableServer->beginListen();
+    reliableServer->beginSend();
+    ChClientHandler *reliableClient = new ChClientHandler("localhost", "8082");
+    reliableClient->beginListen();
+    reliableClient->beginSend();
+
+    ChronoMessages::ControlMessage removal;
+    removal.set_connectionnumber(reliableClient->connectionNumber());
+    removal.set_idnumber(7);
+    removal.set_action(ChronoMessages::ControlMessage::REMOVE_VEHICLE);
+    reliableClient->pushMessage(removal);
+    auto removalPair = reliableServer->popMessage();
+    auto receivedRemoval = std::dynamic_pointer_cast<ChronoMessages::ControlMessage>(removalPair.second);
+    reliableServer->pushMessage(removalPair.first, removal);
+    auto echoedRemoval = std::dynamic_pointer_cast<ChronoMessages::ControlMessage>(reliableClient->popSimMessage());
+    if (receivedRemoval && receivedRemoval->idnumber() == 7 && echoedRemoval && echoedRemoval->idnumber() == 7) {
+        std::cout << "PASSED -- Reliable channel test 4" << std::endl;
+    } else std::cout << "FAILED -- Reliable channel test 4" << std::endl;
+
+    // A snapshot is acknowledged, and its removals reach the simulation
+    ChronoMessages::MessagePacket snapshotPacket;
+    snapshotPacket.set_connectionnumber(-1);
+    snapshotPacket.set_snapshot(5);
+    snapshotPacket.set_baseline(3);
+    *snapshotPacket.add_removals() = removal;
+    reliableServer->pushMessage(removalPair.first, snapshotPacket);
+    auto snapshotRemoval = std::dynamic_pointer_cast<ChronoMessages::ControlMessage>(reliableClient->popSimMessage());
+    auto ack = std::dynamic_pointer_cast<ChronoMessages::SnapshotAck>(reliableServer->popMessage().second);
+    if (snapshotRemoval && snapshotRemoval->idnumber() == 7 && ack && ack->snapshot() == 5 &&
+        ack->connectionnumber() == reliableClient->connectionNumber()) {
+        std::cout << "PASSED -- Snapshot ack test 1" << std::endl;
+    } else std::cout << "FAILED -- Snapshot ack test 1" << std::endl;
+
+    bool disconnected = reliableClient->disconnect();
+    auto disconnectPair = reliableServer->popMessage();
+    auto receivedDisconnect = std::dynamic_pointer_cast<ChronoMessages::ControlMessage>(disconnectPair.second);
+    if (disconnected && receivedDisconnect && receivedDisconnect->action() == ChronoMessages::ControlMessage::DISCONNECT) {
+        std::cout << "PASSED -- Reliable channel test 5" << std::endl;
+    } else std::cout << "FAILED -- Reliable channel test 5" << std::endl;
+
+    delete reliableClient;
+    delete reliableServer;
+
     // Client Communication tests //////////////////////////////////////////////////////////////////////
 
     std::string Dmessage1 = "Yeeeeaaaahhhh boiiiiiiiiiiiiiii";
+    boost::asio::ip::udp::socket udpSocket(ioService);
+    udpSocket.open(boost::asio::ip::udp::v4());
+    udpSocket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 8082));
+
     std::thread client3([&] {
         try {
             ChClientHandler clientHandler("localhost", "8082");
@@ -288,38 +1417,16 @@ int main(int argc, char **argv) {
         }
     });
 
-    boost::asio::ip::tcp::acceptor acceptor2(ioService, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 8082));
-    boost::asio::ip::tcp::socket tcpSocket4(ioService);
-    acceptor2.accept(tcpSocket4);
-
-
-    tcpSocket4.receive(boost::asio::buffer(&requestMessage, sizeof(uint8_t)));
-    tcpSocket4.send(boost::asio::buffer(&acceptMessage, sizeof(uint8_t)));
-    tcpSocket4.send(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
-
-    boost::asio::ip::tcp::endpoint tcpEndpoint = tcpSocket4.remote_endpoint();
-    boost::asio::ip::udp::endpoint udpEndpoint(tcpEndpoint.address(), tcpEndpoint.port());
-
-    tcpSocket4.close();
-    acceptor2.close();
-
-    boost::asio::ip::udp::socket udpSocket(ioService);
-    udpSocket.open(boost::asio::ip::udp::v4());
-    udpSocket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 8082));
+    boost::asio::ip::udp::endpoint recEndpoint = answerHandshake(udpSocket, CONNECTION_ACCEPT, 0);
 
     boost::asio::streambuf buff;
     udpSocket.receive(boost::asio::null_buffers());
     int available = udpSocket.available();
-    boost::asio::ip::udp::endpoint recEndpoint;
     size_t recSize = udpSocket.receive_from(buff.prepare(available), recEndpoint);
-    std::istream inStream(&buff);
 
     uint8_t inMessageType;
-    buff.commit(sizeof(uint8_t));
-    inStream >> inMessageType;
-    buff.commit(recSize - 1);
     ChronoMessages::DSRCMessage pack;
-    pack.ParseFromIstream(&inStream);
+    parseWithHeader(buff, recSize, inMessageType, pack);
 
     if (pack./*dsrcmessages(0).*/buffer().compare(Dmessage1) == 0) {
         std::cout << "PASSED -- Client communication test 1" << std::endl;
@@ -367,9 +1474,7 @@ int main(int argc, char **argv) {
     packet.add_vehiclemessages();
     packet.mutable_vehiclemessages(2)->CopyFrom(vehicle);
 
-    uint8_t messageType = MESSAGE_PACKET;
-    outStream << messageType;
-    packet.SerializeToOstream(&outStream);
+    serializeWithHeader(outStream, MESSAGE_PACKET, packet);
     sentSize = udpSocket.send_to(buffer.data(), recEndpoint);
     buffer.consume(sentSize);
 
@@ -436,22 +1541,12 @@ int main(int argc, char **argv) {
 
     std::unique_lock<std::mutex> lock(initMutex);
     var.wait(lock, [&] { return isReady; });
-    boost::asio::ip::tcp::socket tcpSocket5(ioService);
-    boost::asio::connect(tcpSocket5, endpointIterator);
-
-    connectionRequest = CONNECTION_REQUEST;
-    tcpSocket5.send(boost::asio::buffer(&connectionRequest, sizeof(uint8_t)));
-    tcpSocket5.receive(boost::asio::buffer(&requestResponse, sizeof(uint8_t)));
-    tcpSocket5.receive(boost::asio::buffer(&connectionNumber, sizeof(uint32_t)));
-
-    tcpSocket5.close();
     boost::asio::ip::udp::socket udpSocket2(ioService);
-
-    boost::asio::ip::udp::resolver udpResolver(ioService);
-    boost::asio::ip::udp::resolver::query udpQuery(boost::asio::ip::udp::v4(), "localhost", "8082");
-    boost::asio::ip::udp::endpoint serverEndpoint = *udpResolver.resolve(udpQuery);
     udpSocket2.open(boost::asio::ip::udp::v4());
 
+    exchangeHandshake(udpSocket2, serverEndpoint, CONNECTION_REQUEST, 0, replyType, cookie);
+    exchangeHandshake(udpSocket2, serverEndpoint, CONNECTION_REQUEST, cookie, replyType, connectionNumber);
+
     // Comm test 1
 
     serializeVehicle(outStream, sendVehicle);
@@ -470,35 +1565,25 @@ int main(int argc, char **argv) {
     udpSocket2.receive_from(boost::asio::null_buffers(), serverEndpoint);
     available = udpSocket2.available();
     recSize = udpSocket2.receive_from(newBuffer.prepare(available), serverEndpoint);
-    std::istream newIstream(&newBuffer);
-
-    newBuffer.commit(sizeof(uint8_t));
-    newIstream >> inMessageType;
-    newBuffer.commit(recSize - 1);
     ChronoMessages::MessagePacket recPacket;
-    recPacket.ParseFromIstream(&newIstream);
+    parseWithHeader(newBuffer, recSize, inMessageType, recPacket);
     if (recPacket.DebugString().compare(packet.DebugString()) == 0 && inMessageType == MESSAGE_PACKET) {
         std::cout << "PASSED -- Server communication test 3" << std::endl;
     } else std::cout << "FAILED -- Server communication test 3" << std::endl;
 
     // Comm test 5
 
-    messageType = MESSAGE_PACKET;
-    outStream << messageType;
-    packet.SerializeToOstream(&outStream);
+    serializeWithHeader(outStream, MESSAGE_PACKET, packet);
     sentSize = udpSocket2.send_to(buffer.data(), serverEndpoint);
     buffer.consume(sentSize);
 
     // Comm test 4
     boost::asio::streambuf anotherBuffer;
-    std::istream anotherIstream(&anotherBuffer);
     udpSocket2.receive_from(boost::asio::null_buffers(), serverEndpoint);
     available = udpSocket2.available();
     recSize = udpSocket2.receive_from(anotherBuffer.prepare(available), serverEndpoint);
-    anotherBuffer.commit(recSize);
-    anotherIstream >> inMessageType;
     ChronoMessages::VehicleMessage recVehicle;
-    recVehicle.ParseFromIstream(&anotherIstream);
+    parseWithHeader(anotherBuffer, recSize, inMessageType, recVehicle);
     if (recVehicle.DebugString().compare(sendVehicle.DebugString()) == 0 && inMessageType == VEHICLE_MESSAGE) {
         std::cout << "PASSED -- Server communication test 4" << std::endl;
     } else std::cout << "FAILED -- Server communication test 4" << std::endl;